@@ -0,0 +1,175 @@
+#include <plorth/plorth.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  class small_object : public plorth::memory::managed
+  {
+  public:
+    explicit small_object(std::size_t value)
+      : m_value(value) {}
+
+  private:
+    std::size_t m_value;
+  };
+
+  struct raw_object
+  {
+    std::size_t value;
+  };
+}
+
+/** Number of objects each thread keeps alive at once. */
+static const std::size_t batch_size = 256;
+
+/** Number of batches each thread allocates and releases. */
+static const std::size_t batch_count = 2000;
+
+/**
+ * Runs given callback in given number of threads at once, and returns the
+ * number of milliseconds it took for all of them to finish.
+ */
+template<class Callback>
+static double measure(std::size_t thread_count, Callback callback)
+{
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < thread_count; ++i)
+  {
+    threads.emplace_back(callback, i);
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  return std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start
+  ).count();
+}
+
+/**
+ * Each thread allocates batches of objects and releases them itself.
+ */
+static double local_frees(plorth::memory::manager& manager,
+                          std::size_t thread_count)
+{
+  return measure(thread_count, [&manager](std::size_t)
+  {
+    std::vector<small_object*> objects(batch_size);
+
+    for (std::size_t i = 0; i < batch_count; ++i)
+    {
+      for (std::size_t j = 0; j < batch_size; ++j)
+      {
+        objects[j] = new (manager) small_object(j);
+      }
+      for (const auto object : objects)
+      {
+        delete object;
+      }
+    }
+  });
+}
+
+/**
+ * Same as local_frees(), but using the system allocator for reference.
+ */
+static double system_frees(std::size_t thread_count)
+{
+  return measure(thread_count, [](std::size_t)
+  {
+    std::vector<raw_object*> objects(batch_size);
+
+    for (std::size_t i = 0; i < batch_count; ++i)
+    {
+      for (std::size_t j = 0; j < batch_size; ++j)
+      {
+        objects[j] = new raw_object { j };
+      }
+      for (const auto object : objects)
+      {
+        delete object;
+      }
+    }
+  });
+}
+
+/**
+ * Each thread allocates batches of objects and hands them over to the next
+ * thread, which releases them. Threads are paired so that every object is
+ * released by a different thread than the one which allocated it.
+ */
+static double remote_frees(plorth::memory::manager& manager,
+                           std::size_t thread_count)
+{
+  const auto slots = thread_count < 2 ? 2 : thread_count;
+  std::vector<std::vector<small_object*>> handed(slots * batch_count);
+
+  // Allocation happens before the threads release anything, so that the
+  // release phase only measures cross thread deallocation.
+  const auto allocation = measure(slots, [&manager, &handed](std::size_t i)
+  {
+    for (std::size_t j = 0; j < batch_count; ++j)
+    {
+      auto& objects = handed[i * batch_count + j];
+
+      objects.reserve(batch_size);
+      for (std::size_t k = 0; k < batch_size; ++k)
+      {
+        objects.push_back(new (manager) small_object(k));
+      }
+    }
+  });
+
+  return allocation + measure(slots, [&handed, slots](std::size_t i)
+  {
+    const auto other = (i + 1) % slots;
+
+    for (std::size_t j = 0; j < batch_count; ++j)
+    {
+      for (const auto object : handed[other * batch_count + j])
+      {
+        delete object;
+      }
+    }
+  });
+}
+
+int main(int argc, char** argv)
+{
+  static const std::size_t thread_counts[] = { 1, 2, 4, 8 };
+  const double operations = static_cast<double>(batch_size * batch_count);
+
+  std::printf(
+    "%8s %16s %16s %16s\n",
+    "threads",
+    "local Mops/s",
+    "remote Mops/s",
+    "system Mops/s"
+  );
+  for (const auto thread_count : thread_counts)
+  {
+    plorth::memory::manager manager;
+    const auto total = operations * thread_count;
+    const auto local = local_frees(manager, thread_count);
+    const auto remote = remote_frees(manager, thread_count);
+    const auto system = system_frees(thread_count);
+
+    std::printf(
+      "%8zu %16.2f %16.2f %16.2f\n",
+      thread_count,
+      total / local / 1000,
+      operations * (thread_count < 2 ? 2 : thread_count) / remote / 1000,
+      total / system / 1000
+    );
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include <plorth/plorth.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+/**
+ * Compiles and executes given source code in given context, returning the
+ * number of milliseconds it took, or a negative number if the execution
+ * failed.
+ */
+static double measure(const plorth::ref<plorth::context>& ctx,
+                      const std::u32string& source)
+{
+  const auto quote = ctx->compile(source);
+  const auto start = std::chrono::steady_clock::now();
+
+  if (!quote || !quote->call(ctx))
+  {
+    return -1;
+  }
+  ctx->clear();
+
+  return std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start
+  ).count();
+}
+
+static std::u32string make_source(const char32_t* quote,
+                                  std::size_t count,
+                                  const char32_t* word)
+{
+  const auto number = std::to_string(count);
+
+  return std::u32string(quote)
+    + U" 0 "
+    + std::u32string(std::begin(number), std::end(number))
+    + U" range >array "
+    + word;
+}
+
+int main(int argc, char** argv)
+{
+  static const std::size_t worker_counts[] = { 1, 2, 4, 8 };
+  static const struct
+  {
+    const char32_t* quote;
+    const char32_t* sequential;
+    const char32_t* parallel;
+    const char* name;
+  } words[] =
+  {
+    { U"(dup dup * swap 7 % +)", U"map", U"pmap", "pmap" },
+    { U"(dup dup * swap 7 % + 2 % 0 =)", U"filter", U"pfilter", "pfilter" },
+    { U"(+)", U"reduce", U"preduce", "preduce" },
+  };
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto ctx = plorth::context::make(runtime);
+
+  std::printf("%8s %10s %12s", "word", "elements", "serial ms");
+  for (const auto workers : worker_counts)
+  {
+    std::printf(" %9zu ms", workers);
+  }
+  std::printf("\n");
+
+  for (const auto& word : words)
+  {
+    for (const std::size_t count : { 1000, 100000, 1000000 })
+    {
+      std::printf(
+        "%8s %10zu %12.3f",
+        word.name,
+        count,
+        measure(ctx, make_source(word.quote, count, word.sequential))
+      );
+      for (const auto workers : worker_counts)
+      {
+        runtime->concurrency(workers);
+        std::printf(
+          " %12.3f",
+          measure(ctx, make_source(word.quote, count, word.parallel))
+        );
+      }
+      std::printf("\n");
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+#include <plorth/plorth.hpp>
+
+#include <search.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+/**
+ * Substring search as it was implemented by the string words before the
+ * vectorized search: nested loops over virtual at().
+ */
+static std::size_t naive_index_of(const plorth::string& str,
+                                  const plorth::string& substr)
+{
+  const auto str_length = str.length();
+  const auto substr_length = substr.length();
+
+  for (std::size_t i = 0; i + substr_length <= str_length; ++i)
+  {
+    bool found = true;
+
+    for (std::size_t j = 0; j < substr_length; ++j)
+    {
+      if (str.at(i + j) != substr.at(j))
+      {
+        found = false;
+        break;
+      }
+    }
+    if (found)
+    {
+      return i;
+    }
+  }
+
+  return plorth::search::npos;
+}
+
+/**
+ * Constructs log-like payload of given length from lines of random lower
+ * case words.
+ */
+static std::u32string make_haystack(std::size_t length)
+{
+  std::mt19937 rng(42);
+  std::u32string result;
+
+  result.reserve(length);
+  while (result.length() < length)
+  {
+    const auto c = rng() % 32;
+
+    if (c < 26)
+    {
+      result += static_cast<char32_t>(U'a' + c);
+    }
+    else if (c < 31)
+    {
+      result += U' ';
+    } else {
+      result += U'\n';
+    }
+  }
+
+  return result;
+}
+
+template<class Callback>
+static double measure(int rounds, Callback callback)
+{
+  const auto start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < rounds; ++i)
+  {
+    callback();
+  }
+
+  return std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start
+  ).count() / rounds;
+}
+
+int main(int argc, char** argv)
+{
+  static const std::size_t haystack_length = 4 * 1024 * 1024;
+  static const int rounds = 5;
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto text = make_haystack(haystack_length);
+  const auto haystack = runtime->string(text);
+  const std::vector<std::uint8_t> latin1(std::begin(text), std::end(text));
+
+  std::printf("%8s %12s %12s %12s %12s\n", "needle", "naive ms", "find ms",
+              "rfind ms", "latin-1 ms");
+  for (const std::size_t needle_length : { 1, 3, 8, 16, 64, 255, 256, 1024 })
+  {
+    // Needle is taken from the end of the haystack and then made unique by
+    // replacing its last character, so that every search has to scan the
+    // whole haystack.
+    auto pattern = text.substr(haystack_length - needle_length);
+    std::size_t naive_result = 0;
+    std::size_t find_result = 0;
+    std::size_t rfind_result = 0;
+    std::size_t latin1_result = 0;
+
+    pattern.back() = U'#';
+
+    const std::vector<std::uint8_t> latin1_pattern(
+      std::begin(pattern),
+      std::end(pattern)
+    );
+
+    const auto needle = runtime->string(pattern);
+    const auto naive = measure(rounds, [&]()
+    {
+      naive_result = naive_index_of(*haystack, *needle);
+    });
+    const auto find = measure(rounds, [&]()
+    {
+      find_result = plorth::search::find(
+        text.data(),
+        text.length(),
+        pattern.data(),
+        pattern.length()
+      );
+    });
+    const auto rfind = measure(rounds, [&]()
+    {
+      rfind_result = plorth::search::rfind(
+        text.data(),
+        text.length(),
+        pattern.data(),
+        pattern.length()
+      );
+    });
+    const auto latin1_find = measure(rounds, [&]()
+    {
+      latin1_result = plorth::search::find(
+        latin1.data(),
+        latin1.size(),
+        latin1_pattern.data(),
+        latin1_pattern.size()
+      );
+    });
+
+    if (naive_result != find_result
+        || latin1_result != find_result
+        || rfind_result != plorth::search::npos)
+    {
+      std::fprintf(stderr, "Search results differ.\n");
+
+      return EXIT_FAILURE;
+    }
+    std::printf("%8zu %12.3f %12.3f %12.3f %12.3f\n", needle_length, naive,
+                find, rfind, latin1_find);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+#include <plorth/plorth.hpp>
+
+#include <sort.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+struct entry
+{
+  double key;
+  std::size_t index;
+};
+
+static bool entry_less(const entry& a, const entry& b)
+{
+  return a.key < b.key;
+}
+
+/**
+ * Constructs entries with random keys drawn from a small range, so that
+ * there are plenty of equal keys whose order tells whether the sort was
+ * stable. Every nan_every:th key is replaced with NaN when requested.
+ */
+static std::vector<entry> make_entries(std::size_t count,
+                                       std::size_t nan_every = 0)
+{
+  std::mt19937 rng(42);
+  std::vector<entry> result(count);
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    result[i].key = rng() % (count / 8 + 1);
+    result[i].index = i;
+    if (nan_every && i % nan_every == 0)
+    {
+      result[i].key = std::numeric_limits<double>::quiet_NaN();
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Tests whether the entries are a permutation of the original ones, which
+ * has to hold even when the keys cannot be ordered.
+ */
+static bool is_permutation(const std::vector<entry>& entries)
+{
+  std::vector<bool> seen(entries.size());
+
+  for (const auto& e : entries)
+  {
+    if (e.index >= entries.size() || seen[e.index])
+    {
+      return false;
+    }
+    seen[e.index] = true;
+  }
+
+  return true;
+}
+
+static bool same_order(const std::vector<entry>& a,
+                       const std::vector<entry>& b)
+{
+  return std::equal(
+    std::begin(a),
+    std::end(a),
+    std::begin(b),
+    [](const entry& x, const entry& y)
+    {
+      return x.index == y.index;
+    }
+  );
+}
+
+template<class Callback>
+static double measure(Callback callback)
+{
+  const auto start = std::chrono::steady_clock::now();
+
+  callback();
+
+  return std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start
+  ).count();
+}
+
+int main(int argc, char** argv)
+{
+  static const std::size_t worker_counts[] = { 1, 2, 4, 8 };
+
+  std::printf("%10s %12s", "elements", "std ms");
+  for (const auto workers : worker_counts)
+  {
+    std::printf(" %9zu ms", workers);
+  }
+  std::printf("\n");
+
+  for (const std::size_t count : { 1000, 100000, 1000000, 4000000 })
+  {
+    const auto original = make_entries(count);
+    auto expected = original;
+
+    std::printf("%10zu %12.3f", count, measure([&]()
+    {
+      std::stable_sort(std::begin(expected), std::end(expected), entry_less);
+    }));
+
+    for (const auto workers : worker_counts)
+    {
+      auto sorted = original;
+      auto with_nans = make_entries(count, 7);
+      const auto time = measure([&]()
+      {
+        plorth::sort::stable_sort(sorted, entry_less, workers);
+      });
+
+      plorth::sort::stable_sort(with_nans, entry_less, workers);
+      if (!same_order(sorted, expected) || !is_permutation(with_nans))
+      {
+        std::fprintf(stderr, "Sort with %zu workers is incorrect.\n", workers);
+
+        return EXIT_FAILURE;
+      }
+      std::printf(" %12.3f", time);
+    }
+    std::printf("\n");
+  }
+
+  return EXIT_SUCCESS;
+}
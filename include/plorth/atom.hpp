@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <plorth/config.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace plorth
+{
+  /**
+   * Atom is an interned identifier. Each distinct identifier string is stored
+   * only once in a process wide table and given a small integer ID, so atoms
+   * can be compared and hashed as integers. Atoms are used as names of
+   * symbols, keys of dictionaries and keys of object properties.
+   *
+   * Entries of the table are reference counted. Once the last atom of an
+   * identifier is destroyed, the identifier is removed from the table and
+   * it's ID can be given to another identifier. This way property names
+   * built from data, as well as identifiers of runtimes which no longer
+   * exist, do not stay in the table for the rest of the process.
+   */
+  class atom
+  {
+  public:
+    using id_type = std::uint32_t;
+
+    /**
+     * Constructs atom for empty identifier.
+     */
+    atom();
+
+    /**
+     * Constructs atom for given identifier, adding the identifier into the
+     * atom table if it's not already there.
+     */
+    atom(const std::u32string& name);
+
+    /**
+     * Constructs atom for given identifier, adding the identifier into the
+     * atom table if it's not already there.
+     */
+    atom(const char32_t* name);
+
+    atom(const atom& that)
+      : m_entry(that.m_entry)
+    {
+      retain();
+    }
+
+    atom(atom&& that)
+      : m_entry(that.m_entry)
+    {
+      that.m_entry = nullptr;
+    }
+
+    ~atom()
+    {
+      release();
+    }
+
+    atom& operator=(const atom& that)
+    {
+      if (m_entry != that.m_entry)
+      {
+        that.retain();
+        release();
+        m_entry = that.m_entry;
+      }
+
+      return *this;
+    }
+
+    atom& operator=(atom&& that)
+    {
+      if (this != &that)
+      {
+        release();
+        m_entry = that.m_entry;
+        that.m_entry = nullptr;
+      }
+
+      return *this;
+    }
+
+    /**
+     * Looks for existing atom without adding the identifier into the atom
+     * table.
+     *
+     * \param name Identifier to look for.
+     * \param slot Where the atom will be placed into, if it exists.
+     * \return     Boolean flag which tells whether the atom exists or not.
+     */
+    static bool find(const std::u32string& name, atom& slot);
+
+    /**
+     * Returns atom for given identifier which is never removed from the atom
+     * table, so that it's ID can be stored without keeping the atom around.
+     * Used for names of source code files.
+     */
+    static atom persistent(const std::u32string& name);
+
+    /**
+     * Returns atom which has given ID. The ID must belong to an atom which
+     * still exists, or to one returned by persistent().
+     */
+    static atom from_id(id_type id);
+
+    /**
+     * Returns the integer ID of the atom.
+     */
+    inline id_type id() const
+    {
+      return m_entry->id;
+    }
+
+    /**
+     * Returns the identifier which the atom represents.
+     */
+    inline const std::u32string& name() const
+    {
+      return m_entry->name;
+    }
+
+    inline bool operator==(const atom& that) const
+    {
+      return m_entry == that.m_entry;
+    }
+
+    inline bool operator!=(const atom& that) const
+    {
+      return m_entry != that.m_entry;
+    }
+
+  private:
+    /** Entry of the atom table. */
+    struct entry
+    {
+      std::u32string name;
+      id_type id;
+      /** Number of atoms referring to the entry. */
+      mutable std::atomic<std::size_t> references;
+      /** Whether the entry is never removed from the table. */
+      bool persistent;
+      /** Whether the entry currently is in the table. */
+      bool used;
+
+      explicit entry(id_type id)
+        : id(id)
+        , references(0)
+        , persistent(false)
+        , used(false) {}
+    };
+    struct table;
+
+    /**
+     * Constructs atom from entry whose reference count has already been
+     * incremented for it.
+     */
+    explicit atom(const entry* e)
+      : m_entry(e) {}
+
+    inline void retain() const
+    {
+      if (m_entry && !m_entry->persistent)
+      {
+        m_entry->references.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    inline void release()
+    {
+      if (m_entry &&
+          !m_entry->persistent &&
+          m_entry->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        remove(m_entry);
+      }
+    }
+
+    static table& get_table();
+    static void remove(const entry* e);
+
+  private:
+    const entry* m_entry;
+  };
+}
+
+namespace std
+{
+  template<>
+  struct hash<plorth::atom>
+  {
+    using argument_type = plorth::atom;
+    using result_type = std::size_t;
+
+    inline result_type operator()(const argument_type& key) const
+    {
+      return static_cast<result_type>(key.id());
+    }
+  };
+}
@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <plorth/value-number.hpp>
+
+namespace plorth
+{
+  /**
+   * Cell is a slot in the data stack. Null, booleans and numbers are stored
+   * directly inside the cell without allocating any memory from the memory
+   * manager, while other values are stored as references. Immediate values
+   * are converted into boxed values only when they are needed as such.
+   */
+  class cell
+  {
+  public:
+    /**
+     * Enumeration of different ways a value can be stored in a cell.
+     */
+    enum class kind : unsigned char
+    {
+      /** Null value. */
+      null = 0,
+      /** Immediate boolean value. */
+      boolean = 1,
+      /** Immediate integer number. */
+      integer = 2,
+      /** Immediate real number. */
+      real = 3,
+      /** Reference to a value allocated from memory manager. */
+      boxed = 4
+    };
+
+    /**
+     * Constructs cell which contains null value.
+     */
+    cell() noexcept
+      : m_kind(kind::null)
+      , m_int(0) {}
+
+    /**
+     * Constructs cell which contains given value. Null references are
+     * stored as null values.
+     */
+    cell(const ref<class value>& value) noexcept;
+    cell(ref<class value>&& value) noexcept;
+
+    cell(const cell& that) noexcept;
+    cell(cell&& that) noexcept;
+    ~cell();
+
+    cell& operator=(const cell& that) noexcept;
+    cell& operator=(cell&& that) noexcept;
+
+    /**
+     * Constructs cell which contains immediate boolean value.
+     */
+    static inline cell make_boolean(bool value) noexcept
+    {
+      cell result;
+
+      result.m_kind = kind::boolean;
+      result.m_boolean = value;
+
+      return result;
+    }
+
+    /**
+     * Constructs cell which contains immediate integer number.
+     */
+    static inline cell make_int(number::int_type value) noexcept
+    {
+      cell result;
+
+      result.m_kind = kind::integer;
+      result.m_int = value;
+
+      return result;
+    }
+
+    /**
+     * Constructs cell which contains immediate real number.
+     */
+    static inline cell make_real(number::real_type value) noexcept
+    {
+      cell result;
+
+      result.m_kind = kind::real;
+      result.m_real = value;
+
+      return result;
+    }
+
+    /**
+     * Returns the way the value is stored in this cell.
+     */
+    inline enum kind kind() const noexcept
+    {
+      return m_kind;
+    }
+
+    /**
+     * Returns true if the cell contains a reference to a boxed value.
+     */
+    inline bool is_boxed() const noexcept
+    {
+      return m_kind == kind::boxed;
+    }
+
+    /**
+     * Returns type of the value contained in the cell.
+     */
+    inline enum value::type type() const
+    {
+      switch (m_kind)
+      {
+        case kind::null:
+          return value::type::null;
+
+        case kind::boolean:
+          return value::type::boolean;
+
+        case kind::integer:
+        case kind::real:
+          return value::type::number;
+
+        default:
+          return m_value->type();
+      }
+    }
+
+    /**
+     * Tests whether the cell contains value of given type.
+     */
+    inline bool is(enum value::type t) const
+    {
+      return type() == t;
+    }
+
+    /**
+     * Returns type of number contained in the cell. The cell must contain a
+     * number.
+     */
+    enum number::number_type number_type() const;
+
+    /**
+     * Tests whether the cell contains a number of given type.
+     */
+    inline bool is(enum number::number_type t) const
+    {
+      return number_type() == t;
+    }
+
+    /**
+     * Returns value of the boolean contained in the cell. The cell must
+     * contain a boolean.
+     */
+    bool as_boolean() const;
+
+    /**
+     * Returns value of number contained in the cell as integer. The cell
+     * must contain a number.
+     */
+    number::int_type as_int() const;
+
+    /**
+     * Returns value of number contained in the cell as floating point
+     * decimal. The cell must contain a number.
+     */
+    number::real_type as_real() const;
+
+    /**
+     * Returns reference to the boxed value contained in the cell. The cell
+     * must contain a boxed value.
+     */
+    inline const ref<class value>& boxed() const noexcept
+    {
+      return m_value;
+    }
+
+    /**
+     * Converts contents of the cell into a value reference. Immediate values
+     * are boxed using given runtime.
+     */
+    ref<class value> to_value(const ref<class runtime>& runtime) const &;
+    ref<class value> to_value(const ref<class runtime>& runtime) &&;
+
+    /**
+     * Determines prototype object of the value contained in the cell.
+     */
+    ref<object> prototype(const ref<class runtime>& runtime) const;
+
+    /**
+     * Tests whether two cells contain equal values.
+     */
+    bool equals(const cell& that) const;
+
+    /**
+     * Constructs string representation of the value contained in the cell.
+     */
+    std::u32string to_string() const;
+
+    /**
+     * Constructs source code representation of the value contained in the
+     * cell.
+     */
+    std::u32string to_source() const;
+
+  private:
+    void reset() noexcept;
+    void copy_immediate(const cell& that) noexcept;
+
+  private:
+    /** How the value is stored in this cell. */
+    enum kind m_kind;
+    union
+    {
+      bool m_boolean;
+      number::int_type m_int;
+      number::real_type m_real;
+      ref<class value> m_value;
+    };
+  };
+}
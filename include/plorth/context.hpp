@@ -25,10 +25,11 @@
  */
 #pragma once
 
+#include <plorth/cell.hpp>
 #include <plorth/runtime.hpp>
 #include <plorth/value-error.hpp>
 
-#include <deque>
+#include <vector>
 
 namespace plorth
 {
@@ -40,7 +41,7 @@ namespace plorth
   class context : public memory::managed
   {
   public:
-    using container_type = std::deque<std::shared_ptr<value>>;
+    using container_type = std::vector<cell>;
 
     /**
      * Constructs new context.
@@ -48,14 +49,35 @@ namespace plorth
      * \param runtime Runtime associated with this context.
      * \return        Reference to the created context.
      */
-    static std::shared_ptr<context> make(
-      const std::shared_ptr<class runtime>& runtime
+    static ref<context> make(
+      const ref<class runtime>& runtime
     );
 
+    /**
+     * Constructs new context which shares the runtime of this context and
+     * has a copy of its dictionary. Forked contexts are used for executing
+     * quotes in worker threads, concurrently with other forked contexts.
+     *
+     * \return Reference to the created context.
+     */
+    ref<context> fork() const;
+
+    /**
+     * Returns true if the context may be executed concurrently with other
+     * contexts, which is the case for forked contexts and for all contexts
+     * of a frozen runtime. Code executed in such context only fills caches
+     * which are shared between contexts, such as inline caches of compiled
+     * quotes, and never replaces their contents.
+     */
+    inline bool concurrent() const
+    {
+      return m_concurrent;
+    }
+
     /**
      * Returns the runtime associated with this context.
      */
-    inline const std::shared_ptr<class runtime>& runtime() const
+    inline const ref<class runtime>& runtime() const
     {
       return m_runtime;
     }
@@ -64,7 +86,7 @@ namespace plorth
      * Returns the currently uncaught error in this context or null reference
      * if this context has no error.
      */
-    inline const std::shared_ptr<class error>& error() const
+    inline const ref<class error>& error() const
     {
       return m_error;
     }
@@ -74,7 +96,7 @@ namespace plorth
      *
      * \param error Error instance to set as the currently uncaught error.
      */
-    inline void error(const std::shared_ptr<class error>& error)
+    inline void error(const ref<class error>& error)
     {
       m_error = error;
     }
@@ -132,10 +154,10 @@ namespace plorth
      * \return         Reference the quote that was compiled from given source,
      *                 or null reference if syntax error was encountered.
      */
-    std::shared_ptr<quote> compile(const std::u32string& source,
-                                   const std::u32string& filename = U"",
-                                   int line = 1,
-                                   int column = 1);
+    ref<quote> compile(const std::u32string& source,
+                       const std::u32string& filename = U"",
+                       int line = 1,
+                       int column = 1);
 
     /**
      * Provides direct access to the data stack.
@@ -180,30 +202,70 @@ namespace plorth
     /**
      * Pushes given value into the data stack.
      */
-    inline void push(const std::shared_ptr<class value>& value)
+    inline void push(const ref<class value>& value)
+    {
+      m_data.push_back(value);
+    }
+
+    /**
+     * Pushes given value into the data stack without touching it's reference
+     * count.
+     */
+    inline void push(ref<class value>&& value)
+    {
+      m_data.push_back(std::move(value));
+    }
+
+    /**
+     * Pushes given cell into the data stack.
+     */
+    inline void push(const cell& value)
     {
       m_data.push_back(value);
     }
 
+    /**
+     * Pushes given cell into the data stack.
+     */
+    inline void push(cell&& value)
+    {
+      m_data.push_back(std::move(value));
+    }
+
     /**
      * Pushes null value into the data stack.
      */
-    void push_null();
+    inline void push_null()
+    {
+      m_data.emplace_back();
+    }
 
     /**
-     * Pushes boolean value into the data stack.
+     * Pushes boolean value into the data stack. Booleans are stored in the
+     * data stack as immediate values.
      */
-    void push_boolean(bool value);
+    inline void push_boolean(bool value)
+    {
+      m_data.push_back(cell::make_boolean(value));
+    }
 
     /**
-     * Pushes integer number value into the data stack.
+     * Pushes integer number value into the data stack. Numbers are stored in
+     * the data stack as immediate values.
      */
-    void push_int(number::int_type value);
+    inline void push_int(number::int_type value)
+    {
+      m_data.push_back(cell::make_int(value));
+    }
 
     /**
-     * Pushes real number value into the data stack.
+     * Pushes real number value into the data stack. Numbers are stored in
+     * the data stack as immediate values.
      */
-    void push_real(number::real_type value);
+    inline void push_real(number::real_type value)
+    {
+      m_data.push_back(cell::make_real(value));
+    }
 
     /**
      * Pushes either integer or real number into stack, based on the given text
@@ -226,7 +288,7 @@ namespace plorth
      * Constructs array from given sequence of values and pushes it into the
      * data stack.
      */
-    void push_array(const std::vector<std::shared_ptr<value>>& elements);
+    void push_array(const std::vector<ref<value>>& elements);
 
     /**
      * Constructs array from given sequence of values and pushes it into the
@@ -250,14 +312,160 @@ namespace plorth
      * Constructs quote from given sequence of values and pushes it onto the
      * data stack.
      */
-    void push_quote(const std::vector<std::shared_ptr<value>>& values);
+    void push_quote(const std::vector<ref<value>>& values);
 
     /**
      * Constructs word from given pair of symbol and quote and pushes it onto
      * the data stack.
      */
-    void push_word(const std::shared_ptr<class symbol>& symbol,
-                   const std::shared_ptr<class quote>& quote);
+    void push_word(const ref<class symbol>& symbol,
+                   const ref<class quote>& quote);
+
+    /**
+     * Returns reference to value in the data stack without removing it. No
+     * bounds checking is performed.
+     *
+     * \param depth Distance from the top of the stack, where 0 refers to the
+     *              top-most value.
+     */
+    inline cell& peek(std::size_t depth = 0)
+    {
+      return m_data[m_data.size() - 1 - depth];
+    }
+
+    /**
+     * Returns reference to value in the data stack without removing it. No
+     * bounds checking is performed.
+     *
+     * \param depth Distance from the top of the stack, where 0 refers to the
+     *              top-most value.
+     */
+    inline const cell& peek(std::size_t depth = 0) const
+    {
+      return m_data[m_data.size() - 1 - depth];
+    }
+
+    /**
+     * Replaces top-most value of the data stack with given value. The stack
+     * must not be empty.
+     */
+    inline void replace_top(const cell& value)
+    {
+      m_data.back() = value;
+    }
+
+    /**
+     * Replaces top-most value of the data stack with given value. The stack
+     * must not be empty.
+     */
+    inline void replace_top(cell&& value)
+    {
+      m_data.back() = std::move(value);
+    }
+
+    /**
+     * Replaces top-most value of the data stack with given value. The stack
+     * must not be empty.
+     */
+    inline void replace_top(ref<class value>&& value)
+    {
+      m_data.back() = cell(std::move(value));
+    }
+
+    /**
+     * Removes the second top-most value from the data stack, so that the
+     * top-most value takes it's place. The stack must contain at least two
+     * values.
+     */
+    inline void nip()
+    {
+      m_data[m_data.size() - 2] = std::move(m_data.back());
+      m_data.pop_back();
+    }
+
+    /**
+     * Looks up value from given depth of the data stack without removing it.
+     * If the stack does not contain enough values, range error will be set.
+     *
+     * \param slot  Pointer where address of the value will be placed into.
+     *              It remains valid only until the stack is modified.
+     * \param depth Distance from the top of the stack.
+     * \return      Boolean flag that tells whether the operation was
+     *              successfull or not.
+     */
+    bool peek(const cell*& slot, std::size_t depth = 0);
+
+    /**
+     * Looks up value of certain type from given depth of the data stack
+     * without removing it. If the stack does not contain enough values,
+     * range error will be set. If the value is different type than expected,
+     * type error will be set.
+     *
+     * \param slot  Pointer where address of the value will be placed into.
+     *              It remains valid only until the stack is modified.
+     * \param type  Value type to be expected to be at given depth.
+     * \param depth Distance from the top of the stack.
+     * \return      Boolean flag that tells whether the operation was
+     *              successfull or not.
+     */
+    bool peek(const cell*& slot,
+              enum value::type type,
+              std::size_t depth = 0);
+
+    /**
+     * Looks up number from given depth of the data stack without removing
+     * it. Errors are set as with peek().
+     */
+    bool peek_number(const cell*& slot, std::size_t depth = 0);
+
+    /**
+     * Looks up string from given depth of the data stack without removing
+     * it. The pointer remains valid for as long as the string is kept in the
+     * stack. Errors are set as with peek().
+     */
+    bool peek_string(const string*& slot, std::size_t depth = 0);
+
+    /**
+     * Looks up array from given depth of the data stack without removing it.
+     * The pointer remains valid for as long as the array is kept in the
+     * stack. Errors are set as with peek().
+     */
+    bool peek_array(const array*& slot, std::size_t depth = 0);
+
+    /**
+     * Looks up object from given depth of the data stack without removing
+     * it. The pointer remains valid for as long as the object is kept in the
+     * stack. Errors are set as with peek().
+     */
+    bool peek_object(const object*& slot, std::size_t depth = 0);
+
+    /**
+     * Looks up symbol from given depth of the data stack without removing
+     * it. The pointer remains valid for as long as the symbol is kept in the
+     * stack. Errors are set as with peek().
+     */
+    bool peek_symbol(const symbol*& slot, std::size_t depth = 0);
+
+    /**
+     * Looks up quote from given depth of the data stack without removing it.
+     * The pointer remains valid for as long as the quote is kept in the
+     * stack. Errors are set as with peek().
+     */
+    bool peek_quote(const quote*& slot, std::size_t depth = 0);
+
+    /**
+     * Looks up word from given depth of the data stack without removing it.
+     * The pointer remains valid for as long as the word is kept in the stack.
+     * Errors are set as with peek().
+     */
+    bool peek_word(const word*& slot, std::size_t depth = 0);
+
+    /**
+     * Looks up error from given depth of the data stack without removing it.
+     * The pointer remains valid for as long as the error is kept in the
+     * stack. Errors are set as with peek().
+     */
+    bool peek_error(const class error*& slot, std::size_t depth = 0);
 
     /**
      * Pops value from the data stack and discards it. If the stack is empty,
@@ -281,13 +489,25 @@ namespace plorth
 
     /**
      * Pops value from the data stack and places it into given reference slot.
-     * If the stack is empty, range error will be set.
+     * If the stack is empty, range error will be set. Immediate values are
+     * boxed.
      *
      * \param slot Reference where the value will be placed into.
      * \return     Boolean flag that tells whether the operation was
      *             successfull or not.
      */
-    bool pop(std::shared_ptr<value>& slot);
+    bool pop(ref<value>& slot);
+
+    /**
+     * Pops value from the data stack and places it into given cell, without
+     * boxing immediate values. If the stack is empty, range error will be
+     * set.
+     *
+     * \param slot Cell where the value will be placed into.
+     * \return     Boolean flag that tells whether the operation was
+     *             successfull or not.
+     */
+    bool pop(cell& slot);
 
     /**
      * Pops value of certain type from the data stack and places it into given
@@ -299,7 +519,19 @@ namespace plorth
      * \return     Boolean flag that tells whether the operation was
      *             successfull or not.
      */
-    bool pop(std::shared_ptr<value>& slot, enum value::type type);
+    bool pop(ref<value>& slot, enum value::type type);
+
+    /**
+     * Pops value of certain type from the data stack and places it into given
+     * cell, without boxing immediate values. If the stack is empty, range
+     * error will be set. If the top value of the stack is different type than
+     * expected, type error will be set.
+     *
+     * \param slot Cell where the value will be placed into.
+     * \return     Boolean flag that tells whether the operation was
+     *             successfull or not.
+     */
+    bool pop(cell& slot, enum value::type type);
 
     /**
      * Pops boolean value from the data stack and places it into given slot. If
@@ -321,7 +553,19 @@ namespace plorth
      * \return     Boolean flag that tells whether the operation was
      *             successfull or not.
      */
-    bool pop_number(std::shared_ptr<number>& slot);
+    bool pop_number(ref<number>& slot);
+
+    /**
+     * Pops number value from the data stack and places it into given cell,
+     * without boxing it. If the stack is empty, range error will be set. If
+     * something else than number is as top-most value of the stack, type
+     * error will be set.
+     *
+     * \param slot Where the number value will be placed into.
+     * \return     Boolean flag that tells whether the operation was
+     *             successfull or not.
+     */
+    bool pop_number(cell& slot);
 
     /**
      * Pops string value from the data stack and places it into given slot. If
@@ -332,7 +576,7 @@ namespace plorth
      * \return     Boolean flag that tells whether the operation was
      *             successfull or not.
      */
-    bool pop_string(std::shared_ptr<string>& slot);
+    bool pop_string(ref<string>& slot);
 
     /**
      * Pops array value from the data stack and places it into given slot. If
@@ -343,7 +587,7 @@ namespace plorth
      * \return     Boolean flag that tells whether the operation was
      *             successfull or not.
      */
-    bool pop_array(std::shared_ptr<array>& slot);
+    bool pop_array(ref<array>& slot);
 
     /**
      * Pops object from the data stack and places it into given slot. If the
@@ -354,7 +598,7 @@ namespace plorth
      * \return     Boolean flag that tells whether the operation was
      *             successfull or not.
      */
-    bool pop_object(std::shared_ptr<object>& slot);
+    bool pop_object(ref<object>& slot);
 
     /**
      * Pops symbol from the data stack and places it into given slot. If the
@@ -365,7 +609,7 @@ namespace plorth
      * \return     Boolean flag that tells whether the operation was
      *             successfull or not.
      */
-    bool pop_symbol(std::shared_ptr<symbol>& slot);
+    bool pop_symbol(ref<symbol>& slot);
 
     /**
      * Pops quote from the data stack and places it into given slot. If the
@@ -376,7 +620,7 @@ namespace plorth
      * \return     Boolean flag that tells whether the operation was
      *             successfull or not.
      */
-    bool pop_quote(std::shared_ptr<quote>& slot);
+    bool pop_quote(ref<quote>& slot);
 
     /**
      * Pops word from the data stack and places it into given slot. If the
@@ -387,7 +631,18 @@ namespace plorth
      * \return     Boolean flag that tells whether the operation was
      *             successfull or not.
      */
-    bool pop_word(std::shared_ptr<word>& slot);
+    bool pop_word(ref<word>& slot);
+
+    /**
+     * Pops sequence from the data stack and places it into given slot. If
+     * the stack is empty, range error will be set. If something else than
+     * sequence is as top-most value of the stack, type error will be set.
+     *
+     * \param slot Where the sequence will be placed into.
+     * \return     Boolean flag that tells whether the operation was
+     *             successfull or not.
+     */
+    bool pop_seq(ref<seq>& slot);
 
 #if PLORTH_ENABLE_FILE_SYSTEM_MODULES
     /**
@@ -413,7 +668,7 @@ namespace plorth
      * Returns reference to a structure which has information about current
      * position in source code.
      */
-    inline struct parser::position& position()
+    inline struct source_position& position()
     {
       return m_position;
     }
@@ -422,24 +677,30 @@ namespace plorth
      * Returns reference to a structure which has information about current
      * position in source code.
      */
-    inline const struct parser::position& position() const
+    inline const struct source_position& position() const
     {
       return m_position;
     }
 
   protected:
+    /**
+     * Sets type error about the top-most value of the stack being of
+     * different type than expected.
+     */
+    void type_error(enum value::type expected, enum value::type actual);
+
     /**
      * Constructs new context.
      *
      * \param runtime Runtime associated with this context.
      */
-    explicit context(const std::shared_ptr<class runtime>& runtime);
+    explicit context(const ref<class runtime>& runtime);
 
   private:
     /** Runtime associated with this context. */
-    const std::shared_ptr<class runtime> m_runtime;
+    const ref<class runtime> m_runtime;
     /** Currently uncaught error in this context. */
-    std::shared_ptr<class error> m_error;
+    ref<class error> m_error;
     /** Data stack used for storing values in this context. */
     container_type m_data;
     /** Container for words associated with this context. */
@@ -449,6 +710,8 @@ namespace plorth
     std::u32string m_filename;
 #endif
     /** Current position in source code. */
-    struct parser::position m_position;
+    struct source_position m_position;
+    /** Whether the context is executed concurrently with other contexts. */
+    bool m_concurrent;
   };
 }
@@ -27,6 +27,7 @@
 
 #include <plorth/value-word.hpp>
 
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 
@@ -39,10 +40,11 @@ namespace plorth
   class dictionary
   {
   public:
-    using value_type = std::shared_ptr<word>;
+    using value_type = ref<word>;
     /** Underlying container type. */
-    using container_type = std::unordered_map<std::u32string, value_type>;
+    using container_type = std::unordered_map<atom, value_type>;
     using size_type = container_type::size_type;
+    using version_type = std::uint64_t;
 
     /**
      * Constructs new empty dictionary.
@@ -50,14 +52,12 @@ namespace plorth
     dictionary();
 
     /**
-     * Constructs copy of existing dictionary.
+     * Constructs copy of existing dictionary. The copy is never frozen, even
+     * if the original dictionary is.
      */
     dictionary(const dictionary& that);
 
-    /**
-     * Copies contents of another dictionary into this one.
-     */
-    dictionary& operator=(const dictionary& that);
+    dictionary& operator=(const dictionary& that) = delete;
 
     /**
      * Returns the number of words the dictionary contains.
@@ -67,6 +67,34 @@ namespace plorth
       return m_words.size();
     }
 
+    /**
+     * Returns version of the dictionary. The version changes whenever a word
+     * is inserted into the dictionary, and is unique across all dictionaries,
+     * so two dictionaries with same version always contain same words. This
+     * allows caching results of word lookups.
+     */
+    inline version_type version() const
+    {
+      return m_version;
+    }
+
+    /**
+     * Returns true if the dictionary has been frozen.
+     */
+    inline bool frozen() const
+    {
+      return m_frozen;
+    }
+
+    /**
+     * Freezes the dictionary, after which no words can be inserted into it.
+     * Frozen dictionary can be read from multiple threads at the same time.
+     */
+    inline void freeze()
+    {
+      m_frozen = true;
+    }
+
     /**
      * Returns words from the dictionary as iterable vector.
      */
@@ -77,7 +105,7 @@ namespace plorth
      * symbol. If no such word is found from the dictionary, null reference
      * will be returned instead.
      */
-    value_type find(const std::shared_ptr<symbol>& id) const;
+    value_type find(const ref<symbol>& id) const;
 
     /**
      * Searches for a word from the dictionary which symbol matches with given
@@ -86,14 +114,47 @@ namespace plorth
      */
     value_type find(const std::u32string& id) const;
 
+    /**
+     * Searches for a word from the dictionary which symbol matches with given
+     * string. If no such word is found from the dictionary, null reference
+     * will be returned instead.
+     */
+    inline value_type find(const char32_t* id) const
+    {
+      return find(std::u32string(id));
+    }
+
+    /**
+     * Searches for a word from the dictionary which symbol matches with given
+     * atom. If no such word is found from the dictionary, null reference will
+     * be returned instead.
+     */
+    value_type find(const atom& id) const;
+
     /**
      * Inserts given word into the dictionary. Existing words with identical
      * symbol will be overridden.
+     *
+     * \return Boolean flag which tells whether the word was inserted, which
+     *         is not the case when the dictionary is frozen.
+     */
+    bool insert(const value_type& word);
+
+    /**
+     * Replaces contents of the dictionary with contents of another
+     * dictionary.
+     *
+     * \return Boolean flag which tells whether the contents were replaced,
+     *         which is not the case when the dictionary is frozen.
      */
-    void insert(const value_type& word);
+    bool assign(const dictionary& that);
 
   private:
     /** Container for the words in the dictionary. */
     container_type m_words;
+    /** Current version of the dictionary. */
+    version_type m_version;
+    /** Whether the dictionary has been frozen. */
+    bool m_frozen;
   };
 }
@@ -25,7 +25,7 @@
  */
 #pragma once
 
-#include <plorth/memory.hpp>
+#include <plorth/ref.hpp>
 #include <plorth/unicode.hpp>
 
 namespace plorth
@@ -58,12 +58,12 @@ namespace plorth
        * the process, if standard I/O has been enabled. The input is expected
        * to be UTF-8 encoded.
        */
-      static std::shared_ptr<input> standard(memory::manager& memory_manager);
+      static ref<input> standard(memory::manager& memory_manager);
 
       /**
        * Constructs new input which reads nothing.
        */
-      static std::shared_ptr<input> dummy(memory::manager& memory_manager);
+      static ref<input> dummy(memory::manager& memory_manager);
 
       /**
        * Reads Unicode code points from the input and places them into the
@@ -25,7 +25,7 @@
  */
 #pragma once
 
-#include <plorth/memory.hpp>
+#include <plorth/ref.hpp>
 #include <plorth/unicode.hpp>
 
 namespace plorth
@@ -43,13 +43,13 @@ namespace plorth
        * stream (stdout) of the process, if standard I/O has been enabled. The
        * output will be encoded in UTF-8.
        */
-      static std::shared_ptr<output> standard(memory::manager& memory_manager);
+      static ref<output> standard(memory::manager& memory_manager);
 
       /**
        * Constructs new output which ignores everything that will be written
        * into it.
        */
-      static std::shared_ptr<output> dummy(memory::manager& memory_manager);
+      static ref<output> dummy(memory::manager& memory_manager);
 
       /**
        * Writes given Unicode string into the output.
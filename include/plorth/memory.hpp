@@ -28,7 +28,14 @@
 #include <plorth/config.hpp>
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#if PLORTH_ENABLE_ATOMIC_REFCOUNT || PLORTH_ENABLE_THREAD_CACHE
+# include <atomic>
+#endif
+#if PLORTH_ENABLE_MEMORY_POOL && PLORTH_ENABLE_MUTEXES
+# include <mutex>
+#endif
 
 namespace plorth
 {
@@ -37,8 +44,11 @@ namespace plorth
 
   namespace memory
   {
-    struct pool;
-    struct slot;
+    struct header;
+    struct slab;
+    struct large_block;
+    struct magazine;
+    struct thread_cache;
 
     /**
      * Memory manager manages memory pools used by the interpreter and is used
@@ -60,9 +70,17 @@ namespace plorth
       ~manager();
 
       /**
-       * Allocates memory for a managed object from memory pools of this memory
-       * manager. New memory pools are being created when previous ones are
-       * full.
+       * Allocates memory for a managed object from memory slabs of this memory
+       * manager. Each allocation is rounded up into a size class and served
+       * from the free list of that size class. New slabs are being created
+       * when previous ones are full. Objects which are too large for any size
+       * class are allocated directly from the system allocator.
+       *
+       * When thread caches are enabled, each thread which allocates from the
+       * manager keeps free slots of each size class in a cache of its own,
+       * which is refilled from the slabs in batches. Allocation and
+       * deallocation only need to lock the manager when the cache of the
+       * thread runs empty or becomes full.
        *
        * \param size Size of the object to allocate memory for.
        * \return     Pointer to the allocated memory.
@@ -75,11 +93,91 @@ namespace plorth
       void operator=(manager&&) = delete;
 
 #if PLORTH_ENABLE_MEMORY_POOL
+      /** Number of different size classes used by the memory manager. */
+      static constexpr std::size_t size_class_count = 28;
+
     private:
-      /** Pointer to the first memory pool used by this manager. */
-      pool* m_pool_head;
-      /** Pointer to the last memory pool used by this manager. */
-      pool* m_pool_tail;
+      /**
+       * Releases memory used by an managed object back to the memory manager
+       * which allocated it.
+       */
+      static void deallocate(void* pointer);
+
+      friend class managed;
+# if PLORTH_ENABLE_MUTEXES && PLORTH_ENABLE_THREAD_CACHE
+      friend struct thread_cache_list;
+# endif
+
+      /**
+       * Allocates memory for an object too large for any size class.
+       */
+      void* allocate_large(std::size_t size);
+
+      /**
+       * Takes free slot of given size class from the slabs, creating a new
+       * slab if there are no free slots left.
+       */
+      header* take_slot(std::size_t size_class);
+
+      /**
+       * Places slot back into the free list of its slab, and releases the
+       * slab if it is no longer used.
+       */
+      void return_slot(header* hdr);
+
+# if PLORTH_ENABLE_MUTEXES && PLORTH_ENABLE_THREAD_CACHE
+      /**
+       * Returns cache of the calling thread for this manager, constructing
+       * it if the thread does not have one yet.
+       */
+      thread_cache* local_cache();
+
+      /**
+       * Moves batch of free slots from the slabs into the magazine.
+       */
+      void refill(magazine& magazine, std::size_t size_class);
+
+      /**
+       * Returns given number of slots from the magazine back into the slabs.
+       */
+      void flush(magazine& magazine, std::uint32_t count);
+
+      /**
+       * Returns slots released by threads without a cache back into the
+       * slabs. Must be called while the manager is locked.
+       */
+      void drain_remote_frees();
+# endif
+
+      /**
+       * Slabs which still have free slots in them, one linked list for each
+       * size class.
+       */
+      slab* m_partial[size_class_count];
+      /** Pointer to the first slab allocated by this manager. */
+      slab* m_slab_head;
+      /** Pointer to the first large object allocated by this manager. */
+      large_block* m_large_head;
+      /**
+       * Flag which tells whether the manager is currently being destroyed, in
+       * which case no memory is being returned to the system until all
+       * objects have been destroyed.
+       */
+      bool m_destroying;
+# if PLORTH_ENABLE_MUTEXES
+      /** Used to implement thread safety in allocation and deallocation. */
+      std::mutex m_mutex;
+# endif
+# if PLORTH_ENABLE_MUTEXES && PLORTH_ENABLE_THREAD_CACHE
+      /** Thread caches which currently hold slots of this manager. */
+      thread_cache* m_caches;
+      /**
+       * Slots released by threads which do not have a cache for this
+       * manager, linked through their memory. Slots are pushed without
+       * locking and returned into the slabs when a cache is being refilled.
+       */
+      std::atomic<header*> m_remote_free;
+# endif
 #endif
     };
 
@@ -89,10 +187,17 @@ namespace plorth
      *
      * Instances of classes which derive from this class should always be
      * wrapped into references, as they keep track of the usage of the object.
+     * Reference count of the object is stored in the object itself.
      */
     class managed
     {
     public:
+#if PLORTH_ENABLE_ATOMIC_REFCOUNT
+      using ref_count_type = std::atomic<std::size_t>;
+#else
+      using ref_count_type = std::size_t;
+#endif
+
       /**
        * Constructs new managed object with zero references.
        */
@@ -107,45 +212,109 @@ namespace plorth
       void* operator new(std::size_t size, class manager& manager);
       void operator delete(void* pointer);
 
+      /**
+       * Increments reference count of the object.
+       */
+      inline void retain() const noexcept
+      {
+#if PLORTH_ENABLE_ATOMIC_REFCOUNT
+        m_ref_count.fetch_add(1, std::memory_order_relaxed);
+#else
+        ++m_ref_count;
+#endif
+      }
+
+      /**
+       * Decrements reference count of the object and destroys the object
+       * when there are no references left to it.
+       */
+      inline void release() const noexcept
+      {
+#if PLORTH_ENABLE_ATOMIC_REFCOUNT
+        if (m_ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+#else
+        if (--m_ref_count == 0)
+#endif
+        {
+          delete this;
+        }
+      }
+
+      /**
+       * Returns the number of references currently pointing to the object.
+       */
+      inline std::size_t ref_count() const noexcept
+      {
+        return m_ref_count;
+      }
+
       managed(const managed&) = delete;
       managed(managed&&) = delete;
       void operator=(const managed&) = delete;
       void operator=(managed&&) = delete;
+
+    private:
+      /** Number of references pointing to the object. */
+      mutable ref_count_type m_ref_count;
     };
 
 #if PLORTH_ENABLE_MEMORY_POOL
-    struct pool
+    /**
+     * Compact header which precedes each object allocated by the memory
+     * manager.
+     */
+    struct header
     {
-      /** Pointer to the next pool in the memory manager. */
-      pool* next;
-      /** Pointer to the previous pool in the memory manager. */
-      pool* prev;
-      /** Amount of bytes still unslotted in this pool. */
-      std::size_t remaining;
-      /** Pointer to the allocated memory. */
-      char* memory;
-      /** Pointer to the first free slot in the pool. */
-      slot* free_head;
-      /** Pointer to the last free slot in the pool. */
-      slot* free_tail;
-      /** Pointer to the first used slot in the pool. */
-      slot* used_head;
-      /** Pointer to the last used slot in the pool. */
-      slot* used_tail;
+      /**
+       * Index of the size class of the slot, or `large_size_class` if the
+       * object has been allocated outside slabs.
+       */
+      std::uint32_t size_class;
+      /** Whether the slot is currently being used by an object. */
+      std::uint32_t used;
     };
 
-    struct slot
+    /**
+     * Slab is a block of memory aligned to it's own size, which is divided
+     * into equally sized slots of a single size class. Because of the
+     * alignment, slab of an object can be located from the address of the
+     * object alone.
+     */
+    struct slab
+    {
+      /** Memory manager which allocated the slab. */
+      class manager* manager;
+      /** Pointer to the next slab allocated by the memory manager. */
+      slab* next;
+      /** Pointer to the previous slab allocated by the memory manager. */
+      slab* prev;
+      /** Pointer to the next slab of same size class with free slots. */
+      slab* next_partial;
+      /** Pointer to the previous slab of same size class with free slots. */
+      slab* prev_partial;
+      /** Pointer to the first free slot which has been previously used. */
+      header* free_head;
+      /** Pointer to the first slot that has never been used. */
+      char* bump;
+      /** Pointer to the end of usable memory in the slab. */
+      char* end;
+      /** Index of the size class of the slab. */
+      std::uint32_t size_class;
+      /** Number of slots currently used in the slab. */
+      std::uint32_t used;
+    };
+
+    /**
+     * Header for objects too large to fit in any size class.
+     */
+    struct large_block
     {
-      /** Memory pool where this slot belongs to. */
-      struct pool* pool;
-      /** Pointer to the next slot in the pool. */
-      slot* next;
-      /** Pointer to the previous slot in the pool. */
-      slot* prev;
-      /** Size of the slot. */
-      std::size_t size;
-      /** Pointer to the allocated memory. */
-      char* memory;
+      /** Memory manager which allocated the object. */
+      class manager* manager;
+      /** Pointer to the next large object allocated by the memory manager. */
+      large_block* next;
+      /** Pointer to the previous large object allocated by the manager. */
+      large_block* prev;
     };
 #endif
   }
@@ -51,7 +51,7 @@ namespace plorth
        * \param module_file_extension File extension used to recognize modules
        *                              from other files.
        */
-      static std::shared_ptr<manager> file_system(
+      static ref<manager> file_system(
         memory::manager& memory_manager,
         const std::vector<std::u32string>& lookup_paths
           = std::vector<std::u32string>(),
@@ -62,7 +62,7 @@ namespace plorth
       /**
        * Constructs new module manager which is unable to import modules.
        */
-      static std::shared_ptr<manager> dummy(memory::manager& memory_manager);
+      static ref<manager> dummy(memory::manager& memory_manager);
 
       /**
        * Attempts to import an module from given path and if successful,
@@ -74,8 +74,8 @@ namespace plorth
        * \return     Reference to the imported module as an object, or null
        *             reference if the import failed for some reason.
        */
-      virtual std::shared_ptr<object> import_module(
-        const std::shared_ptr<context>& ctx,
+      virtual ref<object> import_module(
+        const ref<context>& ctx,
         const std::u32string& path
       ) = 0;
     };
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <plorth/context.hpp>
+
+#include <utility>
+
+namespace plorth
+{
+  namespace native
+  {
+    /**
+     * Describes how a parameter type of a native word is looked up from the
+     * data stack. Only the specializations below are supported.
+     */
+    template< class T >
+    struct argument;
+
+    /**
+     * Argument which accepts any value. The reference points directly into
+     * the data stack, so it remains valid only until the stack is modified.
+     */
+    template<>
+    struct argument<const cell&>
+    {
+      static constexpr bool typed = false;
+      static constexpr enum value::type type = value::type::null;
+
+      static inline const cell& get(const cell& slot)
+      {
+        return slot;
+      }
+    };
+
+    /**
+     * Boolean argument, passed by value.
+     */
+    template<>
+    struct argument<bool>
+    {
+      static constexpr bool typed = true;
+      static constexpr enum value::type type = value::type::boolean;
+
+      static inline bool get(const cell& slot)
+      {
+        return slot.as_boolean();
+      }
+    };
+
+    /**
+     * Number argument, converted into an integer.
+     */
+    template<>
+    struct argument<number::int_type>
+    {
+      static constexpr bool typed = true;
+      static constexpr enum value::type type = value::type::number;
+
+      static inline number::int_type get(const cell& slot)
+      {
+        return slot.as_int();
+      }
+    };
+
+    /**
+     * Number argument, converted into a real number.
+     */
+    template<>
+    struct argument<number::real_type>
+    {
+      static constexpr bool typed = true;
+      static constexpr enum value::type type = value::type::number;
+
+      static inline number::real_type get(const cell& slot)
+      {
+        return slot.as_real();
+      }
+    };
+
+    /**
+     * Argument which is a boxed value of certain type. The reference remains
+     * valid for as long as the value is kept in the data stack.
+     */
+    template< class T, enum value::type Type >
+    struct boxed_argument
+    {
+      static constexpr bool typed = true;
+      static constexpr enum value::type type = Type;
+
+      static inline const T& get(const cell& slot)
+      {
+        return *static_cast<const T*>(slot.boxed().get());
+      }
+    };
+
+    template<>
+    struct argument<const string&>
+      : boxed_argument<string, value::type::string> {};
+
+    template<>
+    struct argument<const array&>
+      : boxed_argument<array, value::type::array> {};
+
+    template<>
+    struct argument<const object&>
+      : boxed_argument<object, value::type::object> {};
+
+    template<>
+    struct argument<const quote&>
+      : boxed_argument<quote, value::type::quote> {};
+
+    template<>
+    struct argument<const symbol&>
+      : boxed_argument<symbol, value::type::symbol> {};
+
+    template<>
+    struct argument<const word&>
+      : boxed_argument<word, value::type::word> {};
+
+    template<>
+    struct argument<const error&>
+      : boxed_argument<error, value::type::error> {};
+
+    template< class... Args, std::size_t... Depth >
+    inline void invoke(
+      const ref<context>& ctx,
+      void (*body)(const ref<context>&, Args...),
+      std::index_sequence<Depth...>
+    )
+    {
+      const cell* slot;
+
+      if (ctx->size() < sizeof...(Args))
+      {
+        ctx->error(error::code::range, U"Stack underflow.");
+        return;
+      }
+
+      // Type checks are done starting from the top-most value, just like
+      // they would be when popping the arguments one by one.
+      if (!((!argument<Args>::typed ||
+             ctx->peek(slot, argument<Args>::type, Depth)) && ...))
+      {
+        return;
+      }
+
+      body(ctx, argument<Args>::get(ctx->peek(Depth))...);
+    }
+
+    template< class... Args >
+    inline void invoke(const ref<context>& ctx,
+                       void (*body)(const ref<context>&, Args...))
+    {
+      invoke(ctx, body, std::index_sequence_for<Args...>());
+    }
+
+    /**
+     * Adapts a native word with declared argument types into a plain quote
+     * callback. The first parameter of the word receives the top-most value
+     * of the stack, the second one the value below it and so on.
+     *
+     * Depth and types of the arguments are validated before the body is
+     * called, and the arguments are handed out as borrowed references which
+     * still are owned by the data stack. The body is responsible for leaving
+     * the stack in the state described by its stack effect; arguments it
+     * does not consume stay where they are.
+     *
+     * Every built-in word which takes a fixed number of arguments, leaves its
+     * receiver on the stack and does not call back into the interpreter is
+     * registered through this adapter. Words which consume their receiver,
+     * take a variable number of values or execute quotes pop their arguments
+     * by hand, since those would either have to copy every argument out of
+     * the stack or could reallocate it under the borrowed references. Both
+     * kinds end up as plain function pointers in the prototype tables.
+     *
+     *     static void w_length(const ref<context>& ctx, const string& str)
+     *     {
+     *       ctx->push_int(str.length());
+     *     }
+     *
+     *     { U"length", native::thunk<w_length> }
+     */
+    template< auto Body >
+    void thunk(const ref<context>& ctx)
+    {
+      invoke(ctx, Body);
+    }
+  }
+}
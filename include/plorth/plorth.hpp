@@ -34,6 +34,7 @@
 #include <plorth/value-number.hpp>
 #include <plorth/value-object.hpp>
 #include <plorth/value-quote.hpp>
+#include <plorth/value-seq.hpp>
 #include <plorth/value-string.hpp>
 #include <plorth/value-word.hpp>
 
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <plorth/memory.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace plorth
+{
+  /**
+   * Reference to a managed object. Reference count is stored in the managed
+   * object itself, so unlike with `std::shared_ptr` no separate control block
+   * needs to be allocated for each object.
+   */
+  template<class T>
+  class ref
+  {
+  public:
+    using element_type = T;
+
+    /**
+     * Constructs null reference.
+     */
+    constexpr ref() noexcept
+      : m_pointer(nullptr) {}
+
+    /**
+     * Constructs null reference.
+     */
+    constexpr ref(std::nullptr_t) noexcept
+      : m_pointer(nullptr) {}
+
+    /**
+     * Constructs reference to given managed object, incrementing it's
+     * reference count.
+     */
+    explicit ref(T* pointer) noexcept
+      : m_pointer(pointer)
+    {
+      if (m_pointer)
+      {
+        m_pointer->retain();
+      }
+    }
+
+    ref(const ref& that) noexcept
+      : m_pointer(that.m_pointer)
+    {
+      if (m_pointer)
+      {
+        m_pointer->retain();
+      }
+    }
+
+    template<class U>
+    ref(const ref<U>& that) noexcept
+      : m_pointer(that.get())
+    {
+      if (m_pointer)
+      {
+        m_pointer->retain();
+      }
+    }
+
+    ref(ref&& that) noexcept
+      : m_pointer(that.m_pointer)
+    {
+      that.m_pointer = nullptr;
+    }
+
+    template<class U>
+    ref(ref<U>&& that) noexcept
+      : m_pointer(that.detach()) {}
+
+    ~ref()
+    {
+      if (m_pointer)
+      {
+        m_pointer->release();
+      }
+    }
+
+    ref& operator=(const ref& that) noexcept
+    {
+      ref(that).swap(*this);
+
+      return *this;
+    }
+
+    template<class U>
+    ref& operator=(const ref<U>& that) noexcept
+    {
+      ref(that).swap(*this);
+
+      return *this;
+    }
+
+    ref& operator=(ref&& that) noexcept
+    {
+      ref(std::move(that)).swap(*this);
+
+      return *this;
+    }
+
+    template<class U>
+    ref& operator=(ref<U>&& that) noexcept
+    {
+      ref(std::move(that)).swap(*this);
+
+      return *this;
+    }
+
+    ref& operator=(std::nullptr_t) noexcept
+    {
+      reset();
+
+      return *this;
+    }
+
+    /**
+     * Returns pointer to the referenced object, or null pointer if this is a
+     * null reference.
+     */
+    inline T* get() const noexcept
+    {
+      return m_pointer;
+    }
+
+    inline T& operator*() const noexcept
+    {
+      return *m_pointer;
+    }
+
+    inline T* operator->() const noexcept
+    {
+      return m_pointer;
+    }
+
+    inline explicit operator bool() const noexcept
+    {
+      return !!m_pointer;
+    }
+
+    /**
+     * Releases the referenced object and turns this into a null reference.
+     */
+    void reset() noexcept
+    {
+      if (m_pointer)
+      {
+        m_pointer->release();
+        m_pointer = nullptr;
+      }
+    }
+
+    void swap(ref& that) noexcept
+    {
+      std::swap(m_pointer, that.m_pointer);
+    }
+
+    /**
+     * Turns this into a null reference without decrementing reference count
+     * of the referenced object. Returns pointer to the previously referenced
+     * object, which the caller now owns a reference to.
+     */
+    T* detach() noexcept
+    {
+      T* pointer = m_pointer;
+
+      m_pointer = nullptr;
+
+      return pointer;
+    }
+
+    /**
+     * Constructs reference from a pointer which already owns a reference to
+     * the managed object, without incrementing the reference count.
+     */
+    static ref adopt(T* pointer) noexcept
+    {
+      ref result;
+
+      result.m_pointer = pointer;
+
+      return result;
+    }
+
+  private:
+    /** Pointer to the referenced object. */
+    T* m_pointer;
+  };
+
+  /**
+   * Casts reference into reference of another type, similar to how
+   * `std::static_pointer_cast` works with shared pointers.
+   */
+  template<class T, class U>
+  inline ref<T> ref_cast(const ref<U>& r) noexcept
+  {
+    return ref<T>(static_cast<T*>(r.get()));
+  }
+
+  template<class T, class U>
+  inline ref<T> ref_cast(ref<U>&& r) noexcept
+  {
+    return ref<T>::adopt(static_cast<T*>(r.detach()));
+  }
+
+  template<class T, class U>
+  inline bool operator==(const ref<T>& a, const ref<U>& b) noexcept
+  {
+    return a.get() == b.get();
+  }
+
+  template<class T, class U>
+  inline bool operator!=(const ref<T>& a, const ref<U>& b) noexcept
+  {
+    return a.get() != b.get();
+  }
+
+  template<class T>
+  inline bool operator==(const ref<T>& a, std::nullptr_t) noexcept
+  {
+    return !a;
+  }
+
+  template<class T>
+  inline bool operator==(std::nullptr_t, const ref<T>& a) noexcept
+  {
+    return !a;
+  }
+
+  template<class T>
+  inline bool operator!=(const ref<T>& a, std::nullptr_t) noexcept
+  {
+    return !!a;
+  }
+
+  template<class T>
+  inline bool operator!=(std::nullptr_t, const ref<T>& a) noexcept
+  {
+    return !!a;
+  }
+}
+
+namespace std
+{
+  template<class T>
+  struct hash<plorth::ref<T>>
+  {
+    std::size_t operator()(const plorth::ref<T>& key) const noexcept
+    {
+      return std::hash<T*>()(key.get());
+    }
+  };
+}
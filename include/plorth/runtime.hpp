@@ -32,10 +32,19 @@
 #include <plorth/value-array.hpp>
 #include <plorth/value-boolean.hpp>
 #include <plorth/value-number.hpp>
+#include <plorth/value-seq.hpp>
 #include <plorth/value-string.hpp>
 
+#include <memory>
+#if PLORTH_ENABLE_MUTEXES
+# include <mutex>
+#endif
+
 namespace plorth
 {
+  class shape;
+  class thread_pool;
+
   class runtime : public memory::managed
   {
   public:
@@ -43,12 +52,20 @@ namespace plorth
       std::pair<const char32_t*, quote::callback>
     >;
 #if PLORTH_ENABLE_SYMBOL_CACHE
-    using symbol_cache = std::unordered_map<
-      std::u32string,
-      std::shared_ptr<class symbol>
-    >;
+    using symbol_cache = std::unordered_map<atom, ref<class symbol>>;
 #endif
 
+    /**
+     * Enumeration of engines which can be used for executing compiled quotes.
+     */
+    enum class execution_engine
+    {
+      /** Values of the quote are executed one by one. */
+      interpreter = 0,
+      /** Quote is translated into bytecode before it's executed. */
+      bytecode = 1
+    };
+
     /**
      * Constructs new runtime.
      *
@@ -62,14 +79,14 @@ namespace plorth
      *                       system will be used.
      * \return               Reference to the created runtime.
      */
-    static std::shared_ptr<runtime> make(
+    static ref<runtime> make(
       memory::manager& memory_manager,
-      const std::shared_ptr<io::input>& input
-        = std::shared_ptr<io::input>(),
-      const std::shared_ptr<io::output>& output
-        = std::shared_ptr<io::output>(),
-      const std::shared_ptr<module::manager>& module_manager
-        = std::shared_ptr<module::manager>()
+      const ref<io::input>& input
+        = ref<io::input>(),
+      const ref<io::output>& output
+        = ref<io::output>(),
+      const ref<module::manager>& module_manager
+        = ref<module::manager>()
     );
 
     /**
@@ -83,7 +100,7 @@ namespace plorth
     /**
      * Returns the input used by the runtime.
      */
-    inline std::shared_ptr<io::input>& input()
+    inline ref<io::input>& input()
     {
       return m_input;
     }
@@ -91,7 +108,7 @@ namespace plorth
     /**
      * Returns the input used by the runtime.
      */
-    inline const std::shared_ptr<io::input>& input() const
+    inline const ref<io::input>& input() const
     {
       return m_input;
     }
@@ -99,7 +116,7 @@ namespace plorth
     /**
      * Returns the output used by the runtime.
      */
-    inline std::shared_ptr<io::output>& output()
+    inline ref<io::output>& output()
     {
       return m_output;
     }
@@ -107,7 +124,7 @@ namespace plorth
     /**
      * Returns the output used by the runtime.
      */
-    inline const std::shared_ptr<io::output>& output() const
+    inline const ref<io::output>& output() const
     {
       return m_output;
     }
@@ -115,7 +132,7 @@ namespace plorth
     /**
      * Returns the module manager used to import modules.
      */
-    inline std::shared_ptr<module::manager>& module_manager()
+    inline ref<module::manager>& module_manager()
     {
       return m_module_manager;
     }
@@ -123,17 +140,73 @@ namespace plorth
     /**
      * Returns the module manager used to import modules.
      */
-    inline const std::shared_ptr<module::manager>& module_manager() const
+    inline const ref<module::manager>& module_manager() const
     {
       return m_module_manager;
     }
 
+    /**
+     * Returns the engine used for executing compiled quotes. This non-constant
+     * version of the method can be used to switch between the engines.
+     */
+    inline enum execution_engine& execution_engine()
+    {
+      return m_execution_engine;
+    }
+
+    /**
+     * Returns the engine used for executing compiled quotes.
+     */
+    inline enum execution_engine execution_engine() const
+    {
+      return m_execution_engine;
+    }
+
+    /**
+     * Returns the number of threads which parallel array words use, which
+     * by default is the number of hardware threads.
+     */
+    inline std::size_t concurrency() const
+    {
+      return m_concurrency;
+    }
+
+    /**
+     * Sets the number of threads which parallel array words use. Must not be
+     * called while any parallel word is being executed.
+     */
+    void concurrency(std::size_t concurrency);
+
+    /**
+     * Returns pool of worker threads used by parallel array words. Threads
+     * of the pool are started when this method is called for the first time.
+     */
+    class thread_pool& thread_pool();
+
+    /**
+     * Returns true if the runtime has been frozen.
+     */
+    inline bool frozen() const
+    {
+      return m_frozen;
+    }
+
+    /**
+     * Freezes the runtime, after which the global dictionary can no longer
+     * be modified. Contexts of a frozen runtime can be executed in separate
+     * threads at the same time, as all state of the runtime they share is
+     * either immutable or synchronized. Freezing must be done before the
+     * runtime is shared with other threads, and contexts constructed before
+     * it must not be used concurrently.
+     */
+    void freeze();
+
     /**
      * Returns the global dictionary that contains core word set available to
      * all contexts.
      *
      * This non-constant version of the method can be used to define new words
-     * into the global dictionary, or remove existing ones.
+     * into the global dictionary, until the runtime has been frozen.
      */
     inline class dictionary& dictionary()
     {
@@ -201,7 +274,7 @@ namespace plorth
      *                whether some kind of error occurred.
      */
     bool import(
-      const std::shared_ptr<class context>& context,
+      const ref<class context>& context,
       const std::u32string& path
     );
 
@@ -222,7 +295,7 @@ namespace plorth
      * \param value Value of the number.
      * \return      Reference to the created number value.
      */
-    std::shared_ptr<class number> number(number::int_type value);
+    ref<class number> number(number::int_type value);
 
     /**
      * Constructs real number from given value.
@@ -230,7 +303,7 @@ namespace plorth
      * \param value Value of the number.
      * \return      Reference to the created number value.
      */
-    std::shared_ptr<class number> number(number::real_type value);
+    ref<class number> number(number::real_type value);
 
     /**
      * Parses given text input into number (either real or integer) and
@@ -239,7 +312,7 @@ namespace plorth
      * \param value Value of the number as text.
      * \return      Reference to the created number value.
      */
-    std::shared_ptr<class number> number(const std::u32string& value);
+    ref<class number> number(const std::u32string& value);
 
     /**
      * Constructs array value from given elements.
@@ -248,8 +321,8 @@ namespace plorth
      * \param size     Number of elements in the array.
      * \return         Reference to the created array value.
      */
-    std::shared_ptr<class array> array(array::const_pointer elements,
-                                       array::size_type size);
+    ref<class array> array(array::const_pointer elements,
+                           array::size_type size);
 
     /**
      * Constructs object value from given properties.
@@ -257,7 +330,7 @@ namespace plorth
      * \param properties Properties to construct object from.
      * \return           Reference to the created object value.
      */
-    std::shared_ptr<class object> object(
+    ref<class object> object(
       const std::vector<object::value_type>& properties
     );
 
@@ -267,7 +340,7 @@ namespace plorth
      * \param input Unicode string to construct string value from.
      * \return      Reference to the created string value.
      */
-    std::shared_ptr<class string> string(const std::u32string& input);
+    ref<class string> string(const std::u32string& input);
 
     /**
      * Constructs string value from given pointer of Unicode code points.
@@ -276,8 +349,22 @@ namespace plorth
      * \param length Number of characters in the string.
      * \return       Reference to the created string value.
      */
-    std::shared_ptr<class string> string(string::const_pointer chars,
-                                         string::size_type length);
+    ref<class string> string(string::const_pointer chars,
+                             string::size_type length);
+
+    /**
+     * Constructs string value from given UTF-8 encoded input. The input is
+     * decoded directly into the narrowest storage which can hold it.
+     *
+     * \param input  UTF-8 encoded input to construct string value from.
+     * \param length Number of bytes in the input.
+     * \param output Where the created string value will be assigned to.
+     * \return       Boolean flag which tells whether the input was valid
+     *               UTF-8.
+     */
+    bool decode_string(const char* input,
+                       std::size_t length,
+                       ref<class string>& output);
 
     /**
      * Constructs symbol from given identifier string.
@@ -287,7 +374,7 @@ namespace plorth
      *                 encountered.
      * \return         Reference to the created symbol.
      */
-    std::shared_ptr<class symbol> symbol(
+    ref<class symbol> symbol(
       const std::u32string& id,
       const std::optional<parser::position>& position
         = std::optional<parser::position>()
@@ -296,45 +383,75 @@ namespace plorth
     /**
      * Constructs compiled quote from given sequence of values.
      */
-    std::shared_ptr<quote> compiled_quote(
-      const std::vector<std::shared_ptr<value>>& values
+    ref<quote> compiled_quote(
+      const std::vector<ref<value>>& values
     );
 
     /**
      * Constructs native quote from given C++ callback.
      */
-    std::shared_ptr<quote> native_quote(quote::callback callback);
+    ref<quote> native_quote(quote::callback callback);
 
     /**
      * Constructs word from given string and quote.
      */
-    std::shared_ptr<class word> word(
+    ref<class word> word(
       const std::u32string& id,
-      const std::shared_ptr<class quote>& quote
+      const ref<class quote>& quote
     );
 
     /**
      * Constructs word from given symbol and quote.
      */
-    std::shared_ptr<class word> word(
-      const std::shared_ptr<class symbol>& symbol,
-      const std::shared_ptr<class quote>& quote
+    ref<class word> word(
+      const ref<class symbol>& symbol,
+      const ref<class quote>& quote
     );
 
+    /**
+     * Constructs sequence of elements of given array.
+     */
+    ref<class seq> seq(const ref<class array>& array);
+
+    /**
+     * Constructs sequence of characters of given string, each one given as
+     * a string of its own.
+     */
+    ref<class seq> seq(const ref<class string>& string);
+
+    /**
+     * Constructs endless sequence of consecutive integers beginning from
+     * given number.
+     */
+    ref<class seq> range(number::int_type start);
+
+    /**
+     * Constructs sequence of consecutive integers beginning from given
+     * number and ending before the given limit.
+     */
+    ref<class seq> range(number::int_type start, number::int_type end);
+
+    /**
+     * Constructs sequence of lines read from input of the runtime. Input is
+     * read only as the sequence is consumed, and lines which have been read
+     * once are not seen by later iterations of the sequence.
+     */
+    ref<class seq> input_lines();
+
     /**
      * Helper method for constructing managed objects (such as values) using
      * the memory manager associated with this runtime instance.
      */
     template< typename T, typename... Args >
-    inline std::shared_ptr<T> value(Args... args)
+    inline ref<T> value(Args... args)
     {
-      return std::shared_ptr<T>(new (*m_memory_manager) T(args...));
+      return ref<T>(new (*m_memory_manager) T(args...));
     }
 
     /**
      * Returns shared instance of true boolean value.
      */
-    inline const std::shared_ptr<class boolean>& true_value() const
+    inline const ref<class boolean>& true_value() const
     {
       return m_true_value;
     }
@@ -342,7 +459,7 @@ namespace plorth
     /**
      * Returns shared instance of false boolean value.
      */
-    inline const std::shared_ptr<class boolean>& false_value() const
+    inline const ref<class boolean>& false_value() const
     {
       return m_false_value;
     }
@@ -351,7 +468,7 @@ namespace plorth
      * Helper method for converting C++ boolean value into Plorth boolean
      * value.
      */
-    inline const std::shared_ptr<class boolean>& boolean(bool b) const
+    inline const ref<class boolean>& boolean(bool b) const
     {
       return b ? m_true_value : m_false_value;
     }
@@ -359,7 +476,7 @@ namespace plorth
     /**
      * Returns prototype for array values.
      */
-    inline const std::shared_ptr<class object>& array_prototype() const
+    inline const ref<class object>& array_prototype() const
     {
       return m_array_prototype;
     }
@@ -367,7 +484,7 @@ namespace plorth
     /**
      * Returns prototype for boolean values.
      */
-    inline const std::shared_ptr<class object>& boolean_prototype() const
+    inline const ref<class object>& boolean_prototype() const
     {
       return m_boolean_prototype;
     }
@@ -375,7 +492,7 @@ namespace plorth
     /**
      * Returns prototype for error values.
      */
-    inline const std::shared_ptr<class object>& error_prototype() const
+    inline const ref<class object>& error_prototype() const
     {
       return m_error_prototype;
     }
@@ -383,7 +500,7 @@ namespace plorth
     /**
      * Returns prototype for number values.
      */
-    inline const std::shared_ptr<class object>& number_prototype() const
+    inline const ref<class object>& number_prototype() const
     {
       return m_number_prototype;
     }
@@ -391,7 +508,7 @@ namespace plorth
     /**
      * Returns prototype for objects.
      */
-    inline const std::shared_ptr<class object>& object_prototype() const
+    inline const ref<class object>& object_prototype() const
     {
       return m_object_prototype;
     }
@@ -399,15 +516,23 @@ namespace plorth
     /**
      * Returns prototype for quotes.
      */
-    inline const std::shared_ptr<class object>& quote_prototype() const
+    inline const ref<class object>& quote_prototype() const
     {
       return m_quote_prototype;
     }
 
+    /**
+     * Returns prototype for sequences.
+     */
+    inline const ref<class object>& seq_prototype() const
+    {
+      return m_seq_prototype;
+    }
+
     /**
      * Returns prototype for string values.
      */
-    inline const std::shared_ptr<class object>& string_prototype() const
+    inline const ref<class object>& string_prototype() const
     {
       return m_string_prototype;
     }
@@ -415,7 +540,7 @@ namespace plorth
     /**
      * Returns prototype for symbols.
      */
-    inline const std::shared_ptr<class object>& symbol_prototype() const
+    inline const ref<class object>& symbol_prototype() const
     {
       return m_symbol_prototype;
     }
@@ -423,7 +548,7 @@ namespace plorth
     /**
      * Returns prototype for words.
      */
-    inline const std::shared_ptr<class object>& word_prototype() const
+    inline const ref<class object>& word_prototype() const
     {
       return m_word_prototype;
     }
@@ -437,48 +562,70 @@ namespace plorth
      */
     explicit runtime(memory::manager* memory_manager);
 
+    ~runtime();
+
   private:
     /** Memory manager associated with this runtime. */
     memory::manager* m_memory_manager;
     /** Input which the runtime uses. */
-    std::shared_ptr<io::input> m_input;
+    ref<io::input> m_input;
     /** Output which the runtime uses. */
-    std::shared_ptr<io::output> m_output;
+    ref<io::output> m_output;
     /** Used to import modules. */
-    std::shared_ptr<module::manager> m_module_manager;
+    ref<module::manager> m_module_manager;
+    /** Engine used for executing compiled quotes. */
+    enum execution_engine m_execution_engine;
+    /** Number of threads used by parallel array words. */
+    std::size_t m_concurrency;
+    /** Worker threads used by parallel array words, once started. */
+    std::unique_ptr<class thread_pool> m_thread_pool;
+#if PLORTH_ENABLE_MUTEXES
+    /** Used for starting the worker threads only once. */
+    std::mutex m_thread_pool_mutex;
+#endif
+    /** Whether the runtime has been frozen. */
+    bool m_frozen;
     /** Global dictionary available to all contexts. */
     class dictionary m_dictionary;
+    /** Root of the shape tree, shared by all objects of the runtime. */
+    ref<shape> m_empty_shape;
     /** Shared instance of true boolean value. */
-    std::shared_ptr<class boolean> m_true_value;
+    ref<class boolean> m_true_value;
     /** Shared instance of false boolean value. */
-    std::shared_ptr<class boolean> m_false_value;
+    ref<class boolean> m_false_value;
     /** Prototype for array values. */
-    std::shared_ptr<class object> m_array_prototype;
+    ref<class object> m_array_prototype;
     /** Prototype for boolean values. */
-    std::shared_ptr<class object> m_boolean_prototype;
+    ref<class object> m_boolean_prototype;
     /** Prototype for error values. */
-    std::shared_ptr<class object> m_error_prototype;
+    ref<class object> m_error_prototype;
     /** Prototype for number values. */
-    std::shared_ptr<class object> m_number_prototype;
+    ref<class object> m_number_prototype;
     /** Prototype for objects. */
-    std::shared_ptr<class object> m_object_prototype;
+    ref<class object> m_object_prototype;
     /** Prototype for quotes. */
-    std::shared_ptr<class object> m_quote_prototype;
+    ref<class object> m_quote_prototype;
+    /** Prototype for sequences. */
+    ref<class object> m_seq_prototype;
     /** Prototype for string values. */
-    std::shared_ptr<class object> m_string_prototype;
+    ref<class object> m_string_prototype;
     /** Prototype for symbol values. */
-    std::shared_ptr<class object> m_symbol_prototype;
+    ref<class object> m_symbol_prototype;
     /** Prototype for words. */
-    std::shared_ptr<class object> m_word_prototype;
+    ref<class object> m_word_prototype;
     /** List of command line arguments given for the interpreter. */
     std::vector<std::u32string> m_arguments;
 #if PLORTH_ENABLE_SYMBOL_CACHE
     /** Cache for symbols used by the runtime. */
     symbol_cache m_symbol_cache;
+# if PLORTH_ENABLE_MUTEXES
+    /** Used for synchronizing access to the symbol cache. */
+    std::mutex m_symbol_cache_mutex;
+# endif
 #endif
 #if PLORTH_ENABLE_INTEGER_CACHE
     /** Cache for commonly used integer numbers. */
-    std::shared_ptr<class number> m_integer_cache[256];
+    ref<class number> m_integer_cache[256];
 #endif
   };
 }
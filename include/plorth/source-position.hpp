@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <plorth/parser/position.hpp>
+#include <plorth/atom.hpp>
+
+namespace plorth
+{
+  /**
+   * Compact representation of position in source code. Instead of containing
+   * a copy of the filename, the filename is stored in the atom table as a
+   * persistent atom and only ID of the atom is stored in the position,
+   * keeping the position small and cheap to copy.
+   */
+  struct source_position
+  {
+    /** ID of the atom which contains the filename. */
+    atom::id_type file;
+    /** Line number. */
+    std::uint32_t line;
+    /** Column number. */
+    std::uint32_t column;
+
+    /**
+     * Constructs empty position with no filename.
+     */
+    source_position()
+      : file(atom().id())
+      , line(0)
+      , column(0) {}
+
+    /**
+     * Constructs compact position from position given by the parser.
+     */
+    explicit source_position(const parser::position& position)
+      : file(atom::persistent(position.file).id())
+      , line(static_cast<std::uint32_t>(position.line))
+      , column(static_cast<std::uint32_t>(position.column)) {}
+
+    /**
+     * Returns name of the file.
+     */
+    inline const std::u32string& filename() const
+    {
+      return atom::from_id(file).name();
+    }
+
+    /**
+     * Converts the compact position back into position used by the parser
+     * and errors.
+     */
+    inline parser::position to_parser_position() const
+    {
+      return
+      {
+        filename(),
+        static_cast<int>(line),
+        static_cast<int>(column)
+      };
+    }
+  };
+}
@@ -25,6 +25,8 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <iterator>
 
 #include <plorth/value.hpp>
@@ -39,13 +41,26 @@ namespace plorth
   {
   public:
     using size_type = std::size_t;
-    using value_type = std::shared_ptr<value>;
+    using value_type = ref<value>;
     using reference = value_type&;
     using const_reference = const value_type&;
     using pointer = value_type*;
     using const_pointer = const value_type*;
     class iterator;
 
+    /**
+     * Enumeration of different ways of storing elements of an array.
+     */
+    enum class element_type
+    {
+      /** References to values of any type. */
+      any,
+      /** Unboxed integer numbers. */
+      int64,
+      /** Unboxed real numbers. */
+      float64
+    };
+
     /**
      * Returns the number of elements in the array.
      */
@@ -56,14 +71,77 @@ namespace plorth
      */
     virtual const_reference at(size_type offset) const = 0;
 
+    /**
+     * Returns pointer to contiguous storage of the array beginning from given
+     * offset, or null pointer if the array has no such storage at that
+     * offset.
+     *
+     * \param offset Offset of the first element, which must be less than
+     *               size of the array.
+     * \param size   Where number of elements which can be read through the
+     *               returned pointer will be assigned to.
+     */
+    virtual const_pointer chunk(size_type offset, size_type& size) const;
+
+    /**
+     * Returns the way elements of the array are stored. Typed arrays store
+     * numbers unboxed in contiguous memory, which the numeric array words
+     * process directly. Default implementation returns element_type::any.
+     */
+    virtual enum element_type element_type() const;
+
+    /**
+     * Invokes given callback with consecutive chunks of the array, each one
+     * given as a pointer to contiguous elements and number of elements in
+     * the chunk. Parts of the array which have no contiguous storage are
+     * copied into a temporary buffer first. Iteration stops if the callback
+     * returns false.
+     *
+     * \return Boolean flag which tells whether every chunk was visited.
+     */
+    template<class Callback>
+    bool for_each_chunk(Callback callback) const
+    {
+      const auto length = size();
+      value_type buffer[32];
+
+      for (size_type offset = 0; offset < length;)
+      {
+        size_type count;
+        const_pointer data = chunk(offset, count);
+
+        if (!data)
+        {
+          count = std::min<size_type>(length - offset, 32);
+          for (size_type i = 0; i < count; ++i)
+          {
+            buffer[i] = at(offset + i);
+          }
+          data = buffer;
+        }
+        if (!callback(data, count))
+        {
+          return false;
+        }
+        offset += count;
+      }
+
+      return true;
+    }
+
     inline enum type type() const
     {
       return type::array;
     }
 
-    bool equals(const std::shared_ptr<value>& that) const;
+    bool equals(const ref<value>& that) const;
+    std::size_t hash() const;
     std::u32string to_string() const;
     std::u32string to_source() const;
+
+  private:
+    /** Cached hash code of the array, or zero if not computed yet. */
+    mutable std::atomic<std::size_t> m_hash{0};
   };
 
   /**
@@ -73,12 +151,12 @@ namespace plorth
   {
   public:
     using difference_type = int;
-    using value_type = const std::shared_ptr<value>;
+    using value_type = const ref<value>;
     using pointer = value_type*;
     using reference = value_type&;
     using iterator_category = std::forward_iterator_tag;
 
-    iterator(const std::shared_ptr<array>& ary, array::size_type index = 0);
+    iterator(const ref<array>& ary, array::size_type index = 0);
     iterator(const iterator& that);
     iterator& operator=(const iterator& that);
 
@@ -92,17 +170,17 @@ namespace plorth
 
   private:
     /** Reference to array which is being iterated. */
-    std::shared_ptr<array> m_array;
+    ref<array> m_array;
     /** Current offset in the iterated array. */
     array::size_type m_index;
   };
 
-  inline array::iterator begin(const std::shared_ptr<array>& ary)
+  inline array::iterator begin(const ref<array>& ary)
   {
     return array::iterator(ary);
   }
 
-  inline array::iterator end(const std::shared_ptr<array>& ary)
+  inline array::iterator end(const ref<array>& ary)
   {
     return array::iterator(ary, ary->size());
   }
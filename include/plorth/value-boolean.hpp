@@ -44,7 +44,8 @@ namespace plorth
       return type::boolean;
     }
 
-    bool equals(const std::shared_ptr<class value>& that) const;
+    bool equals(const ref<class value>& that) const;
+    std::size_t hash() const;
     std::u32string to_string() const;
     std::u32string to_source() const;
 
@@ -104,7 +104,8 @@ namespace plorth
       return type::error;
     }
 
-    bool equals(const std::shared_ptr<value>& that) const;
+    bool equals(const ref<value>& that) const;
+    std::size_t hash() const;
     std::u32string to_string() const;
     std::u32string to_source() const;
 
@@ -44,6 +44,17 @@ namespace plorth
     static const real_type real_min;
     static const real_type real_max;
 
+    /**
+     * Constructs integer number using given memory manager. Unlike
+     * runtime::number(), this never returns a cached number.
+     */
+    static ref<number> make(memory::manager& manager, int_type value);
+
+    /**
+     * Constructs real number using given memory manager.
+     */
+    static ref<number> make(memory::manager& manager, real_type value);
+
     /**
      * Enumeration for different supported number types.
      */
@@ -81,7 +92,8 @@ namespace plorth
       return type::number;
     }
 
-    bool equals(const std::shared_ptr<class value>& that) const;
+    bool equals(const ref<class value>& that) const;
+    std::size_t hash() const;
     std::u32string to_string() const;
     std::u32string to_source() const;
   };
@@ -25,9 +25,13 @@
  */
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include <plorth/atom.hpp>
 #include <plorth/value.hpp>
 
 namespace plorth
@@ -42,10 +46,26 @@ namespace plorth
   {
   public:
     using size_type = std::size_t;
-    using key_type = std::u32string;
-    using mapped_type = std::shared_ptr<value>;
+    using id_type = std::uint64_t;
+    using key_type = atom;
+    using mapped_type = ref<value>;
     using value_type = std::pair<key_type, mapped_type>;
 
+    /**
+     * Constructs object with identifier of it's own.
+     */
+    explicit object();
+
+    /**
+     * Returns identifier of the object. Unlike address of the object, the
+     * identifier is never reused for another object, even after this one
+     * has been destroyed.
+     */
+    inline id_type id() const
+    {
+      return m_id;
+    }
+
     /**
      * Tests whether the object has property with given name, including
      * inherited properties.
@@ -57,7 +77,7 @@ namespace plorth
      *                not.
      */
     bool has_property(
-      const std::shared_ptr<class runtime>& runtime,
+      const ref<class runtime>& runtime,
       const key_type& key
     ) const;
 
@@ -82,7 +102,7 @@ namespace plorth
      *                or not.
      */
     bool property(
-      const std::shared_ptr<class runtime>& runtime,
+      const ref<class runtime>& runtime,
       const key_type& key,
       mapped_type& slot
     ) const;
@@ -107,31 +127,88 @@ namespace plorth
      */
     virtual size_type size() const = 0;
 
+    /**
+     * Invokes given callback for each property which the object has, without
+     * constructing intermediate containers. Inherited properties are not
+     * included. If the callback returns boolean, returning false from it
+     * stops the iteration.
+     *
+     * \param callback Callable which takes key and value of the property.
+     * \return         Boolean flag which tells whether all properties were
+     *                 visited or not.
+     */
+    template<class Callback>
+    bool for_each(Callback callback) const
+    {
+      return for_each_property(
+        &object::visit<Callback>,
+        static_cast<void*>(&callback)
+      );
+    }
+
     /**
      * Returns names of the properties which the object has. This does not
      * include inherited properties.
      */
-    virtual std::vector<key_type> keys() const = 0;
+    std::vector<key_type> keys() const;
 
     /**
      * Returns values of the properties which the object has. This does not
      * include inherited properties.
      */
-    virtual std::vector<mapped_type> values() const = 0;
+    std::vector<mapped_type> values() const;
 
     /**
      * Returns each property which the object has. This does not include
      * inherited properties.
      */
-    virtual std::vector<value_type> entries() const = 0;
+    std::vector<value_type> entries() const;
 
     inline enum type type() const
     {
       return type::object;
     }
 
-    bool equals(const std::shared_ptr<value>& that) const;
+    bool equals(const ref<value>& that) const;
+    std::size_t hash() const;
     std::u32string to_string() const;
     std::u32string to_source() const;
+
+  protected:
+    using visitor = bool (*)(void*, const key_type&, const mapped_type&);
+
+    /**
+     * Invokes given visitor for each property which the object has, in
+     * unspecified order, until the visitor returns false.
+     *
+     * \param callback Visitor function.
+     * \param data     Opaque pointer which is passed to the visitor.
+     * \return         Boolean flag which tells whether all properties were
+     *                 visited or not.
+     */
+    virtual bool for_each_property(visitor callback, void* data) const = 0;
+
+  private:
+    /** Identifier of the object. */
+    const id_type m_id;
+    /** Cached hash code of the object, or zero if not computed yet. */
+    mutable std::atomic<std::size_t> m_hash{0};
+
+    template<class Callback>
+    static bool visit(void* data,
+                      const key_type& key,
+                      const mapped_type& value)
+    {
+      auto& callback = *static_cast<Callback*>(data);
+
+      if constexpr (std::is_void_v<decltype(callback(key, value))>)
+      {
+        callback(key, value);
+
+        return true;
+      } else {
+        return callback(key, value);
+      }
+    }
   };
 }
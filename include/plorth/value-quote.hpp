@@ -27,8 +27,6 @@
 
 #include <plorth/value.hpp>
 
-#include <functional>
-
 namespace plorth
 {
   /**
@@ -38,8 +36,11 @@ namespace plorth
   class quote : public value
   {
   public:
-    /** Signature of C++ function that can be used as quote. */
-    using callback = std::function<void(const std::shared_ptr<context>&)>;
+    /**
+     * Signature of C++ function that can be used as quote. See
+     * native::thunk() for adapting functions which declare their arguments.
+     */
+    using callback = void (*)(const ref<context>&);
 
     /**
      * Enumeration for different supported quote types.
@@ -57,7 +58,7 @@ namespace plorth
      * \return    Boolean flag which tells whether execution of the quote was
      *            performed successfully without errors.
      */
-    virtual bool call(const std::shared_ptr<context>& ctx) const = 0;
+    virtual bool call(const ref<context>& ctx) const = 0;
 
     /**
      * Returns type of the quote.
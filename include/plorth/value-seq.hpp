@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <plorth/value-quote.hpp>
+
+#include <memory>
+
+namespace plorth
+{
+  /**
+   * Lazy sequence of values. Sequences are produced from arrays, strings,
+   * ranges of numbers and lines of input. Transforming a sequence with map,
+   * filter, take or drop does not touch any elements; it only adds a stage
+   * to the pipeline of the sequence. Elements are pulled through all stages
+   * one at a time when the sequence is consumed, so no intermediate arrays
+   * are constructed.
+   */
+  class seq : public value
+  {
+  public:
+    /**
+     * Enumeration for different supported sequence types.
+     */
+    enum class seq_type
+    {
+      /** Elements of an array. */
+      array = 0,
+      /** Characters of a string. */
+      string = 1,
+      /** Consecutive integer numbers. */
+      range = 2,
+      /** Lines read from input of the runtime. */
+      input = 3,
+      /** Stages applied to elements of another sequence. */
+      pipeline = 4
+    };
+
+    /**
+     * Enumeration of stages which can be added to the pipeline of a
+     * sequence.
+     */
+    enum class stage_type
+    {
+      /** Replaces each element with result of a quote. */
+      map = 0,
+      /** Skips elements for which a quote returns false. */
+      filter = 1,
+      /** Ends the sequence after given number of elements. */
+      take = 2,
+      /** Skips given number of elements. */
+      drop = 3
+    };
+
+    /**
+     * Single stage of a pipeline.
+     */
+    struct stage
+    {
+      /** Type of the stage. */
+      enum stage_type type;
+      /** Quote which map and filter stages call for each element. */
+      ref<class quote> quote;
+      /** Number of elements which take and drop stages count. */
+      std::size_t count;
+    };
+
+    /**
+     * Produces elements of a sequence one by one. Each consumption of a
+     * sequence uses an iterator of its own, so that the sequence itself
+     * stays immutable.
+     */
+    class iterator
+    {
+    public:
+      virtual ~iterator();
+
+      /**
+       * Produces next element of the sequence.
+       *
+       * \param ctx  Execution context which is used for calling quotes of
+       *             the pipeline and for reporting errors.
+       * \param slot Where the element will be placed into.
+       * \param end  Will be set to true if the sequence has no more
+       *             elements.
+       * \return     Boolean flag which tells whether an error was
+       *             encountered or not.
+       */
+      virtual bool next(const ref<context>& ctx,
+                        ref<value>& slot,
+                        bool& end) = 0;
+    };
+
+    /**
+     * Returns type of the sequence.
+     */
+    virtual enum seq_type seq_type() const = 0;
+
+    /**
+     * Tests whether the sequence is of given type.
+     */
+    inline bool is(enum seq_type t) const
+    {
+      return seq_type() == t;
+    }
+
+    /**
+     * Begins new iteration over the elements of the sequence.
+     */
+    virtual std::unique_ptr<iterator> iterate() const = 0;
+
+    /**
+     * Returns sequence which applies given stage to elements of this
+     * sequence. Consecutive stages are collected into a single pipeline.
+     */
+    ref<seq> then(const ref<class runtime>& runtime,
+                  const struct stage& stage) const;
+
+    inline enum type type() const
+    {
+      return type::seq;
+    }
+
+    bool equals(const ref<value>& that) const;
+    std::size_t hash() const;
+    std::u32string to_string() const;
+    std::u32string to_source() const;
+  };
+}
@@ -25,6 +25,7 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <iterator>
 
 #include <plorth/value.hpp>
@@ -58,12 +59,111 @@ namespace plorth
      */
     virtual value_type at(size_type offset) const = 0;
 
+    /**
+     * Copies contents of the string into given buffer, which must have room
+     * for at least length() code points.
+     */
+    virtual void copy(pointer output) const;
+
+    /**
+     * Returns pointer to contiguous storage of the string beginning from
+     * given offset, or null pointer if the string has no such storage at that
+     * offset.
+     *
+     * \param offset Offset of the first code point, which must be less than
+     *               length of the string.
+     * \param size   Where number of code points which can be read through
+     *               the returned pointer will be assigned to.
+     */
+    virtual const_pointer chunk(size_type offset, size_type& size) const;
+
+    /**
+     * Returns pointer to contiguous code units of the string beginning from
+     * given offset, or null pointer if the string has no such storage at that
+     * offset. Unlike with chunk(), the code units can be narrower than code
+     * points: strings are stored as Latin-1, UCS-2 or UTF-32 depending on
+     * the largest code point they contain.
+     *
+     * \param offset Offset of the first code point, which must be less than
+     *               length of the string.
+     * \param size   Where number of code units which can be read through
+     *               the returned pointer will be assigned to.
+     * \param width  Where width of a single code unit in bytes (1, 2 or 4)
+     *               will be assigned to.
+     */
+    virtual const void* units(size_type offset,
+                              size_type& size,
+                              std::size_t& width) const;
+
+    /**
+     * Copies given number of code points beginning from given offset into
+     * given buffer.
+     */
+    void read(size_type offset, size_type count, pointer output) const;
+
+    /**
+     * Invokes given callback with consecutive chunks of the string, each one
+     * given as a pointer to contiguous code points and number of code points
+     * in the chunk. Parts of the string which have no contiguous storage of
+     * code points are decoded into a temporary buffer first. Iteration stops
+     * if the callback returns false.
+     *
+     * \return Boolean flag which tells whether every chunk was visited.
+     */
+    template<class Callback>
+    bool for_each_chunk(Callback callback) const
+    {
+      const auto len = length();
+      value_type buffer[64];
+
+      for (size_type offset = 0; offset < len;)
+      {
+        size_type size;
+        const_pointer data = chunk(offset, size);
+
+        if (!data)
+        {
+          size = std::min<size_type>(len - offset, 64);
+          read(offset, size, buffer);
+          data = buffer;
+        }
+        if (!callback(data, size))
+        {
+          return false;
+        }
+        offset += size;
+      }
+
+      return true;
+    }
+
+    /**
+     * Compares code points of the string lexicographically against code
+     * points of another string.
+     *
+     * eturn Negative value if this string comes before the other one,
+     *         positive value if it comes after it and zero if the strings are
+     *         equal.
+     */
+    int compare(const string& that) const;
+
+    /**
+     * Returns depth of the rope which the string has been built from.
+     * Strings which are not concatenations of other strings have depth of
+     * zero.
+     */
+    virtual std::size_t depth() const
+    {
+      return 0;
+    }
+
     enum type type() const
     {
       return type::string;
     }
 
-    bool equals(const std::shared_ptr<class value>& that) const;
+    bool equals(const ref<class value>& that) const;
+    std::size_t hash() const;
     std::u32string to_string() const;
     std::u32string to_source() const;
   };
@@ -80,7 +180,7 @@ namespace plorth
     using reference = value_type&;
     using iterator_category = std::forward_iterator_tag;
 
-    iterator(const std::shared_ptr<string>& str, string::size_type index = 0);
+    iterator(const ref<string>& str, string::size_type index = 0);
     iterator(const iterator& that);
     iterator& operator=(const iterator& that);
 
@@ -93,17 +193,17 @@ namespace plorth
 
   private:
     /** Reference to string which is being iterated. */
-    std::shared_ptr<string> m_string;
+    ref<string> m_string;
     /** Current offset in the iterated string. */
     array::size_type m_index;
   };
 
-  inline string::iterator begin(const std::shared_ptr<string>& str)
+  inline string::iterator begin(const ref<string>& str)
   {
     return string::iterator(str);
   }
 
-  inline string::iterator end(const std::shared_ptr<string>& str)
+  inline string::iterator end(const ref<string>& str)
   {
     return string::iterator(str, str->length());
   }
@@ -27,13 +27,10 @@
 
 #include <optional>
 
-#include <plorth/parser/position.hpp>
+#include <plorth/cell.hpp>
+#include <plorth/source-position.hpp>
 #include <plorth/value.hpp>
 
-#if PLORTH_ENABLE_MUTEXES
-# include <mutex>
-#endif
-
 namespace plorth
 {
   /**
@@ -50,7 +47,7 @@ namespace plorth
      *                 encountered.
      */
     explicit symbol(
-      const std::u32string& id,
+      const class atom& id,
       const std::optional<parser::position>& position
         = std::optional<parser::position>()
     );
@@ -60,53 +57,72 @@ namespace plorth
      */
     inline const std::u32string& id() const
     {
-      return m_id;
+      return m_atom.name();
+    }
+
+    /**
+     * Returns the interned identifier of the symbol.
+     */
+    inline const class atom& atom() const
+    {
+      return m_atom;
     }
 
     /**
      * Returns position of the symbol in source code, or null pointer if no
      * such information is available.
      */
-    inline const std::optional<parser::position>& position() const
+    inline const std::optional<source_position>& position() const
     {
       return m_position;
     }
 
     /**
-     * Calculates hash code for the symbol, based on the identifier that
+     * Returns the value which the symbol stands for, if the symbol is a
+     * number literal or one of the constants null, true and false, or null
+     * pointer if it's not. Literals can still be shadowed by prototypes and
+     * words, so the value is used only when neither of those define the
+     * symbol.
+     */
+    inline const cell* literal() const
+    {
+      return m_literal ? &*m_literal : nullptr;
+    }
+
+    /**
+     * Returns hash code for the symbol, based on the identifier that
      * represents the symbol.
      */
-    std::size_t hash() const;
+    inline std::size_t hash() const
+    {
+      return std::hash<class atom>()(m_atom);
+    }
 
     inline enum type type() const
     {
       return type::symbol;
     }
 
-    bool equals(const std::shared_ptr<value>& that) const;
+    bool equals(const ref<value>& that) const;
     std::u32string to_string() const;
     std::u32string to_source() const;
 
   private:
     /** Identifier of the symbol. */
-    const std::u32string m_id;
+    const class atom m_atom;
     /** Position of the symbol in source code. */
-    const std::optional<parser::position> m_position;
-    /** Cached hash code of the symbol. */
-    std::size_t m_hash;
-#if PLORTH_ENABLE_MUTEXES
-    /** Used to implement thread safety in hash calculation. */
-    std::mutex m_mutex;
-#endif
+    const std::optional<source_position> m_position;
+    /** Value of the symbol, if it's a literal. */
+    const std::optional<cell> m_literal;
   };
 }
 
 namespace std
 {
   template<>
-  struct hash<shared_ptr<plorth::symbol>>
+  struct hash<plorth::ref<plorth::symbol>>
   {
-    using argument_type = shared_ptr<plorth::symbol>;
+    using argument_type = plorth::ref<plorth::symbol>;
     using result_type = std::size_t;
 
     inline result_type operator()(const argument_type& key) const
@@ -116,9 +132,9 @@ namespace std
   };
 
   template<>
-  struct equal_to<shared_ptr<plorth::symbol>>
+  struct equal_to<plorth::ref<plorth::symbol>>
   {
-    using first_argument_type = shared_ptr<plorth::symbol>;
+    using first_argument_type = plorth::ref<plorth::symbol>;
     using second_argument_type = first_argument_type;
     using result_type = bool;
 
@@ -127,7 +143,7 @@ namespace std
     {
       if (lhs && rhs)
       {
-        return lhs->id() == rhs->id();
+        return lhs->atom() == rhs->atom();
       } else {
         return !lhs && !rhs;
       }
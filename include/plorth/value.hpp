@@ -25,11 +25,12 @@
  */
 #pragma once
 
-#include <plorth/memory.hpp>
+#include <plorth/ref.hpp>
 #include <plorth/unicode.hpp>
 
 namespace plorth
 {
+  class cell;
   class context;
   class object;
 
@@ -63,7 +64,9 @@ namespace plorth
       /** Words. */
       word = 8,
       /** Errors. */
-      error = 9
+      error = 9,
+      /** Lazy sequences. */
+      seq = 10
     };
 
     /**
@@ -84,11 +87,17 @@ namespace plorth
     /**
      * Tests whether given value is of given type.
      */
-    static inline bool is(const std::shared_ptr<value>& val, enum type t)
+    static inline bool is(const ref<value>& val, enum type t)
     {
       return val ? val->is(t) : t == type::null;
     }
 
+    /**
+     * Tests whether value contained in given data stack cell is of given
+     * type.
+     */
+    static bool is(const cell& c, enum type t);
+
     /**
      * Tests whether the value is of given type.
      */
@@ -105,8 +114,8 @@ namespace plorth
      * \param runtime Script runtime to use for prototype retrieval.
      * \return        Prototype object of the value.
      */
-    std::shared_ptr<object> prototype(
-      const std::shared_ptr<class runtime>& runtime
+    ref<object> prototype(
+      const ref<class runtime>& runtime
     ) const;
 
     /**
@@ -114,7 +123,22 @@ namespace plorth
      *
      * \param that Other value to test this one against.
      */
-    virtual bool equals(const std::shared_ptr<value>& that) const = 0;
+    virtual bool equals(const ref<value>& that) const = 0;
+
+    /**
+     * Returns hash code of the value. Hash code is consistent with equals(),
+     * so values which are equal to each other have identical hash codes.
+     */
+    virtual std::size_t hash() const = 0;
+
+    /**
+     * Returns hash code of given value. Null references have hash code of
+     * zero.
+     */
+    static inline std::size_t hash(const ref<value>& val)
+    {
+      return val ? val->hash() : 0;
+    }
 
     /**
      * Executes value as part of compiled quote. Default implementation
@@ -125,8 +149,8 @@ namespace plorth
      * \return    Boolean flag telling whether the execution was successfull or
      *            whether an error was encountered.
      */
-    static bool exec(const std::shared_ptr<context>& ctx,
-                     const std::shared_ptr<value>& val);
+    static bool exec(const ref<context>& ctx,
+                     const ref<value>& val);
 
     /**
      * Evaluates value as element of an array or value of object's property.
@@ -138,9 +162,9 @@ namespace plorth
      * \return     Boolean flag telling whether the execution was successful or
      *             whether an error was encountered.
      */
-    static bool eval(const std::shared_ptr<context>& ctx,
-                     const std::shared_ptr<value>& val,
-                     std::shared_ptr<value>& slot);
+    static bool eval(const ref<context>& ctx,
+                     const ref<value>& val,
+                     ref<value>& slot);
 
     /**
      * Constructs string representation of the value.
@@ -154,8 +178,8 @@ namespace plorth
     virtual std::u32string to_source() const = 0;
   };
 
-  bool operator==(const std::shared_ptr<value>&, const std::shared_ptr<value>&);
-  bool operator!=(const std::shared_ptr<value>&, const std::shared_ptr<value>&);
+  bool operator==(const ref<value>&, const ref<value>&);
+  bool operator!=(const ref<value>&, const ref<value>&);
 
   std::ostream& operator<<(std::ostream&, enum value::type);
   std::ostream& operator<<(std::ostream&, const value*);
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <plorth/atom.hpp>
+
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#if PLORTH_ENABLE_MUTEXES
+# include <mutex>
+# include <shared_mutex>
+#endif
+
+namespace plorth
+{
+  struct atom::table
+  {
+    /** Entries of the table. Deque is used so that they never move. */
+    std::deque<entry> entries;
+    /** IDs of entries which are no longer in use. */
+    std::vector<id_type> unused;
+    /** Index of the entries, keyed by views to names of the entries. */
+    std::unordered_map<std::u32string_view, entry*> index;
+#if PLORTH_ENABLE_MUTEXES
+    /** Used to implement thread safety in the table. */
+    std::shared_mutex mutex;
+#endif
+
+    /**
+     * Looks for entry with given name and adds a reference to it. The lock
+     * must be held, but a shared one is enough.
+     */
+    const entry* find(const std::u32string& name) const
+    {
+      const auto it = index.find(name);
+
+      if (it == std::end(index))
+      {
+        return nullptr;
+      }
+      // The count might be zero if the last atom of the entry was just
+      // destroyed. That's fine, since remove() checks the count again while
+      // holding an exclusive lock.
+      else if (!it->second->persistent)
+      {
+        it->second->references.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      return it->second;
+    }
+
+    /**
+     * Looks for entry with given name and adds a reference to it, inserting
+     * new entry if there isn't one yet. Persistent entries are never removed
+     * from the table. Whether an entry is persistent is decided when it's
+     * created and never changes after that, so existing entries are kept in
+     * the table by a reference which is never released.
+     */
+    const entry* insert(const std::u32string& name, bool persistent = false)
+    {
+      const entry* e;
+
+      {
+#if PLORTH_ENABLE_MUTEXES
+        std::shared_lock<std::shared_mutex> lock(mutex);
+#endif
+
+        if ((e = find(name)))
+        {
+          return pin(e, persistent);
+        }
+      }
+
+#if PLORTH_ENABLE_MUTEXES
+      std::unique_lock<std::shared_mutex> lock(mutex);
+#endif
+      entry* slot;
+
+      // Another thread might have inserted the atom while the lock was not
+      // being held.
+      if ((e = find(name)))
+      {
+        return pin(e, persistent);
+      }
+
+      if (unused.empty())
+      {
+        slot = &entries.emplace_back(static_cast<id_type>(entries.size()));
+      } else {
+        slot = &entries[unused.back()];
+        unused.pop_back();
+      }
+      slot->name = name;
+      slot->references.store(1, std::memory_order_relaxed);
+      slot->persistent = persistent;
+      slot->used = true;
+      index[slot->name] = slot;
+
+      return slot;
+    }
+
+    static const entry* pin(const entry* e, bool persistent)
+    {
+      if (persistent && !e->persistent)
+      {
+        e->references.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      return e;
+    }
+  };
+
+  atom::table& atom::get_table()
+  {
+    static table instance;
+
+    return instance;
+  }
+
+  void atom::remove(const entry* e)
+  {
+    auto& table = get_table();
+#if PLORTH_ENABLE_MUTEXES
+    std::unique_lock<std::shared_mutex> lock(table.mutex);
+#endif
+    auto slot = &table.entries[e->id];
+
+    // The entry might have been looked up again, or even removed and reused
+    // by another thread, while the lock was not being held.
+    if (!slot->used ||
+        slot->persistent ||
+        slot->references.load(std::memory_order_acquire) != 0)
+    {
+      return;
+    }
+    table.index.erase(slot->name);
+    slot->used = false;
+    slot->name.clear();
+    slot->name.shrink_to_fit();
+    table.unused.push_back(slot->id);
+  }
+
+  atom::atom()
+  {
+    static const entry* empty = get_table().insert(std::u32string(), true);
+
+    m_entry = empty;
+  }
+
+  atom::atom(const std::u32string& name)
+    : m_entry(get_table().insert(name)) {}
+
+  atom::atom(const char32_t* name)
+    : atom(std::u32string(name)) {}
+
+  bool atom::find(const std::u32string& name, atom& slot)
+  {
+    auto& table = get_table();
+    const entry* e;
+
+    {
+#if PLORTH_ENABLE_MUTEXES
+      std::shared_lock<std::shared_mutex> lock(table.mutex);
+#endif
+
+      e = table.find(name);
+    }
+
+    if (e)
+    {
+      slot = atom(e);
+
+      return true;
+    }
+
+    return false;
+  }
+
+  atom atom::persistent(const std::u32string& name)
+  {
+    return atom(get_table().insert(name, true));
+  }
+
+  atom atom::from_id(id_type id)
+  {
+    auto& table = get_table();
+#if PLORTH_ENABLE_MUTEXES
+    std::shared_lock<std::shared_mutex> lock(table.mutex);
+#endif
+    const auto e = &table.entries[id];
+
+    if (!e->persistent)
+    {
+      e->references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return atom(e);
+  }
+}
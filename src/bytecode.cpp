@@ -0,0 +1,843 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <plorth/context.hpp>
+#include <plorth/value-word.hpp>
+
+#include "./bytecode.hpp"
+
+#include <utility>
+
+namespace plorth
+{
+  namespace bytecode
+  {
+    static const std::pair<const char32_t*, enum opcode> stack_words[] =
+    {
+      { U"drop", opcode::drop },
+      { U"2drop", opcode::drop2 },
+      { U"dup", opcode::dup },
+      { U"2dup", opcode::dup2 },
+      { U"nip", opcode::nip },
+      { U"over", opcode::over },
+      { U"rot", opcode::rot },
+      { U"swap", opcode::swap },
+      { U"tuck", opcode::tuck }
+    };
+
+    static bool is_constant(const ref<value>&);
+    static cell to_cell(const ref<value>&);
+    static bool is_shadowed_by_prototype(
+      const ref<class runtime>&,
+      const atom&
+    );
+    static const ref<object>& builtin_prototype(
+      const ref<class runtime>&,
+      const cell&
+    );
+    static inline bool lookup_property(
+      const ref<context>&,
+      const call_site&,
+      inline_cache&,
+      ref<value>&
+    );
+    static inline const word* lookup_word(
+      const ref<context>&,
+      const call_site&,
+      word_cache&,
+      ref<word>&
+    );
+    static inline void update_position(const ref<context>&, const call_site&);
+    static inline bool call_quote(const ref<context>&, const cell&);
+
+    program::program(
+      const ref<class runtime>& runtime,
+      const std::vector<ref<value>>& values
+    )
+    {
+      m_code.reserve(values.size());
+      for (const auto& value : values)
+      {
+        if (!value)
+        {
+          emit(opcode::push, add_constant(cell()));
+          continue;
+        }
+        switch (value->type())
+        {
+          case value::type::symbol:
+            emit_symbol(runtime, ref_cast<class symbol>(value));
+            break;
+
+          case value::type::word:
+            emit(opcode::define, add_constant(value));
+            break;
+
+          case value::type::array:
+          case value::type::object:
+            emit(
+              is_constant(value) ? opcode::push : opcode::eval,
+              add_constant(value)
+            );
+            break;
+
+          default:
+            emit(opcode::push, add_constant(to_cell(value)));
+            break;
+        }
+      }
+      m_caches.reset(new call_site_cache[m_call_sites.size()]);
+    }
+
+    std::uint32_t program::add_constant(const cell& constant)
+    {
+      m_constants.push_back(constant);
+
+      return static_cast<std::uint32_t>(m_constants.size() - 1);
+    }
+
+    void program::emit(enum opcode opcode, std::uint32_t operand)
+    {
+      m_code.push_back({ opcode, operand });
+    }
+
+    /**
+     * Returns index of the quote constant pushed by the instruction that is
+     * given number of instructions before the end of the program, or -1 if
+     * there is no such instruction.
+     */
+    static long quote_constant(
+      const std::vector<instruction>& code,
+      const std::vector<cell>& constants,
+      std::size_t offset
+    )
+    {
+      if (code.size() < offset)
+      {
+        return -1;
+      }
+
+      const auto& instruction = code[code.size() - offset];
+
+      if (instruction.opcode != opcode::push ||
+          !constants[instruction.operand].is(value::type::quote))
+      {
+        return -1;
+      }
+
+      return static_cast<long>(instruction.operand);
+    }
+
+    void program::emit_symbol(
+      const ref<class runtime>& runtime,
+      const ref<class symbol>& symbol
+    )
+    {
+      const auto& id = symbol->id();
+      ref<class word> word;
+      call_site site;
+
+      // When quote literal is immediately followed by `call`, the quote is
+      // guaranteed to be the top-most value of the stack, making the word
+      // resolve into `call` of the quote prototype, which cannot be
+      // overridden.
+      if (!id.compare(U"call"))
+      {
+        const auto index = quote_constant(m_code, m_constants, 1);
+
+        if (index >= 0)
+        {
+          m_code.back().opcode = opcode::call_quote;
+
+          return;
+        }
+      }
+
+      site.symbol = symbol;
+      site.builtin_property = is_shadowed_by_prototype(
+        runtime,
+        symbol->atom()
+      );
+      site.then_quote = site.else_quote = site.literal = 0;
+
+      // Literals are pushed as values for as long as they are not shadowed.
+      // Any word with the same name shadows the literal, so the word which
+      // the symbol might resolve into is not remembered here.
+      if (const auto literal = symbol->literal())
+      {
+        site.literal = add_constant(*literal);
+        m_call_sites.push_back(site);
+        emit(
+          opcode::push_literal,
+          static_cast<std::uint32_t>(m_call_sites.size() - 1)
+        );
+
+        return;
+      }
+
+      // Rest of the special instructions require the symbol to be resolved
+      // into a global word, which is not shadowed by any of the builtin
+      // prototypes.
+      if (!(word = runtime->dictionary().find(symbol)) ||
+          site.builtin_property)
+      {
+        m_call_sites.push_back(site);
+        emit(
+          opcode::call,
+          static_cast<std::uint32_t>(m_call_sites.size() - 1)
+        );
+
+        return;
+      }
+      site.word = word;
+
+      if (!id.compare(U"if"))
+      {
+        const auto then_index = quote_constant(m_code, m_constants, 1);
+
+        if (then_index >= 0)
+        {
+          site.then_quote = static_cast<std::uint32_t>(then_index);
+          m_code.pop_back();
+          m_call_sites.push_back(site);
+          emit(
+            opcode::branch_if,
+            static_cast<std::uint32_t>(m_call_sites.size() - 1)
+          );
+
+          return;
+        }
+      }
+      else if (!id.compare(U"if-else"))
+      {
+        const auto then_index = quote_constant(m_code, m_constants, 2);
+        const auto else_index = quote_constant(m_code, m_constants, 1);
+
+        if (then_index >= 0 && else_index >= 0)
+        {
+          site.then_quote = static_cast<std::uint32_t>(then_index);
+          site.else_quote = static_cast<std::uint32_t>(else_index);
+          m_code.pop_back();
+          m_code.pop_back();
+          m_call_sites.push_back(site);
+          emit(
+            opcode::branch_if_else,
+            static_cast<std::uint32_t>(m_call_sites.size() - 1)
+          );
+
+          return;
+        }
+      }
+
+      m_call_sites.push_back(site);
+      for (const auto& entry : stack_words)
+      {
+        if (!id.compare(entry.first))
+        {
+          emit(
+            entry.second,
+            static_cast<std::uint32_t>(m_call_sites.size() - 1)
+          );
+
+          return;
+        }
+      }
+      emit(
+        opcode::call_word,
+        static_cast<std::uint32_t>(m_call_sites.size() - 1)
+      );
+    }
+
+    bool program::execute(const ref<context>& ctx) const
+    {
+      auto& stack = ctx->data();
+
+      for (const auto& instruction : m_code)
+      {
+        const auto operand = instruction.operand;
+
+        switch (instruction.opcode)
+        {
+          case opcode::push:
+            stack.push_back(m_constants[operand]);
+            continue;
+
+          case opcode::eval:
+            {
+              ref<value> slot;
+
+              if (!value::eval(ctx, m_constants[operand].boxed(), slot))
+              {
+                return false;
+              }
+              ctx->push(std::move(slot));
+            }
+            continue;
+
+          case opcode::define:
+            if (!value::exec(ctx, m_constants[operand].boxed()))
+            {
+              return false;
+            }
+            continue;
+
+          case opcode::call_quote:
+            if (!call_quote(ctx, m_constants[operand]))
+            {
+              return false;
+            }
+            continue;
+
+          default:
+            break;
+        }
+
+        // Rest of the instructions operate on call sites.
+        const auto& site = m_call_sites[operand];
+        auto& cache = m_caches[operand];
+        const auto size = stack.size();
+        // The property is held here, because the cache does not own it and
+        // the call could replace the entry which it was found from.
+        ref<value> property;
+        // Result of word lookup which a concurrent context could not store
+        // into the cache of the call site.
+        ref<word> word_scratch;
+        bool result = true;
+
+        if (instruction.opcode == opcode::branch_if ||
+            instruction.opcode == opcode::branch_if_else)
+        {
+          if (size > 0 &&
+              stack.back().is(value::type::boolean) &&
+              lookup_word(ctx, site, cache.words, word_scratch) ==
+                site.word.get())
+          {
+            const bool condition = stack.back().as_boolean();
+
+            stack.pop_back();
+            if (instruction.opcode == opcode::branch_if)
+            {
+              result = !condition || call_quote(
+                ctx,
+                m_constants[site.then_quote]
+              );
+            } else {
+              result = call_quote(
+                ctx,
+                m_constants[condition ? site.then_quote : site.else_quote]
+              );
+            }
+          } else {
+            // Fall back to full word lookup, with the quotes in the stack.
+            stack.push_back(m_constants[site.then_quote]);
+            if (instruction.opcode == opcode::branch_if_else)
+            {
+              stack.push_back(m_constants[site.else_quote]);
+            }
+            result = exec_sym(ctx, site.symbol);
+          }
+        }
+        else if (lookup_property(ctx, site, cache.properties, property))
+        {
+          update_position(ctx, site);
+          if (value::is(property, value::type::quote))
+          {
+            result = static_cast<const quote*>(property.get())->call(ctx);
+          } else {
+            ctx->push(std::move(property));
+          }
+        }
+        else if (instruction.opcode == opcode::push_literal)
+        {
+          if (const auto word = lookup_word(
+                ctx,
+                site,
+                cache.words,
+                word_scratch
+              ))
+          {
+            const auto quote = word->quote();
+
+            update_position(ctx, site);
+            result = quote->call(ctx);
+          } else {
+            stack.push_back(m_constants[site.literal]);
+          }
+        }
+        else if (const auto word = lookup_word(ctx, site, cache.words, word_scratch);
+                 !word || word != site.word.get())
+        {
+          // Either the symbol was not resolved during compilation, or the
+          // resolved word has been shadowed or removed.
+          update_position(ctx, site);
+          if (word)
+          {
+            // The cache does not own the word, so the quote is held here in
+            // case the word gets redefined while it's being called.
+            const auto quote = word->quote();
+
+            result = quote->call(ctx);
+          } else {
+            result = exec_sym_word(ctx, site.symbol);
+          }
+        }
+        else if (instruction.opcode == opcode::call_word)
+        {
+          update_position(ctx, site);
+          result = site.word->quote()->call(ctx);
+        } else {
+          // Stack manipulation words. If there are not enough values in the
+          // stack, the builtin word is called so that it reports the error.
+          switch (instruction.opcode)
+          {
+            case opcode::drop:
+              if ((result = size >= 1))
+              {
+                stack.pop_back();
+              }
+              break;
+
+            case opcode::drop2:
+              if ((result = size >= 2))
+              {
+                stack.pop_back();
+                stack.pop_back();
+              }
+              break;
+
+            case opcode::dup:
+              if ((result = size >= 1))
+              {
+                stack.push_back(stack[size - 1]);
+              }
+              break;
+
+            case opcode::dup2:
+              if ((result = size >= 2))
+              {
+                stack.push_back(stack[size - 2]);
+                stack.push_back(stack[size - 1]);
+              }
+              break;
+
+            case opcode::nip:
+              if ((result = size >= 2))
+              {
+                stack[size - 2] = std::move(stack[size - 1]);
+                stack.pop_back();
+              }
+              break;
+
+            case opcode::over:
+              if ((result = size >= 2))
+              {
+                stack.push_back(stack[size - 2]);
+              }
+              break;
+
+            case opcode::rot:
+              if ((result = size >= 3))
+              {
+                std::swap(stack[size - 3], stack[size - 2]);
+                std::swap(stack[size - 2], stack[size - 1]);
+              }
+              break;
+
+            case opcode::swap:
+              if ((result = size >= 2))
+              {
+                std::swap(stack[size - 2], stack[size - 1]);
+              }
+              break;
+
+            case opcode::tuck:
+              if ((result = size >= 2))
+              {
+                std::swap(stack[size - 2], stack[size - 1]);
+                stack.push_back(stack[size - 2]);
+              }
+              break;
+
+            default:
+              break;
+          }
+          if (!result)
+          {
+            update_position(ctx, site);
+            result = site.word->quote()->call(ctx);
+          }
+        }
+
+        if (!result)
+        {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    /**
+     * Tests whether given value can be pushed into the stack as it is,
+     * without having to evaluate it first.
+     */
+    static bool is_constant(const ref<value>& val)
+    {
+      if (!val)
+      {
+        return true;
+      }
+      switch (val->type())
+      {
+        case value::type::symbol:
+        case value::type::word:
+          return false;
+
+        case value::type::array:
+          {
+            const auto ary = ref_cast<array>(val);
+
+            for (array::size_type i = 0; i < ary->size(); ++i)
+            {
+              if (!is_constant(ary->at(i)))
+              {
+                return false;
+              }
+            }
+          }
+          break;
+
+        case value::type::object:
+          return ref_cast<object>(val)->for_each(
+            [](const object::key_type&, const object::mapped_type& value)
+            {
+              return is_constant(value);
+            }
+          );
+
+        default:
+          break;
+      }
+
+      return true;
+    }
+
+    /**
+     * Converts numbers and booleans into immediate cells.
+     */
+    static cell to_cell(const ref<value>& val)
+    {
+      if (value::is(val, value::type::number))
+      {
+        const auto num = ref_cast<number>(val);
+
+        if (num->is(number::number_type::integer))
+        {
+          return cell::make_int(num->as_int());
+        }
+
+        return cell::make_real(num->as_real());
+      }
+      else if (value::is(val, value::type::boolean))
+      {
+        return cell::make_boolean(ref_cast<boolean>(val)->value());
+      }
+
+      return cell(val);
+    }
+
+    /**
+     * Tests whether any of the builtin prototypes contains property with given
+     * name, in which case the word lookup depends on the type of the top-most
+     * value of the stack.
+     */
+    static bool is_shadowed_by_prototype(
+      const ref<class runtime>& runtime,
+      const atom& id
+    )
+    {
+      const ref<object> prototypes[] =
+      {
+        runtime->array_prototype(),
+        runtime->boolean_prototype(),
+        runtime->error_prototype(),
+        runtime->number_prototype(),
+        runtime->object_prototype(),
+        runtime->quote_prototype(),
+        runtime->seq_prototype(),
+        runtime->string_prototype(),
+        runtime->symbol_prototype(),
+        runtime->word_prototype()
+      };
+
+      for (const auto& prototype : prototypes)
+      {
+        if (prototype && prototype->has_property(runtime, id))
+        {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    /**
+     * Returns builtin prototype of given value, which must not be an object.
+     */
+    static const ref<object>& builtin_prototype(
+      const ref<class runtime>& runtime,
+      const cell& value
+    )
+    {
+      switch (value.type())
+      {
+        case value::type::boolean:
+          return runtime->boolean_prototype();
+
+        case value::type::number:
+          return runtime->number_prototype();
+
+        case value::type::string:
+          return runtime->string_prototype();
+
+        case value::type::array:
+          return runtime->array_prototype();
+
+        case value::type::symbol:
+          return runtime->symbol_prototype();
+
+        case value::type::quote:
+          return runtime->quote_prototype();
+
+        case value::type::word:
+          return runtime->word_prototype();
+
+        case value::type::error:
+          return runtime->error_prototype();
+
+        case value::type::seq:
+          return runtime->seq_prototype();
+
+        default:
+          return runtime->object_prototype();
+      }
+    }
+
+    /**
+     * Looks for the symbol of the call site from prototype of the top-most
+     * value of the stack, using the inline cache of the call site. Value of
+     * the property is assigned into given slot, and false is returned if the
+     * prototype does not have such property.
+     */
+    static inline bool lookup_property(
+      const ref<context>& ctx,
+      const call_site& site,
+      inline_cache& cache,
+      ref<value>& slot
+    )
+    {
+      const auto& stack = ctx->data();
+      const auto& runtime = ctx->runtime();
+      ref<object> object_prototype;
+      const ref<object>* prototype;
+      inline_cache::entry* entry;
+
+      if (stack.empty())
+      {
+        return false;
+      }
+
+      const auto& top = stack.back();
+
+      if (top.is(value::type::object))
+      {
+        object_prototype = top.prototype(runtime);
+        prototype = &object_prototype;
+      }
+      // Symbols which none of the builtin prototypes have as property do
+      // not need to be looked up from them.
+      else if (!site.builtin_property || top.is(value::type::null))
+      {
+        return false;
+      } else {
+        prototype = &builtin_prototype(runtime, top);
+      }
+      if (!*prototype)
+      {
+        return false;
+      }
+
+      const auto id = (*prototype)->id();
+      const auto count = cache.count.load(std::memory_order_acquire);
+
+      for (std::uint8_t i = 0; i < count; ++i)
+      {
+        entry = &cache.entries[i];
+        if (entry->prototype == id)
+        {
+          if (entry->found)
+          {
+            slot = ref<value>(const_cast<value*>(entry->property));
+          }
+
+          return entry->found;
+        }
+      }
+
+      // Cache miss. Concurrent contexts may only fill a free entry, and only
+      // when no other context is filling one. Otherwise they look up the
+      // property without storing the result.
+      if (ctx->concurrent())
+      {
+        if (count < inline_cache::size &&
+            !cache.filling.test_and_set(std::memory_order_acquire))
+        {
+          const auto index = cache.count.load(std::memory_order_relaxed);
+
+          if (index < inline_cache::size)
+          {
+            entry = &cache.entries[index];
+            entry->prototype = id;
+            entry->found = (*prototype)->property(
+              runtime,
+              site.symbol->atom(),
+              slot
+            );
+            entry->property = entry->found ? slot.get() : nullptr;
+            cache.count.store(index + 1, std::memory_order_release);
+            cache.filling.clear(std::memory_order_release);
+
+            return entry->found;
+          }
+          cache.filling.clear(std::memory_order_release);
+        }
+
+        return (*prototype)->property(runtime, site.symbol->atom(), slot);
+      }
+
+      // Use free entry if there is one, otherwise replace the entries in
+      // round robin order.
+      if (count < inline_cache::size)
+      {
+        entry = &cache.entries[count];
+        cache.count.store(count + 1, std::memory_order_relaxed);
+      } else {
+        entry = &cache.entries[cache.next];
+        cache.next = (cache.next + 1) % inline_cache::size;
+      }
+      entry->prototype = id;
+      entry->found = (*prototype)->property(
+        runtime,
+        site.symbol->atom(),
+        slot
+      );
+      entry->property = entry->found ? slot.get() : nullptr;
+
+      return entry->found;
+    }
+
+    /**
+     * Looks for the symbol of the call site from dictionary of the context
+     * and the global dictionary. Result of the lookup is cached in the call
+     * site and reused for as long as the dictionaries are not modified.
+     */
+    static inline const word* lookup_word(
+      const ref<context>& ctx,
+      const call_site& site,
+      word_cache& cache,
+      ref<word>& scratch
+    )
+    {
+      const auto& local = ctx->dictionary();
+      const auto& global = ctx->runtime()->dictionary();
+      const auto valid = cache.valid.load(std::memory_order_acquire);
+
+      if (valid &&
+          cache.local_version == local.version() &&
+          cache.global_version == global.version())
+      {
+        return cache.word;
+      }
+
+      // Concurrent contexts fill the cache only if it has never been filled
+      // before, because other contexts may be reading it.
+      if (ctx->concurrent())
+      {
+        if (!valid && !cache.filling.test_and_set(std::memory_order_acquire))
+        {
+          if (!cache.valid.load(std::memory_order_relaxed))
+          {
+            if (!(scratch = local.find(site.symbol)))
+            {
+              scratch = global.find(site.symbol);
+            }
+            cache.word = scratch.get();
+            cache.local_version = local.version();
+            cache.global_version = global.version();
+            cache.valid.store(true, std::memory_order_release);
+            cache.filling.clear(std::memory_order_release);
+
+            return cache.word;
+          }
+          cache.filling.clear(std::memory_order_release);
+        }
+        if (!(scratch = local.find(site.symbol)))
+        {
+          scratch = global.find(site.symbol);
+        }
+
+        return scratch.get();
+      }
+
+      if (!(scratch = local.find(site.symbol)))
+      {
+        scratch = global.find(site.symbol);
+      }
+      cache.word = scratch.get();
+      cache.local_version = local.version();
+      cache.global_version = global.version();
+      cache.valid.store(true, std::memory_order_relaxed);
+
+      return cache.word;
+    }
+
+    static inline bool call_quote(const ref<context>& ctx,
+                                  const cell& constant)
+    {
+      return static_cast<const quote*>(constant.boxed().get())->call(ctx);
+    }
+
+    static inline void update_position(const ref<context>& ctx,
+                                       const call_site& site)
+    {
+      const auto& position = site.symbol->position();
+
+      if (position)
+      {
+        ctx->position() = *position;
+      }
+    }
+  }
+}
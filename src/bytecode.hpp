@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <plorth/context.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace plorth
+{
+  namespace bytecode
+  {
+    /**
+     * Enumeration of different instructions understood by the bytecode
+     * interpreter.
+     */
+    enum class opcode : std::uint8_t
+    {
+      /** Pushes constant into the data stack. */
+      push,
+      /** Evaluates array or object literal and pushes the result. */
+      eval,
+      /** Inserts word constant into the dictionary of the context. */
+      define,
+      /** Executes symbol by performing full word lookup. */
+      call,
+      /** Pushes value of literal symbol, unless the symbol is shadowed. */
+      push_literal,
+      /** Calls global word resolved during compilation. */
+      call_word,
+      /** Calls quote constant, compiled from `(...) call`. */
+      call_quote,
+      /** Conditional call compiled from `(...) if`. */
+      branch_if,
+      /** Conditional call compiled from `(...) (...) if-else`. */
+      branch_if_else,
+      /** Stack manipulation words. */
+      drop,
+      drop2,
+      dup,
+      dup2,
+      nip,
+      over,
+      rot,
+      swap,
+      tuck
+    };
+
+    /**
+     * Single instruction of bytecode. Meaning of the operand depends on the
+     * opcode; it's either index of a constant or index of a call site.
+     */
+    struct instruction
+    {
+      enum opcode opcode;
+      std::uint32_t operand;
+    };
+
+    /**
+     * Polymorphic inline cache which remembers results of property lookups
+     * from prototypes of the values the call site has been executed with.
+     * Entries are keyed by identifier of the prototype; because objects are
+     * immutable, a prototype which is replaced is always a different object
+     * and the stale entry simply stops matching.
+     *
+     * Neither the prototype nor the property is owned by the cache, because
+     * methods of the prototype would then keep it alive through their own
+     * compiled quotes. The property is kept alive by the prototype, which
+     * is alive whenever its identifier matches, since identifiers of objects
+     * are never reused.
+     *
+     * Concurrent contexts only append entries into the cache, and publish
+     * them by incrementing the count once the entry has been filled, so that
+     * entries below the count can be read without locking. Entries are
+     * replaced only by contexts which are not concurrent.
+     */
+    struct inline_cache
+    {
+      /** Maximum number of prototypes remembered by the cache. */
+      static constexpr std::size_t size = 4;
+
+      struct entry
+      {
+        /** Identifier of the prototype the property was looked up from. */
+        object::id_type prototype = 0;
+        /** Value of the property, if it was found. */
+        const value* property = nullptr;
+        /** Whether the prototype has the property or not. */
+        bool found = false;
+      };
+
+      entry entries[size];
+      /** Number of entries which are in use. */
+      std::atomic<std::uint8_t> count{0};
+      /** Entry which will be replaced next when the cache is full. */
+      std::uint8_t next = 0;
+      /** Held by a concurrent context while it fills the next entry. */
+      std::atomic_flag filling = ATOMIC_FLAG_INIT;
+    };
+
+    /**
+     * Word which a symbol resolved into when it was last looked up from the
+     * dictionaries. The result stays valid for as long as versions of both
+     * dictionaries remain the same.
+     *
+     * The word is not owned by the cache, because a word which calls itself
+     * would then keep itself alive through it's own compiled quote. It's
+     * kept alive by the dictionaries for as long as their versions match.
+     *
+     * Concurrent contexts fill the cache only once, publishing it through
+     * the validity flag, and never modify it afterwards.
+     */
+    struct word_cache
+    {
+      /** Version of the dictionary of the context. */
+      dictionary::version_type local_version = 0;
+      /** Version of the global dictionary. */
+      dictionary::version_type global_version = 0;
+      /** The word which was found, or null pointer if there was none. */
+      const class word* word = nullptr;
+      /** Whether the symbol has been looked up at all. */
+      std::atomic<bool> valid{false};
+      /** Held by a concurrent context while it fills the cache. */
+      std::atomic_flag filling = ATOMIC_FLAG_INIT;
+    };
+
+    /**
+     * Caches of a single call site. These are kept apart from the call
+     * sites, because they cannot be copied while the program is being
+     * constructed.
+     */
+    struct call_site_cache
+    {
+      /** Results of prototype lookups performed by the call site. */
+      inline_cache properties;
+      /** Result of the latest dictionary lookup performed by the call site. */
+      word_cache words;
+    };
+
+    /**
+     * Call site is a symbol executed by the program. If the symbol was
+     * resolved into a global word during compilation, the resolution is
+     * verified before each call because dictionary of the context, global
+     * dictionary or prototype of the top-most value of the stack can shadow
+     * the word, and the general case is used if it no longer holds. Literal
+     * symbols are verified the same way, and pushed as values only when
+     * neither prototype nor any of the dictionaries define them.
+     */
+    struct call_site
+    {
+      /** Symbol which is executed. */
+      ref<class symbol> symbol;
+      /** Global word which the symbol was resolved into, if any. */
+      ref<class word> word;
+      /** Whether any of the builtin prototypes has property of that name. */
+      bool builtin_property;
+      /** Indexes of quote constants used by branch instructions. */
+      std::uint32_t then_quote;
+      std::uint32_t else_quote;
+      /** Index of the constant which literal symbol stands for. */
+      std::uint32_t literal;
+    };
+
+    /**
+     * Bytecode translated from the values of a compiled quote.
+     */
+    class program
+    {
+    public:
+      /**
+       * Translates sequence of values into bytecode.
+       *
+       * \param runtime Runtime which global dictionary and prototypes are
+       *                used for resolving symbols.
+       * \param values  Values of the compiled quote.
+       */
+      explicit program(
+        const ref<class runtime>& runtime,
+        const std::vector<ref<value>>& values
+      );
+
+      /**
+       * Executes the bytecode in given context.
+       *
+       * \param ctx Scripting context to execute the bytecode in.
+       * \return    Boolean flag which tells whether execution was performed
+       *            successfully without errors.
+       */
+      bool execute(const ref<context>& ctx) const;
+
+    private:
+      program(const program&) = delete;
+      program(program&&) = delete;
+      void operator=(const program&) = delete;
+      void operator=(program&&) = delete;
+
+      std::uint32_t add_constant(const cell& constant);
+      void emit(enum opcode opcode, std::uint32_t operand);
+      void emit_symbol(
+        const ref<class runtime>& runtime,
+        const ref<class symbol>& symbol
+      );
+
+    private:
+      /** Instructions of the program. */
+      std::vector<instruction> m_code;
+      /** Constants referenced by the instructions. */
+      std::vector<cell> m_constants;
+      /** Resolved call sites referenced by the instructions. */
+      std::vector<call_site> m_call_sites;
+      /** Caches of the call sites, one for each call site. */
+      std::unique_ptr<call_site_cache[]> m_caches;
+    };
+  }
+
+  /**
+   * Executes symbol by looking it up from prototype of the top-most value of
+   * the stack, dictionary of the context and the global dictionary.
+   */
+  bool exec_sym(const ref<context>& ctx, const ref<symbol>& sym);
+
+  /**
+   * Executes symbol by looking it up from dictionary of the context and the
+   * global dictionary, skipping the prototype lookup.
+   */
+  bool exec_sym_word(const ref<context>& ctx, const ref<symbol>& sym);
+}
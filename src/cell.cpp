@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <plorth/context.hpp>
+
+#include "./utils.hpp"
+
+#include <cmath>
+
+namespace plorth
+{
+  cell::cell(const ref<class value>& value) noexcept
+    : m_kind(value ? kind::boxed : kind::null)
+  {
+    if (value)
+    {
+      new (&m_value) ref<class value>(value);
+    } else {
+      m_int = 0;
+    }
+  }
+
+  cell::cell(ref<class value>&& value) noexcept
+    : m_kind(value ? kind::boxed : kind::null)
+  {
+    if (value)
+    {
+      new (&m_value) ref<class value>(std::move(value));
+    } else {
+      m_int = 0;
+    }
+  }
+
+  cell::cell(const cell& that) noexcept
+    : m_kind(that.m_kind)
+  {
+    if (m_kind == kind::boxed)
+    {
+      new (&m_value) ref<class value>(that.m_value);
+    } else {
+      copy_immediate(that);
+    }
+  }
+
+  cell::cell(cell&& that) noexcept
+    : m_kind(that.m_kind)
+  {
+    if (m_kind == kind::boxed)
+    {
+      new (&m_value) ref<class value>(std::move(that.m_value));
+      that.reset();
+    } else {
+      copy_immediate(that);
+    }
+  }
+
+  cell::~cell()
+  {
+    reset();
+  }
+
+  cell& cell::operator=(const cell& that) noexcept
+  {
+    if (this != &that)
+    {
+      if (m_kind == kind::boxed && that.m_kind == kind::boxed)
+      {
+        m_value = that.m_value;
+      } else {
+        reset();
+        if ((m_kind = that.m_kind) == kind::boxed)
+        {
+          new (&m_value) ref<class value>(that.m_value);
+        } else {
+          copy_immediate(that);
+        }
+      }
+    }
+
+    return *this;
+  }
+
+  cell& cell::operator=(cell&& that) noexcept
+  {
+    if (this != &that)
+    {
+      reset();
+      if ((m_kind = that.m_kind) == kind::boxed)
+      {
+        new (&m_value) ref<class value>(std::move(that.m_value));
+        that.reset();
+      } else {
+        copy_immediate(that);
+      }
+    }
+
+    return *this;
+  }
+
+  void cell::reset() noexcept
+  {
+    if (m_kind == kind::boxed)
+    {
+      m_value.~ref<class value>();
+      m_kind = kind::null;
+      m_int = 0;
+    }
+  }
+
+  void cell::copy_immediate(const cell& that) noexcept
+  {
+    // Integers and reals are not necessarily of the same size, so the union
+    // member which is active has to be copied.
+    switch (that.m_kind)
+    {
+      case kind::boolean:
+        m_boolean = that.m_boolean;
+        break;
+
+      case kind::real:
+        m_real = that.m_real;
+        break;
+
+      default:
+        m_int = that.m_int;
+        break;
+    }
+  }
+
+  enum number::number_type cell::number_type() const
+  {
+    switch (m_kind)
+    {
+      case kind::integer:
+        return number::number_type::integer;
+
+      case kind::real:
+        return number::number_type::real;
+
+      default:
+        return static_cast<const number*>(m_value.get())->number_type();
+    }
+  }
+
+  bool cell::as_boolean() const
+  {
+    if (m_kind == kind::boolean)
+    {
+      return m_boolean;
+    }
+
+    return static_cast<const boolean*>(m_value.get())->value();
+  }
+
+  number::int_type cell::as_int() const
+  {
+    switch (m_kind)
+    {
+      case kind::integer:
+        return m_int;
+
+      case kind::real:
+        {
+          number::real_type value = m_real;
+
+          if (value > 0.0)
+          {
+            value = std::floor(value);
+          }
+          if (value < 0.0)
+          {
+            value = std::ceil(value);
+          }
+
+          return static_cast<number::int_type>(value);
+        }
+
+      default:
+        return static_cast<const number*>(m_value.get())->as_int();
+    }
+  }
+
+  number::real_type cell::as_real() const
+  {
+    switch (m_kind)
+    {
+      case kind::integer:
+        return static_cast<number::real_type>(m_int);
+
+      case kind::real:
+        return m_real;
+
+      default:
+        return static_cast<const number*>(m_value.get())->as_real();
+    }
+  }
+
+  ref<class value> cell::to_value(const ref<class runtime>& runtime) const &
+  {
+    switch (m_kind)
+    {
+      case kind::null:
+        return ref<class value>();
+
+      case kind::boolean:
+        return runtime->boolean(m_boolean);
+
+      case kind::integer:
+        return runtime->number(m_int);
+
+      case kind::real:
+        return runtime->number(m_real);
+
+      default:
+        return m_value;
+    }
+  }
+
+  ref<class value> cell::to_value(const ref<class runtime>& runtime) &&
+  {
+    if (m_kind == kind::boxed)
+    {
+      ref<class value> result = std::move(m_value);
+
+      reset();
+
+      return result;
+    }
+
+    return static_cast<const cell&>(*this).to_value(runtime);
+  }
+
+  ref<object> cell::prototype(const ref<class runtime>& runtime) const
+  {
+    switch (m_kind)
+    {
+      case kind::null:
+        return runtime->object_prototype();
+
+      case kind::boolean:
+        return runtime->boolean_prototype();
+
+      case kind::integer:
+      case kind::real:
+        return runtime->number_prototype();
+
+      default:
+        return m_value->prototype(runtime);
+    }
+  }
+
+  bool cell::equals(const cell& that) const
+  {
+    const auto t = type();
+
+    if (t != that.type())
+    {
+      return false;
+    }
+
+    switch (t)
+    {
+      case value::type::null:
+        return true;
+
+      case value::type::boolean:
+        return as_boolean() == that.as_boolean();
+
+      case value::type::number:
+        if (is(number::number_type::real)
+            || that.is(number::number_type::real))
+        {
+          return as_real() == that.as_real();
+        }
+
+        return as_int() == that.as_int();
+
+      default:
+        return m_value->equals(that.m_value);
+    }
+  }
+
+  std::u32string cell::to_string() const
+  {
+    switch (m_kind)
+    {
+      case kind::null:
+        return U"";
+
+      case kind::boolean:
+        return m_boolean ? U"true" : U"false";
+
+      case kind::integer:
+        return to_unistring(m_int);
+
+      case kind::real:
+        return to_unistring(m_real);
+
+      default:
+        return m_value->to_string();
+    }
+  }
+
+  std::u32string cell::to_source() const
+  {
+    switch (m_kind)
+    {
+      case kind::null:
+        return U"null";
+
+      case kind::boxed:
+        return m_value->to_source();
+
+      default:
+        return to_string();
+    }
+  }
+
+  bool value::is(const cell& c, enum type t)
+  {
+    return c.is(t);
+  }
+}
@@ -26,23 +26,29 @@
 #include <plorth/context.hpp>
 #include <plorth/parser.hpp>
 
+#include "./utils.hpp"
+
 namespace plorth
 {
-  static std::shared_ptr<value> compile_token(
-    const std::shared_ptr<runtime>&,
+  static ref<value> compile_token(
+    const ref<runtime>&,
+    const std::shared_ptr<parser::ast::token>&
+  );
+  static ref<value> compile_element_token(
+    const ref<runtime>&,
     const std::shared_ptr<parser::ast::token>&
   );
 
-  std::shared_ptr<quote> context::compile(const std::u32string& source,
-                                          const std::u32string& filename,
-                                          int line,
-                                          int column)
+  ref<quote> context::compile(const std::u32string& source,
+                              const std::u32string& filename,
+                              int line,
+                              int column)
   {
     auto begin = std::begin(source);
     const auto end = std::end(source);
     parser::position position = { filename, line, column };
     const auto result = parser::parse(begin, end, position);
-    std::vector<std::shared_ptr<value>> values;
+    std::vector<ref<value>> values;
 
     if (!result)
     {
@@ -54,7 +60,7 @@ namespace plorth
       }
       error(error::code::syntax, error_message, result.error()->position);
 
-      return std::shared_ptr<quote>();
+      return ref<quote>();
     }
     values.reserve(result.value()->size());
     for (const auto& token : *result.value())
@@ -65,25 +71,25 @@ namespace plorth
     return m_runtime->compiled_quote(values);
   }
 
-  static std::shared_ptr<array> compile_array_token(
-    const std::shared_ptr<class runtime>& runtime,
+  static ref<array> compile_array_token(
+    const ref<class runtime>& runtime,
     const std::shared_ptr<parser::ast::array>& token
   )
   {
     const auto& elements = token->elements();
     const auto size = elements.size();
-    std::shared_ptr<value> result[size];
+    ref<value> result[size];
 
     for (std::size_t i = 0; i < size; ++i)
     {
-      result[i] = compile_token(runtime, elements[i]);
+      result[i] = compile_element_token(runtime, elements[i]);
     }
 
     return runtime->array(result, size);
   }
 
-  static std::shared_ptr<object> compile_object_token(
-    const std::shared_ptr<class runtime>& runtime,
+  static ref<object> compile_object_token(
+    const ref<class runtime>& runtime,
     const std::shared_ptr<parser::ast::object>& token
   )
   {
@@ -98,21 +104,21 @@ namespace plorth
 
       result.push_back(object::value_type(
         property.first,
-        compile_token(runtime, property.second)
+        compile_element_token(runtime, property.second)
       ));
     }
 
     return runtime->object(result);
   }
 
-  static std::shared_ptr<quote> compile_quote_token(
-    const std::shared_ptr<class runtime>& runtime,
+  static ref<quote> compile_quote_token(
+    const ref<class runtime>& runtime,
     const std::shared_ptr<parser::ast::quote>& token
   )
   {
     const auto& children = token->children();
     const auto size = children.size();
-    std::vector<std::shared_ptr<value>> result;
+    std::vector<ref<value>> result;
 
     result.reserve(size);
     for (std::size_t i = 0; i < size; ++i)
@@ -123,24 +129,57 @@ namespace plorth
     return runtime->compiled_quote(result);
   }
 
-  static std::shared_ptr<string> compile_string_token(
-    const std::shared_ptr<class runtime>& runtime,
+  static ref<string> compile_string_token(
+    const ref<class runtime>& runtime,
     const std::shared_ptr<parser::ast::string>& token
   )
   {
     return runtime->string(token->value());
   }
 
-  static std::shared_ptr<symbol> compile_symbol_token(
-    const std::shared_ptr<class runtime>& runtime,
+  static ref<symbol> compile_symbol_token(
+    const ref<class runtime>& runtime,
     const std::shared_ptr<parser::ast::symbol>& token
   )
   {
     return runtime->symbol(token->id(), token->position());
   }
 
-  static std::shared_ptr<word> compile_word_token(
-    const std::shared_ptr<class runtime>& runtime,
+  /**
+   * Elements of array and object literals are not looked up from prototypes
+   * or dictionaries, so number literals and the constants null, true and
+   * false among them are resolved into values already during the
+   * compilation instead of being evaluated each time the literal is.
+   */
+  static ref<value> compile_literal_token(
+    const ref<class runtime>& runtime,
+    const std::shared_ptr<parser::ast::symbol>& token
+  )
+  {
+    const auto& id = token->id();
+
+    if (!id.compare(U"null"))
+    {
+      return ref<value>();
+    }
+    else if (!id.compare(U"true"))
+    {
+      return runtime->true_value();
+    }
+    else if (!id.compare(U"false"))
+    {
+      return runtime->false_value();
+    }
+    else if (is_number(id))
+    {
+      return runtime->number(id);
+    }
+
+    return compile_symbol_token(runtime, token);
+  }
+
+  static ref<word> compile_word_token(
+    const ref<class runtime>& runtime,
     const std::shared_ptr<parser::ast::word>& token
   )
   {
@@ -150,14 +189,14 @@ namespace plorth
     );
   }
 
-  static std::shared_ptr<value> compile_token(
-    const std::shared_ptr<class runtime>& runtime,
+  static ref<value> compile_token(
+    const ref<class runtime>& runtime,
     const std::shared_ptr<parser::ast::token>& token
   )
   {
     if (!token)
     {
-      return std::shared_ptr<value>();
+      return ref<value>();
     }
     switch (token->type())
     {
@@ -198,6 +237,22 @@ namespace plorth
         );
     }
 
-    return std::shared_ptr<value>();
+    return ref<value>();
+  }
+
+  static ref<value> compile_element_token(
+    const ref<class runtime>& runtime,
+    const std::shared_ptr<parser::ast::token>& token
+  )
+  {
+    if (token && token->type() == parser::ast::token::type::symbol)
+    {
+      return compile_literal_token(
+        runtime,
+        std::static_pointer_cast<parser::ast::symbol>(token)
+      );
+    }
+
+    return compile_token(runtime, token);
   }
 }
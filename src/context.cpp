@@ -30,54 +30,62 @@
 
 namespace plorth
 {
-  std::shared_ptr<context> context::make(
-    const std::shared_ptr<class runtime>& runtime
+  ref<context> context::make(
+    const ref<class runtime>& runtime
   )
   {
-    return std::shared_ptr<context>(new (runtime->memory_manager()) context(
+    return ref<context>(new (runtime->memory_manager()) context(
       runtime
     ));
   }
 
-  context::context(const std::shared_ptr<class runtime>& runtime)
-    : m_runtime(runtime) {}
+  ref<context> context::fork() const
+  {
+    const auto child = make(m_runtime);
+
+    child->m_dictionary.assign(m_dictionary);
+#if PLORTH_ENABLE_FILE_SYSTEM_MODULES
+    child->m_filename = m_filename;
+#endif
+    child->m_position = m_position;
+    child->m_concurrent = true;
+
+    return child;
+  }
+
+  context::context(const ref<class runtime>& runtime)
+    : m_runtime(runtime)
+    , m_concurrent(runtime->frozen())
+  {
+    m_data.reserve(PLORTH_DATA_STACK_RESERVE);
+  }
 
   void context::error(enum error::code code,
                       const std::u32string& message,
                       const std::optional<parser::position>& position)
   {
+    // Filename of the current position is looked up only here, when the
+    // error is being constructed.
     m_error = m_runtime->value<class error>(
       code,
       message,
-      !position && (m_position.file.empty() || m_position.line > 0)
-        ? m_position
+      !position && (m_position.file == atom().id() || m_position.line > 0)
+        ? m_position.to_parser_position()
         : position
     );
   }
 
-  void context::push_null()
-  {
-    push(std::shared_ptr<value>());
-  }
-
-  void context::push_boolean(bool value)
-  {
-    push(m_runtime->boolean(value));
-  }
-
-  void context::push_int(number::int_type value)
-  {
-    push(m_runtime->number(value));
-  }
-
-  void context::push_real(number::real_type value)
-  {
-    push(m_runtime->number(value));
-  }
-
   void context::push_number(const std::u32string& value)
   {
-    push(m_runtime->number(value));
+    number::int_type int_value;
+    number::real_type real_value;
+
+    if (to_number(value, int_value, real_value))
+    {
+      push_int(int_value);
+    } else {
+      push_real(real_value);
+    }
   }
 
   void context::push_string(const std::u32string& value)
@@ -91,7 +99,7 @@ namespace plorth
     push(m_runtime->string(chars, length));
   }
 
-  void context::push_array(const std::vector<std::shared_ptr<value>>& elements)
+  void context::push_array(const std::vector<ref<value>>& elements)
   {
     push_array(elements.data(), elements.size());
   }
@@ -112,13 +120,13 @@ namespace plorth
     push(m_runtime->symbol(id));
   }
 
-  void context::push_quote(const std::vector<std::shared_ptr<value>>& values)
+  void context::push_quote(const std::vector<ref<value>>& values)
   {
     push(m_runtime->compiled_quote(values));
   }
 
-  void context::push_word(const std::shared_ptr<class symbol>& symbol,
-                          const std::shared_ptr<class quote>& quote)
+  void context::push_word(const ref<class symbol>& symbol,
+                          const ref<class quote>& quote)
   {
     push(m_runtime->word(symbol, quote));
   }
@@ -140,18 +148,9 @@ namespace plorth
   {
     if (!m_data.empty())
     {
-      const auto& value = m_data.back();
-
-      if (!value::is(value, type))
+      if (!m_data.back().is(type))
       {
-        error(
-          error::code::type,
-          U"Expected " +
-          value::type_description(type) +
-          U", got " +
-          value::type_description(value ? value->type() : value::type::null) +
-          U" instead."
-        );
+        type_error(type, m_data.back().type());
 
         return false;
       }
@@ -164,11 +163,11 @@ namespace plorth
     return false;
   }
 
-  bool context::pop(std::shared_ptr<value>& slot)
+  bool context::pop(ref<value>& slot)
   {
     if (!m_data.empty())
     {
-      slot = m_data.back();
+      slot = std::move(m_data.back()).to_value(m_runtime);
       m_data.pop_back();
 
       return true;
@@ -178,24 +177,55 @@ namespace plorth
     return false;
   }
 
-  bool context::pop(std::shared_ptr<value>& slot, enum value::type type)
+  bool context::pop(cell& slot)
   {
     if (!m_data.empty())
     {
-      slot = m_data.back();
-      if (!value::is(slot, type))
+      slot = std::move(m_data.back());
+      m_data.pop_back();
+
+      return true;
+    }
+    error(error::code::range, U"Stack underflow.");
+
+    return false;
+  }
+
+  bool context::pop(ref<value>& slot, enum value::type type)
+  {
+    if (!m_data.empty())
+    {
+      auto& value = m_data.back();
+
+      if (!value.is(type))
+      {
+        type_error(type, value.type());
+
+        return false;
+      }
+      slot = std::move(value).to_value(m_runtime);
+      m_data.pop_back();
+
+      return true;
+    }
+    error(error::code::range, U"Stack underflow.");
+
+    return false;
+  }
+
+  bool context::pop(cell& slot, enum value::type type)
+  {
+    if (!m_data.empty())
+    {
+      auto& value = m_data.back();
+
+      if (!value.is(type))
       {
-        error(
-          error::code::type,
-          U"Expected " +
-          value::type_description(type) +
-          U", got " +
-          value::type_description(slot ? slot->type() : value::type::null) +
-          U" instead."
-        );
+        type_error(type, value.type());
 
         return false;
       }
+      slot = std::move(value);
       m_data.pop_back();
 
       return true;
@@ -205,67 +235,186 @@ namespace plorth
     return false;
   }
 
+  bool context::peek(const cell*& slot, std::size_t depth)
+  {
+    if (depth < m_data.size())
+    {
+      slot = &peek(depth);
+
+      return true;
+    }
+    error(error::code::range, U"Stack underflow.");
+
+    return false;
+  }
+
+  bool context::peek(const cell*& slot,
+                     enum value::type type,
+                     std::size_t depth)
+  {
+    if (depth < m_data.size())
+    {
+      const auto& value = peek(depth);
+
+      if (!value.is(type))
+      {
+        type_error(type, value.type());
+
+        return false;
+      }
+      slot = &value;
+
+      return true;
+    }
+    error(error::code::range, U"Stack underflow.");
+
+    return false;
+  }
+
+  bool context::peek_number(const cell*& slot, std::size_t depth)
+  {
+    return peek(slot, value::type::number, depth);
+  }
+
   bool context::pop_boolean(bool& slot)
   {
-    std::shared_ptr<class value> value;
+    cell value;
 
     if (!pop(value, value::type::boolean))
     {
       return false;
     }
-    slot = std::static_pointer_cast<boolean>(value)->value();
+    slot = value.as_boolean();
 
     return true;
   }
 
+  bool context::pop_number(cell& slot)
+  {
+    return pop(slot, value::type::number);
+  }
+
+  void context::type_error(enum value::type expected, enum value::type actual)
+  {
+    error(
+      error::code::type,
+      U"Expected " +
+      value::type_description(expected) +
+      U", got " +
+      value::type_description(actual) +
+      U" instead."
+    );
+  }
   template< typename T >
   inline bool typed_context_pop(context* ctx,
-                                std::shared_ptr<T>& slot,
+                                ref<T>& slot,
                                 enum value::type type)
   {
-    std::shared_ptr<class value> value;
+    ref<class value> value;
 
     if (!ctx->pop(value, type))
     {
       return false;
     }
-    slot = std::static_pointer_cast<T>(value);
+    slot = ref_cast<T>(std::move(value));
 
     return true;
   }
 
-  bool context::pop_number(std::shared_ptr<number>& slot)
+  template< typename T >
+  inline bool typed_context_peek(context* ctx,
+                                 const T*& slot,
+                                 enum value::type type,
+                                 std::size_t depth)
+  {
+    const cell* value;
+
+    if (!ctx->peek(value, type, depth))
+    {
+      return false;
+    }
+    slot = static_cast<const T*>(value->boxed().get());
+
+    return true;
+  }
+
+  bool context::pop_number(ref<number>& slot)
   {
     return typed_context_pop<number>(this, slot, value::type::number);
   }
 
-  bool context::pop_string(std::shared_ptr<string>& slot)
+  bool context::pop_string(ref<string>& slot)
   {
     return typed_context_pop<string>(this, slot, value::type::string);
   }
 
-  bool context::pop_array(std::shared_ptr<array>& slot)
+  bool context::pop_array(ref<array>& slot)
   {
     return typed_context_pop<array>(this, slot, value::type::array);
   }
 
-  bool context::pop_object(std::shared_ptr<object>& slot)
+  bool context::pop_object(ref<object>& slot)
   {
     return typed_context_pop<object>(this, slot, value::type::object);
   }
 
-  bool context::pop_quote(std::shared_ptr<quote>& slot)
+  bool context::pop_quote(ref<quote>& slot)
   {
     return typed_context_pop<quote>(this, slot, value::type::quote);
   }
 
-  bool context::pop_symbol(std::shared_ptr<symbol>& slot)
+  bool context::pop_symbol(ref<symbol>& slot)
   {
     return typed_context_pop<symbol>(this, slot, value::type::symbol);
   }
 
-  bool context::pop_word(std::shared_ptr<word>& slot)
+  bool context::pop_word(ref<word>& slot)
   {
     return typed_context_pop<word>(this, slot, value::type::word);
   }
+
+  bool context::pop_seq(ref<seq>& slot)
+  {
+    return typed_context_pop<seq>(this, slot, value::type::seq);
+  }
+
+  bool context::peek_string(const string*& slot, std::size_t depth)
+  {
+    return typed_context_peek<string>(this, slot, value::type::string, depth);
+  }
+
+  bool context::peek_array(const array*& slot, std::size_t depth)
+  {
+    return typed_context_peek<array>(this, slot, value::type::array, depth);
+  }
+
+  bool context::peek_object(const object*& slot, std::size_t depth)
+  {
+    return typed_context_peek<object>(this, slot, value::type::object, depth);
+  }
+
+  bool context::peek_symbol(const symbol*& slot, std::size_t depth)
+  {
+    return typed_context_peek<symbol>(this, slot, value::type::symbol, depth);
+  }
+
+  bool context::peek_quote(const quote*& slot, std::size_t depth)
+  {
+    return typed_context_peek<quote>(this, slot, value::type::quote, depth);
+  }
+
+  bool context::peek_word(const word*& slot, std::size_t depth)
+  {
+    return typed_context_peek<word>(this, slot, value::type::word, depth);
+  }
+
+  bool context::peek_error(const class error*& slot, std::size_t depth)
+  {
+    return typed_context_peek<class error>(
+      this,
+      slot,
+      value::type::error,
+      depth
+    );
+  }
 }
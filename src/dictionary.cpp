@@ -25,25 +25,27 @@
  */
 #include <plorth/dictionary.hpp>
 
+#include <atomic>
+
 namespace plorth
 {
-  dictionary::dictionary() {}
+  /** Counter used for generating versions for dictionaries. */
+  static std::atomic<dictionary::version_type> last_version(0);
 
-  dictionary::dictionary(const dictionary& that)
-    : m_words(that.m_words) {}
+  dictionary::dictionary()
+    : m_version(0)
+    , m_frozen(false) {}
 
-  dictionary& dictionary::operator=(const dictionary& that)
-  {
-    m_words = that.m_words;
-
-    return *this;
-  }
+  dictionary::dictionary(const dictionary& that)
+    : m_words(that.m_words)
+    , m_version(that.m_version)
+    , m_frozen(false) {}
 
   dictionary::value_type dictionary::find(
-    const std::shared_ptr<symbol>& id
+    const ref<symbol>& id
   ) const
   {
-    return find(id->id());
+    return find(id->atom());
   }
 
   std::vector<dictionary::value_type> dictionary::words() const
@@ -60,6 +62,20 @@ namespace plorth
   }
 
   dictionary::value_type dictionary::find(const std::u32string& id) const
+  {
+    atom key;
+
+    // Identifiers which are not in the atom table cannot be in the
+    // dictionary either.
+    if (!atom::find(id, key))
+    {
+      return value_type();
+    }
+
+    return find(key);
+  }
+
+  dictionary::value_type dictionary::find(const atom& id) const
   {
     const auto entry = m_words.find(id);
 
@@ -71,8 +87,27 @@ namespace plorth
     }
   }
 
-  void dictionary::insert(const value_type& word)
+  bool dictionary::insert(const value_type& word)
+  {
+    if (m_frozen)
+    {
+      return false;
+    }
+    m_words[word->symbol()->atom()] = word;
+    m_version = ++last_version;
+
+    return true;
+  }
+
+  bool dictionary::assign(const dictionary& that)
   {
-    m_words[word->symbol()->id()] = word;
+    if (m_frozen)
+    {
+      return false;
+    }
+    m_words = that.m_words;
+    m_version = that.m_version;
+
+    return true;
   }
 }
@@ -28,25 +28,25 @@
 
 namespace plorth
 {
-  static bool eval_val(const std::shared_ptr<context>&,
-                       const std::shared_ptr<value>&,
-                       std::shared_ptr<value>&);
-  static bool eval_ary(const std::shared_ptr<context>&,
-                       const std::shared_ptr<array>&,
-                       std::shared_ptr<value>&);
-  static bool eval_obj(const std::shared_ptr<context>&,
-                       const std::shared_ptr<object>&,
-                       std::shared_ptr<value>&);
-  static bool eval_sym(const std::shared_ptr<context>&,
-                       const std::shared_ptr<symbol>&,
-                       std::shared_ptr<value>&);
-  static bool eval_wrd(const std::shared_ptr<context>&,
-                       const std::shared_ptr<word>&,
-                       std::shared_ptr<value>&);
-
-  bool value::eval(const std::shared_ptr<context>& ctx,
-                   const std::shared_ptr<value>& val,
-                   std::shared_ptr<value>& slot)
+  static bool eval_val(const ref<context>&,
+                       const ref<value>&,
+                       ref<value>&);
+  static bool eval_ary(const ref<context>&,
+                       const ref<array>&,
+                       ref<value>&);
+  static bool eval_obj(const ref<context>&,
+                       const ref<object>&,
+                       ref<value>&);
+  static bool eval_sym(const ref<context>&,
+                       const ref<symbol>&,
+                       ref<value>&);
+  static bool eval_wrd(const ref<context>&,
+                       const ref<word>&,
+                       ref<value>&);
+
+  bool value::eval(const ref<context>& ctx,
+                   const ref<value>& val,
+                   ref<value>& slot)
   {
     if (!val)
     {
@@ -57,42 +57,42 @@ namespace plorth
     switch (val->type())
     {
       case value::type::array:
-        return eval_ary(ctx, std::static_pointer_cast<array>(val), slot);
+        return eval_ary(ctx, ref_cast<array>(val), slot);
 
       case value::type::object:
-        return eval_obj(ctx, std::static_pointer_cast<object>(val), slot);
+        return eval_obj(ctx, ref_cast<object>(val), slot);
 
       case value::type::symbol:
-        return eval_sym(ctx, std::static_pointer_cast<symbol>(val), slot);
+        return eval_sym(ctx, ref_cast<symbol>(val), slot);
 
       case value::type::word:
-        return eval_wrd(ctx, std::static_pointer_cast<word>(val), slot);
+        return eval_wrd(ctx, ref_cast<word>(val), slot);
 
       default:
         return eval_val(ctx, val, slot);
     }
   }
 
-  static bool eval_val(const std::shared_ptr<context>& ctx,
-                       const std::shared_ptr<value>& val,
-                       std::shared_ptr<value>& slot)
+  static bool eval_val(const ref<context>& ctx,
+                       const ref<value>& val,
+                       ref<value>& slot)
   {
     slot = val;
 
     return true;
   }
 
-  static bool eval_ary(const std::shared_ptr<context>& ctx,
-                       const std::shared_ptr<array>& ary,
-                       std::shared_ptr<value>& slot)
+  static bool eval_ary(const ref<context>& ctx,
+                       const ref<array>& ary,
+                       ref<value>& slot)
   {
     const auto size = ary->size();
-    std::shared_ptr<value> elements[size];
+    ref<value> elements[size];
 
     for (array::size_type i = 0; i < size; ++i)
     {
       const auto& element = ary->at(i);
-      std::shared_ptr<value> element_slot;
+      ref<value> element_slot;
 
       if (element && !value::eval(ctx, element, element_slot))
       {
@@ -105,31 +105,40 @@ namespace plorth
     return true;
   }
 
-  static bool eval_obj(const std::shared_ptr<context>& ctx,
-                       const std::shared_ptr<object>& obj,
-                       std::shared_ptr<value>& slot)
+  static bool eval_obj(const ref<context>& ctx,
+                       const ref<object>& obj,
+                       ref<value>& slot)
   {
     std::vector<object::value_type> properties;
-
-    properties.reserve(obj->size());
-    for (const auto& property : obj->entries())
+    const auto eval_property = [&ctx, &properties](
+      const object::key_type& key,
+      const object::mapped_type& value
+    )
     {
-      std::shared_ptr<value> value_slot;
+      ref<class value> value_slot;
 
-      if (property.second && !value::eval(ctx, property.second, value_slot))
+      if (value && !value::eval(ctx, value, value_slot))
       {
         return false;
       }
-      properties.push_back({ property.first, value_slot });
+      properties.push_back({ key, value_slot });
+
+      return true;
+    };
+
+    properties.reserve(obj->size());
+    if (!obj->for_each(eval_property))
+    {
+      return false;
     }
     slot = ctx->runtime()->object(properties);
 
     return true;
   }
 
-  static bool eval_sym(const std::shared_ptr<context>& ctx,
-                       const std::shared_ptr<symbol>& sym,
-                       std::shared_ptr<value>& slot)
+  static bool eval_sym(const ref<context>& ctx,
+                       const ref<symbol>& sym,
+                       ref<value>& slot)
   {
     const auto id = sym->id();
 
@@ -164,9 +173,9 @@ namespace plorth
     return true;
   }
 
-  static bool eval_wrd(const std::shared_ptr<context>& ctx,
-                       const std::shared_ptr<word>& wrd,
-                       std::shared_ptr<value>& slot)
+  static bool eval_wrd(const ref<context>& ctx,
+                       const ref<word>& wrd,
+                       ref<value>& slot)
   {
     ctx->error(
       error::code::syntax,
@@ -25,19 +25,18 @@
  */
 #include <plorth/context.hpp>
 #include <plorth/value-word.hpp>
+#include "./bytecode.hpp"
 #include "./utils.hpp"
 
 namespace plorth
 {
-  static bool exec_val(const std::shared_ptr<context>&,
-                       const std::shared_ptr<value>&);
-  static bool exec_sym(const std::shared_ptr<context>&,
-                       const std::shared_ptr<symbol>&);
-  static bool exec_wrd(const std::shared_ptr<context>&,
-                       const std::shared_ptr<word>&);
-
-  bool value::exec(const std::shared_ptr<context>& ctx,
-                   const std::shared_ptr<value>& val)
+  static bool exec_val(const ref<context>&,
+                       const ref<value>&);
+  static bool exec_wrd(const ref<context>&,
+                       const ref<word>&);
+
+  bool value::exec(const ref<context>& ctx,
+                   const ref<value>& val)
   {
     if (!val)
     {
@@ -48,20 +47,20 @@ namespace plorth
     switch (val->type())
     {
       case value::type::symbol:
-        return exec_sym(ctx, std::static_pointer_cast<symbol>(val));
+        return exec_sym(ctx, ref_cast<symbol>(val));
 
       case value::type::word:
-        return exec_wrd(ctx, std::static_pointer_cast<word>(val));
+        return exec_wrd(ctx, ref_cast<word>(val));
 
       default:
         return exec_val(ctx, val);
     }
   }
 
-  static bool exec_val(const std::shared_ptr<context>& ctx,
-                       const std::shared_ptr<value>& val)
+  static bool exec_val(const ref<context>& ctx,
+                       const ref<value>& val)
   {
-    std::shared_ptr<value> slot;
+    ref<value> slot;
 
     if (!value::eval(ctx, val, slot))
     {
@@ -72,11 +71,9 @@ namespace plorth
     return true;
   }
 
-  static bool exec_sym(const std::shared_ptr<context>& ctx,
-                       const std::shared_ptr<symbol>& sym)
+  bool exec_sym(const ref<context>& ctx, const ref<symbol>& sym)
   {
-    const auto position = sym->position();
-    const auto id = sym->id();
+    const auto& position = sym->position();
 
     // Update source code position of the context, if the symbol has such
     // information.
@@ -89,16 +86,17 @@ namespace plorth
     {
       const auto& stack = ctx->data();
 
-      if (!stack.empty() && stack.back())
+      if (!stack.empty() && !stack.back().is(value::type::null))
       {
-        const auto prototype = stack.back()->prototype(ctx->runtime());
-        std::shared_ptr<value> val;
+        const auto prototype = stack.back().prototype(ctx->runtime());
+        ref<value> val;
 
-        if (prototype && prototype->property(ctx->runtime(), id, val))
+        if (prototype &&
+            prototype->property(ctx->runtime(), sym->atom(), val))
         {
           if (value::is(val, value::type::quote))
           {
-            return std::static_pointer_cast<quote>(val)->call(ctx);
+            return ref_cast<quote>(val)->call(ctx);
           }
           ctx->push(val);
 
@@ -107,6 +105,11 @@ namespace plorth
       }
     }
 
+    return exec_sym_word(ctx, sym);
+  }
+
+  bool exec_sym_word(const ref<context>& ctx, const ref<symbol>& sym)
+  {
     // Look for a word from dictionary of current context.
     if (auto word = ctx->dictionary().find(sym))
     {
@@ -123,22 +126,26 @@ namespace plorth
       return word->quote()->call(ctx);
     }
 
-    // If the name of the word can be converted into number, then do just that.
-    if (is_number(id))
+    // If the symbol is a number literal or one of the constants null, true
+    // and false, then push the value it stands for.
+    if (const auto literal = sym->literal())
     {
-      ctx->push_number(id);
+      ctx->push(*literal);
 
       return true;
     }
 
     // Otherwise it's reference error.
-    ctx->error(error::code::reference, U"Unrecognized word: `" + id + U"'");
+    ctx->error(
+      error::code::reference,
+      U"Unrecognized word: `" + sym->id() + U"'"
+    );
 
     return false;
   }
 
-  static bool exec_wrd(const std::shared_ptr<context>& ctx,
-                       const std::shared_ptr<word>& wrd)
+  static bool exec_wrd(const ref<context>& ctx,
+                       const ref<word>& wrd)
   {
     ctx->dictionary().insert(wrd);
 
@@ -24,53 +24,17 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <plorth/context.hpp>
+#include <plorth/native.hpp>
 
 #include <peelo/unicode/ctype/isvalid.hpp>
 
+#include "./utils.hpp"
+
 #include <cmath>
 #include <chrono>
 
 namespace plorth
 {
-  /**
-   * Word: null
-   *
-   * Gives:
-   * - null
-   *
-   * Pushes the null value onto stack.
-   */
-  static void w_null(const std::shared_ptr<context>& ctx)
-  {
-    ctx->push_null();
-  }
-
-  /**
-   * Word: true
-   *
-   * Gives:
-   * - boolean
-   *
-   * Pushes the boolean value true onto stack.
-   */
-  static void w_true(const std::shared_ptr<context>& ctx)
-  {
-    ctx->push_boolean(true);
-  }
-
-  /**
-   * Word: false
-   *
-   * Gives:
-   * - boolean
-   *
-   * Pushes the boolean value false onto stack.
-   */
-  static void w_false(const std::shared_ptr<context>& ctx)
-  {
-    ctx->push_boolean(false);
-  }
-
   /**
    * Word: e
    *
@@ -79,7 +43,7 @@ namespace plorth
    *
    * Pushes Euler's number onto stack.
    */
-  static void w_e(const std::shared_ptr<context>& ctx)
+  static void w_e(const ref<context>& ctx)
   {
     ctx->push_real(M_E);
   }
@@ -92,7 +56,7 @@ namespace plorth
    *
    * Pushes the value of pi onto stack.
    */
-  static void w_pi(const std::shared_ptr<context>& ctx)
+  static void w_pi(const ref<context>& ctx)
   {
     ctx->push_real(M_PI);
   }
@@ -105,7 +69,7 @@ namespace plorth
    *
    * Pushes the value of positive infinity onto stack.
    */
-  static void w_inf(const std::shared_ptr<context>& ctx)
+  static void w_inf(const ref<context>& ctx)
   {
     ctx->push_real(INFINITY);
   }
@@ -118,7 +82,7 @@ namespace plorth
    *
    * Pushes the value of negative infinity onto stack.
    */
-  static void w_minus_inf(const std::shared_ptr<context>& ctx)
+  static void w_minus_inf(const ref<context>& ctx)
   {
     ctx->push_real(-INFINITY);
   }
@@ -131,7 +95,7 @@ namespace plorth
    *
    * Pushes the value of NaN (not a number) onto stack.
    */
-  static void w_nan(const std::shared_ptr<context>& ctx)
+  static void w_nan(const ref<context>& ctx)
   {
     ctx->push_real(NAN);
   }
@@ -142,14 +106,14 @@ namespace plorth
    *
    * Does nothing. Can be used to construct empty quotes.
    */
-  static void w_nop(const std::shared_ptr<context>&) {}
+  static void w_nop(const ref<context>&) {}
 
   /**
    * Word: clear
    *
    * Clears the entire stack of current context.
    */
-  static void w_clear(const std::shared_ptr<context>& ctx)
+  static void w_clear(const ref<context>& ctx)
   {
     ctx->clear();
   }
@@ -162,7 +126,7 @@ namespace plorth
    *
    * Pushes current depth of the stack onto stack.
    */
-  static void w_depth(const std::shared_ptr<context>& ctx)
+  static void w_depth(const ref<context>& ctx)
   {
     ctx->push_int(ctx->size());
   }
@@ -177,7 +141,7 @@ namespace plorth
    *
    *     1 drop #=> empty stack
    */
-  static void w_drop(const std::shared_ptr<context>& ctx)
+  static void w_drop(const ref<context>& ctx)
   {
     ctx->pop();
   }
@@ -193,7 +157,7 @@ namespace plorth
    *
    *     1 2 3 2drop #=> 1
    */
-  static void w_drop2(const std::shared_ptr<context>& ctx)
+  static void w_drop2(const ref<context>& ctx)
   {
     if (ctx->pop())
     {
@@ -215,15 +179,10 @@ namespace plorth
    *
    *     1 dup #=> 1 1
    */
-  static void w_dup(const std::shared_ptr<context>& ctx)
+  static void w_dup(const ref<context>& ctx, const cell& value)
   {
-    std::shared_ptr<class value> value;
-
-    if (ctx->pop(value))
-    {
-      ctx->push(value);
-      ctx->push(value);
-    }
+    // Borrowed cells point into the stack, so copy before growing it.
+    ctx->push(cell(value));
   }
 
   /**
@@ -243,18 +202,13 @@ namespace plorth
    *
    *     1 2 2dup #=> 1 2 1 2
    */
-  static void w_dup2(const std::shared_ptr<context>& ctx)
+  static void w_dup2(const ref<context>& ctx, const cell& a, const cell& b)
   {
-    std::shared_ptr<value> a;
-    std::shared_ptr<value> b;
+    cell first(b);
+    cell second(a);
 
-    if (ctx->pop(a) && ctx->pop(b))
-    {
-      ctx->push(b);
-      ctx->push(a);
-      ctx->push(b);
-      ctx->push(a);
-    }
+    ctx->push(std::move(first));
+    ctx->push(std::move(second));
   }
 
   /**
@@ -271,13 +225,13 @@ namespace plorth
    *
    *     1 2 nip #=> 2
    */
-  static void w_nip(const std::shared_ptr<context>& ctx)
+  static void w_nip(const ref<context>& ctx)
   {
-    std::shared_ptr<class value> value;
+    cell value;
 
     if (ctx->pop(value) && ctx->pop())
     {
-      ctx->push(value);
+      ctx->push(std::move(value));
     }
   }
 
@@ -298,17 +252,9 @@ namespace plorth
    *
    *     1 2 over #=> 1 2 1
    */
-  static void w_over(const std::shared_ptr<context>& ctx)
+  static void w_over(const ref<context>& ctx, const cell&, const cell& b)
   {
-    std::shared_ptr<value> a;
-    std::shared_ptr<value> b;
-
-    if (ctx->pop(a) && ctx->pop(b))
-    {
-      ctx->push(b);
-      ctx->push(a);
-      ctx->push(b);
-    }
+    ctx->push(cell(b));
   }
 
   /**
@@ -328,17 +274,17 @@ namespace plorth
    *
    *     1 2 3 rot #=> 2 3 1
    */
-  static void w_rot(const std::shared_ptr<context>& ctx)
+  static void w_rot(const ref<context>& ctx)
   {
-    std::shared_ptr<value> a;
-    std::shared_ptr<value> b;
-    std::shared_ptr<value> c;
+    cell a;
+    cell b;
+    cell c;
 
     if (ctx->pop(a) && ctx->pop(b) && ctx->pop(c))
     {
-      ctx->push(b);
-      ctx->push(a);
-      ctx->push(c);
+      ctx->push(std::move(b));
+      ctx->push(std::move(a));
+      ctx->push(std::move(c));
     }
   }
 
@@ -357,15 +303,15 @@ namespace plorth
    *
    *     1 2 swap #=> 2 1
    */
-  static void w_swap(const std::shared_ptr<context>& ctx)
+  static void w_swap(const ref<context>& ctx)
   {
-    std::shared_ptr<value> a;
-    std::shared_ptr<value> b;
+    cell a;
+    cell b;
 
     if (ctx->pop(a) && ctx->pop(b))
     {
-      ctx->push(a);
-      ctx->push(b);
+      ctx->push(std::move(a));
+      ctx->push(std::move(b));
     }
   }
 
@@ -386,29 +332,24 @@ namespace plorth
    *
    *     1 2 tuck #=> 2 1 2
    */
-  static void w_tuck(const std::shared_ptr<context>& ctx)
+  static void w_tuck(const ref<context>& ctx)
   {
-    std::shared_ptr<value> a;
-    std::shared_ptr<value> b;
+    cell a;
+    cell b;
 
     if (ctx->pop(a) && ctx->pop(b))
     {
       ctx->push(a);
-      ctx->push(b);
-      ctx->push(a);
+      ctx->push(std::move(b));
+      ctx->push(std::move(a));
     }
   }
 
-  static inline void type_test(const std::shared_ptr<context>& ctx,
+  static inline void type_test(const ref<context>& ctx,
+                               const cell& val,
                                enum value::type type)
   {
-    std::shared_ptr<value> val;
-
-    if (ctx->pop(val))
-    {
-      ctx->push(val);
-      ctx->push_boolean(value::is(val, type));
-    }
+    ctx->push_boolean(val.is(type));
   }
 
   /**
@@ -423,9 +364,9 @@ namespace plorth
    *
    * Returns true if the topmost value of the stack is an array.
    */
-  static void w_is_array(const std::shared_ptr<context>& ctx)
+  static void w_is_array(const ref<context>& ctx, const cell& val)
   {
-    type_test(ctx, value::type::array);
+    type_test(ctx, val, value::type::array);
   }
 
   /**
@@ -440,9 +381,9 @@ namespace plorth
    *
    * Returns true if the topmost value of the stack is a boolean.
    */
-  static void w_is_boolean(const std::shared_ptr<context>& ctx)
+  static void w_is_boolean(const ref<context>& ctx, const cell& val)
   {
-    type_test(ctx, value::type::boolean);
+    type_test(ctx, val, value::type::boolean);
   }
 
   /**
@@ -457,15 +398,9 @@ namespace plorth
    *
    * Returns true if the topmost value of the stack is an error.
    */
-  static void w_is_error(const std::shared_ptr<context>& ctx)
+  static void w_is_error(const ref<context>& ctx, const cell& val)
   {
-    std::shared_ptr<class value> value;
-
-    if (ctx->pop(value))
-    {
-      ctx->push(value);
-      ctx->push_boolean(value::is(value, value::type::error));
-    }
+    type_test(ctx, val, value::type::error);
   }
 
   /**
@@ -480,15 +415,9 @@ namespace plorth
    *
    * Returns true if the topmost value of the stack is a number.
    */
-  static void w_is_number(const std::shared_ptr<context>& ctx)
+  static void w_is_number(const ref<context>& ctx, const cell& val)
   {
-    std::shared_ptr<class value> value;
-
-    if (ctx->pop(value))
-    {
-      ctx->push(value);
-      ctx->push_boolean(value::is(value, value::type::number));
-    }
+    type_test(ctx, val, value::type::number);
   }
 
   /**
@@ -503,15 +432,9 @@ namespace plorth
    *
    * Returns true if the topmost value of the stack is null.
    */
-  static void w_is_null(const std::shared_ptr<context>& ctx)
+  static void w_is_null(const ref<context>& ctx, const cell& val)
   {
-    std::shared_ptr<class value> value;
-
-    if (ctx->pop(value))
-    {
-      ctx->push(value);
-      ctx->push_boolean(value::is(value, value::type::null));
-    }
+    type_test(ctx, val, value::type::null);
   }
 
   /**
@@ -526,15 +449,9 @@ namespace plorth
    *
    * Returns true if the topmost value of the stack is an object.
    */
-  static void w_is_object(const std::shared_ptr<context>& ctx)
+  static void w_is_object(const ref<context>& ctx, const cell& val)
   {
-    std::shared_ptr<class value> value;
-
-    if (ctx->pop(value))
-    {
-      ctx->push(value);
-      ctx->push_boolean(value::is(value, value::type::object));
-    }
+    type_test(ctx, val, value::type::object);
   }
 
   /**
@@ -549,15 +466,26 @@ namespace plorth
    *
    * Returns true if the topmost value of the stack is a quote.
    */
-  static void w_is_quote(const std::shared_ptr<context>& ctx)
+  static void w_is_quote(const ref<context>& ctx, const cell& val)
   {
-    std::shared_ptr<class value> value;
+    type_test(ctx, val, value::type::quote);
+  }
 
-    if (ctx->pop(value))
-    {
-      ctx->push(value);
-      ctx->push_boolean(value::is(value, value::type::quote));
-    }
+  /**
+   * Word: seq?
+   *
+   * Takes:
+   * - any
+   *
+   * Gives:
+   * - any
+   * - boolean
+   *
+   * Returns true if the topmost value of the stack is a sequence.
+   */
+  static void w_is_seq(const ref<context>& ctx, const cell& val)
+  {
+    type_test(ctx, val, value::type::seq);
   }
 
   /**
@@ -572,15 +500,9 @@ namespace plorth
    *
    * Returns true if the topmost value of the stack is a string.
    */
-  static void w_is_string(const std::shared_ptr<context>& ctx)
+  static void w_is_string(const ref<context>& ctx, const cell& val)
   {
-    std::shared_ptr<class value> value;
-
-    if (ctx->pop(value))
-    {
-      ctx->push(value);
-      ctx->push_boolean(value::is(value, value::type::string));
-    }
+    type_test(ctx, val, value::type::string);
   }
 
   /**
@@ -595,15 +517,9 @@ namespace plorth
    *
    * Returns true if the topmost value of the stack is symbol.
    */
-  static void w_is_symbol(const std::shared_ptr<context>& ctx)
+  static void w_is_symbol(const ref<context>& ctx, const cell& val)
   {
-    std::shared_ptr<value> val;
-
-    if (ctx->pop(val))
-    {
-      ctx->push(val);
-      ctx->push_boolean(value::is(val, value::type::symbol));
-    }
+    type_test(ctx, val, value::type::symbol);
   }
 
   /**
@@ -618,15 +534,9 @@ namespace plorth
    *
    * Returns true if the topmost value of the stack is word.
    */
-  static void w_is_word(const std::shared_ptr<context>& ctx)
+  static void w_is_word(const ref<context>& ctx, const cell& val)
   {
-    std::shared_ptr<value> val;
-
-    if (ctx->pop(val))
-    {
-      ctx->push(val);
-      ctx->push_boolean(value::is(val, value::type::word));
-    }
+    type_test(ctx, val, value::type::word);
   }
 
   /**
@@ -641,20 +551,9 @@ namespace plorth
    *
    * Returns name of the type of the topmost value as a string.
    */
-  static void w_typeof(const std::shared_ptr<context>& ctx)
+  static void w_typeof(const ref<context>& ctx, const cell& val)
   {
-    std::shared_ptr<class value> value;
-
-    if (ctx->pop(value))
-    {
-      ctx->push(value);
-      if (value)
-      {
-        ctx->push_string(value->type_description());
-      } else {
-        ctx->push_string(U"null");
-      }
-    }
+    ctx->push_string(value::type_description(val.type()));
   }
 
   /**
@@ -670,47 +569,47 @@ namespace plorth
    *
    * Tests whether prototype chain of given value inherits from given object.
    */
-  static void w_is_instance_of(const std::shared_ptr<context>& ctx)
+  static bool inherits(const ref<class runtime>& runtime,
+                       const object& obj,
+                       const cell& val)
   {
-    const auto& runtime = ctx->runtime();
-    std::shared_ptr<value> val;
-    std::shared_ptr<object> obj;
+    ref<value> prototype1;
+    ref<value> prototype2 = val.prototype(runtime);
 
-    if (ctx->pop_object(obj) && ctx->pop(val))
+    if (!obj.own_property(U"prototype", prototype1) ||
+        !value::is(prototype1, value::type::object) ||
+        !prototype2)
     {
-      std::shared_ptr<value> prototype1;
-      std::shared_ptr<value> prototype2 = val->prototype(runtime);
-
-      ctx->push(val);
+      return false;
+    }
+    else if (prototype1->equals(prototype2))
+    {
+      return true;
+    }
 
-      if (!obj->own_property(U"prototype", prototype1) ||
-          !value::is(prototype1, value::type::object) ||
-          !prototype2)
-      {
-        ctx->push_boolean(false);
-        return;
-      }
-      else if (prototype1->equals(prototype2))
+    while (ref_cast<object>(prototype2)->own_property(
+            U"__proto__",
+            prototype2
+           ) &&
+          value::is(prototype2, value::type::object))
+    {
+      if (prototype1->equals(prototype2))
       {
-        ctx->push_boolean(true);
-        return;
+        return true;
       }
+    }
 
-      while (std::static_pointer_cast<object>(prototype2)->own_property(
-              U"__proto__",
-              prototype2
-             ) &&
-            value::is(prototype2, value::type::object))
-      {
-        if (prototype1->equals(prototype2))
-        {
-          ctx->push_boolean(true);
-          return;
-        }
-      }
+    return false;
+  }
 
-      ctx->push_boolean(false);
-    }
+  static void w_is_instance_of(const ref<context>& ctx,
+                               const object& obj,
+                               const cell& val)
+  {
+    const bool result = inherits(ctx->runtime(), obj, val);
+
+    ctx->pop();
+    ctx->push_boolean(result);
   }
 
   /**
@@ -726,20 +625,13 @@ namespace plorth
    * Retrieves proto of the topmost value. If the topmost value of the stack
    * is null, null will be returned instead.
    */
-  static void w_proto(const std::shared_ptr<context>& ctx)
+  static void w_proto(const ref<context>& ctx, const cell& val)
   {
-    std::shared_ptr<class value> value;
+    auto prototype = val.is(value::type::null)
+      ? ref<object>()
+      : val.prototype(ctx->runtime());
 
-    if (ctx->pop(value))
-    {
-      ctx->push(value);
-      if (value)
-      {
-        ctx->push(value->prototype(ctx->runtime()));
-      } else {
-        ctx->push_null();
-      }
-    }
+    ctx->push(std::move(prototype));
   }
 
   /**
@@ -754,19 +646,19 @@ namespace plorth
    * Converts the topmost value of the stack into a boolean. Null and false
    * will become false while everything else will become true.
    */
-  static void w_to_boolean(const std::shared_ptr<context>& ctx)
+  static void w_to_boolean(const ref<context>& ctx)
   {
-    std::shared_ptr<class value> value;
+    cell val;
 
-    if (!ctx->pop(value))
+    if (!ctx->pop(val))
     {
       return;
     }
-    else if (value::is(value, value::type::boolean))
+    else if (val.is(value::type::boolean))
     {
-      ctx->push(value);
+      ctx->push(std::move(val));
     } else {
-      ctx->push_boolean(!!value);
+      ctx->push_boolean(!val.is(value::type::null));
     }
   }
 
@@ -782,19 +674,13 @@ namespace plorth
    * Converts the topmost value of the stack into a string. Null will become
    * an empty string.
    */
-  static void w_to_string(const std::shared_ptr<context>& ctx)
+  static void w_to_string(const ref<context>& ctx)
   {
-    std::shared_ptr<class value> value;
+    cell val;
 
-    if (!ctx->pop(value))
-    {
-      return;
-    }
-    else if (value)
+    if (ctx->pop(val))
     {
-      ctx->push_string(value->to_string());
-    } else {
-      ctx->push_string(U"");
+      ctx->push_string(val.to_string());
     }
   }
 
@@ -810,19 +696,13 @@ namespace plorth
    * Converts the topmost value of the stack into a string that most accurately
    * represents what the value would look like in source code.
    */
-  static void w_to_source(const std::shared_ptr<context>& ctx)
+  static void w_to_source(const ref<context>& ctx)
   {
-    std::shared_ptr<class value> value;
+    cell val;
 
-    if (!ctx->pop(value))
-    {
-      return;
-    }
-    else if (value)
+    if (ctx->pop(val))
     {
-      ctx->push_string(value->to_source());
-    } else {
-      ctx->push_string(U"null");
+      ctx->push_string(val.to_source());
     }
   }
 
@@ -837,9 +717,9 @@ namespace plorth
    *
    * Constructs array from given value.
    */
-  static void w_1array(const std::shared_ptr<context>& ctx)
+  static void w_1array(const ref<context>& ctx)
   {
-    std::shared_ptr<value> val;
+    ref<value> val;
 
     if (ctx->pop(val))
     {
@@ -859,14 +739,14 @@ namespace plorth
    *
    * Constructs array from given two values.
    */
-  static void w_2array(const std::shared_ptr<context>& ctx)
+  static void w_2array(const ref<context>& ctx)
   {
-    std::shared_ptr<value> val1;
-    std::shared_ptr<value> val2;
+    ref<value> val1;
+    ref<value> val2;
 
     if (ctx->pop(val2) && ctx->pop(val1))
     {
-      std::shared_ptr<value> buffer[2];
+      ref<value> buffer[2];
 
       buffer[0] = val1;
       buffer[1] = val2;
@@ -886,14 +766,14 @@ namespace plorth
    *
    * Constructs array from given amount of values from the stack.
    */
-  static void w_narray(const std::shared_ptr<context>& ctx)
+  static void w_narray(const ref<context>& ctx)
   {
-    std::shared_ptr<number> num;
+    cell num;
 
     if (ctx->pop_number(num))
     {
-      const number::int_type size = num->as_int();
-      std::shared_ptr<value>* buffer;
+      const number::int_type size = num.as_int();
+      ref<value>* buffer;
 
       if (size < 0)
       {
@@ -901,11 +781,11 @@ namespace plorth
         return;
       }
 
-      buffer = new std::shared_ptr<value>[size];
+      buffer = new ref<value>[size];
 
       for (number::int_type i = 0; i < size; ++i)
       {
-        std::shared_ptr<value> val;
+        ref<value> val;
 
         if (!ctx->pop(val))
         {
@@ -929,10 +809,10 @@ namespace plorth
    *
    * Executes quote if the boolean value is true.
    */
-  static void w_if(const std::shared_ptr<context>& ctx)
+  static void w_if(const ref<context>& ctx)
   {
     bool condition;
-    std::shared_ptr<class quote> quote;
+    ref<class quote> quote;
 
     if (ctx->pop_quote(quote) && ctx->pop_boolean(condition) && condition)
     {
@@ -950,11 +830,11 @@ namespace plorth
    *
    * Calls first quote if boolean value is true, second quote otherwise.
    */
-  static void w_if_else(const std::shared_ptr<context>& ctx)
+  static void w_if_else(const ref<context>& ctx)
   {
     bool condition;
-    std::shared_ptr<quote> then_quote;
-    std::shared_ptr<quote> else_quote;
+    ref<quote> then_quote;
+    ref<quote> else_quote;
 
     if (!ctx->pop_quote(else_quote)
         || !ctx->pop_quote(then_quote)
@@ -980,10 +860,10 @@ namespace plorth
    *
    * Executes second quote as long as the first quote returns true.
    */
-  static void w_while(const std::shared_ptr<context>& ctx)
+  static void w_while(const ref<context>& ctx)
   {
-    std::shared_ptr<quote> test;
-    std::shared_ptr<quote> body;
+    ref<quote> test;
+    ref<quote> body;
 
     if (!ctx->pop_quote(body) || !ctx->pop_quote(test))
     {
@@ -1011,10 +891,10 @@ namespace plorth
    * Executes first quote and if it throws an error, calls second quote with
    * the error on top of the stack.
    */
-  static void w_try(const std::shared_ptr<context>& ctx)
+  static void w_try(const ref<context>& ctx)
   {
-    std::shared_ptr<quote> try_quote;
-    std::shared_ptr<quote> catch_quote;
+    ref<quote> try_quote;
+    ref<quote> catch_quote;
 
     if (!ctx->pop_quote(catch_quote) || !ctx->pop_quote(try_quote))
     {
@@ -1041,11 +921,11 @@ namespace plorth
    * the error on top of the stack. If no error was thrown, third quote will
    * be called instead.
    */
-  static void w_try_else(const std::shared_ptr<context>& ctx)
+  static void w_try_else(const ref<context>& ctx)
   {
-    std::shared_ptr<quote> try_quote;
-    std::shared_ptr<quote> catch_quote;
-    std::shared_ptr<quote> else_quote;
+    ref<quote> try_quote;
+    ref<quote> catch_quote;
+    ref<quote> else_quote;
 
     if (!ctx->pop_quote(else_quote)
         || !ctx->pop_quote(catch_quote)
@@ -1075,10 +955,10 @@ namespace plorth
    *
    * Compiles given string of source code into a quote.
    */
-  static void w_compile(const std::shared_ptr<context>& ctx)
+  static void w_compile(const ref<context>& ctx)
   {
-    std::shared_ptr<string> source;
-    std::shared_ptr<class quote> quote;
+    ref<string> source;
+    ref<class quote> quote;
 
     if (!ctx->pop_string(source))
     {
@@ -1100,7 +980,7 @@ namespace plorth
    *
    * Returns the global dictionary as an object.
    */
-  static void w_globals(const std::shared_ptr<context>& ctx)
+  static void w_globals(const ref<context>& ctx)
   {
     const auto& dictionary = ctx->runtime()->dictionary();
     std::vector<object::value_type> result;
@@ -1121,7 +1001,7 @@ namespace plorth
    *
    * Returns the local dictionary of current execution context as an object.
    */
-  static void w_locals(const std::shared_ptr<context>& ctx)
+  static void w_locals(const ref<context>& ctx)
   {
     const auto& dictionary = ctx->dictionary();
     std::vector<object::value_type> result;
@@ -1144,10 +1024,10 @@ namespace plorth
    * Declares given value as constant in the current context with name
    * identified by given string.
    */
-  static void w_const(const std::shared_ptr<context>& ctx)
+  static void w_const(const ref<context>& ctx)
   {
-    std::shared_ptr<string> id;
-    std::shared_ptr<value> val;
+    ref<string> id;
+    ref<value> val;
 
     if (ctx->pop_string(id) && ctx->pop(val))
     {
@@ -1169,9 +1049,9 @@ namespace plorth
    * Imports module from given path and adds all of its exported words into
    * this execution context.
    */
-  static void w_import(const std::shared_ptr<context>& ctx)
+  static void w_import(const ref<context>& ctx)
   {
-    std::shared_ptr<string> path;
+    ref<string> path;
 
     if (ctx->pop_string(path))
     {
@@ -1188,12 +1068,12 @@ namespace plorth
    * Returns command line arguments given to the interpreter as an array of
    * strings.
    */
-  static void w_args(const std::shared_ptr<context>& ctx)
+  static void w_args(const ref<context>& ctx)
   {
     const auto& runtime = ctx->runtime();
     const auto& arguments = runtime->arguments();
     const auto size = arguments.size();
-    std::vector<std::shared_ptr<value>> result;
+    std::vector<ref<value>> result;
 
     result.reserve(size);
     for (std::size_t i = 0; i < size; ++i)
@@ -1211,15 +1091,15 @@ namespace plorth
    *
    * Returns version of the Plorth interpreter as string.
    */
-  static void w_version(const std::shared_ptr<context>& ctx)
+  static void w_version(const ref<context>& ctx)
   {
     ctx->push_string(PLORTH_VERSION);
   }
 
-  static void make_error(const std::shared_ptr<context>& ctx,
+  static void make_error(const ref<context>& ctx,
                          enum error::code code)
   {
-    std::shared_ptr<value> val;
+    ref<value> val;
     std::u32string message;
 
     if (!ctx->pop(val))
@@ -1231,7 +1111,7 @@ namespace plorth
     {
       if (val->is(value::type::string))
       {
-        message = std::static_pointer_cast<string>(val)->to_string();
+        message = ref_cast<string>(val)->to_string();
       } else {
         ctx->error(
           error::code::type,
@@ -1256,7 +1136,7 @@ namespace plorth
    * Construct an instance of type error with with given optional error
    * message and places it on the stack.
    */
-  static void w_type_error(const std::shared_ptr<context>& ctx)
+  static void w_type_error(const ref<context>& ctx)
   {
     make_error(ctx, error::code::type);
   }
@@ -1273,7 +1153,7 @@ namespace plorth
    * Constructs an instance of value error with given optional error message
    * and places it on the stack.
    */
-  static void w_value_error(const std::shared_ptr<context>& ctx)
+  static void w_value_error(const ref<context>& ctx)
   {
     make_error(ctx, error::code::value);
   }
@@ -1290,7 +1170,7 @@ namespace plorth
    * Construct an instance of range error with given optional error message
    * and places it on the stack.
    */
-  static void w_range_error(const std::shared_ptr<context>& ctx)
+  static void w_range_error(const ref<context>& ctx)
   {
     make_error(ctx, error::code::range);
   }
@@ -1307,7 +1187,7 @@ namespace plorth
    * Construct an instance of unknown error with with given optional error
    * message and places it on the stack.
    */
-  static void w_unknown_error(const std::shared_ptr<context>& ctx)
+  static void w_unknown_error(const ref<context>& ctx)
   {
     make_error(ctx, error::code::unknown);
   }
@@ -1322,7 +1202,7 @@ namespace plorth
    * encoded text and returns result. If end of input has been reached, null
    * will be returned instead.
    */
-  static void w_read(const std::shared_ptr<context>& ctx)
+  static void w_read(const ref<context>& ctx)
   {
     std::u32string output;
     io::input::size_type read;
@@ -1355,13 +1235,13 @@ namespace plorth
    * number of characters if there isn't that much characters available from
    * the standard input stream.
    */
-  static void w_nread(const std::shared_ptr<context>& ctx)
+  static void w_nread(const ref<context>& ctx)
   {
-    std::shared_ptr<number> num;
+    cell num;
 
     if (ctx->pop_number(num))
     {
-      const number::int_type amount = num->as_int();
+      const number::int_type amount = num.as_int();
       std::u32string output;
       io::input::size_type read;
       io::input::result result;
@@ -1391,6 +1271,20 @@ namespace plorth
     }
   }
 
+  /**
+   * Word: lines
+   *
+   * Gives:
+   * - seq
+   *
+   * Returns lazy sequence of lines read from standard input stream, without
+   * the line terminators. Input is read only as the sequence is consumed.
+   */
+  static void w_lines(const ref<context>& ctx)
+  {
+    ctx->push(ctx->runtime()->input_lines());
+  }
+
   /**
    * Word: print
    *
@@ -1399,13 +1293,13 @@ namespace plorth
    *
    * Prints topmost value of the stack to stdout.
    */
-  static void w_print(const std::shared_ptr<context>& ctx)
+  static void w_print(const ref<context>& ctx)
   {
-    std::shared_ptr<value> val;
+    cell val;
 
-    if (ctx->pop(val) && val)
+    if (ctx->pop(val) && !val.is(value::type::null))
     {
-      ctx->runtime()->print(val->to_string());
+      ctx->runtime()->print(val.to_string());
     }
   }
 
@@ -1418,16 +1312,16 @@ namespace plorth
    * Prints the topmost value of the stack to stdout with a terminating new
    * line.
    */
-  static void w_println(const std::shared_ptr<context>& ctx)
+  static void w_println(const ref<context>& ctx)
   {
     const auto& runtime = ctx->runtime();
-    std::shared_ptr<value> val;
+    cell val;
 
     if (ctx->pop(val))
     {
-      if (val)
+      if (!val.is(value::type::null))
       {
-        runtime->print(val->to_string());
+        runtime->print(val.to_string());
       }
       runtime->println();
     }
@@ -1443,13 +1337,13 @@ namespace plorth
    * error will be thrown if the given number is not a valid Unicode code
    * point.
    */
-  static void w_emit(const std::shared_ptr<context>& ctx)
+  static void w_emit(const ref<context>& ctx)
   {
-    std::shared_ptr<number> num;
+    cell num;
 
     if (ctx->pop_number(num))
     {
-      number::int_type c = num->as_int();
+      number::int_type c = num.as_int();
 
       if (!peelo::unicode::ctype::isvalid(c))
       {
@@ -1460,6 +1354,104 @@ namespace plorth
     }
   }
 
+  /**
+   * Converts number given as bound of a range into integer. Value error is
+   * raised if the number has fractional part, and range error if it does not
+   * fit into an integer.
+   */
+  static bool to_bound(const ref<context>& ctx,
+                       const cell& num,
+                       number::int_type& result)
+  {
+    number::real_type real;
+
+    if (num.is(number::number_type::integer))
+    {
+      result = num.as_int();
+
+      return true;
+    }
+    real = num.as_real();
+    if (std::isfinite(real) && std::trunc(real) != real)
+    {
+      ctx->error(
+        error::code::value,
+        U"Number " + to_unistring(real) +
+        U" has fractional part and cannot be converted into integer."
+      );
+
+      return false;
+    }
+    // Values outside of this range, including NaN, have no integer
+    // representation.
+    if (!(real >= static_cast<number::real_type>(number::int_min) &&
+          real < -static_cast<number::real_type>(number::int_min)))
+    {
+      ctx->error(
+        error::code::range,
+        U"Number " + to_unistring(real) + U" cannot be converted into integer."
+      );
+
+      return false;
+    }
+    result = static_cast<number::int_type>(real);
+
+    return true;
+  }
+
+  /**
+   * Word: iota
+   *
+   * Takes:
+   * - number
+   *
+   * Gives:
+   * - seq
+   *
+   * Returns endless lazy sequence of consecutive integers, beginning from
+   * given number. Value error is thrown if the number is not an integer.
+   */
+  static void w_iota(const ref<context>& ctx)
+  {
+    cell start;
+    number::int_type start_value;
+
+    if (ctx->pop_number(start) && to_bound(ctx, start, start_value))
+    {
+      ctx->push(ctx->runtime()->range(start_value));
+    }
+  }
+
+  /**
+   * Word: range
+   *
+   * Takes:
+   * - number
+   * - number
+   *
+   * Gives:
+   * - seq
+   *
+   * Returns lazy sequence of consecutive integers beginning from the first
+   * number and ending before the second one. Value error is thrown if either
+   * of the numbers is not an integer.
+   */
+  static void w_range(const ref<context>& ctx)
+  {
+    cell start;
+    cell end;
+    number::int_type start_value;
+    number::int_type end_value;
+
+    if (ctx->pop_number(end) &&
+        ctx->pop_number(start) &&
+        to_bound(ctx, start, start_value) &&
+        to_bound(ctx, end, end_value))
+    {
+      ctx->push(ctx->runtime()->range(start_value, end_value));
+    }
+  }
+
   /**
    * Word: now
    *
@@ -1469,7 +1461,7 @@ namespace plorth
    * Returns the number of seconds that have elapsed since the  Unix epoch
    * (1 January 1970 00:00:00 UTC) rounded to the nearest integer.
    */
-  static void w_now(const std::shared_ptr<context>& ctx)
+  static void w_now(const ref<context>& ctx)
   {
     const auto timestamp = std::chrono::system_clock::now().time_since_epoch();
 
@@ -1488,14 +1480,14 @@ namespace plorth
    *
    * Tests whether the two topmost values of the stack are equal.
    */
-  static void w_eq(const std::shared_ptr<context>& ctx)
+  static void w_eq(const ref<context>& ctx)
   {
-    std::shared_ptr<value> a;
-    std::shared_ptr<value> b;
+    cell a;
+    cell b;
 
     if (ctx->pop(a) && ctx->pop(b))
     {
-      ctx->push_boolean(b == a);
+      ctx->push_boolean(b.equals(a));
     }
   }
 
@@ -1511,14 +1503,14 @@ namespace plorth
    *
    * Tests whether the two topmost values of the stack are not equal.
    */
-  static void w_ne(const std::shared_ptr<context>& ctx)
+  static void w_ne(const ref<context>& ctx)
   {
-    std::shared_ptr<value> a;
-    std::shared_ptr<value> b;
+    cell a;
+    cell b;
 
     if (ctx->pop(a) && ctx->pop(b))
     {
-      ctx->push_boolean(b != a);
+      ctx->push_boolean(!b.equals(a));
     }
   }
 
@@ -1529,9 +1521,6 @@ namespace plorth
       return
       {
         // Constants.
-        { U"null", w_null },
-        { U"true", w_true },
-        { U"false", w_false },
         { U"e", w_e },
         { U"pi", w_pi },
         { U"inf", w_inf },
@@ -1544,28 +1533,29 @@ namespace plorth
         { U"depth", w_depth },
         { U"drop", w_drop },
         { U"2drop", w_drop2 },
-        { U"dup", w_dup },
-        { U"2dup", w_dup2 },
+        { U"dup", native::thunk<w_dup> },
+        { U"2dup", native::thunk<w_dup2> },
         { U"nip", w_nip },
-        { U"over", w_over },
+        { U"over", native::thunk<w_over> },
         { U"rot", w_rot },
         { U"swap", w_swap },
         { U"tuck", w_tuck },
 
         // Value types.
-        { U"array?", w_is_array },
-        { U"boolean?", w_is_boolean },
-        { U"error?", w_is_error },
-        { U"null?", w_is_null },
-        { U"number?", w_is_number },
-        { U"object?", w_is_object },
-        { U"quote?", w_is_quote },
-        { U"string?", w_is_string },
-        { U"symbol?", w_is_symbol },
-        { U"word?", w_is_word },
-        { U"typeof" , w_typeof },
-        { U"instance-of?", w_is_instance_of },
-        { U"proto", w_proto },
+        { U"array?", native::thunk<w_is_array> },
+        { U"boolean?", native::thunk<w_is_boolean> },
+        { U"error?", native::thunk<w_is_error> },
+        { U"null?", native::thunk<w_is_null> },
+        { U"number?", native::thunk<w_is_number> },
+        { U"object?", native::thunk<w_is_object> },
+        { U"quote?", native::thunk<w_is_quote> },
+        { U"seq?", native::thunk<w_is_seq> },
+        { U"string?", native::thunk<w_is_string> },
+        { U"symbol?", native::thunk<w_is_symbol> },
+        { U"word?", native::thunk<w_is_word> },
+        { U"typeof" , native::thunk<w_typeof> },
+        { U"instance-of?", native::thunk<w_is_instance_of> },
+        { U"proto", native::thunk<w_proto> },
 
         // Conversions.
         { U">boolean", w_to_boolean },
@@ -1576,6 +1566,8 @@ namespace plorth
         { U"1array", w_1array },
         { U"2array", w_2array },
         { U"narray", w_narray },
+        { U"iota", w_iota },
+        { U"range", w_range },
 
         // Logic.
         { U"if", w_if },
@@ -1602,6 +1594,7 @@ namespace plorth
         // I/O related.
         { U"read", w_read },
         { U"nread", w_nread },
+        { U"lines", w_lines },
         { U"print", w_print },
         { U"println", w_println },
         { U"emit", w_emit },
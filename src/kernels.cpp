@@ -0,0 +1,788 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "./kernels.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+// Entry points of the kernels are compiled both for the baseline instruction
+// set and for AVX2, and the dynamic linker picks the best one supported by
+// the processor.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+    defined(__linux__)
+# define PLORTH_KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+# define PLORTH_KERNEL
+#endif
+
+// Helpers which pass vectors around are always inlined into the kernels, as
+// the clones of the kernels do not agree on how vectors are passed between
+// functions. The compiler warns about that, even though no vector ever
+// crosses a function call.
+#define PLORTH_KERNEL_INLINE inline __attribute__((always_inline))
+#if defined(__GNUC__) && !defined(__clang__)
+# pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace plorth
+{
+  namespace kernels
+  {
+    namespace
+    {
+      /** Width of the vectors processed by the kernels, in bytes. */
+      static constexpr std::size_t vector_width = 32;
+
+      template<class T>
+      struct vector_of
+      {
+        typedef T type __attribute__((vector_size(vector_width)));
+      };
+
+      template<class T>
+      using vector = typename vector_of<T>::type;
+
+      template<class T>
+      static constexpr std::size_t lanes = vector_width / sizeof(T);
+
+      template<class T>
+      PLORTH_KERNEL_INLINE vector<T> load(const T* data)
+      {
+        vector<T> result;
+
+        std::memcpy(&result, data, sizeof(result));
+
+        return result;
+      }
+
+      template<class T>
+      PLORTH_KERNEL_INLINE void store(T* data, const vector<T>& value)
+      {
+        std::memcpy(data, &value, sizeof(value));
+      }
+
+      /**
+       * Left operand of element-wise operation, which is either a sequence
+       * of numbers or a single number repeated for every element.
+       */
+      template<class T>
+      struct sequence_operand
+      {
+        const T* data;
+
+        PLORTH_KERNEL_INLINE vector<T> at_vector(std::size_t offset) const
+        {
+          return load(data + offset);
+        }
+
+        PLORTH_KERNEL_INLINE T at(std::size_t offset) const
+        {
+          return data[offset];
+        }
+      };
+
+      template<class T>
+      struct scalar_operand
+      {
+        T value;
+
+        PLORTH_KERNEL_INLINE vector<T> at_vector(std::size_t) const
+        {
+          return vector<T>{} + value;
+        }
+
+        PLORTH_KERNEL_INLINE T at(std::size_t) const
+        {
+          return value;
+        }
+      };
+
+      /*
+       * Operations applied by the element-wise kernels, to both vectors and
+       * single elements.
+       */
+      struct add_op
+      {
+        template<class V>
+        PLORTH_KERNEL_INLINE auto operator()(const V& x, const V& y) const
+        {
+          return x + y;
+        }
+      };
+
+      struct subtract_op
+      {
+        template<class V>
+        PLORTH_KERNEL_INLINE auto operator()(const V& x, const V& y) const
+        {
+          return x - y;
+        }
+      };
+
+      struct multiply_op
+      {
+        template<class V>
+        PLORTH_KERNEL_INLINE auto operator()(const V& x, const V& y) const
+        {
+          return x * y;
+        }
+      };
+
+      struct divide_op
+      {
+        template<class V>
+        PLORTH_KERNEL_INLINE auto operator()(const V& x, const V& y) const
+        {
+          return x / y;
+        }
+      };
+
+      struct equal_op
+      {
+        template<class V>
+        PLORTH_KERNEL_INLINE auto operator()(const V& x, const V& y) const
+        {
+          return x == y;
+        }
+      };
+
+      struct not_equal_op
+      {
+        template<class V>
+        PLORTH_KERNEL_INLINE auto operator()(const V& x, const V& y) const
+        {
+          return x != y;
+        }
+      };
+
+      struct less_op
+      {
+        template<class V>
+        PLORTH_KERNEL_INLINE auto operator()(const V& x, const V& y) const
+        {
+          return x < y;
+        }
+      };
+
+      struct greater_op
+      {
+        template<class V>
+        PLORTH_KERNEL_INLINE auto operator()(const V& x, const V& y) const
+        {
+          return x > y;
+        }
+      };
+
+      struct less_equal_op
+      {
+        template<class V>
+        PLORTH_KERNEL_INLINE auto operator()(const V& x, const V& y) const
+        {
+          return x <= y;
+        }
+      };
+
+      struct greater_equal_op
+      {
+        template<class V>
+        PLORTH_KERNEL_INLINE auto operator()(const V& x, const V& y) const
+        {
+          return x >= y;
+        }
+      };
+
+      /**
+       * Tests whether the sign bit is set in any of the given overflow
+       * flags.
+       */
+      template<class U>
+      PLORTH_KERNEL_INLINE bool overflowed(const vector<U>& flags, U tail)
+      {
+        for (std::size_t i = 0; i < lanes<U>; ++i)
+        {
+          tail |= flags[i];
+        }
+
+        return tail >> (sizeof(U) * 8 - 1);
+      }
+
+      /**
+       * Adds or subtracts integers with wrap around, detecting overflow from
+       * signs of the operands and the result.
+       */
+      template<bool Subtract, class T, class Left>
+      PLORTH_KERNEL_INLINE bool add_integers(const Left& left,
+                        const T* b,
+                        T* output,
+                        std::size_t length)
+      {
+        using U = std::make_unsigned_t<T>;
+        vector<U> flags = {};
+        U tail = 0;
+        std::size_t i = 0;
+
+        for (; i + lanes<T> <= length; i += lanes<T>)
+        {
+          const auto x = reinterpret_cast<vector<U>>(left.at_vector(i));
+          const auto y = reinterpret_cast<vector<U>>(load(b + i));
+          const auto result = Subtract ? x - y : x + y;
+
+          flags |= Subtract
+            ? (x ^ y) & (x ^ result)
+            : (x ^ result) & (y ^ result);
+          store(output + i, reinterpret_cast<vector<T>>(result));
+        }
+        for (; i < length; ++i)
+        {
+          const auto x = static_cast<U>(left.at(i));
+          const auto y = static_cast<U>(b[i]);
+          const U result = Subtract ? x - y : x + y;
+
+          tail |= Subtract
+            ? (x ^ y) & (x ^ result)
+            : (x ^ result) & (y ^ result);
+          output[i] = static_cast<T>(result);
+        }
+
+        return !overflowed(flags, tail);
+      }
+
+      /**
+       * Multiplies integers. Overflow is detected the same way as the *
+       * word of numbers does it, by performing the multiplication with real
+       * numbers as well.
+       */
+      template<class T, class Left>
+      PLORTH_KERNEL_INLINE bool multiply_integers(const Left& left,
+                             const T* b,
+                             T* output,
+                             std::size_t length)
+      {
+        using U = std::make_unsigned_t<T>;
+        static const auto limit = static_cast<number::real_type>(
+          std::numeric_limits<T>::max()
+        );
+        bool overflow = false;
+
+        for (std::size_t i = 0; i < length; ++i)
+        {
+          const auto x = left.at(i);
+          const auto y = b[i];
+
+          overflow |= std::fabs(
+            static_cast<number::real_type>(x) *
+            static_cast<number::real_type>(y)
+          ) > limit;
+          output[i] = static_cast<T>(static_cast<U>(x) * static_cast<U>(y));
+        }
+
+        return !overflow;
+      }
+
+      template<class T, class Left>
+      PLORTH_KERNEL_INLINE bool apply_integers(arithmetic op,
+                          const Left& left,
+                          const T* b,
+                          T* output,
+                          std::size_t length)
+      {
+        switch (op)
+        {
+          case arithmetic::add:
+            return add_integers<false>(left, b, output, length);
+
+          case arithmetic::subtract:
+            return add_integers<true>(left, b, output, length);
+
+          case arithmetic::multiply:
+            return multiply_integers(left, b, output, length);
+
+          default:
+            return false;
+        }
+      }
+
+      template<class T, class Left, class Operation>
+      PLORTH_KERNEL_INLINE void transform(const Left& left,
+                            const T* b,
+                            T* output,
+                            std::size_t length,
+                            const Operation& operation)
+      {
+        std::size_t i = 0;
+
+        for (; i + lanes<T> <= length; i += lanes<T>)
+        {
+          store(output + i, operation(left.at_vector(i), load(b + i)));
+        }
+        for (; i < length; ++i)
+        {
+          output[i] = operation(left.at(i), b[i]);
+        }
+      }
+
+      template<class T, class Left>
+      PLORTH_KERNEL_INLINE void apply_reals(arithmetic op,
+                       const Left& left,
+                       const T* b,
+                       T* output,
+                       std::size_t length)
+      {
+        switch (op)
+        {
+          case arithmetic::add:
+            transform(left, b, output, length, add_op());
+            break;
+
+          case arithmetic::subtract:
+            transform(left, b, output, length, subtract_op());
+            break;
+
+          case arithmetic::multiply:
+            transform(left, b, output, length, multiply_op());
+            break;
+
+          case arithmetic::divide:
+            transform(left, b, output, length, divide_op());
+            break;
+        }
+      }
+
+      /**
+       * Compares consecutive vectors of the inputs and expands the resulting
+       * lane masks into booleans.
+       */
+      template<class T, class Left, class Compare>
+      PLORTH_KERNEL_INLINE void compare_each(const Left& left,
+                               const T* b,
+                               bool* output,
+                               std::size_t length,
+                               const Compare& compare)
+      {
+        std::size_t i = 0;
+
+        for (; i + lanes<T> <= length; i += lanes<T>)
+        {
+          const auto mask = compare(left.at_vector(i), load(b + i));
+
+          for (std::size_t j = 0; j < lanes<T>; ++j)
+          {
+            output[i + j] = mask[j] != 0;
+          }
+        }
+        for (; i < length; ++i)
+        {
+          output[i] = compare(left.at(i), b[i]);
+        }
+      }
+
+      template<class T, class Left>
+      PLORTH_KERNEL_INLINE void compare_with(comparison op,
+                        const Left& left,
+                        const T* b,
+                        bool* output,
+                        std::size_t length)
+      {
+        switch (op)
+        {
+          case comparison::equal:
+            compare_each(left, b, output, length, equal_op());
+            break;
+
+          case comparison::not_equal:
+            compare_each(left, b, output, length, not_equal_op());
+            break;
+
+          case comparison::less:
+            compare_each(left, b, output, length, less_op());
+            break;
+
+          case comparison::greater:
+            compare_each(left, b, output, length, greater_op());
+            break;
+
+          case comparison::less_equal:
+            compare_each(left, b, output, length, less_equal_op());
+            break;
+
+          case comparison::greater_equal:
+            compare_each(left, b, output, length, greater_equal_op());
+            break;
+        }
+      }
+
+      /**
+       * Selects the smallest or the largest number with vectors of running
+       * extremes. NaN does not compare with anything, so it's tracked
+       * separately.
+       */
+      template<bool Largest, class T>
+      PLORTH_KERNEL_INLINE T extreme(const T* data, std::size_t length)
+      {
+        using mask_type = decltype(vector<T>{} < vector<T>{});
+        auto result = data[0];
+        bool nan = false;
+        std::size_t i = 0;
+
+        if (length >= lanes<T>)
+        {
+          auto extremes = load(data);
+          mask_type nans = {};
+
+          for (i = lanes<T>; i + lanes<T> <= length; i += lanes<T>)
+          {
+            const auto x = load(data + i);
+
+            extremes = (Largest ? x > extremes : x < extremes) ? x : extremes;
+            if constexpr (std::is_floating_point<T>::value)
+            {
+              nans |= x != x;
+            }
+          }
+          result = extremes[0];
+          for (std::size_t j = 0; j < lanes<T>; ++j)
+          {
+            if (Largest ? extremes[j] > result : extremes[j] < result)
+            {
+              result = extremes[j];
+            }
+            nan = nan || nans[j] || extremes[j] != extremes[j];
+          }
+        }
+        for (; i < length; ++i)
+        {
+          if (Largest ? data[i] > result : data[i] < result)
+          {
+            result = data[i];
+          }
+          nan = nan || data[i] != data[i];
+        }
+        if constexpr (std::is_floating_point<T>::value)
+        {
+          if (nan)
+          {
+            return std::numeric_limits<T>::quiet_NaN();
+          }
+        }
+
+        return result;
+      }
+    }
+
+    PLORTH_KERNEL
+    bool apply(arithmetic op,
+               const number::int_type* a,
+               const number::int_type* b,
+               number::int_type* output,
+               std::size_t length)
+    {
+      return apply_integers(
+        op,
+        sequence_operand<number::int_type>{ a },
+        b,
+        output,
+        length
+      );
+    }
+
+    PLORTH_KERNEL
+    bool apply(arithmetic op,
+               number::int_type a,
+               const number::int_type* b,
+               number::int_type* output,
+               std::size_t length)
+    {
+      return apply_integers(
+        op,
+        scalar_operand<number::int_type>{ a },
+        b,
+        output,
+        length
+      );
+    }
+
+    PLORTH_KERNEL
+    void apply(arithmetic op,
+               const number::real_type* a,
+               const number::real_type* b,
+               number::real_type* output,
+               std::size_t length)
+    {
+      apply_reals(
+        op,
+        sequence_operand<number::real_type>{ a },
+        b,
+        output,
+        length
+      );
+    }
+
+    PLORTH_KERNEL
+    void apply(arithmetic op,
+               number::real_type a,
+               const number::real_type* b,
+               number::real_type* output,
+               std::size_t length)
+    {
+      apply_reals(
+        op,
+        scalar_operand<number::real_type>{ a },
+        b,
+        output,
+        length
+      );
+    }
+
+    PLORTH_KERNEL
+    void compare(comparison op,
+                 const number::int_type* a,
+                 const number::int_type* b,
+                 bool* output,
+                 std::size_t length)
+    {
+      compare_with(
+        op,
+        sequence_operand<number::int_type>{ a },
+        b,
+        output,
+        length
+      );
+    }
+
+    PLORTH_KERNEL
+    void compare(comparison op,
+                 number::int_type a,
+                 const number::int_type* b,
+                 bool* output,
+                 std::size_t length)
+    {
+      compare_with(
+        op,
+        scalar_operand<number::int_type>{ a },
+        b,
+        output,
+        length
+      );
+    }
+
+    PLORTH_KERNEL
+    void compare(comparison op,
+                 const number::real_type* a,
+                 const number::real_type* b,
+                 bool* output,
+                 std::size_t length)
+    {
+      compare_with(
+        op,
+        sequence_operand<number::real_type>{ a },
+        b,
+        output,
+        length
+      );
+    }
+
+    PLORTH_KERNEL
+    void compare(comparison op,
+                 number::real_type a,
+                 const number::real_type* b,
+                 bool* output,
+                 std::size_t length)
+    {
+      compare_with(
+        op,
+        scalar_operand<number::real_type>{ a },
+        b,
+        output,
+        length
+      );
+    }
+
+    PLORTH_KERNEL
+    bool sum(const number::int_type* data,
+             std::size_t length,
+             number::int_type& result,
+             number::real_type& real_result)
+    {
+      using T = number::int_type;
+      using U = std::make_unsigned_t<T>;
+      static constexpr int bits = sizeof(U) * 8;
+      vector<U> lows = {};
+      vector<T> highs = {};
+      U low = 0;
+      T high = 0;
+      std::size_t i = 0;
+
+      // The sum is kept in two words, lower one holding the wrapped sum and
+      // the higher one counting carries out of it. The total is therefore
+      // exact no matter how the elements are divided between the lanes.
+      for (; i + lanes<T> <= length; i += lanes<T>)
+      {
+        const auto x = load(data + i);
+        const auto partial = lows + reinterpret_cast<vector<U>>(x);
+
+        highs += x >> (bits - 1);
+        highs -= reinterpret_cast<vector<T>>(
+          partial < reinterpret_cast<vector<U>>(x)
+        );
+        lows = partial;
+      }
+      for (std::size_t j = 0; j < lanes<T>; ++j)
+      {
+        const U partial = low + lows[j];
+
+        high += highs[j] + (partial < lows[j]);
+        low = partial;
+      }
+      for (; i < length; ++i)
+      {
+        const U partial = low + static_cast<U>(data[i]);
+
+        high += (data[i] < 0 ? -1 : 0) + (partial < static_cast<U>(data[i]));
+        low = partial;
+      }
+
+      if (high == (static_cast<T>(low) < 0 ? -1 : 0))
+      {
+        result = static_cast<T>(low);
+
+        return true;
+      }
+      real_result = std::ldexp(static_cast<number::real_type>(high), bits)
+        + static_cast<number::real_type>(low);
+
+      return false;
+    }
+
+    PLORTH_KERNEL
+    number::real_type sum(const number::real_type* data, std::size_t length)
+    {
+      vector<number::real_type> sums[2] = {};
+      number::real_type result = 0;
+      std::size_t i = 0;
+
+      for (; i + 2 * lanes<number::real_type> <= length;
+           i += 2 * lanes<number::real_type>)
+      {
+        sums[0] += load(data + i);
+        sums[1] += load(data + i + lanes<number::real_type>);
+      }
+      sums[0] += sums[1];
+      for (std::size_t j = 0; j < lanes<number::real_type>; ++j)
+      {
+        result += sums[0][j];
+      }
+      for (; i < length; ++i)
+      {
+        result += data[i];
+      }
+
+      return result;
+    }
+
+    PLORTH_KERNEL
+    number::int_type min(const number::int_type* data, std::size_t length)
+    {
+      return extreme<false>(data, length);
+    }
+
+    PLORTH_KERNEL
+    number::real_type min(const number::real_type* data, std::size_t length)
+    {
+      return extreme<false>(data, length);
+    }
+
+    PLORTH_KERNEL
+    number::int_type max(const number::int_type* data, std::size_t length)
+    {
+      return extreme<true>(data, length);
+    }
+
+    PLORTH_KERNEL
+    number::real_type max(const number::real_type* data, std::size_t length)
+    {
+      return extreme<true>(data, length);
+    }
+
+    PLORTH_KERNEL
+    bool dot(const number::int_type* a,
+             const number::int_type* b,
+             std::size_t length,
+             number::int_type& result)
+    {
+      using U = std::make_unsigned_t<number::int_type>;
+      static const auto limit = static_cast<number::real_type>(
+        number::int_max
+      );
+      U total = 0;
+      U flags = 0;
+      bool overflow = false;
+
+      for (std::size_t i = 0; i < length; ++i)
+      {
+        const auto product = static_cast<U>(a[i]) * static_cast<U>(b[i]);
+        const U partial = total + product;
+
+        overflow |= std::fabs(
+          static_cast<number::real_type>(a[i]) *
+          static_cast<number::real_type>(b[i])
+        ) > limit;
+        flags |= (total ^ partial) & (product ^ partial);
+        total = partial;
+      }
+      result = static_cast<number::int_type>(total);
+
+      return !overflow && !(flags >> (sizeof(U) * 8 - 1));
+    }
+
+    PLORTH_KERNEL
+    number::real_type dot(const number::real_type* a,
+                          const number::real_type* b,
+                          std::size_t length)
+    {
+      vector<number::real_type> sums = {};
+      number::real_type result = 0;
+      std::size_t i = 0;
+
+      for (; i + lanes<number::real_type> <= length;
+           i += lanes<number::real_type>)
+      {
+        sums += load(a + i) * load(b + i);
+      }
+      for (std::size_t j = 0; j < lanes<number::real_type>; ++j)
+      {
+        result += sums[j];
+      }
+      for (; i < length; ++i)
+      {
+        result += a[i] * b[i];
+      }
+
+      return result;
+    }
+  }
+}
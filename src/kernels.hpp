@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <plorth/value-number.hpp>
+
+#include <cstddef>
+
+namespace plorth
+{
+  namespace kernels
+  {
+    /**
+     * Element-wise arithmetic operations.
+     */
+    enum class arithmetic
+    {
+      add,
+      subtract,
+      multiply,
+      divide
+    };
+
+    /**
+     * Element-wise comparison operations.
+     */
+    enum class comparison
+    {
+      equal,
+      not_equal,
+      less,
+      greater,
+      less_equal,
+      greater_equal
+    };
+
+    /**
+     * Applies arithmetic operation to each pair of integers from the two
+     * inputs. Division is not supported for integers, as it always produces
+     * real numbers.
+     *
+     * \return False if result of some operation does not fit into an
+     *         integer, in which case contents of the output are unspecified.
+     */
+    bool apply(arithmetic op,
+               const number::int_type* a,
+               const number::int_type* b,
+               number::int_type* output,
+               std::size_t length);
+
+    /**
+     * Applies arithmetic operation to each integer from the input, with the
+     * given integer as the left operand of each operation.
+     */
+    bool apply(arithmetic op,
+               number::int_type a,
+               const number::int_type* b,
+               number::int_type* output,
+               std::size_t length);
+
+    void apply(arithmetic op,
+               const number::real_type* a,
+               const number::real_type* b,
+               number::real_type* output,
+               std::size_t length);
+
+    void apply(arithmetic op,
+               number::real_type a,
+               const number::real_type* b,
+               number::real_type* output,
+               std::size_t length);
+
+    /**
+     * Compares each pair of numbers from the two inputs.
+     */
+    void compare(comparison op,
+                 const number::int_type* a,
+                 const number::int_type* b,
+                 bool* output,
+                 std::size_t length);
+
+    /**
+     * Compares each number from the input, with the given number as the
+     * left operand of each comparison.
+     */
+    void compare(comparison op,
+                 number::int_type a,
+                 const number::int_type* b,
+                 bool* output,
+                 std::size_t length);
+
+    void compare(comparison op,
+                 const number::real_type* a,
+                 const number::real_type* b,
+                 bool* output,
+                 std::size_t length);
+
+    void compare(comparison op,
+                 number::real_type a,
+                 const number::real_type* b,
+                 bool* output,
+                 std::size_t length);
+
+    /**
+     * Sums up integers. The sum is exact regardless of order of the
+     * integers, even when some of the intermediate sums would not fit into
+     * an integer.
+     *
+     * \param result      Receives the sum, if it fits into an integer.
+     * \param real_result Receives the sum as real number, if it does not.
+     * \return False if the sum does not fit into an integer.
+     */
+    bool sum(const number::int_type* data,
+             std::size_t length,
+             number::int_type& result,
+             number::real_type& real_result);
+
+    /**
+     * Sums up real numbers. The numbers are added up in several interleaved
+     * partial sums, so the result can differ slightly from adding them up
+     * one by one.
+     */
+    number::real_type sum(const number::real_type* data, std::size_t length);
+
+    /**
+     * Returns the smallest one of given numbers, which must not be empty.
+     * Real numbers yield NaN if any one of them is NaN.
+     */
+    number::int_type min(const number::int_type* data, std::size_t length);
+    number::real_type min(const number::real_type* data, std::size_t length);
+
+    /**
+     * Returns the largest one of given numbers, which must not be empty.
+     * Real numbers yield NaN if any one of them is NaN.
+     */
+    number::int_type max(const number::int_type* data, std::size_t length);
+    number::real_type max(const number::real_type* data, std::size_t length);
+
+    /**
+     * Calculates dot product of two integer sequences of the same length.
+     *
+     * \return False if the product does not fit into an integer.
+     */
+    bool dot(const number::int_type* a,
+             const number::int_type* b,
+             std::size_t length,
+             number::int_type& result);
+
+    number::real_type dot(const number::real_type* a,
+                          const number::real_type* b,
+                          std::size_t length);
+  }
+}
@@ -24,6 +24,14 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <plorth/context.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#if PLORTH_ENABLE_MEMORY_POOL && PLORTH_ENABLE_MUTEXES \
+  && PLORTH_ENABLE_THREAD_CACHE
+# include <vector>
+#endif
+
 #if PLORTH_ENABLE_MEMORY_POOL
 # if !defined(PLORTH_MEMORY_POOL_SIZE)
 #  define PLORTH_MEMORY_POOL_SIZE (4096 * 32)
@@ -35,31 +43,203 @@ namespace plorth
   namespace memory
   {
 #if PLORTH_ENABLE_MEMORY_POOL
-    static pool* pool_create();
-    static slot* pool_allocate(pool*, std::size_t);
-#endif
+    static_assert(
+      (PLORTH_MEMORY_POOL_SIZE & (PLORTH_MEMORY_POOL_SIZE - 1)) == 0,
+      "Size of memory slab must be a power of two."
+    );
+
+    /** Size class used for objects allocated outside slabs. */
+    static const std::uint32_t large_size_class = 0xffffffff;
+
+    /** Alignment of objects allocated by the memory manager. */
+    static const std::size_t alignment = 16;
+
+    /**
+     * Offset of the first slot in a slab, chosen so that the objects which
+     * follow the slot headers are properly aligned.
+     */
+    static const std::size_t slab_offset = (
+      (sizeof(slab) + sizeof(header) + alignment - 1) / alignment * alignment
+      - sizeof(header)
+    );
+
+    /** Offset of the object header from the beginning of a large block. */
+    static const std::size_t large_offset = (
+      (sizeof(large_block) + sizeof(header) + alignment - 1)
+      / alignment * alignment
+      - sizeof(header)
+    );
+
+    static std::size_t size_class_of(std::size_t);
+    static std::size_t slot_size_of(std::size_t);
+    static slab* slab_create(class manager*, std::size_t);
+    static void slab_destroy(slab*);
+
+# if PLORTH_ENABLE_MUTEXES && PLORTH_ENABLE_THREAD_CACHE
+    /**
+     * Maximum number of free slots a thread cache holds in a single size
+     * class. Once exceeded, half of them are returned into the slabs.
+     */
+    static const std::uint32_t magazine_capacity = 64;
+
+    /**
+     * Number of slots moved between thread cache and the slabs at once.
+     */
+    static const std::uint32_t magazine_batch = magazine_capacity / 2;
+
+    /**
+     * Stack of free slots of a single size class, linked through their
+     * memory.
+     */
+    struct magazine
+    {
+      header* head;
+      std::uint32_t count;
+    };
+
+    /**
+     * Free slots which a single thread holds from a single memory manager.
+     */
+    struct thread_cache
+    {
+      /**
+       * Memory manager which the slots belong to, or null pointer once the
+       * memory manager has been destroyed.
+       */
+      std::atomic<class manager*> manager;
+      /** Pointer to the next cache of the same memory manager. */
+      thread_cache* next;
+      /** Pointer to the previous cache of the same memory manager. */
+      thread_cache* prev;
+      magazine magazines[manager::size_class_count];
+    };
+
+    /**
+     * Caches of a single thread, one for each memory manager the thread has
+     * allocated from. Slots in the caches are returned to their memory
+     * managers when the thread exits.
+     */
+    struct thread_cache_list
+    {
+      std::vector<thread_cache*> caches;
+      /** Cache which was used most recently. */
+      thread_cache* last = nullptr;
+
+      ~thread_cache_list();
+
+      thread_cache* find(const class manager* manager);
+    };
+
+    /**
+     * Protects links between memory managers and thread caches, which are
+     * broken either by the thread exiting or the memory manager being
+     * destroyed.
+     */
+    static std::mutex cache_registry_mutex;
+
+    static thread_local thread_cache_list local_caches;
+# endif
 
     manager::manager()
-#if PLORTH_ENABLE_MEMORY_POOL
-      : m_pool_head(nullptr)
-      , m_pool_tail(nullptr)
+      : m_slab_head(nullptr)
+      , m_large_head(nullptr)
+      , m_destroying(false)
+# if PLORTH_ENABLE_MUTEXES && PLORTH_ENABLE_THREAD_CACHE
+      , m_caches(nullptr)
+      , m_remote_free(nullptr)
+# endif
+    {
+      for (std::size_t i = 0; i < size_class_count; ++i)
+      {
+        m_partial[i] = nullptr;
+      }
+    }
+#else
+    manager::manager() {}
 #endif
-      {}
 
     manager::~manager()
     {
 #if PLORTH_ENABLE_MEMORY_POOL
-      pool* current;
-      pool* prev;
+      // Objects destroyed here may release references to other objects, which
+      // then get destroyed as well. Instead of returning memory back to the
+      // system while the slabs are still being traversed, deallocation only
+      // marks the slots as free until every object has been destroyed.
+      m_destroying = true;
+
+# if PLORTH_ENABLE_MUTEXES && PLORTH_ENABLE_THREAD_CACHE
+      // Slots held by thread caches are released together with the slabs,
+      // so the caches are simply detached from the manager.
+      {
+        std::lock_guard<std::mutex> lock(cache_registry_mutex);
 
-      for (current = m_pool_tail; current; current = prev)
+        for (auto cache = m_caches; cache; cache = cache->next)
+        {
+          cache->manager.store(nullptr, std::memory_order_release);
+        }
+        m_caches = nullptr;
+      }
+# endif
+
+      const auto for_each_object = [this](auto callback)
       {
-        prev = current->prev;
-        for (struct slot* slot = current->used_head; slot; slot = slot->next)
+        for (slab* slab = m_slab_head; slab; slab = slab->next)
+        {
+          const std::size_t slot_size = slot_size_of(slab->size_class);
+          char* memory = reinterpret_cast<char*>(slab) + slab_offset;
+
+          for (; memory < slab->bump; memory += slot_size)
+          {
+            header* hdr = reinterpret_cast<header*>(memory);
+
+            if (hdr->used)
+            {
+              callback(reinterpret_cast<managed*>(hdr + 1));
+            }
+          }
+        }
+
+        for (large_block* block = m_large_head; block; block = block->next)
         {
-          delete reinterpret_cast<managed*>(slot->memory);
+          header* hdr = reinterpret_cast<header*>(
+            reinterpret_cast<char*>(block) + large_offset
+          );
+
+          if (hdr->used)
+          {
+            callback(reinterpret_cast<managed*>(hdr + 1));
+          }
         }
-        std::free(static_cast<void*>(current));
+      };
+
+      // Objects still alive at this point may refer to each other, even in
+      // cycles. Each of them is given an extra reference first, so that
+      // references released by destructors never bring the count down to
+      // zero and destroy an object for the second time. Memory of destroyed
+      // objects stays in place until the slabs are released below.
+      for_each_object([](managed* object)
+      {
+        object->retain();
+      });
+      for_each_object([](managed* object)
+      {
+        delete object;
+      });
+
+      while (m_slab_head)
+      {
+        slab* next = m_slab_head->next;
+
+        slab_destroy(m_slab_head);
+        m_slab_head = next;
+      }
+
+      while (m_large_head)
+      {
+        large_block* next = m_large_head->next;
+
+        std::free(static_cast<void*>(m_large_head));
+        m_large_head = next;
       }
 #endif
     }
@@ -67,219 +247,521 @@ namespace plorth
     void* manager::allocate(std::size_t size)
     {
 #if PLORTH_ENABLE_MEMORY_POOL
-      const std::size_t remainder = size % 8;
-      struct pool* pool;
-      struct slot* slot;
+      const std::size_t size_class = size_class_of(size);
+      header* hdr;
 
-      if (remainder)
+      // Objects which do not fit into any size class are allocated directly
+      // from the system allocator.
+      if (size_class >= size_class_count)
       {
-        size += 8 - remainder;
+        return allocate_large(size);
       }
 
-      // First go through existing memory pools and check whether we can slice
-      // a slot from any of them.
-      for (pool = m_pool_tail; pool; pool = pool->prev)
+# if PLORTH_ENABLE_MUTEXES && PLORTH_ENABLE_THREAD_CACHE
+      auto& magazine = local_cache()->magazines[size_class];
+
+      if (!magazine.head)
       {
-        if ((slot = pool_allocate(pool, size)))
-        {
-          return static_cast<void*>(slot->memory);
-        }
+        refill(magazine, size_class);
       }
+      hdr = magazine.head;
+      magazine.head = *reinterpret_cast<header**>(hdr + 1);
+      --magazine.count;
+# else
+#  if PLORTH_ENABLE_MUTEXES
+      std::lock_guard<std::mutex> lock(m_mutex);
+#  endif
+
+      hdr = take_slot(size_class);
+# endif
+      hdr->used = 1;
+
+      return static_cast<void*>(hdr + 1);
+#else
+      return std::malloc(size);
+#endif
+    }
 
-      // If all existing pools are full, create a new one. If that one fails,
-      // abort the entire process as it's a signal that we are out of memory.
-      if (!(pool = pool_create()))
+#if PLORTH_ENABLE_MEMORY_POOL
+    void* manager::allocate_large(std::size_t size)
+    {
+      char* memory = static_cast<char*>(
+        std::malloc(large_offset + sizeof(header) + size)
+      );
+      large_block* block;
+      header* hdr;
+# if PLORTH_ENABLE_MUTEXES
+      std::lock_guard<std::mutex> lock(m_mutex);
+# endif
+
+      if (!memory)
       {
         std::abort();
       }
 
+      block = reinterpret_cast<large_block*>(memory);
+      block->manager = this;
+      block->prev = nullptr;
+      if ((block->next = m_large_head))
+      {
+        m_large_head->prev = block;
+      }
+      m_large_head = block;
+
+      hdr = reinterpret_cast<header*>(memory + large_offset);
+      hdr->size_class = large_size_class;
+      hdr->used = 1;
+
+      return static_cast<void*>(hdr + 1);
+    }
+
+    header* manager::take_slot(std::size_t size_class)
+    {
+      struct slab* slab;
+      header* hdr;
+
+      // If there are no slabs with free slots in this size class, create a
+      // new one. If that fails, abort the entire process as it's a signal
+      // that we are out of memory.
+      if (!(slab = m_partial[size_class]))
+      {
+        if (!(slab = slab_create(this, size_class)))
+        {
+          std::abort();
+        }
+
 # if defined(PLORTH_ENABLE_GC_DEBUG)
-      std::fprintf(stderr, "GC: Memory pool allocated.\n");
+        std::fprintf(
+          stderr,
+          "GC: Memory slab allocated for size class %zu.\n",
+          size_class
+        );
 # endif
 
-      // Place the newly created pool into linked list of memory pools.
-      if ((pool->prev = m_pool_tail))
+        if ((slab->next = m_slab_head))
+        {
+          m_slab_head->prev = slab;
+        }
+        m_slab_head = slab;
+        m_partial[size_class] = slab;
+      }
+
+      // Prefer slots which have been used before, as their memory is most
+      // likely still in the cache.
+      if ((hdr = slab->free_head))
       {
-        m_pool_tail->next = pool;
+        slab->free_head = *reinterpret_cast<header**>(hdr + 1);
       } else {
-        m_pool_head = pool;
+        hdr = reinterpret_cast<header*>(slab->bump);
+        slab->bump += slot_size_of(size_class);
+        hdr->size_class = static_cast<std::uint32_t>(size_class);
+        hdr->used = 0;
       }
-      m_pool_tail = pool;
+      ++slab->used;
 
-      // Try to allocate slot from the freshly created memory pool. If even
-      // that is not possible, crash and burn as something is seriously wrong
-      // now.
-      if (!(slot = pool_allocate(pool, size)))
+      // Remove the slab from the list of partially used slabs, if it just
+      // became full.
+      if (!slab->free_head && slab->bump + slot_size_of(size_class) > slab->end)
       {
-        std::abort();
+        if ((m_partial[size_class] = slab->next_partial))
+        {
+          slab->next_partial->prev_partial = nullptr;
+        }
+        slab->next_partial = nullptr;
       }
 
-      return static_cast<void*>(slot->memory);
-#else
-      return std::malloc(size);
-#endif
+      return hdr;
     }
 
-    managed::managed() {}
+    void manager::deallocate(void* pointer)
+    {
+      header* hdr = static_cast<header*>(pointer) - 1;
+      class manager* manager;
+      struct slab* slab;
 
-    managed::~managed() {}
+      hdr->used = 0;
 
-    void* managed::operator new(std::size_t size, class manager& manager)
-    {
-      return manager.allocate(size);
-    }
+      if (hdr->size_class == large_size_class)
+      {
+        large_block* block = reinterpret_cast<large_block*>(
+          reinterpret_cast<char*>(hdr) - large_offset
+        );
 
-    void managed::operator delete(void* pointer)
-    {
-#if PLORTH_ENABLE_MEMORY_POOL
-      struct slot* slot;
-      struct pool* pool;
+        manager = block->manager;
+        if (manager->m_destroying)
+        {
+          return;
+        }
+# if PLORTH_ENABLE_MUTEXES
+        std::lock_guard<std::mutex> lock(manager->m_mutex);
+# endif
+        if (block->next)
+        {
+          block->next->prev = block->prev;
+        }
+        if (block->prev)
+        {
+          block->prev->next = block->next;
+        } else {
+          manager->m_large_head = block->next;
+        }
+        std::free(static_cast<void*>(block));
 
-      if (!pointer)
+        return;
+      }
+
+      slab = reinterpret_cast<struct slab*>(
+        reinterpret_cast<std::uintptr_t>(hdr)
+        & ~static_cast<std::uintptr_t>(PLORTH_MEMORY_POOL_SIZE - 1)
+      );
+      manager = slab->manager;
+      if (manager->m_destroying)
+      {
+        return;
+      }
+
+# if PLORTH_ENABLE_MUTEXES && PLORTH_ENABLE_THREAD_CACHE
+      // Slots are placed into cache of the releasing thread, regardless of
+      // which thread allocated them.
+      if (const auto cache = local_caches.find(manager))
       {
+        auto& magazine = cache->magazines[hdr->size_class];
+
+        *reinterpret_cast<header**>(hdr + 1) = magazine.head;
+        magazine.head = hdr;
+        if (++magazine.count > magazine_capacity)
+        {
+          manager->flush(magazine, magazine_batch);
+        }
+
         return;
       }
 
-      slot = reinterpret_cast<struct slot*>(static_cast<char*>(pointer) - sizeof(struct slot));
-      pool = slot->pool;
+      // Threads which have never allocated from the manager do not get a
+      // cache, as the slots would be stuck in it until the thread exits.
+      // Instead the slot is pushed into the remote free list of the manager.
+      auto head = manager->m_remote_free.load(std::memory_order_relaxed);
 
-      // Remove the slot from the linked of list of used slots in the pool.
-      if (slot->next && slot->prev)
+      do
       {
-        slot->next->prev = slot->prev;
-        slot->prev->next = slot->next;
+        *reinterpret_cast<header**>(hdr + 1) = head;
       }
-      else if (slot->next)
+      while (!manager->m_remote_free.compare_exchange_weak(
+        head,
+        hdr,
+        std::memory_order_release,
+        std::memory_order_relaxed
+      ));
+# else
+#  if PLORTH_ENABLE_MUTEXES
+      std::lock_guard<std::mutex> lock(manager->m_mutex);
+#  endif
+
+      manager->return_slot(hdr);
+# endif
+    }
+
+    void manager::return_slot(header* hdr)
+    {
+      struct slab* slab = reinterpret_cast<struct slab*>(
+        reinterpret_cast<std::uintptr_t>(hdr)
+        & ~static_cast<std::uintptr_t>(PLORTH_MEMORY_POOL_SIZE - 1)
+      );
+      const bool was_full = !slab->free_head
+        && slab->bump + slot_size_of(slab->size_class) > slab->end;
+
+      // Place the slot into the free list of the slab.
+      *reinterpret_cast<header**>(hdr + 1) = slab->free_head;
+      slab->free_head = hdr;
+      --slab->used;
+
+      // If the slab was full, it's not in the list of partially used slabs of
+      // the size class, so it needs to be placed back there.
+      if (was_full)
       {
-        slot->next->prev = nullptr;
-        pool->used_head = slot->next;
+        slab->prev_partial = nullptr;
+        if ((slab->next_partial = m_partial[slab->size_class]))
+        {
+          slab->next_partial->prev_partial = slab;
+        }
+        m_partial[slab->size_class] = slab;
       }
-      else if (slot->prev)
+
+      // Release the slab if it's no longer used, unless it's the last one
+      // remaining in it's size class. Keeping one empty slab around prevents
+      // slabs from being constantly created and destroyed when single object
+      // is allocated and released in a loop.
+      if (slab->used > 0
+          || (m_partial[slab->size_class] == slab && !slab->next_partial))
       {
-        slot->prev->next = nullptr;
-        pool->used_tail = slot->prev;
-      } else {
-        pool->used_head = nullptr;
-        pool->used_tail = nullptr;
+        return;
       }
 
-      // Then place the slot into linked of list of free slots in the pool.
-      slot->next = nullptr;
-      if ((slot->prev = slot->pool->free_tail))
+      if (slab->next_partial)
+      {
+        slab->next_partial->prev_partial = slab->prev_partial;
+      }
+      if (slab->prev_partial)
       {
-        pool->free_tail->next = slot;
+        slab->prev_partial->next_partial = slab->next_partial;
       } else {
-        pool->free_head = slot;
+        m_partial[slab->size_class] = slab->next_partial;
       }
-      pool->free_tail = slot;
 
-      // Remove the pool if it's no longer used.
-      if (pool->next && pool->prev && !pool->used_head && !pool->used_tail)
+      if (slab->next)
+      {
+        slab->next->prev = slab->prev;
+      }
+      if (slab->prev)
       {
-        pool->next->prev = pool->prev;
-        pool->prev->next = pool->next;
+        slab->prev->next = slab->next;
+      } else {
+        m_slab_head = slab->next;
+      }
+
 # if defined(PLORTH_ENABLE_GC_DEBUG)
-        std::fprintf(stderr, "GC: Memory pool removed.\n");
+      std::fprintf(stderr, "GC: Memory slab removed.\n");
 # endif
-        std::free(static_cast<void*>(pool));
+      slab_destroy(slab);
+    }
+
+# if PLORTH_ENABLE_MUTEXES && PLORTH_ENABLE_THREAD_CACHE
+    thread_cache* manager::local_cache()
+    {
+      auto cache = local_caches.find(this);
+
+      if (cache)
+      {
+        return cache;
       }
-#else
-      if (pointer)
+
+      cache = new thread_cache();
+      cache->manager.store(this, std::memory_order_relaxed);
+      cache->prev = nullptr;
+      for (auto& magazine : cache->magazines)
       {
-        std::free(pointer);
+        magazine.head = nullptr;
+        magazine.count = 0;
       }
-#endif
+      {
+        std::lock_guard<std::mutex> lock(cache_registry_mutex);
+
+        if ((cache->next = m_caches))
+        {
+          m_caches->prev = cache;
+        }
+        m_caches = cache;
+      }
+      local_caches.caches.push_back(cache);
+      local_caches.last = cache;
+
+      return cache;
     }
 
-#if PLORTH_ENABLE_MEMORY_POOL
-    static pool* pool_create()
+    void manager::refill(magazine& magazine, std::size_t size_class)
     {
-      char* memory = static_cast<char*>(std::malloc(sizeof(struct pool) + PLORTH_MEMORY_POOL_SIZE));
-      struct pool* pool;
+      std::lock_guard<std::mutex> lock(m_mutex);
 
-      if (!memory)
+      drain_remote_frees();
+      while (magazine.count < magazine_batch)
       {
-        return nullptr;
+        header* hdr = take_slot(size_class);
+
+        *reinterpret_cast<header**>(hdr + 1) = magazine.head;
+        magazine.head = hdr;
+        ++magazine.count;
       }
+    }
+
+    void manager::flush(magazine& magazine, std::uint32_t count)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
 
-      pool = reinterpret_cast<struct pool*>(memory);
-      pool->next = nullptr;
-      pool->prev = nullptr;
-      pool->remaining = PLORTH_MEMORY_POOL_SIZE;
-      pool->memory = memory + sizeof(struct pool);
-      pool->free_head = nullptr;
-      pool->free_tail = nullptr;
-      pool->used_head = nullptr;
-      pool->used_tail = nullptr;
+      for (; count > 0 && magazine.head; --count)
+      {
+        header* hdr = magazine.head;
 
-      return pool;
+        magazine.head = *reinterpret_cast<header**>(hdr + 1);
+        --magazine.count;
+        return_slot(hdr);
+      }
     }
 
-    static slot* pool_allocate(struct pool* pool, std::size_t size)
+    void manager::drain_remote_frees()
     {
-      struct slot* slot;
-      char* memory;
+      header* hdr = m_remote_free.exchange(nullptr, std::memory_order_acquire);
 
-      for (slot = pool->free_head; slot; slot = slot->next)
+      while (hdr)
       {
-        if (slot->size < size)
-        {
-          continue;
-        }
+        header* next = *reinterpret_cast<header**>(hdr + 1);
 
-        if (slot->next && slot->prev)
+        return_slot(hdr);
+        hdr = next;
+      }
+    }
+
+    thread_cache_list::~thread_cache_list()
+    {
+      for (const auto cache : caches)
+      {
+        std::lock_guard<std::mutex> lock(cache_registry_mutex);
+        const auto manager = cache->manager.load(std::memory_order_acquire);
+
+        if (manager)
         {
-          slot->next->prev = slot->prev;
-          slot->prev->next = slot->next;
+          for (auto& magazine : cache->magazines)
+          {
+            manager->flush(magazine, magazine.count);
+          }
+          if (cache->next)
+          {
+            cache->next->prev = cache->prev;
+          }
+          if (cache->prev)
+          {
+            cache->prev->next = cache->next;
+          } else {
+            manager->m_caches = cache->next;
+          }
         }
-        else if (slot->next)
+        delete cache;
+      }
+    }
+
+    thread_cache* thread_cache_list::find(const class manager* manager)
+    {
+      if (last && last->manager.load(std::memory_order_relaxed) == manager)
+      {
+        return last;
+      }
+      for (auto it = std::begin(caches); it != std::end(caches);)
+      {
+        const auto owner = (*it)->manager.load(std::memory_order_acquire);
+
+        if (owner == manager)
         {
-          slot->next->prev = nullptr;
-          pool->free_head = slot->next;
+          return last = *it;
         }
-        else if (slot->prev)
+        // Caches of destroyed memory managers are no longer referenced by
+        // anyone else, and can be discarded.
+        else if (!owner)
         {
-          slot->prev->next = nullptr;
-          pool->free_tail = slot->prev;
-        } else {
-          pool->free_head = nullptr;
-          pool->free_tail = nullptr;
+          if (last == *it)
+          {
+            last = nullptr;
+          }
+          delete *it;
+          it = caches.erase(it);
+          continue;
         }
+        ++it;
+      }
 
-        slot->next = nullptr;
-        if ((slot->prev = pool->used_tail))
-        {
-          slot->prev->next = slot;
-        } else {
-          pool->used_head = slot;
-        }
-        pool->used_tail = slot;
+      return nullptr;
+    }
+# endif
+#endif
 
-        return slot;
+    managed::managed()
+      : m_ref_count(0) {}
+
+    managed::~managed() {}
+
+    void* managed::operator new(std::size_t size, class manager& manager)
+    {
+      return manager.allocate(size);
+    }
+
+    void managed::operator delete(void* pointer)
+    {
+      if (!pointer)
+      {
+        return;
       }
+#if PLORTH_ENABLE_MEMORY_POOL
+      manager::deallocate(pointer);
+# else
+      std::free(pointer);
+#endif
+    }
 
-      if (pool->remaining < size + sizeof(struct slot))
+#if PLORTH_ENABLE_MEMORY_POOL
+    /**
+     * Determines size class for an object of given size. Size classes are 16
+     * bytes apart up to 256 bytes, and 64 bytes apart from there up to 1024
+     * bytes. Returns a value equal or greater than size class count if the
+     * object is too large for any size class.
+     */
+    static std::size_t size_class_of(std::size_t size)
+    {
+      size += sizeof(header);
+
+      if (size <= 256)
       {
-        return nullptr;
+        return (size + 15) / 16 - 1;
+      }
+      else if (size <= 1024)
+      {
+        return 15 + (size - 256 + 63) / 64;
       }
 
-      memory = pool->memory + (PLORTH_MEMORY_POOL_SIZE - pool->remaining);
-      pool->remaining -= size + sizeof(struct slot);
+      return manager::size_class_count;
+    }
 
-      slot = reinterpret_cast<struct slot*>(memory);
-      slot->pool = pool;
-      slot->next = nullptr;
-      if ((slot->prev = pool->used_tail))
+    /**
+     * Returns size of a single slot, including the object header, in given
+     * size class.
+     */
+    static std::size_t slot_size_of(std::size_t size_class)
+    {
+      if (size_class < 16)
       {
-        slot->prev->next = slot;
-      } else {
-        pool->used_head = slot;
+        return (size_class + 1) * 16;
       }
-      pool->used_tail = slot;
-      slot->size = size;
-      slot->memory = memory + sizeof(struct slot);
 
-      return slot;
+      return 256 + (size_class - 15) * 64;
+    }
+
+    static slab* slab_create(class manager* manager, std::size_t size_class)
+    {
+      void* memory;
+      struct slab* slab;
+
+# if defined(_WIN32)
+      memory = _aligned_malloc(PLORTH_MEMORY_POOL_SIZE, PLORTH_MEMORY_POOL_SIZE);
+# else
+      memory = std::aligned_alloc(
+        PLORTH_MEMORY_POOL_SIZE,
+        PLORTH_MEMORY_POOL_SIZE
+      );
+# endif
+      if (!memory)
+      {
+        return nullptr;
+      }
+
+      slab = static_cast<struct slab*>(memory);
+      slab->manager = manager;
+      slab->next = nullptr;
+      slab->prev = nullptr;
+      slab->next_partial = nullptr;
+      slab->prev_partial = nullptr;
+      slab->free_head = nullptr;
+      slab->bump = static_cast<char*>(memory) + slab_offset;
+      slab->end = static_cast<char*>(memory) + PLORTH_MEMORY_POOL_SIZE;
+      slab->size_class = static_cast<std::uint32_t>(size_class);
+      slab->used = 0;
+
+      return slab;
+    }
+
+    static void slab_destroy(slab* slab)
+    {
+# if defined(_WIN32)
+      _aligned_free(static_cast<void*>(slab));
+# else
+      std::free(static_cast<void*>(slab));
+# endif
     }
 #endif /* PLORTH_ENABLE_MEMORY_POOL */
   }
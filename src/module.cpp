@@ -30,6 +30,9 @@
 # include <peelo/unicode/encoding/utf8.hpp>
 # include <climits>
 # include <fstream>
+# if PLORTH_ENABLE_MUTEXES
+#  include <mutex>
+# endif
 # if HAVE_SYS_TYPES_H
 #  include <sys/types.h>
 # endif
@@ -48,10 +51,10 @@
 
 namespace plorth
 {
-  bool runtime::import(const std::shared_ptr<class context>& context,
+  bool runtime::import(const ref<class context>& context,
                        const std::u32string& path)
   {
-    std::shared_ptr<class object> module;
+    ref<class object> module;
 
     // Do not allow importing anything if the runtime does not have a module
     // manager.
@@ -80,16 +83,17 @@ namespace plorth
 
       // Transfer all exported words from the module into the calling execution
       // context.
-      for (const auto& property : module->entries())
+      module->for_each([this, &dictionary](const object::key_type& key,
+                                           const object::mapped_type& value)
       {
-        if (value::is(property.second, value::type::quote))
+        if (value::is(value, value::type::quote))
         {
           dictionary.insert(word(
-            symbol(property.first),
-            std::static_pointer_cast<quote>(property.second)
+            symbol(key.name()),
+            ref_cast<quote>(value)
           ));
         }
-      }
+      });
 
       return true;
     }
@@ -130,7 +134,7 @@ namespace plorth
       public:
         using module_cache_type = std::unordered_map<
           std::u32string,
-          std::shared_ptr<object>
+          ref<object>
         >;
 
         explicit file_system_manager(
@@ -142,8 +146,8 @@ namespace plorth
             module_file_extension
           )) {}
 
-        std::shared_ptr<object> import_module(
-          const std::shared_ptr<context>& ctx,
+        ref<object> import_module(
+          const ref<context>& ctx,
           const std::u32string& path
         )
         {
@@ -159,15 +163,23 @@ namespace plorth
               U"No such file or directory: " + path
             );
 
-            return std::shared_ptr<object>();
+            return ref<object>();
           }
 
           // Then look from the module cache whether the module has already
           // been imported before, and use that cached module if such exists.
-          cached_module = m_cache.find(resolved_path);
-          if (cached_module != std::end(m_cache))
+          // The lock is not held while the module is being loaded, as the
+          // module can import other modules.
           {
-            return cached_module->second;
+#if PLORTH_ENABLE_MUTEXES
+            std::lock_guard<std::mutex> lock(m_cache_mutex);
+#endif
+
+            cached_module = m_cache.find(resolved_path);
+            if (cached_module != std::end(m_cache))
+            {
+              return cached_module->second;
+            }
           }
 
           // Otherwise begin loading the module from file system.
@@ -193,7 +205,7 @@ namespace plorth
          * \return              Boolean flag telling whether the given path was
          *                      successfully resolved into a file or not.
          */
-        bool resolve_path(const std::shared_ptr<context>& ctx,
+        bool resolve_path(const ref<context>& ctx,
                           const std::u32string& path,
                           std::u32string& resolved_path)
         {
@@ -360,18 +372,18 @@ namespace plorth
          *             reference if any kind of error occurred during the
          *             import.
          */
-        std::shared_ptr<object> import_resolved_path(
-          const std::shared_ptr<context>& ctx,
+        ref<object> import_resolved_path(
+          const ref<context>& ctx,
           const std::u32string& path
         )
         {
           std::ifstream is(peelo::unicode::encoding::utf8::encode(path));
           std::string raw_source;
           std::u32string source;
-          std::shared_ptr<quote> compiled_module;
-          std::shared_ptr<context> module_ctx;
+          ref<quote> compiled_module;
+          ref<context> module_ctx;
           std::vector<object::value_type> result;
-          std::shared_ptr<object> module;
+          ref<object> module;
 
           if (!is.good())
           {
@@ -380,7 +392,7 @@ namespace plorth
               U"Unable to import from `" + path + U"'"
             );
 
-            return std::shared_ptr<object>();
+            return ref<object>();
           }
 
           raw_source = std::string(
@@ -400,13 +412,13 @@ namespace plorth
               U"Unable to decode source code into UTF-8."
             );
 
-            return std::shared_ptr<object>();
+            return ref<object>();
           }
 
           // Then attempt to compile it.
           if (!(compiled_module = ctx->compile(source, path)))
           {
-            return std::shared_ptr<object>();
+            return ref<object>();
           }
 
           // Run the module code inside new execution context.
@@ -419,7 +431,7 @@ namespace plorth
               ctx->error(module_ctx->error());
             }
 
-            return std::shared_ptr<object>();
+            return ref<object>();
           }
 
           // Finally convert the module into an object.
@@ -429,7 +441,13 @@ namespace plorth
           }
 
           module = ctx->runtime()->object(result);
-          m_cache[path] = module;
+          {
+#if PLORTH_ENABLE_MUTEXES
+            std::lock_guard<std::mutex> lock(m_cache_mutex);
+#endif
+
+            m_cache[path] = module;
+          }
 
           return module;
         }
@@ -441,6 +459,10 @@ namespace plorth
         const std::string m_module_file_extension;
         /** Cache for already imported modules. */
         module_cache_type m_cache;
+#if PLORTH_ENABLE_MUTEXES
+        /** Used for synchronizing access to the module cache. */
+        std::mutex m_cache_mutex;
+#endif
       };
 #endif
 
@@ -451,22 +473,22 @@ namespace plorth
       class dummy_manager : public manager
       {
       public:
-        std::shared_ptr<object> import_module(const std::shared_ptr<context>&,
-                                              const std::u32string&)
+        ref<object> import_module(const ref<context>&,
+                                  const std::u32string&)
         {
-          return std::shared_ptr<object>();
+          return ref<object>();
         }
       };
     }
 
-    std::shared_ptr<manager> manager::file_system(
+    ref<manager> manager::file_system(
       memory::manager& memory_manager,
       const std::vector<std::u32string>& lookup_paths,
       const std::u32string& module_file_extension
     )
     {
 #if PLORTH_ENABLE_FILE_SYSTEM_MODULES
-      return std::shared_ptr<manager>(new (memory_manager) file_system_manager(
+      return ref<manager>(new (memory_manager) file_system_manager(
         lookup_paths,
         module_file_extension
       ));
@@ -475,9 +497,9 @@ namespace plorth
 #endif
     }
 
-    std::shared_ptr<manager> manager::dummy(memory::manager& memory_manager)
+    ref<manager> manager::dummy(memory::manager& memory_manager)
     {
-      return std::shared_ptr<manager>(new (memory_manager) dummy_manager());
+      return ref<manager>(new (memory_manager) dummy_manager());
     }
 
 #if PLORTH_ENABLE_FILE_SYSTEM_MODULES
@@ -27,7 +27,13 @@
 #include <plorth/value-error.hpp>
 #include <plorth/value-quote.hpp>
 
+#include "./shape.hpp"
+#include "./thread-pool.hpp"
+
 #include <cassert>
+#if PLORTH_ENABLE_THREADS
+# include <thread>
+#endif
 
 namespace plorth
 {
@@ -40,25 +46,26 @@ namespace plorth
     runtime::prototype_definition number_prototype();
     runtime::prototype_definition object_prototype();
     runtime::prototype_definition quote_prototype();
+    runtime::prototype_definition seq_prototype();
     runtime::prototype_definition string_prototype();
     runtime::prototype_definition symbol_prototype();
     runtime::prototype_definition word_prototype();
   }
 
-  static inline std::shared_ptr<object> make_prototype(
+  static inline ref<object> make_prototype(
     runtime*,
     const char32_t*,
     const runtime::prototype_definition&
   );
 
-  std::shared_ptr<runtime> runtime::make(
+  ref<runtime> runtime::make(
     memory::manager& memory_manager,
-    const std::shared_ptr<io::input>& input,
-    const std::shared_ptr<io::output>& output,
-    const std::shared_ptr<module::manager>& module_manager
+    const ref<io::input>& input,
+    const ref<io::output>& output,
+    const ref<module::manager>& module_manager
   )
   {
-    const auto runtime = std::shared_ptr<class runtime>(
+    const auto runtime = ref<class runtime>(
       new (memory_manager) class runtime(&memory_manager)
     );
 
@@ -74,11 +81,25 @@ namespace plorth
 
   runtime::runtime(memory::manager* memory_manager)
     : m_memory_manager(memory_manager)
+    , m_execution_engine(execution_engine::bytecode)
+#if PLORTH_ENABLE_THREADS
+    , m_concurrency(std::thread::hardware_concurrency())
+#else
+    , m_concurrency(1)
+#endif
+    , m_frozen(false)
   {
     assert(memory_manager);
 
+    m_empty_shape = ref<shape>(new (*memory_manager) shape());
     m_true_value = value<class boolean>(true);
     m_false_value = value<class boolean>(false);
+#if PLORTH_ENABLE_INTEGER_CACHE
+    for (int i = 0; i < 256; ++i)
+    {
+      m_integer_cache[i] = number(number::int_type(i - 128));
+    }
+#endif
 
     for (auto& entry : api::global_dictionary())
     {
@@ -118,6 +139,11 @@ namespace plorth
       U"quote",
       api::quote_prototype()
     );
+    m_seq_prototype = make_prototype(
+      this,
+      U"seq",
+      api::seq_prototype()
+    );
     m_string_prototype = make_prototype(
       this,
       U"string",
@@ -135,6 +161,38 @@ namespace plorth
     );
   }
 
+  runtime::~runtime() {}
+
+  void runtime::freeze()
+  {
+    m_frozen = true;
+    m_dictionary.freeze();
+  }
+
+  void runtime::concurrency(std::size_t concurrency)
+  {
+#if PLORTH_ENABLE_MUTEXES
+    std::lock_guard<std::mutex> lock(m_thread_pool_mutex);
+#endif
+
+    m_concurrency = concurrency;
+    m_thread_pool.reset();
+  }
+
+  class thread_pool& runtime::thread_pool()
+  {
+#if PLORTH_ENABLE_MUTEXES
+    std::lock_guard<std::mutex> lock(m_thread_pool_mutex);
+#endif
+
+    if (!m_thread_pool)
+    {
+      m_thread_pool.reset(new class thread_pool(m_concurrency));
+    }
+
+    return *m_thread_pool;
+  }
+
   io::input::result runtime::read(io::input::size_type size,
                                   std::u32string& output,
                                   io::input::size_type& read)
@@ -173,14 +231,14 @@ namespace plorth
     println();
   }
 
-  static inline std::shared_ptr<object> make_prototype(
+  static inline ref<object> make_prototype(
     class runtime* runtime,
     const char32_t* name,
     const runtime::prototype_definition& definition
   )
   {
     std::vector<object::value_type> properties;
-    std::shared_ptr<object> prototype;
+    ref<object> prototype;
 
     for (auto& entry : definition)
     {
@@ -189,7 +247,7 @@ namespace plorth
         runtime->native_quote(entry.second)
       });
     }
-    properties.push_back({ U"__proto__", std::shared_ptr<value>() });
+    properties.push_back({ U"__proto__", ref<value>() });
     prototype = runtime->object(properties);
 
     // Define prototype into global dictionary as constant if name has been
@@ -0,0 +1,613 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "./search.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+# define PLORTH_SEARCH_X86 1
+# include <immintrin.h>
+#endif
+
+namespace plorth
+{
+  namespace search
+  {
+    namespace
+    {
+      template<class CharT>
+      using searcher = std::size_t (*)(
+        const CharT*,
+        std::size_t,
+        const CharT*,
+        std::size_t
+      );
+
+      /**
+       * Tests whether the needle matches the haystack at given position,
+       * once the first and the last code unit of the needle are already
+       * known to match.
+       */
+      template<class CharT>
+      inline bool match_middle(const CharT* position,
+                               const CharT* needle,
+                               std::size_t needle_length)
+      {
+        return needle_length < 3 || std::equal(
+          needle + 1,
+          needle + needle_length - 1,
+          position + 1
+        );
+      }
+
+      template<class CharT>
+      std::size_t find_scalar(const CharT* haystack,
+                              std::size_t haystack_length,
+                              const CharT* needle,
+                              std::size_t needle_length)
+      {
+        const auto first = needle[0];
+        const auto last = needle[needle_length - 1];
+
+        for (std::size_t i = 0; i + needle_length <= haystack_length; ++i)
+        {
+          if (haystack[i] == first
+              && haystack[i + needle_length - 1] == last
+              && match_middle(haystack + i, needle, needle_length))
+          {
+            return i;
+          }
+        }
+
+        return npos;
+      }
+
+      template<class CharT>
+      std::size_t rfind_scalar(const CharT* haystack,
+                               std::size_t haystack_length,
+                               const CharT* needle,
+                               std::size_t needle_length)
+      {
+        const auto first = needle[0];
+        const auto last = needle[needle_length - 1];
+
+        if (needle_length > haystack_length)
+        {
+          return npos;
+        }
+        for (auto i = haystack_length - needle_length + 1; i-- > 0;)
+        {
+          if (haystack[i] == first
+              && haystack[i + needle_length - 1] == last
+              && match_middle(haystack + i, needle, needle_length))
+          {
+            return i;
+          }
+        }
+
+        return npos;
+      }
+
+#if PLORTH_SEARCH_X86
+      /*
+       * The vectorized searchers compare the first and the last code unit of
+       * the needle against several consecutive positions of the haystack at
+       * once, and only compare the rest of the needle at positions where both
+       * of them match.
+       *
+       * Byte masks produced by the comparisons have one bit for each byte of
+       * a code unit, so only the lowest bit of each code unit is kept.
+       */
+      template<class CharT>
+      constexpr unsigned int lane_mask()
+      {
+        return 0xffffffffu / ((1u << sizeof(CharT)) - 1);
+      }
+
+      template<class CharT>
+      __attribute__((target("sse2")))
+      inline __m128i splat_sse2(CharT c)
+      {
+        if constexpr (sizeof(CharT) == 1)
+        {
+          return _mm_set1_epi8(static_cast<char>(c));
+        }
+        else if constexpr (sizeof(CharT) == 2)
+        {
+          return _mm_set1_epi16(static_cast<short>(c));
+        } else {
+          return _mm_set1_epi32(static_cast<int>(c));
+        }
+      }
+
+      template<class CharT>
+      __attribute__((target("sse2")))
+      inline unsigned int match_sse2(const __m128i& first,
+                                     const __m128i& last,
+                                     const CharT* block_first,
+                                     const CharT* block_last)
+      {
+        const auto a = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(block_first)
+        );
+        const auto b = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(block_last)
+        );
+        __m128i result;
+
+        if constexpr (sizeof(CharT) == 1)
+        {
+          result = _mm_and_si128(
+            _mm_cmpeq_epi8(first, a),
+            _mm_cmpeq_epi8(last, b)
+          );
+        }
+        else if constexpr (sizeof(CharT) == 2)
+        {
+          result = _mm_and_si128(
+            _mm_cmpeq_epi16(first, a),
+            _mm_cmpeq_epi16(last, b)
+          );
+        } else {
+          result = _mm_and_si128(
+            _mm_cmpeq_epi32(first, a),
+            _mm_cmpeq_epi32(last, b)
+          );
+        }
+
+        return static_cast<unsigned int>(_mm_movemask_epi8(result))
+          & lane_mask<CharT>();
+      }
+
+      template<class CharT>
+      __attribute__((target("avx2")))
+      inline __m256i splat_avx2(CharT c)
+      {
+        if constexpr (sizeof(CharT) == 1)
+        {
+          return _mm256_set1_epi8(static_cast<char>(c));
+        }
+        else if constexpr (sizeof(CharT) == 2)
+        {
+          return _mm256_set1_epi16(static_cast<short>(c));
+        } else {
+          return _mm256_set1_epi32(static_cast<int>(c));
+        }
+      }
+
+      template<class CharT>
+      __attribute__((target("avx2")))
+      inline unsigned int match_avx2(const __m256i& first,
+                                     const __m256i& last,
+                                     const CharT* block_first,
+                                     const CharT* block_last)
+      {
+        const auto a = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(block_first)
+        );
+        const auto b = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(block_last)
+        );
+        __m256i result;
+
+        if constexpr (sizeof(CharT) == 1)
+        {
+          result = _mm256_and_si256(
+            _mm256_cmpeq_epi8(first, a),
+            _mm256_cmpeq_epi8(last, b)
+          );
+        }
+        else if constexpr (sizeof(CharT) == 2)
+        {
+          result = _mm256_and_si256(
+            _mm256_cmpeq_epi16(first, a),
+            _mm256_cmpeq_epi16(last, b)
+          );
+        } else {
+          result = _mm256_and_si256(
+            _mm256_cmpeq_epi32(first, a),
+            _mm256_cmpeq_epi32(last, b)
+          );
+        }
+
+        return static_cast<unsigned int>(_mm256_movemask_epi8(result))
+          & lane_mask<CharT>();
+      }
+
+      template<class CharT>
+      __attribute__((target("sse2")))
+      std::size_t find_sse2(const CharT* haystack,
+                            std::size_t haystack_length,
+                            const CharT* needle,
+                            std::size_t needle_length)
+      {
+        constexpr std::size_t lanes = 16 / sizeof(CharT);
+        const auto first = splat_sse2(needle[0]);
+        const auto last = splat_sse2(needle[needle_length - 1]);
+        std::size_t i = 0;
+
+        for (; i + needle_length + lanes - 1 <= haystack_length; i += lanes)
+        {
+          auto mask = match_sse2(
+            first,
+            last,
+            haystack + i,
+            haystack + i + needle_length - 1
+          );
+
+          while (mask)
+          {
+            const auto lane = __builtin_ctz(mask) / sizeof(CharT);
+
+            if (match_middle(haystack + i + lane, needle, needle_length))
+            {
+              return i + lane;
+            }
+            mask &= mask - 1;
+          }
+        }
+
+        const auto rest = find_scalar(
+          haystack + i,
+          haystack_length - i,
+          needle,
+          needle_length
+        );
+
+        return rest == npos ? npos : i + rest;
+      }
+
+      template<class CharT>
+      __attribute__((target("sse2")))
+      std::size_t rfind_sse2(const CharT* haystack,
+                             std::size_t haystack_length,
+                             const CharT* needle,
+                             std::size_t needle_length)
+      {
+        constexpr std::size_t lanes = 16 / sizeof(CharT);
+        const auto first = splat_sse2(needle[0]);
+        const auto last = splat_sse2(needle[needle_length - 1]);
+        // Number of positions which have not been tested yet.
+        auto end = haystack_length - needle_length + 1;
+
+        for (; end >= lanes; end -= lanes)
+        {
+          const auto start = end - lanes;
+          auto mask = match_sse2(
+            first,
+            last,
+            haystack + start,
+            haystack + start + needle_length - 1
+          );
+
+          while (mask)
+          {
+            const auto bit = 31 - __builtin_clz(mask);
+            const auto lane = bit / sizeof(CharT);
+
+            if (match_middle(haystack + start + lane, needle, needle_length))
+            {
+              return start + lane;
+            }
+            mask &= ~(1u << bit);
+          }
+        }
+
+        return rfind_scalar(
+          haystack,
+          end + needle_length - 1,
+          needle,
+          needle_length
+        );
+      }
+
+      template<class CharT>
+      __attribute__((target("avx2")))
+      std::size_t find_avx2(const CharT* haystack,
+                            std::size_t haystack_length,
+                            const CharT* needle,
+                            std::size_t needle_length)
+      {
+        constexpr std::size_t lanes = 32 / sizeof(CharT);
+        const auto first = splat_avx2(needle[0]);
+        const auto last = splat_avx2(needle[needle_length - 1]);
+        std::size_t i = 0;
+
+        for (; i + needle_length + lanes - 1 <= haystack_length; i += lanes)
+        {
+          auto mask = match_avx2(
+            first,
+            last,
+            haystack + i,
+            haystack + i + needle_length - 1
+          );
+
+          while (mask)
+          {
+            const auto lane = __builtin_ctz(mask) / sizeof(CharT);
+
+            if (match_middle(haystack + i + lane, needle, needle_length))
+            {
+              return i + lane;
+            }
+            mask &= mask - 1;
+          }
+        }
+
+        const auto rest = find_scalar(
+          haystack + i,
+          haystack_length - i,
+          needle,
+          needle_length
+        );
+
+        return rest == npos ? npos : i + rest;
+      }
+
+      template<class CharT>
+      __attribute__((target("avx2")))
+      std::size_t rfind_avx2(const CharT* haystack,
+                             std::size_t haystack_length,
+                             const CharT* needle,
+                             std::size_t needle_length)
+      {
+        constexpr std::size_t lanes = 32 / sizeof(CharT);
+        const auto first = splat_avx2(needle[0]);
+        const auto last = splat_avx2(needle[needle_length - 1]);
+        // Number of positions which have not been tested yet.
+        auto end = haystack_length - needle_length + 1;
+
+        for (; end >= lanes; end -= lanes)
+        {
+          const auto start = end - lanes;
+          auto mask = match_avx2(
+            first,
+            last,
+            haystack + start,
+            haystack + start + needle_length - 1
+          );
+
+          while (mask)
+          {
+            const auto bit = 31 - __builtin_clz(mask);
+            const auto lane = bit / sizeof(CharT);
+
+            if (match_middle(haystack + start + lane, needle, needle_length))
+            {
+              return start + lane;
+            }
+            mask &= ~(1u << bit);
+          }
+        }
+
+        return rfind_scalar(
+          haystack,
+          end + needle_length - 1,
+          needle,
+          needle_length
+        );
+      }
+#endif
+
+      /**
+       * Boyer-Moore-Horspool search. Shift table is indexed with the lowest
+       * eight bits of the code units, which keeps the table small while the
+       * shifts remain safe for code units sharing the same low bits.
+       */
+      template<class CharT>
+      std::size_t find_horspool(const CharT* haystack,
+                                std::size_t haystack_length,
+                                const CharT* needle,
+                                std::size_t needle_length)
+      {
+        const auto last = needle[needle_length - 1];
+        std::size_t shift[256];
+
+        std::fill(std::begin(shift), std::end(shift), needle_length);
+        for (std::size_t i = 0; i + 1 < needle_length; ++i)
+        {
+          shift[needle[i] & 0xff] = needle_length - 1 - i;
+        }
+        for (std::size_t i = 0;
+             i + needle_length <= haystack_length;
+             i += shift[haystack[i + needle_length - 1] & 0xff])
+        {
+          if (haystack[i + needle_length - 1] == last
+              && std::equal(needle, needle + needle_length - 1, haystack + i))
+          {
+            return i;
+          }
+        }
+
+        return npos;
+      }
+
+      template<class CharT>
+      std::size_t rfind_horspool(const CharT* haystack,
+                                 std::size_t haystack_length,
+                                 const CharT* needle,
+                                 std::size_t needle_length)
+      {
+        const auto first = needle[0];
+        std::size_t shift[256];
+
+        std::fill(std::begin(shift), std::end(shift), needle_length);
+        for (auto i = needle_length - 1; i > 0; --i)
+        {
+          shift[needle[i] & 0xff] = i;
+        }
+        for (auto i = haystack_length - needle_length;;)
+        {
+          const auto c = haystack[i];
+
+          if (c == first && std::equal(
+                needle + 1,
+                needle + needle_length,
+                haystack + i + 1
+              ))
+          {
+            return i;
+          }
+          else if (shift[c & 0xff] > i)
+          {
+            break;
+          }
+          i -= shift[c & 0xff];
+        }
+
+        return npos;
+      }
+
+      template<class CharT>
+      searcher<CharT> select_find()
+      {
+#if PLORTH_SEARCH_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+          return find_avx2<CharT>;
+        }
+        else if (__builtin_cpu_supports("sse2"))
+        {
+          return find_sse2<CharT>;
+        }
+#endif
+
+        return find_scalar<CharT>;
+      }
+
+      template<class CharT>
+      searcher<CharT> select_rfind()
+      {
+#if PLORTH_SEARCH_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+          return rfind_avx2<CharT>;
+        }
+        else if (__builtin_cpu_supports("sse2"))
+        {
+          return rfind_sse2<CharT>;
+        }
+#endif
+
+        return rfind_scalar<CharT>;
+      }
+    }
+
+    template<class CharT>
+    std::size_t find(const CharT* haystack,
+                     std::size_t haystack_length,
+                     const CharT* needle,
+                     std::size_t needle_length)
+    {
+      static const searcher<CharT> filter = select_find<CharT>();
+
+      if (!needle_length)
+      {
+        return 0;
+      }
+      else if (needle_length > haystack_length)
+      {
+        return npos;
+      }
+      else if (needle_length >= horspool_threshold)
+      {
+        return find_horspool(haystack, haystack_length, needle, needle_length);
+      }
+
+      return filter(haystack, haystack_length, needle, needle_length);
+    }
+
+    template<class CharT>
+    std::size_t rfind(const CharT* haystack,
+                      std::size_t haystack_length,
+                      const CharT* needle,
+                      std::size_t needle_length)
+    {
+      static const searcher<CharT> filter = select_rfind<CharT>();
+
+      if (!needle_length)
+      {
+        return haystack_length;
+      }
+      else if (needle_length > haystack_length)
+      {
+        return npos;
+      }
+      else if (needle_length >= horspool_threshold)
+      {
+        return rfind_horspool(
+          haystack,
+          haystack_length,
+          needle,
+          needle_length
+        );
+      }
+
+      return filter(haystack, haystack_length, needle, needle_length);
+    }
+
+    template std::size_t find(
+      const std::uint8_t*,
+      std::size_t,
+      const std::uint8_t*,
+      std::size_t
+    );
+    template std::size_t find(
+      const char16_t*,
+      std::size_t,
+      const char16_t*,
+      std::size_t
+    );
+    template std::size_t find(
+      const char32_t*,
+      std::size_t,
+      const char32_t*,
+      std::size_t
+    );
+    template std::size_t rfind(
+      const std::uint8_t*,
+      std::size_t,
+      const std::uint8_t*,
+      std::size_t
+    );
+    template std::size_t rfind(
+      const char16_t*,
+      std::size_t,
+      const char16_t*,
+      std::size_t
+    );
+    template std::size_t rfind(
+      const char32_t*,
+      std::size_t,
+      const char32_t*,
+      std::size_t
+    );
+  }
+}
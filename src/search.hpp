@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace plorth
+{
+  namespace search
+  {
+    /** Value returned when the needle is not found from the haystack. */
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    /**
+     * Needles at least this long are searched with Boyer-Moore-Horspool
+     * algorithm instead of the vectorized first and last character filter.
+     */
+    static constexpr std::size_t horspool_threshold = 256;
+
+    /**
+     * Searches for the first occurrence of the needle from the haystack.
+     * Both are given as code units of the same width, which can be
+     * std::uint8_t, char16_t or char32_t.
+     *
+     * \param haystack        Code units to search from.
+     * \param haystack_length Number of code units in the haystack.
+     * \param needle          Code units to search for.
+     * \param needle_length   Number of code units in the needle.
+     * \return                Offset of the first occurrence, or npos if the
+     *                        needle does not occur in the haystack.
+     */
+    template<class CharT>
+    std::size_t find(
+      const CharT* haystack,
+      std::size_t haystack_length,
+      const CharT* needle,
+      std::size_t needle_length
+    );
+
+    /**
+     * Searches for the last occurrence of the needle from the haystack.
+     *
+     * \param haystack        Code units to search from.
+     * \param haystack_length Number of code units in the haystack.
+     * \param needle          Code units to search for.
+     * \param needle_length   Number of code units in the needle.
+     * \return                Offset of the last occurrence, or npos if the
+     *                        needle does not occur in the haystack.
+     */
+    template<class CharT>
+    std::size_t rfind(
+      const CharT* haystack,
+      std::size_t haystack_length,
+      const CharT* needle,
+      std::size_t needle_length
+    );
+  }
+}
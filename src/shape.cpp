@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "./shape.hpp"
+
+#if PLORTH_ENABLE_MUTEXES
+# include <mutex>
+#endif
+
+namespace plorth
+{
+  static std::vector<shape::key_type> append_key(
+    const std::vector<shape::key_type>& keys,
+    const shape::key_type& key
+  )
+  {
+    std::vector<shape::key_type> result;
+
+    result.reserve(keys.size() + 1);
+    result.insert(std::end(result), std::begin(keys), std::end(keys));
+    result.push_back(key);
+
+    return result;
+  }
+
+  shape::shape() {}
+
+  shape::shape(const shape& parent, const key_type& key)
+    : m_keys(append_key(parent.m_keys, key)) {}
+
+  ref<shape> shape::transition(memory::manager& manager,
+                               const key_type& key) const
+  {
+    if (m_keys.size() >= max_size)
+    {
+      return ref<shape>();
+    }
+
+    {
+#if PLORTH_ENABLE_MUTEXES
+      std::shared_lock<std::shared_mutex> lock(m_mutex);
+#endif
+      const auto it = m_transitions.find(key);
+
+      if (it != std::end(m_transitions))
+      {
+        return it->second;
+      }
+    }
+
+#if PLORTH_ENABLE_MUTEXES
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+#endif
+    auto& slot = m_transitions[key];
+
+    // Another thread might have added the transition while the lock was not
+    // being held.
+    if (!slot)
+    {
+      if (m_transitions.size() > max_transitions)
+      {
+        m_transitions.erase(key);
+
+        return ref<shape>();
+      }
+      slot = ref<shape>(new (manager) shape(*this, key));
+    }
+
+    return slot;
+  }
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <plorth/value-object.hpp>
+
+#include <unordered_map>
+#include <vector>
+#if PLORTH_ENABLE_MUTEXES
+# include <shared_mutex>
+#endif
+
+namespace plorth
+{
+  /**
+   * Shape describes layout of an object which has been constructed by adding
+   * properties to it one by one: names of the properties in insertion order,
+   * each of them mapped to an index in a flat array of property values.
+   * Objects which have been constructed by adding the same properties in the
+   * same order share the same shape.
+   *
+   * Shapes form a tree rooted at the empty shape owned by the runtime. Each
+   * shape keeps transition links to shapes which have one more property, so
+   * that adding a property to an object with existing layout does not create
+   * a new shape.
+   */
+  class shape : public memory::managed
+  {
+  public:
+    using size_type = std::size_t;
+    using key_type = object::key_type;
+
+    /**
+     * Maximum number of properties which an object described by a shape may
+     * have. Larger objects are stored in dictionary mode instead.
+     */
+    static constexpr size_type max_size = 16;
+
+    /**
+     * Maximum number of transitions a single shape may have. Objects which
+     * are used as dictionaries with varying keys would otherwise grow the
+     * shape tree without bounds.
+     */
+    static constexpr size_type max_transitions = 64;
+
+    /**
+     * Constructs the empty shape.
+     */
+    explicit shape();
+
+    /**
+     * Constructs shape which has all properties of given parent shape,
+     * followed by one additional property.
+     */
+    explicit shape(const shape& parent, const key_type& key);
+
+    /**
+     * Returns the number of properties in the shape.
+     */
+    inline size_type size() const
+    {
+      return m_keys.size();
+    }
+
+    /**
+     * Returns name of the property stored in given slot.
+     */
+    inline const key_type& key(size_type index) const
+    {
+      return m_keys[index];
+    }
+
+    /**
+     * Looks up slot of the property with given name.
+     *
+     * \param key  Name of the property to look for.
+     * \param slot Where index of the slot will be assigned to.
+     * \return     Boolean flag which tells whether the shape contains the
+     *             property or not.
+     */
+    inline bool find(const key_type& key, size_type& slot) const
+    {
+      const auto size = m_keys.size();
+
+      for (size_type i = 0; i < size; ++i)
+      {
+        if (m_keys[i] == key)
+        {
+          slot = i;
+
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    /**
+     * Returns shape which has all properties of this shape followed by
+     * property with given name, creating it if it does not exist yet.
+     *
+     * \param manager Memory manager used for allocating new shape.
+     * \param key     Name of the property to add.
+     * \return        Reference to the shape, or null reference if the
+     *                resulting shape would exceed the size or transition
+     *                limits, in which case the object should be stored in
+     *                dictionary mode.
+     */
+    ref<shape> transition(memory::manager& manager, const key_type& key) const;
+
+  private:
+    /** Names of the properties, in the order of their slots. */
+    const std::vector<key_type> m_keys;
+    /** Shapes which have one more property than this one. */
+    mutable std::unordered_map<key_type, ref<shape>> m_transitions;
+#if PLORTH_ENABLE_MUTEXES
+    /** Used to implement thread safety in the transition table. */
+    mutable std::shared_mutex m_mutex;
+#endif
+  };
+}
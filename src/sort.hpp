@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <plorth/config.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#if PLORTH_ENABLE_THREADS
+# include <thread>
+#endif
+
+namespace plorth
+{
+  namespace sort
+  {
+    /**
+     * Length of the runs which are sorted with insertion sort before they are
+     * merged together.
+     */
+    static constexpr std::size_t run_length = 32;
+
+    /**
+     * Sequences shorter than this are always sorted in the calling thread.
+     */
+    static constexpr std::size_t parallel_threshold = 1 << 16;
+
+    /**
+     * Minimum number of elements given to each worker thread when a sequence
+     * is sorted in parallel.
+     */
+    static constexpr std::size_t parallel_grain = 1 << 14;
+
+    /**
+     * Sorts given range with insertion sort. Unlike the unguarded insertion
+     * found in standard library sorts, this never steps outside the range
+     * even when the comparison function is inconsistent, which user defined
+     * comparators are free to be.
+     */
+    template<class T, class Compare>
+    void insertion_sort(T* first, T* last, const Compare& less)
+    {
+      for (auto i = first + 1; i < last; ++i)
+      {
+        if (less(*i, *(i - 1)))
+        {
+          T element = std::move(*i);
+          auto j = i;
+
+          do
+          {
+            *j = std::move(*(j - 1));
+            --j;
+          }
+          while (j > first && less(element, *(j - 1)));
+          *j = std::move(element);
+        }
+      }
+    }
+
+    /**
+     * Merges two sorted ranges into the output. Elements of the left range
+     * are placed before equal elements of the right range, which keeps the
+     * sort stable.
+     */
+    template<class T, class Compare>
+    void merge(T* left,
+               T* left_last,
+               T* right,
+               T* right_last,
+               T* output,
+               const Compare& less)
+    {
+      while (left < left_last && right < right_last)
+      {
+        if (less(*right, *left))
+        {
+          *output++ = std::move(*right++);
+        } else {
+          *output++ = std::move(*left++);
+        }
+      }
+      output = std::move(left, left_last, output);
+      std::move(right, right_last, output);
+    }
+
+    /**
+     * Sorts the range with bottom-up merge sort. Buffer must have room for
+     * the same number of elements as the range and is used as temporary
+     * storage, the result is always placed into the range itself.
+     */
+    template<class T, class Compare>
+    void merge_sort(T* data,
+                    T* buffer,
+                    std::size_t length,
+                    const Compare& less)
+    {
+      auto input = data;
+      auto output = buffer;
+
+      for (std::size_t i = 0; i < length; i += run_length)
+      {
+        insertion_sort(
+          data + i,
+          data + std::min(i + run_length, length),
+          less
+        );
+      }
+      for (std::size_t width = run_length; width < length; width *= 2)
+      {
+        for (std::size_t i = 0; i < length; i += 2 * width)
+        {
+          const auto middle = input + std::min(i + width, length);
+
+          merge(
+            input + i,
+            middle,
+            middle,
+            input + std::min(i + 2 * width, length),
+            output + i,
+            less
+          );
+        }
+        std::swap(input, output);
+      }
+      if (input != data)
+      {
+        std::move(input, input + length, data);
+      }
+    }
+
+    /**
+     * Returns the number of threads which should be used for sorting a
+     * sequence of given length. The result is always a power of two, and one
+     * when the sequence should be sorted without any worker threads.
+     */
+    inline std::size_t workers_for(std::size_t length)
+    {
+      std::size_t workers = 1;
+#if PLORTH_ENABLE_THREADS
+      const std::size_t hardware = std::thread::hardware_concurrency();
+
+      if (length < parallel_threshold)
+      {
+        return 1;
+      }
+      while (workers * 2 <= hardware &&
+             length / (workers * 2) >= parallel_grain)
+      {
+        workers *= 2;
+      }
+#endif
+
+      return workers;
+    }
+
+#if PLORTH_ENABLE_THREADS
+    /**
+     * Splits merge of two adjacent sorted ranges into given number of
+     * independent parts and starts a thread for each one of them. The left
+     * range is split evenly and the matching split points of the right range
+     * are searched with binary search, so that the parts can be written into
+     * the output without any coordination between the threads.
+     */
+    template<class T, class Compare>
+    void parallel_merge(T* first,
+                        T* middle,
+                        T* last,
+                        T* output,
+                        const Compare& less,
+                        std::size_t parts,
+                        std::vector<std::thread>& threads)
+    {
+      const std::size_t left_length = middle - first;
+      auto left = first;
+      auto right = middle;
+
+      for (std::size_t i = 1; i <= parts; ++i)
+      {
+        T* left_end;
+        T* right_end;
+
+        if (i == parts)
+        {
+          left_end = middle;
+          right_end = last;
+        } else {
+          left_end = first + left_length * i / parts;
+          // Comparison functions which do not define a strict weak order,
+          // such as the one used for NaN keys, could otherwise move the
+          // split point backwards.
+          right_end = left_end < middle
+            ? std::max(
+              right,
+              std::lower_bound(
+                right,
+                last,
+                *left_end,
+                less
+              )
+            )
+            : last;
+        }
+        threads.emplace_back(
+          merge<T, Compare>,
+          left,
+          left_end,
+          right,
+          right_end,
+          output + ((left - first) + (right - middle)),
+          std::cref(less)
+        );
+        left = left_end;
+        right = right_end;
+      }
+    }
+
+    /**
+     * Sorts the range with given number of worker threads. Each worker first
+     * sorts its own slice of the range, after which the slices are merged
+     * pairwise with all workers taking part in each round of merging.
+     */
+    template<class T, class Compare>
+    void parallel_merge_sort(T* data,
+                             T* buffer,
+                             std::size_t length,
+                             const Compare& less,
+                             std::size_t workers)
+    {
+      std::vector<std::size_t> bounds(workers + 1);
+      std::vector<std::thread> threads;
+      auto input = data;
+      auto output = buffer;
+
+      for (std::size_t i = 0; i <= workers; ++i)
+      {
+        bounds[i] = length * i / workers;
+      }
+
+      threads.reserve(workers);
+      for (std::size_t i = 0; i < workers; ++i)
+      {
+        threads.emplace_back(
+          merge_sort<T, Compare>,
+          data + bounds[i],
+          buffer + bounds[i],
+          bounds[i + 1] - bounds[i],
+          std::cref(less)
+        );
+      }
+      for (auto& thread : threads)
+      {
+        thread.join();
+      }
+
+      for (std::size_t step = 1; step < workers; step *= 2)
+      {
+        threads.clear();
+        for (std::size_t i = 0; i < workers; i += 2 * step)
+        {
+          parallel_merge(
+            input + bounds[i],
+            input + bounds[i + step],
+            input + bounds[i + 2 * step],
+            output + bounds[i],
+            less,
+            2 * step,
+            threads
+          );
+        }
+        for (auto& thread : threads)
+        {
+          thread.join();
+        }
+        std::swap(input, output);
+      }
+      if (input != data)
+      {
+        std::move(input, input + length, data);
+      }
+    }
+#endif
+
+    /**
+     * Stable sort of the given elements. When more than one worker is
+     * requested and the library has been built with thread support, the
+     * elements are sorted in parallel, in which case the comparison function
+     * must be safe to call from multiple threads at once.
+     */
+    template<class T, class Compare>
+    void stable_sort(std::vector<T>& elements,
+                     const Compare& less,
+                     std::size_t workers = 1)
+    {
+      const auto length = elements.size();
+      std::vector<T> buffer(length);
+
+#if PLORTH_ENABLE_THREADS
+      if (workers > 1)
+      {
+        parallel_merge_sort(
+          elements.data(),
+          buffer.data(),
+          length,
+          less,
+          workers
+        );
+        return;
+      }
+#endif
+      merge_sort(elements.data(), buffer.data(), length, less);
+    }
+  }
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "./thread-pool.hpp"
+
+#include <cassert>
+
+namespace plorth
+{
+#if PLORTH_ENABLE_THREADS
+  /**
+   * Pool which the current thread is a worker of, and index of the queue
+   * owned by the thread in that pool.
+   */
+  static thread_local const thread_pool* current_pool = nullptr;
+  static thread_local std::size_t current_queue = 0;
+
+  struct thread_pool::batch
+  {
+    const std::function<void(std::size_t)>& body;
+    /** Number of tasks which have not been completed yet. */
+    std::atomic<std::size_t> remaining;
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+
+  thread_pool::thread_pool(std::size_t concurrency)
+    : m_concurrency(concurrency > 0 ? concurrency : 1)
+    , m_pending(0)
+    , m_generation(0)
+    , m_stopping(false)
+  {
+    const auto workers = m_concurrency - 1;
+
+    for (std::size_t i = 0; i <= workers; ++i)
+    {
+      m_queues.emplace_back(new queue());
+    }
+    m_threads.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i)
+    {
+      m_threads.emplace_back(&thread_pool::work, this, i);
+    }
+  }
+
+  thread_pool::~thread_pool()
+  {
+    assert(m_pending.load(std::memory_order_acquire) == 0);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads)
+    {
+      thread.join();
+    }
+  }
+
+  void thread_pool::run(std::size_t count,
+                        const std::function<void(std::size_t)>& body)
+  {
+    const auto own = current_pool == this ? current_queue : m_threads.size();
+    batch b{ body, { count }, {}, {} };
+    task slot;
+
+    if (m_threads.empty() || count < 2)
+    {
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        body(i);
+      }
+      return;
+    }
+
+    // Tasks are counted before they can be taken by other threads, so that
+    // the count never drops below zero as they are completed.
+    m_pending.fetch_add(count, std::memory_order_relaxed);
+    {
+      auto& q = *m_queues[own];
+      std::lock_guard<std::mutex> lock(q.mutex);
+
+      // Tasks are taken from the back of the own queue, so they are added in
+      // reverse order to have them executed in order by this thread.
+      for (std::size_t i = count; i > 0; --i)
+      {
+        q.tasks.push_back({ &b, i - 1 });
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      m_generation.fetch_add(1, std::memory_order_release);
+    }
+    m_wake.notify_all();
+
+    // Help with the tasks until there are none left for this thread to take.
+    // The remaining ones are being executed by other threads, so it's enough
+    // to wait for them to finish.
+    while (b.remaining.load(std::memory_order_acquire) > 0)
+    {
+      if (take(own, slot))
+      {
+        execute(slot);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(b.mutex);
+
+      b.done.wait(lock, [&b]()
+      {
+        return b.remaining.load(std::memory_order_acquire) == 0;
+      });
+    }
+
+    // Thread which completed the last task might still be notifying, so the
+    // batch must not go out of scope before it has released the lock.
+    std::lock_guard<std::mutex> lock(b.mutex);
+  }
+
+  void thread_pool::work(std::size_t index)
+  {
+    task slot;
+
+    current_pool = this;
+    current_queue = index;
+    for (;;)
+    {
+      // Generation is read before looking for tasks, so that tasks which are
+      // added after the queues were found empty wake the worker up again.
+      const auto generation = m_generation.load(std::memory_order_acquire);
+
+      if (take(index, slot))
+      {
+        execute(slot);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      m_wake.wait(lock, [this, generation]()
+      {
+        return m_stopping ||
+          m_generation.load(std::memory_order_acquire) != generation;
+      });
+      if (m_stopping)
+      {
+        return;
+      }
+    }
+  }
+
+  /**
+   * Takes task from the back of the own queue, or steals one from the front
+   * of some other queue.
+   */
+  bool thread_pool::take(std::size_t index, task& slot)
+  {
+    const auto size = m_queues.size();
+
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      auto& q = *m_queues[(index + i) % size];
+      std::lock_guard<std::mutex> lock(q.mutex);
+
+      if (q.tasks.empty())
+      {
+        continue;
+      }
+      if (i == 0)
+      {
+        slot = q.tasks.back();
+        q.tasks.pop_back();
+      } else {
+        slot = q.tasks.front();
+        q.tasks.pop_front();
+      }
+
+      return true;
+    }
+
+    return false;
+  }
+
+  void thread_pool::execute(const task& task)
+  {
+    auto& b = *task.owner;
+
+    b.body(task.index);
+    // Done before completing the task, so that no tasks are counted once
+    // the batch has finished.
+    m_pending.fetch_sub(1, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(b.mutex);
+
+    if (b.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      b.done.notify_all();
+    }
+  }
+#else
+  thread_pool::thread_pool(std::size_t)
+    : m_concurrency(1) {}
+
+  thread_pool::~thread_pool() {}
+
+  void thread_pool::run(std::size_t count,
+                        const std::function<void(std::size_t)>& body)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      body(i);
+    }
+  }
+#endif
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <plorth/config.hpp>
+
+#include <cstddef>
+#include <functional>
+#if PLORTH_ENABLE_THREADS
+# include <atomic>
+# include <condition_variable>
+# include <deque>
+# include <memory>
+# include <mutex>
+# include <thread>
+# include <vector>
+#endif
+
+namespace plorth
+{
+  /**
+   * Pool of worker threads which execute batches of tasks. Each worker has
+   * a queue of its own, from which it takes the most recently added task
+   * first. Workers which run out of tasks steal the oldest tasks from the
+   * queues of other workers. Tasks added by threads outside of the pool are
+   * placed into a shared queue, which the workers steal from as well.
+   *
+   * Thread which waits for a batch to complete keeps executing tasks while
+   * it waits, so tasks can run batches of their own without exhausting the
+   * workers.
+   */
+  class thread_pool
+  {
+  public:
+    /**
+     * Starts the worker threads.
+     *
+     * \param concurrency Total number of threads executing tasks of a batch,
+     *                    including the thread which runs the batch. Pool
+     *                    with concurrency of one has no worker threads and
+     *                    executes all tasks in the calling thread.
+     */
+    explicit thread_pool(std::size_t concurrency);
+
+    /**
+     * Stops and joins the worker threads. There must not be any batches
+     * running when the pool is being destroyed.
+     */
+    ~thread_pool();
+
+    /**
+     * Returns the number of threads executing tasks of a batch, including
+     * the thread which runs the batch.
+     */
+    inline std::size_t concurrency() const
+    {
+      return m_concurrency;
+    }
+
+    /**
+     * Invokes given function once for each index from zero up to given
+     * count, in parallel, and returns once all of the invocations have
+     * completed. The function must be safe to call from multiple threads at
+     * once.
+     */
+    void run(std::size_t count, const std::function<void(std::size_t)>& body);
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool(thread_pool&&) = delete;
+    void operator=(const thread_pool&) = delete;
+    void operator=(thread_pool&&) = delete;
+
+  private:
+#if PLORTH_ENABLE_THREADS
+    struct batch;
+
+    /**
+     * Single invocation of the function of a batch.
+     */
+    struct task
+    {
+      batch* owner;
+      std::size_t index;
+    };
+
+    /**
+     * Queue of tasks, owned either by a worker or shared by threads outside
+     * of the pool.
+     */
+    struct queue
+    {
+      std::mutex mutex;
+      std::deque<task> tasks;
+    };
+
+    void work(std::size_t index);
+    bool take(std::size_t index, task& slot);
+    void execute(const task& task);
+
+    const std::size_t m_concurrency;
+    /** Queues of the workers, followed by the shared queue. */
+    std::vector<std::unique_ptr<queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    /** Number of tasks which have been added but not completed yet. */
+    std::atomic<std::size_t> m_pending;
+    /** Incremented under the mutex whenever tasks are added. */
+    std::atomic<std::size_t> m_generation;
+    /** Used for putting idle workers to sleep. */
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping;
+#else
+    const std::size_t m_concurrency;
+#endif
+  };
+}
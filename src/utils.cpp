@@ -170,6 +170,34 @@ namespace plorth
     return true;
   }
 
+  bool to_number(const std::u32string& input,
+                 number::int_type& int_slot,
+                 number::real_type& real_slot)
+  {
+    for (const auto c : input)
+    {
+      if (c == '.' || c == 'e' || c == 'E')
+      {
+        real_slot = to_real(input);
+
+        return false;
+      }
+    }
+
+    // Integer literals which overflow the integer type are treated as real
+    // numbers.
+    if (!(int_slot = to_integer(input)))
+    {
+      real_slot = to_real(input);
+      if (real_slot != int_slot)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
   std::u32string to_unistring(number::int_type number)
   {
     const bool negative = number < 0;
@@ -341,4 +369,12 @@ namespace plorth
 
     return number;
   }
+
+  std::size_t hash_combine(std::size_t seed, std::size_t value)
+  {
+    return seed ^ (
+      value + static_cast<std::size_t>(0x9e3779b97f4a7c15ull)
+      + (seed << 6) + (seed >> 2)
+    );
+  }
 }
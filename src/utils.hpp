@@ -33,6 +33,8 @@ namespace plorth
   number::int_type to_integer(const std::u32string&);
   number::real_type to_real(const std::u32string&);
   bool is_number(const std::u32string&);
+  bool to_number(const std::u32string&, number::int_type&, number::real_type&);
   std::u32string to_unistring(number::int_type);
   std::u32string to_unistring(number::real_type);
+  std::size_t hash_combine(std::size_t, std::size_t);
 }
@@ -24,145 +24,407 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <plorth/context.hpp>
+#include <plorth/native.hpp>
+
+#include "./kernels.hpp"
+#include "./sort.hpp"
+#include "./thread-pool.hpp"
+#include "./utils.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_set>
 
 namespace plorth
 {
   namespace
   {
+    /** Number of index bits consumed by each level of the vector trie. */
+    static const unsigned int vector_bits = 5;
+    /** Number of slots in each node of the vector trie. */
+    static const array::size_type vector_width = 1 << vector_bits;
+    static const array::size_type vector_mask = vector_width - 1;
+
+    /**
+     * Internal node of the vector trie, which points either to other branches
+     * or, on the lowest level, to leaves.
+     */
+    struct vector_branch : public memory::managed
+    {
+      ref<memory::managed> children[vector_width];
+    };
+
+    /**
+     * Leaf node of the vector trie, which contains the actual elements.
+     */
+    struct vector_leaf : public memory::managed
+    {
+      array::value_type elements[vector_width];
+    };
+
+    static inline const vector_leaf* as_leaf(const ref<memory::managed>& node)
+    {
+      return static_cast<const vector_leaf*>(node.get());
+    }
+
     /**
-     * Implementation of simple array, which only acts as a wrapper for C type
-     * array.
+     * Persistent vector which is the default array implementation. Elements
+     * are stored in a trie with 32-way branching, except the last up to 32
+     * elements, which are kept in a separate tail leaf so that appending to
+     * the end does not need to walk the trie. Modified versions of the vector
+     * share all untouched nodes with the original.
      */
-    class simple_array : public array
+    class vector_array : public array
     {
     public:
-      simple_array(size_type size, const_pointer elements)
+      explicit vector_array(size_type size,
+                            unsigned int shift,
+                            const ref<memory::managed>& root,
+                            const ref<memory::managed>& tail)
         : m_size(size)
-        , m_elements(size > 0 ? new value_type[size] : nullptr)
+        , m_shift(shift)
+        , m_root(root)
+        , m_tail(tail) {}
+
+      /**
+       * Returns index of the first element which is stored in the tail of a
+       * vector with given size.
+       */
+      static inline size_type tail_offset(size_type size)
       {
-        for (size_type i = 0; i < m_size; ++i)
-        {
-          m_elements[i] = elements[i];
-        }
+        return size < vector_width
+          ? 0
+          : ((size - 1) >> vector_bits) << vector_bits;
       }
 
-      ~simple_array()
+      inline size_type size() const
       {
-        if (m_size > 0)
-        {
-          delete[] m_elements;
-        }
+        return m_size;
       }
 
-      inline size_type size() const
+      const_reference at(size_type offset) const
       {
-        return m_size;
+        return as_leaf(leaf_for(offset))->elements[offset & vector_mask];
+      }
+
+      const_pointer chunk(size_type offset, size_type& size) const
+      {
+        const auto index = offset & vector_mask;
+
+        size = std::min(vector_width - index, m_size - offset);
+
+        return as_leaf(leaf_for(offset))->elements + index;
+      }
+
+      inline unsigned int shift() const
+      {
+        return m_shift;
+      }
+
+      inline const ref<memory::managed>& root() const
+      {
+        return m_root;
       }
 
-      const_reference at(size_type i) const
+      inline const ref<memory::managed>& tail() const
       {
-        return m_elements[i];
+        return m_tail;
+      }
+
+      /**
+       * Returns leaf which contains element from given offset.
+       */
+      const ref<memory::managed>& leaf_for(size_type offset) const
+      {
+        const ref<memory::managed>* node = &m_root;
+
+        if (offset >= tail_offset(m_size))
+        {
+          return m_tail;
+        }
+        for (auto level = m_shift; level > 0; level -= vector_bits)
+        {
+          node = &static_cast<const vector_branch*>(node->get())->children[
+            (offset >> level) & vector_mask
+          ];
+        }
+
+        return *node;
       }
 
     private:
       const size_type m_size;
-      pointer m_elements;
+      const unsigned int m_shift;
+      const ref<memory::managed> m_root;
+      const ref<memory::managed> m_tail;
     };
 
     /**
-     * Implementation of array where two arrays have been concatenated into one.
+     * Constructs new persistent vectors, either from scratch or by modifying
+     * an existing one. Nodes which are referenced only by the builder are
+     * modified in place, while shared nodes are copied before they are
+     * modified.
      */
-    class concat_array : public array
+    class vector_builder
     {
     public:
-      concat_array(const std::shared_ptr<array>& left,
-                   const std::shared_ptr<array>& right)
-        : m_size(left->size() + right->size())
-        , m_left(left)
-        , m_right(right) {}
+      explicit vector_builder(memory::manager& manager)
+        : m_manager(manager)
+        , m_size(0)
+        , m_shift(vector_bits) {}
+
+      explicit vector_builder(memory::manager& manager,
+                              const vector_array& vector)
+        : m_manager(manager)
+        , m_size(vector.size())
+        , m_shift(vector.shift())
+        , m_root(vector.root())
+        , m_tail(vector.tail()) {}
+
+      /**
+       * Returns builder which continues from contents of given array. Trie of
+       * persistent vectors is shared, other arrays are copied.
+       */
+      static vector_builder from(memory::manager& manager,
+                                 const ref<array>& ary)
+      {
+        if (const auto vector = dynamic_cast<const vector_array*>(ary.get()))
+        {
+          return vector_builder(manager, *vector);
+        } else {
+          vector_builder builder(manager);
 
-      inline size_type size() const
+          builder.push(ary);
+
+          return builder;
+        }
+      }
+
+      inline array::size_type size() const
       {
         return m_size;
       }
 
-      const_reference at(size_type offset) const
+      /**
+       * Appends given value to the end of the vector.
+       */
+      void push(const array::value_type& value)
+      {
+        if (m_size - vector_array::tail_offset(m_size) == vector_width)
+        {
+          push_tail();
+          m_tail.reset();
+        }
+        unique_leaf(m_tail)->elements[m_size & vector_mask] = value;
+        ++m_size;
+      }
+
+      /**
+       * Appends all elements from given array to the end of the vector.
+       */
+      void push(const ref<array>& ary)
+      {
+        ary->for_each_chunk([this](array::const_pointer data,
+                                   array::size_type count)
+        {
+          for (array::size_type i = 0; i < count; ++i)
+          {
+            push(data[i]);
+          }
+
+          return true;
+        });
+      }
+
+      /**
+       * Removes last element from the vector, which must not be empty.
+       */
+      void pop()
+      {
+        if (m_size == 1)
+        {
+          m_root.reset();
+          m_tail.reset();
+          m_shift = vector_bits;
+        }
+        else if (m_size - vector_array::tail_offset(m_size) > 1)
+        {
+          unique_leaf(m_tail)->elements[(m_size - 1) & vector_mask].reset();
+        } else {
+          // The tail becomes empty, so the last leaf of the trie is moved into
+          // the tail.
+          m_tail = leaf_for(m_size - 2);
+          pop_tail(m_root, m_shift);
+          if (!m_root)
+          {
+            m_shift = vector_bits;
+          }
+          else if (m_shift > vector_bits &&
+                   !static_cast<const vector_branch*>(
+                     m_root.get()
+                   )->children[1])
+          {
+            m_root = ref<memory::managed>(
+              static_cast<const vector_branch*>(m_root.get())->children[0]
+            );
+            m_shift -= vector_bits;
+          }
+        }
+        --m_size;
+      }
+
+      /**
+       * Replaces element at given offset, which must be within bounds.
+       */
+      void set(array::size_type offset, const array::value_type& value)
       {
-        const size_type left_size = m_left->size();
+        ref<memory::managed>* node = &m_root;
 
-        if (offset < left_size)
+        if (offset >= vector_array::tail_offset(m_size))
         {
-          return m_left->at(offset);
+          node = &m_tail;
         } else {
-          return m_right->at(offset - left_size);
+          for (auto level = m_shift; level > 0; level -= vector_bits)
+          {
+            node = &unique_branch(*node)->children[
+              (offset >> level) & vector_mask
+            ];
+          }
         }
+        unique_leaf(*node)->elements[offset & vector_mask] = value;
+      }
+
+      /**
+       * Constructs persistent vector from current contents of the builder.
+       */
+      ref<array> build() const
+      {
+        return ref<array>(new (m_manager) vector_array(
+          m_size,
+          m_shift,
+          m_root,
+          m_tail
+        ));
       }
 
     private:
-      const size_type m_size;
-      const std::shared_ptr<array> m_left;
-      const std::shared_ptr<array> m_right;
-    };
+      vector_branch* unique_branch(ref<memory::managed>& node)
+      {
+        if (!node)
+        {
+          node = ref<memory::managed>(new (m_manager) vector_branch());
+        }
+        else if (node->ref_count() > 1)
+        {
+          const auto original = static_cast<const vector_branch*>(node.get());
+          const auto copy = new (m_manager) vector_branch();
 
-    /**
-     * Implementation of array which consists from existing array and extra
-     * element. Used mainly for the "push" word.
-     */
-    class push_array : public array
-    {
-    public:
-      explicit push_array(const std::shared_ptr<class array>& array,
-                          const std::shared_ptr<value>& extra)
-        : m_array(array)
-        , m_extra(extra) {}
+          for (array::size_type i = 0; i < vector_width; ++i)
+          {
+            copy->children[i] = original->children[i];
+          }
+          node = ref<memory::managed>(copy);
+        }
 
-      inline size_type size() const
+        return static_cast<vector_branch*>(node.get());
+      }
+
+      vector_leaf* unique_leaf(ref<memory::managed>& node)
       {
-        return m_array->size() + 1;
+        if (!node)
+        {
+          node = ref<memory::managed>(new (m_manager) vector_leaf());
+        }
+        else if (node->ref_count() > 1)
+        {
+          const auto original = as_leaf(node);
+          const auto copy = new (m_manager) vector_leaf();
+
+          for (array::size_type i = 0; i < vector_width; ++i)
+          {
+            copy->elements[i] = original->elements[i];
+          }
+          node = ref<memory::managed>(copy);
+        }
+
+        return static_cast<vector_leaf*>(node.get());
       }
 
-      const_reference at(size_type offset) const
+      const ref<memory::managed>& leaf_for(array::size_type offset) const
       {
-        if (offset == m_array->size())
+        const ref<memory::managed>* node = &m_root;
+
+        for (auto level = m_shift; level > 0; level -= vector_bits)
         {
-          return m_extra;
-        } else {
-          return m_array->at(offset);
+          node = &static_cast<const vector_branch*>(node->get())->children[
+            (offset >> level) & vector_mask
+          ];
         }
+
+        return *node;
       }
 
-    private:
-      const std::shared_ptr<array> m_array;
-      const std::shared_ptr<value> m_extra;
-    };
+      /**
+       * Moves full tail into the trie, growing the trie by one level if the
+       * root has no room left.
+       */
+      void push_tail()
+      {
+        if ((m_size >> vector_bits) > (array::size_type(1) << m_shift))
+        {
+          auto root = ref<memory::managed>(new (m_manager) vector_branch());
 
-    /**
-     * Array implementation which is actually portion of already existing array.
-     */
-    class subarray : public array
-    {
-    public:
-      explicit subarray(const std::shared_ptr<class array>& array,
-                        size_type offset,
-                        size_type size)
-        : m_array(array)
-        , m_offset(offset)
-        , m_size(size) {}
+          static_cast<vector_branch*>(root.get())->children[0] = m_root;
+          m_root = root;
+          m_shift += vector_bits;
+        }
+        insert_tail(m_root, m_shift);
+      }
 
-      inline size_type size() const
+      void insert_tail(ref<memory::managed>& node, unsigned int level)
       {
-        return m_size;
+        const auto branch = unique_branch(node);
+        auto& child = branch->children[((m_size - 1) >> level) & vector_mask];
+
+        if (level == vector_bits)
+        {
+          child = m_tail;
+        } else {
+          insert_tail(child, level - vector_bits);
+        }
       }
 
-      const_reference at(size_type offset) const
+      void pop_tail(ref<memory::managed>& node, unsigned int level)
       {
-        return m_array->at(m_offset + offset);
+        const auto index = ((m_size - 2) >> level) & vector_mask;
+
+        if (level > vector_bits)
+        {
+          auto& child = unique_branch(node)->children[index];
+
+          pop_tail(child, level - vector_bits);
+          if (!child && !index)
+          {
+            node.reset();
+          }
+        }
+        else if (!index)
+        {
+          node.reset();
+        } else {
+          unique_branch(node)->children[index].reset();
+        }
       }
 
     private:
-      const std::shared_ptr<array> m_array;
-      const size_type m_offset;
-      const size_type m_size;
+      memory::manager& m_manager;
+      array::size_type m_size;
+      unsigned int m_shift;
+      ref<memory::managed> m_root;
+      ref<memory::managed> m_tail;
     };
 
     /**
@@ -171,7 +433,7 @@ namespace plorth
     class reversed_array : public array
     {
     public:
-      explicit reversed_array(const std::shared_ptr<class array>& array)
+      explicit reversed_array(const ref<class array>& array)
         : m_array(array) {}
 
       inline size_type size() const
@@ -185,150 +447,1495 @@ namespace plorth
       }
 
     private:
-      const std::shared_ptr<array> m_array;
+      const ref<array> m_array;
     };
-  }
-
-  bool array::equals(const std::shared_ptr<value>& that) const
-  {
-    std::shared_ptr<array> ary;
 
-    if (!is(that, type::array))
+    /**
+     * Array which stores numbers of single type unboxed, in memory trailing
+     * the array object itself. Numeric array words operate on the unboxed
+     * numbers directly. Generic access through at() and chunk() boxes the
+     * numbers in blocks of vector width, only boxing the block which the
+     * accessed element belongs to. Boxed blocks are kept for as long as the
+     * array exists.
+     */
+    template<class T>
+    class typed_array : public array
     {
-      return false;
-    }
+    public:
+      /**
+       * Allocates typed array which has room for given number of elements.
+       * Contents of the array are left for the caller to fill.
+       */
+      static typed_array* make(const ref<class runtime>& runtime,
+                               size_type size)
+      {
+        auto& manager = runtime->memory_manager();
+        void* memory = memory::managed::operator new(
+          sizeof(typed_array)
+          + sizeof(T) * size
+          + sizeof(block_type) * block_count(size),
+          manager
+        );
 
-    ary = std::static_pointer_cast<array>(that);
+        return ::new (memory) typed_array(manager, size);
+      }
 
-    if (size() != ary->size())
-    {
-      return false;
-    }
+      ~typed_array()
+      {
+        const auto count = block_count(m_size);
 
-    for (size_type i = 0; i < size(); ++i)
-    {
-      if (at(i) != ary->at(i))
+        for (size_type i = 0; i < count; ++i)
+        {
+          delete[] blocks()[i].load(std::memory_order_relaxed);
+          blocks()[i].~block_type();
+        }
+      }
+
+      inline size_type size() const
       {
-        return false;
+        return m_size;
       }
-    }
 
-    return true;
-  }
+      const_reference at(size_type offset) const
+      {
+        return block(offset >> vector_bits)[offset & vector_mask];
+      }
 
-  std::u32string array::to_string() const
-  {
-    const size_type s = size();
-    std::u32string result;
+      const_pointer chunk(size_type offset, size_type& size) const
+      {
+        const auto index = offset >> vector_bits;
 
-    for (size_type i = 0; i < s; ++i)
-    {
-      const_reference element = at(i);
+        size = std::min(m_size, (index + 1) << vector_bits) - offset;
+
+        return block(index) + (offset & vector_mask);
+      }
+
+      enum element_type element_type() const
+      {
+        return std::is_same<T, number::int_type>::value
+          ? element_type::int64
+          : element_type::float64;
+      }
 
-      if (i > 0)
+      inline T* data()
       {
-        result += ',';
-        result += ' ';
+        return reinterpret_cast<T*>(this + 1);
       }
-      if (element)
+
+      inline const T* data() const
       {
-        result += element->to_string();
+        return reinterpret_cast<const T*>(this + 1);
       }
-    }
 
-    return result;
-  }
+    private:
+      /** Pointer to boxed numbers of a block, or null if not boxed yet. */
+      using block_type = std::atomic<value_type*>;
 
-  std::u32string array::to_source() const
-  {
-    const size_type s = size();
-    std::u32string result;
+      explicit typed_array(memory::manager& manager, size_type size)
+        : m_memory_manager(manager)
+        , m_size(size)
+      {
+        const auto count = block_count(size);
 
-    result += '[';
-    for (size_type i = 0; i < s; ++i)
-    {
-      const_reference element = at(i);
+        for (size_type i = 0; i < count; ++i)
+        {
+          ::new (static_cast<void*>(blocks() + i)) block_type(nullptr);
+        }
+      }
 
-      if (i > 0)
+      static inline size_type block_count(size_type size)
       {
-        result += ',';
-        result += ' ';
+        return (size + vector_mask) >> vector_bits;
       }
-      if (element)
+
+      inline block_type* blocks() const
       {
-        result += element->to_source();
-      } else {
-        result += U"null";
+        return reinterpret_cast<block_type*>(
+          const_cast<T*>(data()) + m_size
+        );
       }
-    }
-    result += ']';
 
-    return result;
-  }
+      /**
+       * Returns the numbers of given block boxed into values, boxing them
+       * first if that has not been done yet.
+       */
+      const value_type* block(size_type index) const
+      {
+        auto& slot = blocks()[index];
+        value_type* boxed = slot.load(std::memory_order_acquire);
+        value_type* expected = nullptr;
+        const auto begin = index << vector_bits;
+        const auto end = std::min(m_size, begin + vector_width);
 
-  array::iterator::iterator(const std::shared_ptr<array>& ary,
-                            array::size_type index)
-    : m_array(ary)
-    , m_index(index) {}
+        if (boxed)
+        {
+          return boxed;
+        }
 
-  array::iterator::iterator(const iterator& that)
-    : m_array(that.m_array)
-    , m_index(that.m_index) {}
+        boxed = new value_type[end - begin];
+        for (size_type i = begin; i < end; ++i)
+        {
+          boxed[i - begin] = number::make(m_memory_manager, data()[i]);
+        }
 
-  array::iterator& array::iterator::operator=(const iterator& that)
-  {
-    m_array = that.m_array;
-    m_index = that.m_index;
+        // Another thread might have boxed the block at the same time, in
+        // which case the values boxed by it are used instead.
+        if (!slot.compare_exchange_strong(expected,
+                                          boxed,
+                                          std::memory_order_acq_rel))
+        {
+          delete[] boxed;
 
-    return *this;
-  }
+          return expected;
+        }
 
-  array::iterator& array::iterator::operator++()
-  {
-    ++m_index;
+        return boxed;
+      }
 
-    return *this;
-  }
+    private:
+      /**
+       * Memory manager used for boxing the numbers. Unlike the runtime, the
+       * memory manager always outlives objects allocated by it.
+       */
+      memory::manager& m_memory_manager;
+      const size_type m_size;
+    };
 
-  array::iterator array::iterator::operator++(int)
-  {
-    const iterator copy(*this);
+    using int_array = typed_array<number::int_type>;
+    using real_array = typed_array<number::real_type>;
 
-    ++m_index;
+    /**
+     * Function objects which hash and compare contents of values, so that
+     * values which are equal to each other are treated as the same element
+     * in hash based containers.
+     */
+    struct value_hash
+    {
+      inline std::size_t operator()(const ref<value>& val) const
+      {
+        return value::hash(val);
+      }
+    };
 
-    return copy;
-  }
+    struct value_equal
+    {
+      inline bool operator()(const ref<value>& a, const ref<value>& b) const
+      {
+        return a == b;
+      }
+    };
 
-  array::iterator::reference array::iterator::operator*()
-  {
-    return m_array->at(m_index);
-  }
+    using value_set = std::unordered_set<ref<value>, value_hash, value_equal>;
 
-  array::iterator::reference array::iterator::operator->()
-  {
-    return m_array->at(m_index);
-  }
+    /**
+     * Element of an array which is being sorted: the key which the element is
+     * ordered by and index of the element in the original array.
+     */
+    template<class Key>
+    struct sort_entry
+    {
+      Key key;
+      array::size_type index;
+    };
 
-  bool array::iterator::operator==(const iterator& that) const
+    /**
+     * Compares two values in the order used by the sorting words. Numbers
+     * are compared just like the < word of numbers does, strings by their
+     * code points and any other values by executing the < word on them.
+     */
+    static bool compare_values(const ref<context>& ctx,
+                               const ref<value>& less_than,
+                               const ref<value>& a,
+                               const ref<value>& b,
+                               bool& result)
+    {
+      if (value::is(a, value::type::number) &&
+          value::is(b, value::type::number))
+      {
+        const auto x = static_cast<const number*>(a.get());
+        const auto y = static_cast<const number*>(b.get());
+
+        if (x->is(number::number_type::real) ||
+            y->is(number::number_type::real))
+        {
+          result = x->as_real() < y->as_real();
+        } else {
+          result = x->as_int() < y->as_int();
+        }
+
+        return true;
+      }
+      else if (value::is(a, value::type::string) &&
+               value::is(b, value::type::string))
+      {
+        result = static_cast<const string*>(a.get())->compare(
+          *static_cast<const string*>(b.get())
+        ) < 0;
+
+        return true;
+      }
+      ctx->push(a);
+      ctx->push(b);
+
+      return value::exec(ctx, less_than) && ctx->pop_boolean(result);
+    }
+
+    /**
+     * Pushes the elements into the context as an array, in the order given by
+     * sorted entries.
+     */
+    template<class Key>
+    static void push_sorted(const ref<context>& ctx,
+                            const std::vector<ref<value>>& elements,
+                            const std::vector<sort_entry<Key>>& entries)
+    {
+      std::vector<ref<value>> result;
+
+      result.reserve(entries.size());
+      for (const auto& entry : entries)
+      {
+        result.push_back(elements[entry.index]);
+      }
+      ctx->push_array(result);
+    }
+
+    template<class Key, class Compare>
+    static void sort_keys(const ref<context>& ctx,
+                          const std::vector<ref<value>>& elements,
+                          std::vector<sort_entry<Key>>& entries,
+                          const Compare& less)
+    {
+      sort::stable_sort(
+        entries,
+        [&less](const sort_entry<Key>& a, const sort_entry<Key>& b)
+        {
+          return less(a.key, b.key);
+        },
+        sort::workers_for(entries.size())
+      );
+      push_sorted(ctx, elements, entries);
+    }
+
+    /**
+     * Sorts the elements by keys which all are numbers or all are strings,
+     * without executing any words. Large arrays are sorted in parallel.
+     * Returns false if the keys are of some other types, in which case
+     * nothing is pushed into the context.
+     */
+    static bool sort_natively(const ref<context>& ctx,
+                              const std::vector<ref<value>>& elements,
+                              const std::vector<ref<value>>& keys)
+    {
+      const auto size = keys.size();
+      bool numbers = true;
+      bool strings = true;
+      bool reals = false;
+
+      for (const auto& key : keys)
+      {
+        if (value::is(key, value::type::number))
+        {
+          strings = false;
+          reals = reals || static_cast<const number*>(key.get())->is(
+            number::number_type::real
+          );
+        }
+        else if (value::is(key, value::type::string))
+        {
+          numbers = false;
+        } else {
+          return false;
+        }
+      }
+
+      if (numbers && !reals)
+      {
+        std::vector<sort_entry<number::int_type>> entries(size);
+
+        for (array::size_type i = 0; i < size; ++i)
+        {
+          entries[i].key = static_cast<const number*>(keys[i].get())->as_int();
+          entries[i].index = i;
+        }
+        sort_keys(ctx, elements, entries, std::less<number::int_type>());
+      }
+      else if (numbers)
+      {
+        std::vector<sort_entry<number::real_type>> entries(size);
+
+        for (array::size_type i = 0; i < size; ++i)
+        {
+          entries[i].key = static_cast<const number*>(
+            keys[i].get()
+          )->as_real();
+          entries[i].index = i;
+        }
+        sort_keys(ctx, elements, entries, std::less<number::real_type>());
+      }
+      else if (strings)
+      {
+        std::vector<sort_entry<const string*>> entries(size);
+
+        for (array::size_type i = 0; i < size; ++i)
+        {
+          entries[i].key = static_cast<const string*>(keys[i].get());
+          entries[i].index = i;
+        }
+        sort_keys(
+          ctx,
+          elements,
+          entries,
+          [](const string* a, const string* b)
+          {
+            return a->compare(*b) < 0;
+          }
+        );
+      } else {
+        return false;
+      }
+
+      return true;
+    }
+
+    /**
+     * Removes values left into the data stack by a comparison which has
+     * failed, so that the stack has given depth again.
+     */
+    static void truncate_stack(const ref<context>& ctx, std::size_t depth)
+    {
+      auto& stack = ctx->data();
+
+      if (stack.size() > depth)
+      {
+        stack.erase(std::begin(stack) + depth, std::end(stack));
+      }
+    }
+
+    /**
+     * Sorts the elements by their keys with comparison function which
+     * executes Plorth code and thus can fail. Once the comparison function
+     * has failed, rest of the sort is completed without calling it again,
+     * nothing is pushed into the context and false is returned.
+     */
+    template<class Compare>
+    static bool sort_with(const ref<context>& ctx,
+                          const std::vector<ref<value>>& elements,
+                          const std::vector<ref<value>>& keys,
+                          const Compare& compare)
+    {
+      const auto size = keys.size();
+      std::vector<sort_entry<const ref<value>*>> entries(size);
+      bool succeeded = true;
+
+      for (array::size_type i = 0; i < size; ++i)
+      {
+        entries[i].key = &keys[i];
+        entries[i].index = i;
+      }
+      sort::stable_sort(
+        entries,
+        [&compare, &succeeded](const sort_entry<const ref<value>*>& a,
+                               const sort_entry<const ref<value>*>& b)
+        {
+          bool result = false;
+
+          succeeded = succeeded && compare(*a.key, *b.key, result);
+
+          return succeeded && result;
+        }
+      );
+      if (succeeded)
+      {
+        push_sorted(ctx, elements, entries);
+      }
+
+      return succeeded;
+    }
+
+    /**
+     * Sorts the elements by keys in the order used by compare_values().
+     * Returns false if comparison of the keys has failed.
+     */
+    static bool sort_values(const ref<context>& ctx,
+                            const std::vector<ref<value>>& elements,
+                            const std::vector<ref<value>>& keys)
+    {
+      if (!sort_natively(ctx, elements, keys))
+      {
+        const auto less_than = ctx->runtime()->symbol(U"<");
+
+        return sort_with(
+          ctx,
+          elements,
+          keys,
+          [&ctx, &less_than](const ref<value>& a,
+                             const ref<value>& b,
+                             bool& result)
+          {
+            return compare_values(ctx, less_than, a, b, result);
+          }
+        );
+      }
+
+      return true;
+    }
+
+    /**
+     * Minimum number of elements processed by a single task of the parallel
+     * array words. Smaller chunks would spend more time in forking contexts
+     * and scheduling than in executing the quote.
+     */
+    static const array::size_type parallel_grain = 64;
+
+    /**
+     * Splits the range of elements between given offsets into chunks and
+     * invokes given callback for each chunk from the thread pool of the
+     * runtime, with a forked context of its own. Once a chunk has failed,
+     * chunks which come after it are skipped. Error of the first failed
+     * chunk is placed into the calling context and false is returned.
+     */
+    template<class Callback>
+    static bool run_parallel(const ref<context>& ctx,
+                             array::size_type begin,
+                             array::size_type end,
+                             const Callback& callback)
+    {
+      auto& pool = ctx->runtime()->thread_pool();
+      const auto length = end - begin;
+      const auto chunks = std::max<array::size_type>(
+        1,
+        std::min<array::size_type>(
+          length / parallel_grain,
+          pool.concurrency() * 4
+        )
+      );
+      std::vector<ref<error>> errors(chunks);
+      std::atomic<std::size_t> first_failure(chunks);
+
+      if (!length)
+      {
+        return true;
+      }
+
+      pool.run(chunks, [&](std::size_t index)
+      {
+        const auto chunk_begin = begin + length * index / chunks;
+        const auto chunk_end = begin + length * (index + 1) / chunks;
+        ref<context> worker;
+        std::size_t failure;
+
+        if (first_failure.load(std::memory_order_relaxed) < index)
+        {
+          return;
+        }
+        worker = ctx->fork();
+        if (callback(worker, chunk_begin, chunk_end))
+        {
+          return;
+        }
+        errors[index] = worker->error();
+        failure = first_failure.load(std::memory_order_relaxed);
+        while (index < failure && !first_failure.compare_exchange_weak(
+          failure,
+          index,
+          std::memory_order_relaxed
+        ));
+      });
+
+      for (const auto& error : errors)
+      {
+        if (error)
+        {
+          ctx->error(error);
+
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    /**
+     * Numbers of an array in unboxed form. Typed arrays lend their storage to
+     * the view, while numbers of other arrays are unboxed into a buffer.
+     */
+    struct numeric_view
+    {
+      /** Keeps the array alive for as long as its storage is being used. */
+      ref<array> owner;
+      enum array::element_type type;
+      array::size_type size;
+      const number::int_type* ints;
+      const number::real_type* reals;
+      std::vector<number::int_type> int_buffer;
+      std::vector<number::real_type> real_buffer;
+
+      /**
+       * Converts integers of the view into real numbers.
+       */
+      void promote()
+      {
+        if (type == array::element_type::int64)
+        {
+          real_buffer.assign(ints, ints + size);
+          reals = real_buffer.data();
+          type = array::element_type::float64;
+        }
+      }
+    };
+
+    /**
+     * Constructs unboxed view of numbers contained in the array. Arrays
+     * which contain only integers give integers, all other arrays of
+     * numbers give real numbers. Type error is set if the array contains
+     * something else than numbers.
+     */
+    static bool unbox(const ref<context>& ctx,
+                      const ref<array>& ary,
+                      numeric_view& view)
+    {
+      bool valid = true;
+
+      view.owner = ary;
+      view.size = ary->size();
+      view.type = ary->element_type();
+      if (view.type == array::element_type::int64)
+      {
+        view.ints = static_cast<const int_array*>(ary.get())->data();
+
+        return true;
+      }
+      else if (view.type == array::element_type::float64)
+      {
+        view.reals = static_cast<const real_array*>(ary.get())->data();
+
+        return true;
+      }
+
+      view.type = array::element_type::int64;
+      view.int_buffer.reserve(view.size);
+      ary->for_each_chunk([&view, &valid](array::const_pointer data,
+                                          array::size_type count)
+      {
+        for (array::size_type i = 0; i < count; ++i)
+        {
+          const number* num;
+
+          if (!value::is(data[i], value::type::number))
+          {
+            valid = false;
+
+            return false;
+          }
+          num = static_cast<const number*>(data[i].get());
+          if (view.type == array::element_type::int64 &&
+              num->is(number::number_type::real))
+          {
+            view.type = array::element_type::float64;
+            view.real_buffer.reserve(view.size);
+            view.real_buffer.assign(
+              std::begin(view.int_buffer),
+              std::end(view.int_buffer)
+            );
+          }
+          if (view.type == array::element_type::int64)
+          {
+            view.int_buffer.push_back(num->as_int());
+          } else {
+            view.real_buffer.push_back(num->as_real());
+          }
+        }
+
+        return true;
+      });
+
+      if (!valid)
+      {
+        ctx->error(
+          error::code::type,
+          U"Expected array of numbers, got array with other values instead."
+        );
+
+        return false;
+      }
+      view.ints = view.int_buffer.data();
+      view.reals = view.real_buffer.data();
+
+      return true;
+    }
+
+    /**
+     * Copies numbers into a new typed array.
+     */
+    template<class T>
+    static ref<array> make_typed(const ref<class runtime>& runtime,
+                                 const T* data,
+                                 array::size_type size)
+    {
+      const auto result = typed_array<T>::make(runtime, size);
+
+      std::copy(data, data + size, result->data());
+
+      return ref<array>(result);
+    }
+
+    /**
+     * Converts booleans produced by a comparison kernel into an array of
+     * boolean values.
+     */
+    static void push_booleans(const ref<context>& ctx,
+                              const bool* flags,
+                              array::size_type size)
+    {
+      const auto& runtime = ctx->runtime();
+      std::vector<ref<value>> result;
+
+      result.reserve(size);
+      for (array::size_type i = 0; i < size; ++i)
+      {
+        if (flags[i])
+        {
+          result.push_back(runtime->true_value());
+        } else {
+          result.push_back(runtime->false_value());
+        }
+      }
+      ctx->push_array(result);
+    }
+
+    /**
+     * Applies arithmetic operation to two integers with the same rules as
+     * the scalar arithmetic words have: the operation is performed on real
+     * numbers first, and repeated with integers if the result is within the
+     * range of integers, wrapping around on overflow. Returns false if the
+     * result is given as real number instead.
+     */
+    static bool apply_scalar(kernels::arithmetic op,
+                             number::int_type a,
+                             number::int_type b,
+                             number::int_type& int_result,
+                             number::real_type& real_result)
+    {
+      using unsigned_type = std::make_unsigned<number::int_type>::type;
+      const auto x = static_cast<number::real_type>(a);
+      const auto y = static_cast<number::real_type>(b);
+      unsigned_type result;
+
+      switch (op)
+      {
+        case kernels::arithmetic::add:
+          real_result = x + y;
+          result = static_cast<unsigned_type>(a) + static_cast<unsigned_type>(b);
+          break;
+
+        case kernels::arithmetic::subtract:
+          real_result = x - y;
+          result = static_cast<unsigned_type>(a) - static_cast<unsigned_type>(b);
+          break;
+
+        case kernels::arithmetic::multiply:
+          real_result = x * y;
+          result = static_cast<unsigned_type>(a) * static_cast<unsigned_type>(b);
+          break;
+
+        default:
+          real_result = x / y;
+
+          return false;
+      }
+      if (!(std::fabs(real_result)
+            <= static_cast<number::real_type>(number::int_max)))
+      {
+        return false;
+      }
+      int_result = static_cast<number::int_type>(result);
+
+      return true;
+    }
+
+    /**
+     * Pushes results of integer arithmetic which has overflowed. Each result
+     * is computed the way the scalar words would compute it, and the results
+     * are given as a typed array if all of them are of the same type, or
+     * as an array of numbers if they are mixed.
+     */
+    static void push_overflowed(const ref<context>& ctx,
+                                kernels::arithmetic op,
+                                const number* scalar,
+                                const numeric_view& left,
+                                const numeric_view& right)
+    {
+      const auto& runtime = ctx->runtime();
+      const auto size = right.size;
+      std::vector<number::int_type> ints(size);
+      std::vector<number::real_type> reals(size);
+      std::vector<bool> is_int(size);
+      array::size_type int_count = 0;
+
+      for (array::size_type i = 0; i < size; ++i)
+      {
+        is_int[i] = apply_scalar(
+          op,
+          scalar ? scalar->as_int() : left.ints[i],
+          right.ints[i],
+          ints[i],
+          reals[i]
+        );
+        int_count += is_int[i];
+      }
+
+      if (int_count == size)
+      {
+        ctx->push(make_typed(runtime, ints.data(), size));
+      }
+      else if (!int_count)
+      {
+        ctx->push(make_typed(runtime, reals.data(), size));
+      } else {
+        std::vector<ref<value>> result;
+
+        result.reserve(size);
+        for (array::size_type i = 0; i < size; ++i)
+        {
+          if (is_int[i])
+          {
+            result.push_back(runtime->number(ints[i]));
+          } else {
+            result.push_back(runtime->number(reals[i]));
+          }
+        }
+        ctx->push_array(result);
+      }
+    }
+
+    /**
+     * Pops the operands of an element-wise numeric word from the stack: an
+     * array, and below it either another array of the same size or a number
+     * which is used as the left operand for each element.
+     */
+    static bool pop_operands(const ref<context>& ctx,
+                             numeric_view& left,
+                             const number*& scalar,
+                             ref<value>& scalar_slot,
+                             numeric_view& right)
+    {
+      ref<array> ary;
+
+      if (!ctx->pop_array(ary) ||
+          !ctx->pop(scalar_slot) ||
+          !unbox(ctx, ary, right))
+      {
+        return false;
+      }
+      else if (value::is(scalar_slot, value::type::number))
+      {
+        scalar = static_cast<const number*>(scalar_slot.get());
+
+        return true;
+      }
+      else if (!value::is(scalar_slot, value::type::array))
+      {
+        ctx->error(
+          error::code::type,
+          U"Expected number or array, got " +
+          (
+            scalar_slot
+              ? scalar_slot->type_description()
+              : value::type_description(value::type::null)
+          ) +
+          U" instead."
+        );
+
+        return false;
+      }
+      scalar = nullptr;
+      if (!unbox(ctx, ref_cast<array>(scalar_slot), left))
+      {
+        return false;
+      }
+      else if (left.size != right.size)
+      {
+        ctx->error(error::code::range, U"Array lengths do not match.");
+
+        return false;
+      }
+
+      return true;
+    }
+  }
+
+  array::const_pointer array::chunk(size_type, size_type&) const
+  {
+    return nullptr;
+  }
+
+  enum array::element_type array::element_type() const
+  {
+    return element_type::any;
+  }
+
+  bool array::equals(const ref<value>& that) const
+  {
+    ref<array> ary;
+    size_type offset = 0;
+
+    if (!is(that, type::array))
+    {
+      return false;
+    }
+
+    ary = ref_cast<array>(that);
+
+    if (size() != ary->size())
+    {
+      return false;
+    }
+
+    return for_each_chunk([&ary, &offset](const_pointer data, size_type count)
+    {
+      while (count > 0)
+      {
+        size_type available;
+        const auto other = ary->chunk(offset, available);
+
+        if (!other)
+        {
+          if (*data != ary->at(offset))
+          {
+            return false;
+          }
+          available = 1;
+        } else {
+          available = std::min(available, count);
+          if (!std::equal(data, data + available, other))
+          {
+            return false;
+          }
+        }
+        data += available;
+        count -= available;
+        offset += available;
+      }
+
+      return true;
+    });
+  }
+
+  std::size_t array::hash() const
+  {
+    auto result = m_hash.load(std::memory_order_relaxed);
+
+    if (!result)
+    {
+      result = size();
+      for_each_chunk([&result](const_pointer data, size_type count)
+      {
+        for (size_type i = 0; i < count; ++i)
+        {
+          result = hash_combine(result, value::hash(data[i]));
+        }
+
+        return true;
+      });
+      // Zero is reserved for hash codes which have not been computed yet.
+      if (!result)
+      {
+        result = 1;
+      }
+      m_hash.store(result, std::memory_order_relaxed);
+    }
+
+    return result;
+  }
+
+  std::u32string array::to_string() const
+  {
+    std::u32string result;
+    bool first = true;
+
+    for_each_chunk([&result, &first](const_pointer data, size_type count)
+    {
+      for (size_type i = 0; i < count; ++i)
+      {
+        if (first)
+        {
+          first = false;
+        } else {
+          result += ',';
+          result += ' ';
+        }
+        if (data[i])
+        {
+          result += data[i]->to_string();
+        }
+      }
+
+      return true;
+    });
+
+    return result;
+  }
+
+  std::u32string array::to_source() const
+  {
+    std::u32string result;
+    bool first = true;
+
+    result += '[';
+    for_each_chunk([&result, &first](const_pointer data, size_type count)
+    {
+      for (size_type i = 0; i < count; ++i)
+      {
+        if (first)
+        {
+          first = false;
+        } else {
+          result += ',';
+          result += ' ';
+        }
+        if (data[i])
+        {
+          result += data[i]->to_source();
+        } else {
+          result += U"null";
+        }
+      }
+
+      return true;
+    });
+    result += ']';
+
+    return result;
+  }
+
+  array::iterator::iterator(const ref<array>& ary,
+                            array::size_type index)
+    : m_array(ary)
+    , m_index(index) {}
+
+  array::iterator::iterator(const iterator& that)
+    : m_array(that.m_array)
+    , m_index(that.m_index) {}
+
+  array::iterator& array::iterator::operator=(const iterator& that)
+  {
+    m_array = that.m_array;
+    m_index = that.m_index;
+
+    return *this;
+  }
+
+  array::iterator& array::iterator::operator++()
+  {
+    ++m_index;
+
+    return *this;
+  }
+
+  array::iterator array::iterator::operator++(int)
+  {
+    const iterator copy(*this);
+
+    ++m_index;
+
+    return copy;
+  }
+
+  array::iterator::reference array::iterator::operator*()
+  {
+    return m_array->at(m_index);
+  }
+
+  array::iterator::reference array::iterator::operator->()
+  {
+    return m_array->at(m_index);
+  }
+
+  bool array::iterator::operator==(const iterator& that) const
+  {
+    return m_index == that.m_index;
+  }
+
+  bool array::iterator::operator!=(const iterator& that) const
+  {
+    return m_index != that.m_index;
+  }
+
+  ref<class array> runtime::array(array::const_pointer elements,
+                                  array::size_type size)
+  {
+    vector_builder builder(*m_memory_manager);
+
+    for (array::size_type i = 0; i < size; ++i)
+    {
+      builder.push(elements[i]);
+    }
+
+    return builder.build();
+  }
+
+  /**
+   * Word: length
+   * Prototype: array
+   *
+   * Takes:
+   * - array
+   *
+   * Gives:
+   * - array
+   * - number
+   *
+   * Returns the number of elements in the array, while keeping the array on
+   * the stack.
+   */
+  static void w_length(const ref<context>& ctx, const array& ary)
+  {
+    ctx->push_int(ary.size());
+  }
+
+  /**
+   * Word: push
+   * Prototype: array
+   *
+   * Takes:
+   * - any
+   * - array
+   *
+   * Gives:
+   * - array
+   *
+   * Constructs new array where first value has been pushed as the last element
+   * of the existing array.
+   *
+   *     4 [1, 2, 3] push  #=> [1, 2, 3, 4]
+   */
+  static void w_push(const ref<context>& ctx)
+  {
+    ref<value> val;
+    ref<array> ary;
+
+    if (ctx->pop_array(ary) && ctx->pop(val))
+    {
+      auto builder = vector_builder::from(
+        ctx->runtime()->memory_manager(),
+        ary
+      );
+
+      builder.push(val);
+      ctx->push(builder.build());
+    }
+  }
+
+  /**
+   * Word: pop
+   * Prototype: array
+   *
+   * Takes:
+   * - array
+   *
+   * Gives:
+   * - array
+   * - any
+   *
+   * Removes last element from the array and places it onto the stack.
+   *
+   *     [1, 2, 3] pop  #=> [1, 2] 3
+   */
+  static void w_pop(const ref<context>& ctx)
+  {
+    ref<array> ary;
+
+    if (ctx->pop_array(ary))
+    {
+      const auto size = ary->size();
+
+      if (!size)
+      {
+        ctx->push(ary);
+        ctx->error(error::code::range, U"Array is empty.");
+        return;
+      }
+
+      auto builder = vector_builder::from(
+        ctx->runtime()->memory_manager(),
+        ary
+      );
+
+      builder.pop();
+      ctx->push(builder.build());
+      ctx->push(ary->at(size - 1));
+    }
+  }
+
+  /**
+   * Word: includes?
+   * Prototype: array
+   *
+   * Takes:
+   * - any
+   * - array
+   *
+   * Gives:
+   * - array
+   * - boolean
+   *
+   * Searches for given value in the array and returns true if it's included
+   * and false if it's not.
+   */
+  static void w_includes(const ref<context>& ctx,
+                         const array& ary,
+                         const cell& arg)
+  {
+    const auto val = arg.to_value(ctx->runtime());
+    const bool found = !ary.for_each_chunk(
+      [&val](array::const_pointer data, array::size_type count)
+      {
+        return std::find(data, data + count, val) == data + count;
+      }
+    );
+
+    ctx->nip();
+    ctx->push_boolean(found);
+  }
+
+  /**
+   * Word: index-of
+   * Prototype: array
+   *
+   * Takes:
+   * - any
+   * - array
+   *
+   * Gives:
+   * - array
+   * - number|null
+   *
+   * Searches for given value from the array and returns its index in the array
+   * if it's included in the array and null if it's not.
+   */
+  static void w_index_of(const ref<context>& ctx,
+                         const array& ary,
+                         const cell& arg)
+  {
+    const auto val = arg.to_value(ctx->runtime());
+    array::size_type index = 0;
+    const bool found = !ary.for_each_chunk(
+      [&val, &index](array::const_pointer data, array::size_type count)
+      {
+        const auto position = std::find(data, data + count, val);
+
+        index += position - data;
+
+        return position == data + count;
+      }
+    );
+
+    ctx->nip();
+    if (found)
+    {
+      ctx->push_int(index);
+    } else {
+      ctx->push_null();
+    }
+  }
+
+  /**
+   * Word: binary-search
+   * Prototype: array
+   *
+   * Takes:
+   * - any
+   * - array
+   *
+   * Gives:
+   * - array
+   * - number|null
+   *
+   * Searches for given value from an array which has been sorted into
+   * ascending order with the sort word. Returns index of the first element
+   * which is equal to the value, or null if the array does not include it.
+   */
+  static void w_binary_search(const ref<context>& ctx)
+  {
+    ref<array> ary;
+    ref<value> val;
+    array::size_type low = 0;
+    array::size_type high;
+    bool less;
+
+    if (!ctx->pop_array(ary) || !ctx->pop(val))
+    {
+      return;
+    }
+
+    const auto less_than = ctx->runtime()->symbol(U"<");
+    const auto depth = ctx->size();
+
+    high = ary->size();
+    while (low < high)
+    {
+      const auto middle = low + (high - low) / 2;
+
+      if (!compare_values(ctx, less_than, ary->at(middle), val, less))
+      {
+        truncate_stack(ctx, depth);
+        ctx->push(val);
+        ctx->push(ary);
+        return;
+      }
+      else if (less)
+      {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+
+    if (low < ary->size() &&
+        !compare_values(ctx, less_than, val, ary->at(low), less))
+    {
+      truncate_stack(ctx, depth);
+      ctx->push(val);
+      ctx->push(ary);
+      return;
+    }
+
+    ctx->push(ary);
+    if (low < ary->size() && !less)
+    {
+      ctx->push_int(low);
+    } else {
+      ctx->push_null();
+    }
+  }
+
+  /**
+   * Word: find
+   * Prototype: array
+   *
+   * Takes:
+   * - quote
+   * - array
+   *
+   * Gives:
+   * - array
+   * -any|null
+   *
+   * Returns the first element from the array that satisfies the provided
+   * testing quote. Otherwise null is returned.
+   */
+  static void w_find(const ref<context>& ctx)
+  {
+    ref<array> ary;
+    ref<quote> quo;
+
+    if (ctx->pop_array(ary) && ctx->pop_quote(quo))
+    {
+      ctx->push(ary);
+      for (const auto& element : ary)
+      {
+        bool result;
+
+        ctx->push(element);
+        if (!quo->call(ctx) || !ctx->pop_boolean(result))
+        {
+          return;
+        }
+        else if (result)
+        {
+          ctx->push(element);
+          return;
+        }
+      }
+      ctx->push_null();
+    }
+  }
+
+  /**
+   * Word: find-index
+   * Prototype: array
+   *
+   * Takes:
+   * - quote
+   * - array
+   *
+   * Gives:
+   * - array
+   * - number|null
+   *
+   * Returns the index of the first element in the array that satisfies the
+   * provided testing quote. Otherwise null is returned.
+   */
+  static void w_find_index(const ref<context>& ctx)
+  {
+    ref<array> ary;
+    ref<quote> quo;
+
+    if (ctx->pop_array(ary) && ctx->pop_quote(quo))
+    {
+      const auto size = ary->size();
+
+      ctx->push(ary);
+      for (array::size_type i = 0; i < size; ++i)
+      {
+        bool result;
+
+        ctx->push(ary->at(i));
+        if (!quo->call(ctx) || !ctx->pop_boolean(result))
+        {
+          return;
+        }
+        else if (result)
+        {
+          ctx->push_int(i);
+          return;
+        }
+      }
+      ctx->push_null();
+    }
+  }
+
+  /**
+   * Word: every?
+   * Prototype: array
+   *
+   * Takes:
+   * - quote
+   * - array
+   *
+   * Gives:
+   * - array
+   * -boolean
+   *
+   * Tests whether all elements in the array satisfy the provided testing
+   * quote.
+   */
+  static void w_every(const ref<context>& ctx)
+  {
+    ref<array> ary;
+    ref<quote> quo;
+
+    if (ctx->pop_array(ary) && ctx->pop_quote(quo))
+    {
+      ctx->push(ary);
+      for (const auto& element : ary)
+      {
+        bool result;
+
+        ctx->push(element);
+        if (!quo->call(ctx) || !ctx->pop_boolean(result))
+        {
+          return;
+        }
+        else if (!result)
+        {
+          ctx->push_boolean(false);
+          return;
+        }
+      }
+      ctx->push_boolean(true);
+    }
+  }
+
+  /**
+   * Word: some?
+   * Prototype: array
+   *
+   * Takes:
+   * - quote
+   * - array
+   *
+   * Gives:
+   * - array
+   * - boolean
+   *
+   * Tests whether any element in the array satisfies the provided quote.
+   */
+  static void w_some(const ref<context>& ctx)
   {
-    return m_index == that.m_index;
+    ref<array> ary;
+    ref<quote> quo;
+
+    if (ctx->pop_array(ary) && ctx->pop_quote(quo))
+    {
+      ctx->push(ary);
+      for (const auto& element : ary)
+      {
+        bool result;
+
+        ctx->push(element);
+        if (!quo->call(ctx) || !ctx->pop_boolean(result))
+        {
+          return;
+        }
+        else if (result)
+        {
+          ctx->push_boolean(true);
+          return;
+        }
+      }
+      ctx->push_boolean(false);
+    }
   }
 
-  bool array::iterator::operator!=(const iterator& that) const
+  /**
+   * Word: reverse
+   * Prototype: array
+   *
+   * Takes:
+   * - array
+   *
+   * Gives:
+   * - array
+   *
+   * Reverses the array. The first array element becomes the last and the last
+   * array element becomes first.
+   */
+  static void w_reverse(const ref<context>& ctx)
   {
-    return m_index != that.m_index;
+    ref<array> ary;
+
+    if (ctx->pop_array(ary))
+    {
+      ctx->push(ctx->runtime()->value<reversed_array>(ary));
+    }
   }
 
-  std::shared_ptr<class array> runtime::array(array::const_pointer elements,
-                                              array::size_type size)
+  /**
+   * Word: uniq
+   * Prototype: array
+   *
+   * Takes:
+   * - array
+   *
+   * Gives:
+   * - array
+   *
+   * Removes duplicate elements from the array.
+   */
+  static void w_uniq(const ref<context>& ctx)
   {
-    return std::shared_ptr<class array>(
-      new (*m_memory_manager) simple_array(size, elements)
-    );
+    ref<array> ary;
+
+    if (ctx->pop_array(ary))
+    {
+      std::vector<ref<value>> result;
+      value_set seen(ary->size());
+
+      for (const auto& element : ary)
+      {
+        if (seen.insert(element).second)
+        {
+          result.push_back(element);
+        }
+      }
+
+      ctx->push_array(result.data(), result.size());
+    }
   }
 
   /**
-   * Word: length
+   * Word: sort
    * Prototype: array
    *
    * Takes:
@@ -336,200 +1943,413 @@ namespace plorth
    *
    * Gives:
    * - array
-   * - number
    *
-   * Returns the number of elements in the array, while keeping the array on
-   * the stack.
+   * Sorts elements of the array into ascending order. Numbers and strings are
+   * compared directly, other values with the < word. The sort is stable, so
+   * elements which are equal to each other keep their original order.
    */
-  static void w_length(const std::shared_ptr<context>& ctx)
+  static void w_sort(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
+    ref<array> ary;
 
     if (ctx->pop_array(ary))
     {
-      ctx->push(ary);
-      ctx->push_int(ary->size());
+      const std::vector<ref<value>> elements(begin(ary), end(ary));
+      const auto depth = ctx->size();
+
+      if (!sort_values(ctx, elements, elements))
+      {
+        truncate_stack(ctx, depth);
+        ctx->push(ary);
+      }
+    }
+  }
+
+  /**
+   * Word: sort-by
+   * Prototype: array
+   *
+   * Takes:
+   * - quote
+   * - array
+   *
+   * Gives:
+   * - array
+   *
+   * Sorts elements of the array into ascending order of keys returned by the
+   * quote, which is called once for each element. Keys are compared just
+   * like elements are compared by the sort word.
+   */
+  static void w_sort_by(const ref<context>& ctx)
+  {
+    ref<array> ary;
+    ref<quote> quo;
+
+    if (ctx->pop_array(ary) && ctx->pop_quote(quo))
+    {
+      const std::vector<ref<value>> elements(begin(ary), end(ary));
+      const auto depth = ctx->size();
+      std::vector<ref<value>> keys;
+
+      keys.reserve(elements.size());
+      for (const auto& element : elements)
+      {
+        ref<value> key;
+
+        ctx->push(element);
+        if (!quo->call(ctx) || !ctx->pop(key))
+        {
+          truncate_stack(ctx, depth);
+          ctx->push(quo);
+          ctx->push(ary);
+          return;
+        }
+        keys.push_back(key);
+      }
+      if (!sort_values(ctx, elements, keys))
+      {
+        truncate_stack(ctx, depth);
+        ctx->push(quo);
+        ctx->push(ary);
+      }
+    }
+  }
+
+  /**
+   * Word: sort-with
+   * Prototype: array
+   *
+   * Takes:
+   * - quote
+   * - array
+   *
+   * Gives:
+   * - array
+   *
+   * Sorts elements of the array with comparator quote, which takes two
+   * elements and returns boolean telling whether the first one should be
+   * placed before the second one. The sort is stable.
+   */
+  static void w_sort_with(const ref<context>& ctx)
+  {
+    ref<array> ary;
+    ref<quote> quo;
+
+    if (ctx->pop_array(ary) && ctx->pop_quote(quo))
+    {
+      const std::vector<ref<value>> elements(begin(ary), end(ary));
+      const auto depth = ctx->size();
+
+      if (!sort_with(
+        ctx,
+        elements,
+        elements,
+        [&ctx, &quo](const ref<value>& a, const ref<value>& b, bool& result)
+        {
+          ctx->push(a);
+          ctx->push(b);
+
+          return quo->call(ctx) && ctx->pop_boolean(result);
+        }
+      ))
+      {
+        truncate_stack(ctx, depth);
+        ctx->push(quo);
+        ctx->push(ary);
+      }
+    }
+  }
+
+  /**
+   * Word: extract
+   * Prototype: array
+   *
+   * Takes:
+   * - array
+   *
+   * Gives:
+   * - any...
+   *
+   * Extracts all values from the array and places them onto the stack.
+   */
+  static void w_extract(const ref<context>& ctx)
+  {
+    ref<array> ary;
+
+    if (!ctx->pop_array(ary))
+    {
+      return;
+    }
+    for (array::size_type i = ary->size(); i > 0; --i)
+    {
+      ctx->push(ary->at(i - 1));
+    }
+  }
+
+  /**
+   * Word: join
+   * Prototype: array
+   *
+   * Takes:
+   * - string
+   * - array
+   *
+   * Gives:
+   * - string
+   *
+   * Concatenates all elements from the array into single string delimited by
+   * the given separator string.
+   */
+  static void w_join(const ref<context>& ctx)
+  {
+    ref<array> ary;
+    ref<string> separator;
+    std::u32string result;
+
+    if (!ctx->pop_array(ary) || !ctx->pop_string(separator))
+    {
+      return;
+    }
+
+    const auto glue = separator->to_string();
+    bool first = true;
+
+    ary->for_each_chunk([&result, &glue, &first](array::const_pointer data,
+                                                 array::size_type count)
+    {
+      for (array::size_type i = 0; i < count; ++i)
+      {
+        if (first)
+        {
+          first = false;
+        } else {
+          result += glue;
+        }
+        if (data[i])
+        {
+          result += data[i]->to_string();
+        } else {
+          result += U"null";
+        }
+      }
+
+      return true;
+    });
+
+    ctx->push_string(result);
+  }
+
+  static void do_flatten(const ref<array>& ary,
+                         std::vector<ref<value>>& container)
+  {
+    for (const auto& value : ary)
+    {
+      if (value::is(value, value::type::array))
+      {
+        do_flatten(ref_cast<array>(value), container);
+      } else {
+        container.push_back(value);
+      }
+    }
+  }
+
+  /**
+   * Word: flatten
+   * Prototype: array
+   *
+   * Takes:
+   * - array
+   *
+   * Gives:
+   * - array
+   *
+   * Creates new array with all sub-array elements concatted into it
+   * recursively.
+   */
+  static void w_flatten(const ref<context>& ctx)
+  {
+    ref<array> ary;
+
+    if (ctx->pop_array(ary))
+    {
+      std::vector<ref<value>> result;
+
+      result.reserve(ary->size());
+      do_flatten(ary, result);
+      ctx->push_array(result.data(), result.size());
+    }
+  }
+
+  static void do_nflatten(const ref<array>& ary,
+                          std::vector<ref<value>>& container,
+                          const number::int_type limit,
+                          number::int_type depth)
+  {
+    for (const auto& value : ary)
+    {
+      if (value::is(value, value::type::array) && depth < limit)
+      {
+        do_nflatten(
+          ref_cast<array>(value),
+          container,
+          limit,
+          depth + 1
+        );
+      } else {
+        container.push_back(value);
+      }
     }
   }
 
   /**
-   * Word: push
+   * Word: nflatten
    * Prototype: array
    *
    * Takes:
-   * - any
+   * - number
    * - array
    *
    * Gives:
    * - array
    *
-   * Constructs new array where first value has been pushed as the last element
-   * of the existing array.
-   *
-   *     4 [1, 2, 3] push  #=> [1, 2, 3, 4]
+   * Creates new array with all sub-array elements concatted into it
+   * recursively up to the given maximum depth.
    */
-  static void w_push(const std::shared_ptr<context>& ctx)
+  static void w_nflatten(const ref<context>& ctx)
   {
-    std::shared_ptr<value> val;
-    std::shared_ptr<array> ary;
+    ref<array> ary;
+    cell num;
 
-    if (ctx->pop_array(ary) && ctx->pop(val))
+    if (ctx->pop_array(ary) && ctx->pop_number(num))
     {
-      ctx->push(ctx->runtime()->value<push_array>(ary, val));
+      const auto limit = num.as_int();
+      std::vector<ref<value>> result;
+
+      result.reserve(ary->size());
+      do_nflatten(ary, result, limit, 0);
+      ctx->push_array(result.data(), result.size());
     }
   }
 
   /**
-   * Word: pop
+   * Word: >quote
    * Prototype: array
    *
    * Takes:
    * - array
    *
    * Gives:
-   * - array
-   * - any
-   *
-   * Removes last element from the array and places it onto the stack.
+   * - quote
    *
-   *     [1, 2, 3] pop  #=> [1, 2] 3
+   * Converts array into executable quote.
    */
-  static void w_pop(const std::shared_ptr<context>& ctx)
+  static void w_to_quote(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
+    ref<array> ary;
 
     if (ctx->pop_array(ary))
     {
-      const auto size = ary->size();
+      std::vector<ref<value>> elements;
 
-      if (!size)
+      elements.reserve(ary->size());
+      for (const auto& element : ary)
       {
-        ctx->push(ary);
-        ctx->error(error::code::range, U"Array is empty.");
-        return;
+        elements.push_back(element);
       }
-
-      ctx->push(ctx->runtime()->value<subarray>(ary, 0, size - 1));
-      ctx->push(ary->at(size - 1));
+      ctx->push(ctx->runtime()->compiled_quote(elements));
     }
   }
 
   /**
-   * Word: includes?
+   * Word: >seq
    * Prototype: array
    *
    * Takes:
-   * - any
    * - array
    *
    * Gives:
-   * - array
-   * - boolean
+   * - seq
    *
-   * Searches for given value in the array and returns true if it's included
-   * and false if it's not.
+   * Returns lazy sequence of elements of the array.
    */
-  static void w_includes(const std::shared_ptr<context>& ctx)
+  static void w_to_seq(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<value> val;
+    ref<array> ary;
 
-    if (ctx->pop_array(ary) && ctx->pop(val))
+    if (ctx->pop_array(ary))
     {
-      ctx->push(ary);
-      for (const auto& element : ary)
-      {
-        if (val == element)
-        {
-          ctx->push_boolean(true);
-          return;
-        }
-      }
-      ctx->push_boolean(false);
+      ctx->push(ctx->runtime()->seq(ary));
     }
   }
 
   /**
-   * Word: index-of
+   * Word: for-each
    * Prototype: array
    *
    * Takes:
-   * - any
-   * - array
-   *
-   * Gives:
+   * - quote
    * - array
-   * - number|null
    *
-   * Searches for given value from the array and returns its index in the array
-   * if it's included in the array and null if it's not.
+   * Runs quote once for every element in the array.
    */
-  static void w_index_of(const std::shared_ptr<context>& ctx)
+  static void w_for_each(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<value> val;
+    ref<array> ary;
+    ref<quote> quo;
 
-    if (ctx->pop_array(ary) && ctx->pop(val))
+    if (!ctx->pop_array(ary) || !ctx->pop_quote(quo))
     {
-      const auto size = ary->size();
+      return;
+    }
 
-      ctx->push(ary);
-      for (array::size_type i = 0; i < size; ++i)
+    for (const auto& element : ary)
+    {
+      ctx->push(element);
+      if (!quo->call(ctx))
       {
-        if (val == ary->at(i))
-        {
-          ctx->push_int(i);
-          return;
-        }
+        return;
       }
-      ctx->push_null();
     }
   }
 
   /**
-   * Word: find
+   * Word: 2for-each
    * Prototype: array
    *
    * Takes:
    * - quote
    * - array
-   *
-   * Gives:
    * - array
-   * -any|null
    *
-   * Returns the first element from the array that satisfies the provided
-   * testing quote. Otherwise null is returned.
+   * Runs quote taking two arguments once for each element pair in the
+   * arrays.
    */
-  static void w_find(const std::shared_ptr<context>& ctx)
+  static void w_2for_each(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<quote> quo;
+    ref<array> ary_a;
+    ref<array> ary_b;
+    ref<quote> quo;
 
-    if (ctx->pop_array(ary) && ctx->pop_quote(quo))
+    if (ctx->pop_array(ary_b) && ctx->pop_array(ary_a) && ctx->pop_quote(quo))
     {
-      ctx->push(ary);
-      for (const auto& element : ary)
-      {
-        bool result;
+      const auto size_a = ary_a->size();
+      const auto size_b = ary_b->size();
+      const auto size = std::min(size_a, size_b);
 
-        ctx->push(element);
-        if (!quo->call(ctx) || !ctx->pop_boolean(result))
-        {
-          return;
-        }
-        else if (result)
+      for (array::size_type i = 0; i < size; ++i)
+      {
+        ctx->push(ary_a->at(i));
+        ctx->push(ary_b->at(i));
+        if (!quo->call(ctx))
         {
-          ctx->push(element);
           return;
         }
       }
-      ctx->push_null();
     }
   }
 
   /**
-   * Word: find-index
+   * Word: map
    * Prototype: array
    *
    * Takes:
@@ -538,84 +2358,83 @@ namespace plorth
    *
    * Gives:
    * - array
-   * - number|null
    *
-   * Returns the index of the first element in the array that satisfies the
-   * provided testing quote. Otherwise null is returned.
+   * Applies quote once for each element in the array and constructs a new
+   * array from values returned by the quote.
    */
-  static void w_find_index(const std::shared_ptr<context>& ctx)
+  static void w_map(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<quote> quo;
+    ref<array> ary;
+    ref<quote> quo;
 
     if (ctx->pop_array(ary) && ctx->pop_quote(quo))
     {
       const auto size = ary->size();
+      std::vector<ref<value>> result;
 
-      ctx->push(ary);
+      result.reserve(size);
       for (array::size_type i = 0; i < size; ++i)
       {
-        bool result;
+        ref<value> quote_result;
 
         ctx->push(ary->at(i));
-        if (!quo->call(ctx) || !ctx->pop_boolean(result))
-        {
-          return;
-        }
-        else if (result)
+        if (!quo->call(ctx) || !ctx->pop(quote_result))
         {
-          ctx->push_int(i);
           return;
         }
+        result.push_back(quote_result);
       }
-      ctx->push_null();
+      ctx->push_array(result.data(), size);
     }
   }
 
   /**
-   * Word: every?
+   * Word: 2map
    * Prototype: array
    *
    * Takes:
    * - quote
    * - array
+   * - array
    *
    * Gives:
    * - array
-   * -boolean
    *
-   * Tests whether all elements in the array satisfy the provided testing
-   * quote.
+   * Applies quote taking two arguments once for each element pair in the
+   * arrays and constructs a new array from values returned by the quote.
    */
-  static void w_every(const std::shared_ptr<context>& ctx)
+  static void w_2map(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<quote> quo;
+    ref<array> ary_a;
+    ref<array> ary_b;
+    ref<quote> quo;
 
-    if (ctx->pop_array(ary) && ctx->pop_quote(quo))
+    if (ctx->pop_array(ary_b) && ctx->pop_array(ary_a) && ctx->pop_quote(quo))
     {
-      ctx->push(ary);
-      for (const auto& element : ary)
+      const auto size_a = ary_a->size();
+      const auto size_b = ary_b->size();
+      const auto size = std::min(size_a, size_b);
+      std::vector<ref<value>> result;
+
+      result.reserve(size);
+      for (array::size_type i = 0; i < size; ++i)
       {
-        bool result;
+        ref<value> quote_result;
 
-        ctx->push(element);
-        if (!quo->call(ctx) || !ctx->pop_boolean(result))
-        {
-          return;
-        }
-        else if (!result)
+        ctx->push(ary_a->at(i));
+        ctx->push(ary_b->at(i));
+        if (!quo->call(ctx) || !ctx->pop(quote_result))
         {
-          ctx->push_boolean(false);
           return;
         }
+        result.push_back(quote_result);
       }
-      ctx->push_boolean(true);
+      ctx->push_array(result.data(), size);
     }
   }
 
   /**
-   * Word: some?
+   * Word: filter
    * Prototype: array
    *
    * Takes:
@@ -624,237 +2443,343 @@ namespace plorth
    *
    * Gives:
    * - array
-   * - boolean
    *
-   * Tests whether any element in the array satisfies the provided quote.
+   * Removes elements of the array that do not satisfy the provided testing
+   * quote.
    */
-  static void w_some(const std::shared_ptr<context>& ctx)
+  static void w_filter(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<quote> quo;
+    ref<array> ary;
+    ref<quote> quo;
+    std::vector<ref<value>> result;
 
-    if (ctx->pop_array(ary) && ctx->pop_quote(quo))
+    if (!ctx->pop_array(ary) || !ctx->pop_quote(quo))
     {
-      ctx->push(ary);
-      for (const auto& element : ary)
-      {
-        bool result;
+      return;
+    }
 
-        ctx->push(element);
-        if (!quo->call(ctx) || !ctx->pop_boolean(result))
-        {
-          return;
-        }
-        else if (result)
-        {
-          ctx->push_boolean(true);
-          return;
-        }
+    for (const auto& element : ary)
+    {
+      bool quote_result;
+
+      ctx->push(element);
+      if (!quo->call(ctx) || !ctx->pop_boolean(quote_result))
+      {
+        return;
+      }
+      else if (quote_result)
+      {
+        result.push_back(element);
       }
-      ctx->push_boolean(false);
     }
+
+    ctx->push_array(result.data(), result.size());
   }
 
   /**
-   * Word: reverse
+   * Word: reduce
    * Prototype: array
    *
    * Takes:
+   * - quote
    * - array
    *
    * Gives:
-   * - array
+   * - any
    *
-   * Reverses the array. The first array element becomes the last and the last
-   * array element becomes first.
+   * Applies given quote against an accumulator and each element in the array
+   * to reduce it into a single value.
    */
-  static void w_reverse(const std::shared_ptr<context>& ctx)
+  static void w_reduce(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
+    ref<class array> array;
+    ref<class quote> quote;
+    ref<value> result;
+    array::size_type size;
 
-    if (ctx->pop_array(ary))
+    if (!ctx->pop_array(array) || !ctx->pop_quote(quote))
     {
-      ctx->push(ctx->runtime()->value<reversed_array>(ary));
+      return;
+    }
+
+    size = array->size();
+
+    if (size == 0)
+    {
+      ctx->error(error::code::range, U"Cannot reduce empty array.");
+      return;
+    }
+
+    result = array->at(0);
+
+    for (array::size_type i = 1; i < size; ++i)
+    {
+      ctx->push(result);
+      ctx->push(array->at(i));
+      if (!quote->call(ctx) || !ctx->pop(result))
+      {
+        return;
+      }
     }
+
+    ctx->push(result);
   }
 
   /**
-   * Word: uniq
+   * Word: pmap
    * Prototype: array
    *
    * Takes:
+   * - quote
    * - array
    *
    * Gives:
    * - array
    *
-   * Removes duplicate elements from the array.
+   * Applies quote once for each element in the array, in parallel on worker
+   * threads of the runtime, and constructs a new array from values returned
+   * by the quote in the order of the original elements. The quote is
+   * executed in forked contexts, so it cannot leave values into the stack of
+   * the calling context nor define words visible to it.
    */
-  static void w_uniq(const std::shared_ptr<context>& ctx)
+  static void w_pmap(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
+    ref<array> ary;
+    ref<quote> quo;
+    array::size_type size;
 
-    if (ctx->pop_array(ary))
+    if (!ctx->pop_array(ary) || !ctx->pop_quote(quo))
     {
-      std::vector<std::shared_ptr<value>> result;
+      return;
+    }
+
+    size = ary->size();
 
-      for (const auto& value1 : ary)
-      {
-        bool found = false;
+    std::vector<ref<value>> result(size);
 
-        for (const auto& value2 : result)
+    if (!run_parallel(
+      ctx,
+      0,
+      size,
+      [&ary, &quo, &result](const ref<context>& worker,
+                            array::size_type begin,
+                            array::size_type end)
+      {
+        for (auto i = begin; i < end; ++i)
         {
-          if (value1 == value2)
+          worker->push(ary->at(i));
+          if (!quo->call(worker) || !worker->pop(result[i]))
           {
-            found = true;
-            break;
+            return false;
           }
         }
 
-        if (!found)
-        {
-          result.push_back(value1);
-        }
+        return true;
       }
-
-      ctx->push_array(result.data(), result.size());
+    ))
+    {
+      return;
     }
+
+    ctx->push_array(result.data(), size);
   }
 
   /**
-   * Word: extract
+   * Word: pfilter
    * Prototype: array
    *
    * Takes:
+   * - quote
    * - array
    *
    * Gives:
-   * - any...
+   * - array
    *
-   * Extracts all values from the array and places them onto the stack.
+   * Removes elements of the array that do not satisfy the provided testing
+   * quote, which is executed in parallel on worker threads of the runtime.
+   * Order of the remaining elements is preserved.
    */
-  static void w_extract(const std::shared_ptr<context>& ctx)
+  static void w_pfilter(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
+    ref<array> ary;
+    ref<quote> quo;
+    array::size_type size;
 
-    if (!ctx->pop_array(ary))
+    if (!ctx->pop_array(ary) || !ctx->pop_quote(quo))
     {
       return;
     }
-    for (array::size_type i = ary->size(); i > 0; --i)
+
+    size = ary->size();
+
+    std::vector<char> keep(size, 0);
+    std::vector<ref<value>> result;
+
+    if (!run_parallel(
+      ctx,
+      0,
+      size,
+      [&ary, &quo, &keep](const ref<context>& worker,
+                          array::size_type begin,
+                          array::size_type end)
+      {
+        for (auto i = begin; i < end; ++i)
+        {
+          bool quote_result;
+
+          worker->push(ary->at(i));
+          if (!quo->call(worker) || !worker->pop_boolean(quote_result))
+          {
+            return false;
+          }
+          keep[i] = quote_result;
+        }
+
+        return true;
+      }
+    ))
     {
-      ctx->push(ary->at(i - 1));
+      return;
     }
+
+    for (array::size_type i = 0; i < size; ++i)
+    {
+      if (keep[i])
+      {
+        result.push_back(ary->at(i));
+      }
+    }
+
+    ctx->push_array(result.data(), result.size());
   }
 
   /**
-   * Word: join
+   * Word: preduce
    * Prototype: array
    *
    * Takes:
-   * - string
+   * - quote
    * - array
    *
    * Gives:
-   * - string
+   * - any
    *
-   * Concatenates all elements from the array into single string delimited by
-   * the given separator string.
+   * Reduces the array into a single value with given quote, in parallel on
+   * worker threads of the runtime. Each worker reduces a contiguous chunk of
+   * the array, after which the partial results are reduced in order in the
+   * calling context. The quote must therefore be associative, but it does
+   * not need to be commutative.
    */
-  static void w_join(const std::shared_ptr<context>& ctx)
+  static void w_preduce(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<string> separator;
-    std::u32string result;
+    ref<class array> array;
+    ref<class quote> quote;
+    ref<value> result;
+    array::size_type size;
+    std::vector<std::pair<array::size_type, ref<value>>> chunks;
+    std::mutex chunks_mutex;
 
-    if (!ctx->pop_array(ary) || !ctx->pop_string(separator))
+    if (!ctx->pop_array(array) || !ctx->pop_quote(quote))
     {
       return;
     }
 
-    for (array::size_type i = 0; i < ary->size(); ++i)
+    size = array->size();
+
+    if (size == 0)
     {
-      const auto& element = ary->at(i);
+      ctx->error(error::code::range, U"Cannot reduce empty array.");
+      return;
+    }
 
-      if (i > 0)
-      {
-        result += separator->to_string();
-      }
-      if (element)
+    if (!run_parallel(
+      ctx,
+      0,
+      size,
+      [&array, &quote, &chunks, &chunks_mutex](const ref<context>& worker,
+                                                array::size_type begin,
+                                                array::size_type end)
       {
-        result += element->to_string();
-      } else {
-        result += U"null";
+        ref<value> partial = array->at(begin);
+
+        for (auto i = begin + 1; i < end; ++i)
+        {
+          worker->push(partial);
+          worker->push(array->at(i));
+          if (!quote->call(worker) || !worker->pop(partial))
+          {
+            return false;
+          }
+        }
+        {
+          std::lock_guard<std::mutex> lock(chunks_mutex);
+
+          chunks.emplace_back(begin, partial);
+        }
+
+        return true;
       }
+    ))
+    {
+      return;
     }
 
-    ctx->push_string(result);
-  }
+    std::sort(
+      std::begin(chunks),
+      std::end(chunks),
+      [](const std::pair<array::size_type, ref<value>>& a,
+         const std::pair<array::size_type, ref<value>>& b)
+      {
+        return a.first < b.first;
+      }
+    );
 
-  static void do_flatten(const std::shared_ptr<array>& ary,
-                         std::vector<std::shared_ptr<value>>& container)
-  {
-    for (const auto& value : ary)
+    result = chunks[0].second;
+    for (std::size_t i = 1; i < chunks.size(); ++i)
     {
-      if (value::is(value, value::type::array))
+      ctx->push(result);
+      ctx->push(chunks[i].second);
+      if (!quote->call(ctx) || !ctx->pop(result))
       {
-        do_flatten(std::static_pointer_cast<array>(value), container);
-      } else {
-        container.push_back(value);
+        return;
       }
     }
+
+    ctx->push(result);
   }
 
   /**
-   * Word: flatten
+   * Word: +
    * Prototype: array
    *
    * Takes:
    * - array
+   * - array
    *
    * Gives:
    * - array
    *
-   * Creates new array with all sub-array elements concatted into it
-   * recursively.
+   * Concatenates the contents of two arrays and returns the result.
    */
-  static void w_flatten(const std::shared_ptr<context>& ctx)
+  static void w_concat(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
+    ref<array> a;
+    ref<array> b;
 
-    if (ctx->pop_array(ary))
+    if (ctx->pop_array(a) && ctx->pop_array(b))
     {
-      std::vector<std::shared_ptr<value>> result;
-
-      result.reserve(ary->size());
-      do_flatten(ary, result);
-      ctx->push_array(result.data(), result.size());
-    }
-  }
+      auto builder = vector_builder::from(
+        ctx->runtime()->memory_manager(),
+        b
+      );
 
-  static void do_nflatten(const std::shared_ptr<array>& ary,
-                          std::vector<std::shared_ptr<value>>& container,
-                          const number::int_type limit,
-                          number::int_type depth)
-  {
-    for (const auto& value : ary)
-    {
-      if (value::is(value, value::type::array) && depth < limit)
-      {
-        do_nflatten(
-          std::static_pointer_cast<array>(value),
-          container,
-          limit,
-          depth + 1
-        );
-      } else {
-        container.push_back(value);
-      }
+      builder.push(a);
+      ctx->push(builder.build());
     }
   }
 
   /**
-   * Word: nflatten
+   * Word: *
    * Prototype: array
    *
    * Takes:
@@ -864,578 +2789,742 @@ namespace plorth
    * Gives:
    * - array
    *
-   * Creates new array with all sub-array elements concatted into it
-   * recursively up to the given maximum depth.
+   * Repeats the array given number of times.
    */
-  static void w_nflatten(const std::shared_ptr<context>& ctx)
+  static void w_repeat(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<number> num;
+    ref<array> ary;
+    cell num;
 
     if (ctx->pop_array(ary) && ctx->pop_number(num))
     {
-      const auto limit = num->as_int();
-      std::vector<std::shared_ptr<value>> result;
+      const number::int_type count = num.as_int();
 
-      result.reserve(ary->size());
-      do_nflatten(ary, result, limit, 0);
-      ctx->push_array(result.data(), result.size());
+      if (count > 0)
+      {
+        auto builder = vector_builder::from(
+          ctx->runtime()->memory_manager(),
+          ary
+        );
+
+        for (number::int_type i = 1; i < count; ++i)
+        {
+          builder.push(ary);
+        }
+        ctx->push(builder.build());
+      }
+      else if (count == 0)
+      {
+        ctx->push_array(nullptr, 0);
+      } else {
+        ctx->error(error::code::range, U"Invalid repeat count.");
+      }
     }
   }
 
   /**
-   * Word: >quote
+   * Word: &
    * Prototype: array
    *
    * Takes:
    * - array
+   * - array
    *
    * Gives:
-   * - quote
+   * - array
    *
-   * Converts array into executable quote.
+   * Set intersection: Returns a new array containing unique elements common to
+   * the two arrays.
    */
-  static void w_to_quote(const std::shared_ptr<context>& ctx)
+  static void w_intersect(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
+    ref<array> a;
+    ref<array> b;
 
-    if (ctx->pop_array(ary))
+    if (ctx->pop_array(a) && ctx->pop_array(b))
     {
-      std::vector<std::shared_ptr<value>> elements;
+      std::vector<ref<value>> result;
+      const value_set elements(begin(a), end(a), a->size());
+      value_set seen;
 
-      elements.reserve(ary->size());
-      for (const auto& element : ary)
+      for (const auto& element : b)
       {
-        elements.push_back(element);
+        if (elements.count(element) && seen.insert(element).second)
+        {
+          result.push_back(element);
+        }
       }
-      ctx->push(ctx->runtime()->compiled_quote(elements));
+
+      ctx->push_array(result.data(), result.size());
     }
   }
 
   /**
-   * Word: for-each
+   * Word: |
    * Prototype: array
    *
    * Takes:
-   * - quote
+   * - array
    * - array
    *
-   * Runs quote once for every element in the array.
+   * Gives:
+   * - array
+   *
+   * Set union: Returns a new array by joining the two given arrays, excluding
+   * any duplicates and preserving the order of the given arrays.
    */
-  static void w_for_each(const std::shared_ptr<context>& ctx)
+  static void w_union(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<quote> quo;
+    ref<array> a;
+    ref<array> b;
 
-    if (!ctx->pop_array(ary) || !ctx->pop_quote(quo))
+    if (ctx->pop_array(a) && ctx->pop_array(b))
     {
-      return;
-    }
+      std::vector<ref<value>> result;
+      value_set seen(a->size() + b->size());
 
-    for (const auto& element : ary)
-    {
-      ctx->push(element);
-      if (!quo->call(ctx))
+      for (const auto& ary : { b, a })
       {
-        return;
+        for (const auto& element : ary)
+        {
+          if (seen.insert(element).second)
+          {
+            result.push_back(element);
+          }
+        }
       }
+
+      ctx->push_array(result.data(), result.size());
     }
   }
 
   /**
-   * Word: 2for-each
+   * Word: @
    * Prototype: array
    *
    * Takes:
-   * - quote
+   * - number
    * - array
+   *
+   * Gives:
    * - array
+   * - any
    *
-   * Runs quote taking two arguments once for each element pair in the
-   * arrays.
+   * Retrieves a value from the array at given numerical index. Negative
+   * indices count backwards from the end. If the given index is out of bounds,
+   * arange error will be thrown.
    */
-  static void w_2for_each(const std::shared_ptr<context>& ctx)
+  static void w_get(const ref<context>& ctx,
+                    const array& ary,
+                    number::int_type index)
   {
-    std::shared_ptr<array> ary_a;
-    std::shared_ptr<array> ary_b;
-    std::shared_ptr<quote> quo;
+    const auto size = ary.size();
 
-    if (ctx->pop_array(ary_b) && ctx->pop_array(ary_a) && ctx->pop_quote(quo))
+    if (index < 0)
     {
-      const auto size_a = ary_a->size();
-      const auto size_b = ary_b->size();
-      const auto size = std::min(size_a, size_b);
+      index += size;
+    }
 
-      for (array::size_type i = 0; i < size; ++i)
-      {
-        ctx->push(ary_a->at(i));
-        ctx->push(ary_b->at(i));
-        if (!quo->call(ctx))
-        {
-          return;
-        }
-      }
+    ctx->nip();
+
+    if (!size || index < 0 || index >= static_cast<number::int_type>(size))
+    {
+      ctx->error(error::code::range, U"Array index out of bounds.");
+      return;
     }
+
+    ctx->push(ary.at(index));
   }
 
   /**
-   * Word: map
+   * Word: !
    * Prototype: array
    *
    * Takes:
-   * - quote
+   * - any
+   * - number
    * - array
    *
    * Gives:
    * - array
    *
-   * Applies quote once for each element in the array and constructs a new
-   * array from values returned by the quote.
+   * Sets value in the array at given index. Negative indices count backwards
+   * from the end. If the index is larger than the number of elements in the
+   * array, the value will be appended as the last element of the array.
    */
-  static void w_map(const std::shared_ptr<context>& ctx)
+  static void w_set(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<quote> quo;
+    ref<array> ary;
+    cell num;
+    ref<value> val;
 
-    if (ctx->pop_array(ary) && ctx->pop_quote(quo))
+    if (ctx->pop_array(ary) && ctx->pop_number(num) && ctx->pop(val))
     {
       const auto size = ary->size();
-      std::vector<std::shared_ptr<value>> result;
+      number::int_type index = num.as_int();
+      auto builder = vector_builder::from(
+        ctx->runtime()->memory_manager(),
+        ary
+      );
 
-      result.reserve(size);
-      for (array::size_type i = 0; i < size; ++i)
+      if (index < 0)
       {
-        std::shared_ptr<value> quote_result;
+        index += size;
+      }
 
-        ctx->push(ary->at(i));
-        if (!quo->call(ctx) || !ctx->pop(quote_result))
-        {
-          return;
-        }
-        result.push_back(quote_result);
+      if (index < 0 || index >= static_cast<number::int_type>(size))
+      {
+        builder.push(val);
+      } else {
+        builder.set(index, val);
       }
-      ctx->push_array(result.data(), size);
+
+      ctx->push(builder.build());
     }
   }
 
   /**
-   * Word: 2map
+   * Word: >int64-array
    * Prototype: array
    *
    * Takes:
-   * - quote
-   * - array
    * - array
    *
    * Gives:
    * - array
    *
-   * Applies quote taking two arguments once for each element pair in the
-   * arrays and constructs a new array from values returned by the quote.
+   * Converts array of numbers into typed array which stores them as unboxed
+   * integers. Real numbers must have integral values; value error is raised
+   * for the ones which have fractional part, and range error for the ones
+   * which do not fit into an integer.
    */
-  static void w_2map(const std::shared_ptr<context>& ctx)
+  static void w_to_int64_array(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary_a;
-    std::shared_ptr<array> ary_b;
-    std::shared_ptr<quote> quo;
+    ref<array> ary;
+    numeric_view view;
 
-    if (ctx->pop_array(ary_b) && ctx->pop_array(ary_a) && ctx->pop_quote(quo))
+    if (!ctx->pop_array(ary) || !unbox(ctx, ary, view))
     {
-      const auto size_a = ary_a->size();
-      const auto size_b = ary_b->size();
-      const auto size = std::min(size_a, size_b);
-      std::vector<std::shared_ptr<value>> result;
-
-      result.reserve(size);
-      for (array::size_type i = 0; i < size; ++i)
+      return;
+    }
+    else if (ary->element_type() == array::element_type::int64)
+    {
+      ctx->push(ary);
+      return;
+    }
+    else if (view.type == array::element_type::float64)
+    {
+      const auto result = int_array::make(ctx->runtime(), view.size);
+      const ref<array> slot(result);
+
+      for (array::size_type i = 0; i < view.size; ++i)
       {
-        std::shared_ptr<value> quote_result;
+        const auto real = view.reals[i];
 
-        ctx->push(ary_a->at(i));
-        ctx->push(ary_b->at(i));
-        if (!quo->call(ctx) || !ctx->pop(quote_result))
+        if (std::isfinite(real) && std::trunc(real) != real)
         {
+          ctx->error(
+            error::code::value,
+            U"Number " + to_unistring(real) +
+            U" has fractional part and cannot be converted into integer."
+          );
           return;
         }
-        result.push_back(quote_result);
+        // Values outside of this range, including NaN, have no integer
+        // representation.
+        if (!(real >= static_cast<number::real_type>(number::int_min) &&
+              real < -static_cast<number::real_type>(number::int_min)))
+        {
+          ctx->error(
+            error::code::range,
+            U"Number " + to_unistring(view.reals[i]) +
+            U" cannot be converted into integer."
+          );
+          return;
+        }
+        result->data()[i] = static_cast<number::int_type>(real);
       }
-      ctx->push_array(result.data(), size);
+      ctx->push(slot);
+      return;
     }
+    ctx->push(make_typed(ctx->runtime(), view.ints, view.size));
   }
 
   /**
-   * Word: filter
+   * Word: >float64-array
    * Prototype: array
    *
    * Takes:
-   * - quote
    * - array
    *
    * Gives:
    * - array
    *
-   * Removes elements of the array that do not satisfy the provided testing
-   * quote.
+   * Converts array of numbers into typed array which stores them as unboxed
+   * real numbers.
    */
-  static void w_filter(const std::shared_ptr<context>& ctx)
+  static void w_to_float64_array(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<quote> quo;
-    std::vector<std::shared_ptr<value>> result;
+    ref<array> ary;
+    numeric_view view;
 
-    if (!ctx->pop_array(ary) || !ctx->pop_quote(quo))
+    if (!ctx->pop_array(ary) || !unbox(ctx, ary, view))
     {
       return;
     }
-
-    for (const auto& element : ary)
+    else if (ary->element_type() == array::element_type::float64)
     {
-      bool quote_result;
-
-      ctx->push(element);
-      if (!quo->call(ctx) || !ctx->pop_boolean(quote_result))
-      {
-        return;
-      }
-      else if (quote_result)
-      {
-        result.push_back(element);
-      }
+      ctx->push(ary);
+      return;
     }
-
-    ctx->push_array(result.data(), result.size());
+    view.promote();
+    ctx->push(make_typed(ctx->runtime(), view.reals, view.size));
   }
 
   /**
-   * Word: reduce
+   * Word: >generic-array
    * Prototype: array
    *
    * Takes:
-   * - quote
    * - array
    *
    * Gives:
-   * - any
+   * - array
    *
-   * Applies given quote against an accumulator and each element in the array
-   * to reduce it into a single value.
+   * Converts typed array into an array which stores its elements as boxed
+   * values. Other arrays are returned as they are.
    */
-  static void w_reduce(const std::shared_ptr<context>& ctx)
+  static void w_to_generic_array(const ref<context>& ctx)
   {
-    std::shared_ptr<class array> array;
-    std::shared_ptr<class quote> quote;
-    std::shared_ptr<value> result;
-    array::size_type size;
+    ref<array> ary;
 
-    if (!ctx->pop_array(array) || !ctx->pop_quote(quote))
+    if (!ctx->pop_array(ary))
     {
       return;
     }
-
-    size = array->size();
-
-    if (size == 0)
+    else if (ary->element_type() == array::element_type::any)
     {
-      ctx->error(error::code::range, U"Cannot reduce empty array.");
+      ctx->push(ary);
       return;
     }
 
-    result = array->at(0);
+    const auto& runtime = ctx->runtime();
+    const auto size = ary->size();
+    std::vector<ref<value>> result;
 
-    for (array::size_type i = 1; i < size; ++i)
+    result.reserve(size);
+    if (ary->element_type() == array::element_type::int64)
     {
-      ctx->push(result);
-      ctx->push(array->at(i));
-      if (!quote->call(ctx) || !ctx->pop(result))
+      const auto data = static_cast<const int_array*>(ary.get())->data();
+
+      for (array::size_type i = 0; i < size; ++i)
       {
-        return;
+        result.push_back(runtime->number(data[i]));
       }
-    }
+    } else {
+      const auto data = static_cast<const real_array*>(ary.get())->data();
 
-    ctx->push(result);
+      for (array::size_type i = 0; i < size; ++i)
+      {
+        result.push_back(runtime->number(data[i]));
+      }
+    }
+    ctx->push_array(result);
   }
 
   /**
-   * Word: +
+   * Word: element-type
    * Prototype: array
    *
    * Takes:
    * - array
-   * - array
    *
    * Gives:
    * - array
+   * - string
    *
-   * Concatenates the contents of two arrays and returns the result.
+   * Returns name of the way elements of the array are stored in: "int64" or
+   * "float64" for typed arrays and "any" for other arrays.
    */
-  static void w_concat(const std::shared_ptr<context>& ctx)
+  static void w_element_type(const ref<context>& ctx, const array& ary)
   {
-    std::shared_ptr<array> a;
-    std::shared_ptr<array> b;
-
-    if (ctx->pop_array(a) && ctx->pop_array(b))
+    switch (ary.element_type())
     {
-      ctx->push(ctx->runtime()->value<concat_array>(b, a));
+      case array::element_type::int64:
+        ctx->push_string(U"int64");
+        break;
+
+      case array::element_type::float64:
+        ctx->push_string(U"float64");
+        break;
+
+      default:
+        ctx->push_string(U"any");
+        break;
     }
   }
 
   /**
-   * Word: *
+   * Word: .+
    * Prototype: array
    *
    * Takes:
-   * - number
+   * - array|number
    * - array
    *
    * Gives:
    * - array
    *
-   * Repeats the array given number of times.
+   * Adds numbers of the two arrays together element by element. If a number
+   * is given instead of the first array, it's added to each element.
+   * Result is a typed array of integers if both operands are integers, and
+   * a typed array of real numbers otherwise. Each result is the same as the
+   * + word would give for the pair of numbers: integer results which
+   * overflow wrap around, unless the overflow is so large that the +
+   * word would give a real number instead. If results of both types are
+   * produced, result is an array of numbers instead of a typed array.
+   *
+   * Word: .-
+   * Prototype: array
+   *
+   * Subtracts numbers of the second array from the first one element by
+   * element, with the same rules as .+ word has.
+   *
+   * Word: .*
+   * Prototype: array
+   *
+   * Multiplies numbers of the two arrays element by element, with the same
+   * rules as .+ word has.
+   *
+   * Word: ./
+   * Prototype: array
+   *
+   * Divides numbers of the first array by the second one element by element.
+   * Result is always a typed array of real numbers.
    */
-  static void w_repeat(const std::shared_ptr<context>& ctx)
+  template<kernels::arithmetic Op>
+  static void w_elementwise(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<number> num;
+    const auto& runtime = ctx->runtime();
+    numeric_view left;
+    numeric_view right;
+    const number* scalar;
+    ref<value> scalar_slot;
 
-    if (ctx->pop_array(ary) && ctx->pop_number(num))
+    if (!pop_operands(ctx, left, scalar, scalar_slot, right))
     {
-      const number::int_type count = num->as_int();
+      return;
+    }
 
-      if (count > 0)
-      {
-        const auto& runtime = ctx->runtime();
-        std::shared_ptr<array> result = ary;
+    if (Op != kernels::arithmetic::divide &&
+        right.type == array::element_type::int64 &&
+        (scalar
+         ? scalar->is(number::number_type::integer)
+         : left.type == array::element_type::int64))
+    {
+      const auto result = int_array::make(runtime, right.size);
+      const ref<array> slot(result);
+      const bool fits = scalar
+        ? kernels::apply(
+          Op,
+          scalar->as_int(),
+          right.ints,
+          result->data(),
+          right.size
+        )
+        : kernels::apply(
+          Op,
+          left.ints,
+          right.ints,
+          result->data(),
+          right.size
+        );
 
-        for (number::int_type i = 1; i < count; ++i)
-        {
-          result = runtime->value<concat_array>(result, ary);
-        }
-        ctx->push(result);
-      }
-      else if (count == 0)
+      if (fits)
       {
-        ctx->push_array(nullptr, 0);
+        ctx->push(slot);
       } else {
-        ctx->error(error::code::range, U"Invalid repeat count.");
+        push_overflowed(ctx, Op, scalar, left, right);
       }
+      return;
     }
+
+    const auto result = real_array::make(runtime, right.size);
+    const ref<array> slot(result);
+
+    right.promote();
+    if (scalar)
+    {
+      kernels::apply(
+        Op,
+        scalar->as_real(),
+        right.reals,
+        result->data(),
+        right.size
+      );
+    } else {
+      left.promote();
+      kernels::apply(Op, left.reals, right.reals, result->data(), right.size);
+    }
+    ctx->push(slot);
   }
 
   /**
-   * Word: &
+   * Word: .=
    * Prototype: array
    *
    * Takes:
-   * - array
+   * - array|number
    * - array
    *
    * Gives:
    * - array
    *
-   * Set intersection: Returns a new array containing unique elements common to
-   * the two arrays.
+   * Compares numbers of the two arrays element by element and returns array
+   * of booleans telling whether they are equal. If a number is given instead
+   * of the first array, each element is compared against it. The .!=, .<,
+   * .>, .<= and .>= words perform the other comparisons in the same way.
    */
-  static void w_intersect(const std::shared_ptr<context>& ctx)
+  template<kernels::comparison Op>
+  static void w_compare_elements(const ref<context>& ctx)
   {
-    std::shared_ptr<array> a;
-    std::shared_ptr<array> b;
+    numeric_view left;
+    numeric_view right;
+    const number* scalar;
+    ref<value> scalar_slot;
+    std::unique_ptr<bool[]> flags;
 
-    if (ctx->pop_array(a) && ctx->pop_array(b))
+    if (!pop_operands(ctx, left, scalar, scalar_slot, right))
     {
-      std::vector<std::shared_ptr<value>> result;
+      return;
+    }
 
-      for (const auto& value1 : b)
+    flags.reset(new bool[right.size]);
+    if (right.type == array::element_type::int64 &&
+        (scalar
+         ? scalar->is(number::number_type::integer)
+         : left.type == array::element_type::int64))
+    {
+      if (scalar)
       {
-        bool found = false;
-
-        for (const auto& value2 : a)
-        {
-          if (value1 == value2)
-          {
-            found = true;
-            break;
-          }
-        }
-
-        if (!found)
-        {
-          continue;
-        }
-
-        for (const auto& value2 : result)
-        {
-          if (value1 == value2)
-          {
-            found = false;
-            break;
-          }
-        }
-
-        if (found)
-        {
-          result.push_back(value1);
-        }
+        kernels::compare(
+          Op,
+          scalar->as_int(),
+          right.ints,
+          flags.get(),
+          right.size
+        );
+      } else {
+        kernels::compare(Op, left.ints, right.ints, flags.get(), right.size);
+      }
+    } else {
+      right.promote();
+      if (scalar)
+      {
+        kernels::compare(
+          Op,
+          scalar->as_real(),
+          right.reals,
+          flags.get(),
+          right.size
+        );
+      } else {
+        left.promote();
+        kernels::compare(
+          Op,
+          left.reals,
+          right.reals,
+          flags.get(),
+          right.size
+        );
       }
-
-      ctx->push_array(result.data(), result.size());
     }
+    push_booleans(ctx, flags.get(), right.size);
   }
 
   /**
-   * Word: |
+   * Word: sum
    * Prototype: array
    *
    * Takes:
    * - array
-   * - array
    *
    * Gives:
-   * - array
+   * - number
    *
-   * Set union: Returns a new array by joining the two given arrays, excluding
-   * any duplicates and preserving the order of the given arrays.
+   * Sums up numbers of the array. Sum of an empty array is zero. Sum of
+   * integers is exact regardless of their order, and range error is thrown
+   * if it does not fit into an integer.
    */
-  static void w_union(const std::shared_ptr<context>& ctx)
+  static void w_sum(const ref<context>& ctx)
   {
-    std::shared_ptr<array> a;
-    std::shared_ptr<array> b;
+    ref<array> ary;
+    numeric_view view;
+    number::int_type result;
+    number::real_type real_result;
 
-    if (ctx->pop_array(a) && ctx->pop_array(b))
+    if (!ctx->pop_array(ary) || !unbox(ctx, ary, view))
     {
-      std::vector<std::shared_ptr<value>> result;
-
-      for (const auto& value1 : b)
-      {
-        bool found = false;
-
-        for (const auto& value2 : result)
-        {
-          if (value1 == value2)
-          {
-            found = true;
-            break;
-          }
-        }
-
-        if (!found)
-        {
-          result.push_back(value1);
-        }
-      }
-
-      for (const auto& value1 : a)
-      {
-        bool found = false;
-
-        for (const auto& value2 : result)
-        {
-          if (value1 == value2)
-          {
-            found = true;
-            break;
-          }
-        }
-
-        if (!found)
-        {
-          result.push_back(value1);
-        }
-      }
-
-      ctx->push_array(result.data(), result.size());
+      return;
+    }
+    else if (view.type != array::element_type::int64)
+    {
+      ctx->push_real(kernels::sum(view.reals, view.size));
+    }
+    else if (kernels::sum(view.ints, view.size, result, real_result))
+    {
+      ctx->push_int(result);
+    } else {
+      ctx->error(
+        error::code::range,
+        U"Sum " + to_unistring(real_result) + U" does not fit into an integer."
+      );
     }
   }
 
   /**
-   * Word: @
+   * Word: mean
    * Prototype: array
    *
    * Takes:
-   * - number
    * - array
    *
    * Gives:
-   * - array
-   * - any
+   * - number
    *
-   * Retrieves a value from the array at given numerical index. Negative
-   * indices count backwards from the end. If the given index is out of bounds,
-   * arange error will be thrown.
+   * Returns arithmetic mean of numbers of the array, which must not be
+   * empty.
    */
-  static void w_get(const std::shared_ptr<context>& ctx)
+  static void w_mean(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<number> num;
+    ref<array> ary;
+    numeric_view view;
+    number::int_type result;
+    number::real_type real_result;
 
-    if (ctx->pop_array(ary) && ctx->pop_number(num))
+    if (!ctx->pop_array(ary) || !unbox(ctx, ary, view))
     {
-      const auto size = ary->size();
-      number::int_type index = num->as_int();
-
-      if (index < 0)
-      {
-        index += ary->size();
-      }
-
-      ctx->push(ary);
-
-      if (!size || index < 0 || index >= static_cast<number::int_type>(size))
-      {
-        ctx->error(error::code::range, U"Array index out of bounds.");
-        return;
-      }
-
-      ctx->push(ary->at(index));
+      return;
+    }
+    else if (!view.size)
+    {
+      ctx->error(error::code::range, U"Cannot take mean of empty array.");
+      return;
+    }
+    else if (view.type != array::element_type::int64)
+    {
+      ctx->push_real(kernels::sum(view.reals, view.size) / view.size);
+    }
+    else if (kernels::sum(view.ints, view.size, result, real_result))
+    {
+      ctx->push_real(static_cast<number::real_type>(result) / view.size);
+    } else {
+      ctx->push_real(real_result / view.size);
     }
   }
 
   /**
-   * Word: !
+   * Word: min
    * Prototype: array
    *
    * Takes:
-   * - any
-   * - number
    * - array
    *
    * Gives:
+   * - number
+   *
+   * Returns the smallest number of the array, which must not be empty.
+   *
+   * Word: max
+   * Prototype: array
+   *
+   * Takes:
    * - array
    *
-   * Sets value in the array at given index. Negative indices count backwards
-   * from the end. If the index is larger than the number of elements in the
-   * array, the value will be appended as the last element of the array.
+   * Gives:
+   * - number
+   *
+   * Returns the largest number of the array, which must not be empty.
    */
-  static void w_set(const std::shared_ptr<context>& ctx)
+  template<bool Largest>
+  static void w_extreme(const ref<context>& ctx)
   {
-    std::shared_ptr<array> ary;
-    std::shared_ptr<number> num;
-    std::shared_ptr<value> val;
+    ref<array> ary;
+    numeric_view view;
 
-    if (ctx->pop_array(ary) && ctx->pop_number(num) && ctx->pop(val))
+    if (!ctx->pop_array(ary) || !unbox(ctx, ary, view))
     {
-      const auto size = ary->size();
-      number::int_type index = num->as_int();
-      std::vector<std::shared_ptr<value>> result;
-
-      if (index < 0)
-      {
-        index += size;
-      }
-
-      for (array::size_type i = 0;  i < size; ++i)
-      {
-        result.push_back(ary->at(i));
-      }
-
-      if (!size || index < 0 || index > static_cast<number::int_type>(size))
-      {
-        result.push_back(val);
-      } else {
-        result[index] = val;
-      }
+      return;
+    }
+    else if (!view.size)
+    {
+      ctx->error(
+        error::code::range,
+        Largest
+          ? U"Cannot take maximum of empty array."
+          : U"Cannot take minimum of empty array."
+      );
+    }
+    else if (view.type == array::element_type::int64)
+    {
+      ctx->push_int(
+        Largest
+          ? kernels::max(view.ints, view.size)
+          : kernels::min(view.ints, view.size)
+      );
+    } else {
+      ctx->push_real(
+        Largest
+          ? kernels::max(view.reals, view.size)
+          : kernels::min(view.reals, view.size)
+      );
+    }
+  }
 
-      ctx->push_array(result.data(), result.size());
+  /**
+   * Word: dot
+   * Prototype: array
+   *
+   * Takes:
+   * - array
+   * - array
+   *
+   * Gives:
+   * - number
+   *
+   * Returns dot product of numbers of the two arrays, which must be of the
+   * same length.
+   */
+  static void w_dot(const ref<context>& ctx)
+  {
+    ref<array> a;
+    ref<array> b;
+    numeric_view left;
+    numeric_view right;
+    number::int_type result;
+
+    if (!ctx->pop_array(b) ||
+        !ctx->pop_array(a) ||
+        !unbox(ctx, a, left) ||
+        !unbox(ctx, b, right))
+    {
+      return;
+    }
+    else if (left.size != right.size)
+    {
+      ctx->error(error::code::range, U"Array lengths do not match.");
+      return;
+    }
+    else if (left.type == array::element_type::int64 &&
+             right.type == array::element_type::int64 &&
+             kernels::dot(left.ints, right.ints, left.size, result))
+    {
+      ctx->push_int(result);
+      return;
     }
+    left.promote();
+    right.promote();
+    ctx->push_real(kernels::dot(left.reals, right.reals, left.size));
   }
 
   namespace api
@@ -1444,15 +3533,16 @@ namespace plorth
     {
       return
       {
-        { U"length", w_length },
+        { U"length", native::thunk<w_length> },
 
         // Modification.
         { U"push", w_push },
         { U"pop", w_pop },
 
         // Search methods.
-        { U"includes?", w_includes },
-        { U"index-of", w_index_of },
+        { U"includes?", native::thunk<w_includes> },
+        { U"index-of", native::thunk<w_index_of> },
+        { U"binary-search", w_binary_search },
         { U"find", w_find },
         { U"find-index", w_find_index },
         { U"every?", w_every },
@@ -1461,11 +3551,15 @@ namespace plorth
         // Conversions.
         { U"reverse", w_reverse },
         { U"uniq", w_uniq },
+        { U"sort", w_sort },
+        { U"sort-by", w_sort_by },
+        { U"sort-with", w_sort_with },
         { U"extract", w_extract },
         { U"join", w_join },
         { U"flatten", w_flatten },
         { U"nflatten", w_nflatten },
         { U">quote", w_to_quote },
+        { U">seq", w_to_seq },
 
         { U"for-each", w_for_each },
         { U"2for-each", w_2for_each },
@@ -1473,13 +3567,37 @@ namespace plorth
         { U"2map", w_2map },
         { U"filter", w_filter },
         { U"reduce", w_reduce },
+        { U"pmap", w_pmap },
+        { U"pfilter", w_pfilter },
+        { U"preduce", w_preduce },
 
         { U"+", w_concat },
         { U"*", w_repeat },
         { U"&", w_intersect },
         { U"|", w_union },
-        { U"@", w_get },
-        { U"!", w_set }
+        { U"@", native::thunk<w_get> },
+        { U"!", w_set },
+
+        // Numeric arrays.
+        { U">int64-array", w_to_int64_array },
+        { U">float64-array", w_to_float64_array },
+        { U">generic-array", w_to_generic_array },
+        { U"element-type", native::thunk<w_element_type> },
+        { U".+", w_elementwise<kernels::arithmetic::add> },
+        { U".-", w_elementwise<kernels::arithmetic::subtract> },
+        { U".*", w_elementwise<kernels::arithmetic::multiply> },
+        { U"./", w_elementwise<kernels::arithmetic::divide> },
+        { U".=", w_compare_elements<kernels::comparison::equal> },
+        { U".!=", w_compare_elements<kernels::comparison::not_equal> },
+        { U".<", w_compare_elements<kernels::comparison::less> },
+        { U".>", w_compare_elements<kernels::comparison::greater> },
+        { U".<=", w_compare_elements<kernels::comparison::less_equal> },
+        { U".>=", w_compare_elements<kernels::comparison::greater_equal> },
+        { U"sum", w_sum },
+        { U"mean", w_mean },
+        { U"min", w_extreme<false> },
+        { U"max", w_extreme<true> },
+        { U"dot", w_dot }
       };
     }
   }
@@ -24,6 +24,9 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <plorth/context.hpp>
+#include <plorth/native.hpp>
+
+#include "./utils.hpp"
 
 #include <peelo/unicode/encoding/utf8.hpp>
 
@@ -73,20 +76,28 @@ namespace plorth
     return U"Unknown error";
   }
 
-  bool error::equals(const std::shared_ptr<value>& that) const
+  bool error::equals(const ref<value>& that) const
   {
-    std::shared_ptr<error> err;
+    ref<error> err;
 
     if (!is(that, type::error))
     {
       return false;
     }
 
-    err = std::static_pointer_cast<error>(that);
+    err = ref_cast<error>(that);
 
     return m_code == err->m_code && !m_message.compare(err->m_message);
   }
 
+  std::size_t error::hash() const
+  {
+    return hash_combine(
+      static_cast<std::size_t>(m_code),
+      std::hash<std::u32string>()(m_message)
+    );
+  }
+
   std::u32string error::to_string() const
   {
     std::u32string result;
@@ -127,17 +138,9 @@ namespace plorth
    *
    * Returns error code extracted from the error in numeric form.
    */
-  static void w_code(const std::shared_ptr<context>& ctx)
+  static void w_code(const ref<context>& ctx, const error& err)
   {
-    std::shared_ptr<value> err;
-
-    if (ctx->pop(err, value::type::error))
-    {
-      ctx->push(err);
-      ctx->push_int(static_cast<number::int_type>(
-        std::static_pointer_cast<error>(err)->code()
-      ));
-    }
+    ctx->push_int(static_cast<number::int_type>(err.code()));
   }
 
   /**
@@ -154,21 +157,15 @@ namespace plorth
    * Returns error message extracted from the error, or null if the error does
    * not have any error message.
    */
-  static void w_message(const std::shared_ptr<context>& ctx)
+  static void w_message(const ref<context>& ctx, const error& err)
   {
-    std::shared_ptr<value> err;
+    const auto& message = err.message();
 
-    if (ctx->pop(err, value::type::error))
+    if (message.empty())
     {
-      const auto& message = std::static_pointer_cast<error>(err)->message();
-
-      ctx->push(err);
-      if (message.empty())
-      {
-        ctx->push_null();
-      } else {
-        ctx->push_string(message);
-      }
+      ctx->push_null();
+    } else {
+      ctx->push_string(message);
     }
   }
 
@@ -189,27 +186,21 @@ namespace plorth
    * Position is returned as object with `filename`, `line` and `column`
    * properties.
    */
-  static void w_position(const std::shared_ptr<context>& ctx)
+  static void w_position(const ref<context>& ctx, const error& err)
   {
-    std::shared_ptr<value> err;
+    const auto position = err.position();
 
-    if (ctx->pop(err, value::type::error))
+    if (position)
     {
-      const auto position = std::static_pointer_cast<error>(err)->position();
-
-      ctx->push(err);
-      if (position)
-      {
-        const auto& runtime = ctx->runtime();
-
-        ctx->push_object({
-          { U"filename", runtime->string(position->file) },
-          { U"line", runtime->number(number::int_type(position->line)) },
-          { U"column", runtime->number(number::int_type(position->column)) }
-        });
-      } else {
-        ctx->push_null();
-      }
+      const auto& runtime = ctx->runtime();
+
+      ctx->push_object({
+        { U"filename", runtime->string(position->file) },
+        { U"line", runtime->number(number::int_type(position->line)) },
+        { U"column", runtime->number(number::int_type(position->column)) }
+      });
+    } else {
+      ctx->push_null();
     }
   }
 
@@ -222,13 +213,13 @@ namespace plorth
    *
    * Sets given error as current error of the execution context.
    */
-  static void w_throw(const std::shared_ptr<context>& ctx)
+  static void w_throw(const ref<context>& ctx)
   {
-    std::shared_ptr<value> err;
+    ref<value> err;
 
     if (ctx->pop(err, value::type::error))
     {
-      ctx->error(std::static_pointer_cast<error>(err));
+      ctx->error(ref_cast<error>(err));
     }
   }
 
@@ -238,9 +229,9 @@ namespace plorth
     {
       return
       {
-        { U"code", w_code },
-        { U"message", w_message },
-        { U"position", w_position },
+        { U"code", native::thunk<w_code> },
+        { U"message", native::thunk<w_message> },
+        { U"position", native::thunk<w_position> },
         { U"throw", w_throw },
       };
     }
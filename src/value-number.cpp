@@ -24,6 +24,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <plorth/context.hpp>
+#include <plorth/native.hpp>
 
 #include "./utils.hpp"
 
@@ -107,15 +108,15 @@ namespace plorth
     };
   }
 
-  bool number::equals(const std::shared_ptr<class value>& that) const
+  bool number::equals(const ref<class value>& that) const
   {
-    std::shared_ptr<number> num;
+    ref<number> num;
 
     if (!value::is(that, type::number))
     {
       return false;
     }
-    num = std::static_pointer_cast<number>(that);
+    num = ref_cast<number>(that);
     if (is(number_type::real) || num->is(number_type::real))
     {
       return as_real() == num->as_real();
@@ -124,6 +125,16 @@ namespace plorth
     }
   }
 
+  std::size_t number::hash() const
+  {
+    // Integers are hashed through their floating point representation, as
+    // integers are equal to reals which represent the same number. Negative
+    // zero is equal to positive zero, so it's hashed as such.
+    const auto value = as_real();
+
+    return std::hash<real_type>()(value == 0.0 ? 0.0 : value);
+  }
+
   std::u32string number::to_string() const
   {
     if (is(number_type::real))
@@ -139,68 +150,48 @@ namespace plorth
     return to_string();
   }
 
-  std::shared_ptr<number> runtime::number(number::int_type value)
+  ref<number> runtime::number(number::int_type value)
   {
 #if PLORTH_ENABLE_INTEGER_CACHE
     static const int offset = 128;
 
-    if (value >= -128 && value <= 127)
+    // The cache is filled when the runtime is constructed, so that it's
+    // never modified while contexts of the runtime are being executed.
+    if (value >= -128 && value <= 127 && m_integer_cache[value + offset])
     {
-      const int index = value + offset;
-      auto reference = m_integer_cache[index];
-
-      if (!reference)
-      {
-        reference = std::shared_ptr<class number>(
-          new (*m_memory_manager) int_number(value)
-        );
-        m_integer_cache[index] = reference;
-      }
-
-      return reference;
+      return m_integer_cache[value + offset];
     }
 #endif
 
-    return std::shared_ptr<class number>(
-      new (*m_memory_manager) int_number(value)
-    );
+    return number::make(*m_memory_manager, value);
   }
 
-  std::shared_ptr<number> runtime::number(number::real_type value)
+  ref<number> runtime::number(number::real_type value)
   {
-    return std::shared_ptr<class number>(
-      new (*m_memory_manager) real_number(value)
-    );
+    return number::make(*m_memory_manager, value);
   }
 
-  std::shared_ptr<class number> runtime::number(const std::u32string& value)
+  ref<number> number::make(memory::manager& manager, int_type value)
   {
-    const auto dot_index = value.find('.');
-    const auto exponent_index_lower_case = value.find('e');
-    const auto exponent_index_upper_case = value.find('E');
-
-    if (
-      dot_index == std::u32string::npos &&
-      exponent_index_lower_case == std::u32string::npos &&
-      exponent_index_upper_case == std::u32string::npos
-    )
-    {
-      const number::int_type result = to_integer(value);
+    return ref<number>(new (manager) int_number(value));
+  }
 
-      if (result == false)
-      {
-        const number::real_type big_result = to_real(value);
+  ref<number> number::make(memory::manager& manager, real_type value)
+  {
+    return ref<number>(new (manager) real_number(value));
+  }
 
-        if (big_result != result)
-        {
-          return number(big_result);
-        }
-      }
+  ref<class number> runtime::number(const std::u32string& value)
+  {
+    number::int_type int_value;
+    number::real_type real_value;
 
-      return number(result);
-    } else {
-      return number(to_real(value));
+    if (to_number(value, int_value, real_value))
+    {
+      return number(int_value);
     }
+
+    return number(real_value);
   }
 
   /**
@@ -216,20 +207,9 @@ namespace plorth
    *
    * Returns true if given number is NaN.
    */
-  static void w_is_nan(const std::shared_ptr<context>& ctx)
+  static void w_is_nan(const ref<context>& ctx, number::real_type num)
   {
-    std::shared_ptr<number> num;
-
-    if (ctx->pop_number(num))
-    {
-      ctx->push(num);
-      if (num->is(number::number_type::real))
-      {
-        ctx->push_boolean(std::isnan(num->as_real()));
-      } else {
-        ctx->push_boolean(false);
-      }
-    }
+    ctx->push_boolean(std::isnan(num));
   }
 
   /**
@@ -245,20 +225,9 @@ namespace plorth
    *
    * Returns true if given number is finite.
    */
-  static void w_is_finite(const std::shared_ptr<context>& ctx)
+  static void w_is_finite(const ref<context>& ctx, number::real_type num)
   {
-    std::shared_ptr<number> num;
-
-    if (ctx->pop_number(num))
-    {
-      ctx->push(num);
-      if (num->is(number::number_type::real))
-      {
-        ctx->push_boolean(std::isfinite(num->as_real()));
-      } else {
-        ctx->push_boolean(true);
-      }
-    }
+    ctx->push_boolean(std::isfinite(num));
   }
 
   /**
@@ -271,14 +240,14 @@ namespace plorth
    *
    * Executes a quote given number of times.
    */
-  static void w_times(const std::shared_ptr<context>& ctx)
+  static void w_times(const ref<context>& ctx)
   {
-    std::shared_ptr<number> num;
-    std::shared_ptr<quote> quo;
+    cell num;
+    ref<quote> quo;
 
     if (ctx->pop_number(num) && ctx->pop_quote(quo))
     {
-      auto count = num->as_int();
+      auto count = num.as_int();
 
       if (count < 0)
       {
@@ -307,17 +276,17 @@ namespace plorth
    *
    * Returns absolute value of the number.
    */
-  static void w_abs(const std::shared_ptr<context>& ctx)
+  static void w_abs(const ref<context>& ctx)
   {
-    std::shared_ptr<number> num;
+    const cell* num;
 
-    if (ctx->pop_number(num))
+    if (ctx->peek_number(num))
     {
       if (num->is(number::number_type::real))
       {
-        ctx->push_real(std::fabs(num->as_real()));
+        ctx->replace_top(cell::make_real(std::fabs(num->as_real())));
       } else {
-        ctx->push_int(std::abs(num->as_int()));
+        ctx->replace_top(cell::make_int(std::abs(num->as_int())));
       }
     }
   }
@@ -334,18 +303,13 @@ namespace plorth
    *
    * Rounds given number to nearest integer value.
    */
-  static void w_round(const std::shared_ptr<context>& ctx)
+  static void w_round(const ref<context>& ctx)
   {
-    std::shared_ptr<number> num;
+    const cell* num;
 
-    if (ctx->pop_number(num))
+    if (ctx->peek_number(num) && num->is(number::number_type::real))
     {
-      if (num->is(number::number_type::real))
-      {
-        ctx->push_int(std::round(num->as_real()));
-      } else {
-        ctx->push(num);
-      }
+      ctx->replace_top(cell::make_int(std::round(num->as_real())));
     }
   }
 
@@ -361,18 +325,13 @@ namespace plorth
    *
    * Computes the smallest integer value not less than given number.
    */
-  static void w_ceil(const std::shared_ptr<context>& ctx)
+  static void w_ceil(const ref<context>& ctx)
   {
-    std::shared_ptr<number> num;
+    const cell* num;
 
-    if (ctx->pop_number(num))
+    if (ctx->peek_number(num) && num->is(number::number_type::real))
     {
-      if (num->is(number::number_type::real))
-      {
-        ctx->push_int(std::ceil(num->as_real()));
-      } else {
-        ctx->push(num);
-      }
+      ctx->replace_top(cell::make_int(std::ceil(num->as_real())));
     }
   }
 
@@ -388,18 +347,13 @@ namespace plorth
    *
    * Computes the largest integer value not greater than given number.
    */
-  static void w_floor(const std::shared_ptr<context>& ctx)
+  static void w_floor(const ref<context>& ctx)
   {
-    std::shared_ptr<number> num;
+    const cell* num;
 
-    if (ctx->pop_number(num))
+    if (ctx->peek_number(num) && num->is(number::number_type::real))
     {
-      if (num->is(number::number_type::real))
-      {
-        ctx->push_int(std::floor(num->as_real()));
-      } else {
-        ctx->push(num);
-      }
+      ctx->replace_top(cell::make_int(std::floor(num->as_real())));
     }
   }
 
@@ -416,18 +370,18 @@ namespace plorth
    *
    * Returns maximum of two numbers.
    */
-  static void w_max(const std::shared_ptr<context>& ctx)
+  static void w_max(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    cell a;
+    cell b;
 
     if (ctx->pop_number(b) && ctx->pop_number(a))
     {
-      if (a->is(number::number_type::real) || b->is(number::number_type::real))
+      if (a.is(number::number_type::real) || b.is(number::number_type::real))
       {
-        ctx->push(a->as_real() > b->as_real() ? a : b);
+        ctx->push(a.as_real() > b.as_real() ? a : b);
       } else {
-        ctx->push(a->as_int() > b->as_int() ? a : b);
+        ctx->push(a.as_int() > b.as_int() ? a : b);
       }
     }
   }
@@ -445,18 +399,18 @@ namespace plorth
    *
    * Returns minimum of two numbers.
    */
-  static void w_min(const std::shared_ptr<context>& ctx)
+  static void w_min(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    cell a;
+    cell b;
 
     if (ctx->pop_number(b) && ctx->pop_number(a))
     {
-      if (a->is(number::number_type::real) || b->is(number::number_type::real))
+      if (a.is(number::number_type::real) || b.is(number::number_type::real))
       {
-        ctx->push(a->as_real() < b->as_real() ? a : b);
+        ctx->push(a.as_real() < b.as_real() ? a : b);
       } else {
-        ctx->push(a->as_int() < b->as_int() ? a : b);
+        ctx->push(a.as_int() < b.as_int() ? a : b);
       }
     }
   }
@@ -475,21 +429,21 @@ namespace plorth
    *
    * Clamps the topmost number between the minimum and maximum limits.
    */
-  static void w_clamp(const std::shared_ptr<context>& ctx)
+  static void w_clamp(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
-    std::shared_ptr<number> c;
+    cell a;
+    cell b;
+    cell c;
 
     if (ctx->pop_number(c) && ctx->pop_number(b) && ctx->pop_number(a))
     {
-      if (a->is(number::number_type::real)
-          || b->is(number::number_type::real)
-          || c->is(number::number_type::real))
+      if (a.is(number::number_type::real)
+          || b.is(number::number_type::real)
+          || c.is(number::number_type::real))
       {
-        const number::real_type min = a->as_real();
-        const number::real_type max = b->as_real();
-        number::real_type number = c->as_real();
+        const number::real_type min = a.as_real();
+        const number::real_type max = b.as_real();
+        number::real_type number = c.as_real();
 
         if (number > max)
         {
@@ -501,9 +455,9 @@ namespace plorth
         }
         ctx->push_real(number);
       } else {
-        const auto min = a->as_int();
-        const auto max = b->as_int();
-        auto number = c->as_int();
+        const auto min = a.as_int();
+        const auto max = b.as_int();
+        auto number = c.as_int();
 
         if (number > max)
         {
@@ -533,27 +487,27 @@ namespace plorth
    * Tests whether the topmost number is in range of given minimum and maximum
    * numbers.
    */
-  static void w_is_in_range(const std::shared_ptr<context>& ctx)
+  static void w_is_in_range(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
-    std::shared_ptr<number> c;
+    cell a;
+    cell b;
+    cell c;
 
     if (ctx->pop_number(c) && ctx->pop_number(b) && ctx->pop_number(a))
     {
-      if (a->is(number::number_type::real)
-          || b->is(number::number_type::real)
-          || c->is(number::number_type::real))
+      if (a.is(number::number_type::real)
+          || b.is(number::number_type::real)
+          || c.is(number::number_type::real))
       {
-        const number::real_type min = a->as_real();
-        const number::real_type max = b->as_real();
-        const number::real_type number = c->as_real();
+        const number::real_type min = a.as_real();
+        const number::real_type max = b.as_real();
+        const number::real_type number = c.as_real();
 
         ctx->push_boolean(number >= min && number <= max);
       } else {
-        const number::int_type min = a->as_int();
-        const number::int_type max = b->as_int();
-        const number::int_type number = c->as_int();
+        const number::int_type min = a.as_int();
+        const number::int_type max = b.as_int();
+        const number::int_type number = c.as_int();
 
         ctx->push_boolean(number >= min && number <= max);
       }
@@ -562,16 +516,16 @@ namespace plorth
 
   template<class RealOperation, class IntOperation>
   static void number_op(
-    const std::shared_ptr<context>& ctx,
+    const ref<context>& ctx,
     const RealOperation& real_op,
     const IntOperation& int_op
   )
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    const cell* a;
+    const cell* b;
     number::real_type result;
 
-    if (!ctx->pop_number(b) || !ctx->pop_number(a))
+    if (!ctx->peek_number(b) || !ctx->peek_number(a, 1))
     {
       return;
     }
@@ -583,13 +537,17 @@ namespace plorth
         std::fabs(result) <= number::int_max)
     {
       // Repeat the operation with full integer precision
-      ctx->push_int(int_op(a->as_int(), b->as_int()));
+      const auto int_result = int_op(a->as_int(), b->as_int());
+
+      ctx->nip();
+      ctx->replace_top(cell::make_int(int_result));
       return;
     }
 
     // Otherwise keep it real as it seems to be integer overflow or either of
     // the arguments are real numbers.
-    ctx->push_real(result);
+    ctx->nip();
+    ctx->replace_top(cell::make_real(result));
   }
 
   /**
@@ -605,7 +563,7 @@ namespace plorth
    *
    * Performs addition on the two given numbers.
    */
-  static void w_add(const std::shared_ptr<context>& ctx)
+  static void w_add(const ref<context>& ctx)
   {
     number_op(ctx, std::plus<number::real_type>(), std::plus<number::int_type>());
   }
@@ -623,7 +581,7 @@ namespace plorth
    *
    * Subtracts the second number from the first and returns the result.
    */
-  static void w_sub(const std::shared_ptr<context>& ctx)
+  static void w_sub(const ref<context>& ctx)
   {
     number_op(ctx, std::minus<number::real_type>(), std::minus<number::int_type>());
   }
@@ -641,7 +599,7 @@ namespace plorth
    *
    * Performs multiplication on the two given numbers.
    */
-  static void w_mul(const std::shared_ptr<context>& ctx)
+  static void w_mul(const ref<context>& ctx)
   {
     number_op(ctx, std::multiplies<number::real_type>(), std::multiplies<number::int_type>());
   }
@@ -659,14 +617,14 @@ namespace plorth
    *
    * Divides the first number by the second and returns the result.
    */
-  static void w_div(const std::shared_ptr<context>& ctx)
+  static void w_div(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    cell a;
+    cell b;
 
     if (ctx->pop_number(b) && ctx->pop_number(a))
     {
-      ctx->push_real(a->as_real() / b->as_real());
+      ctx->push_real(a.as_real() / b.as_real());
     }
   }
 
@@ -684,18 +642,18 @@ namespace plorth
    * Computes the modulo of the first number with respect to the second number
    * i.e. the remainder after floor division.
    */
-  static void w_mod(const std::shared_ptr<context>& ctx)
+  static void w_mod(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    cell a;
+    cell b;
     number::real_type dividend;
     number::real_type divider;
     number::real_type result;
 
     if (ctx->pop_number(b) && ctx->pop_number(a))
     {
-      dividend = a->as_real();
-      divider = b->as_real();
+      dividend = a.as_real();
+      divider = b.as_real();
       result = std::fmod(dividend, divider);
       if (std::signbit(dividend) != std::signbit(divider)) {
          result += divider;
@@ -705,15 +663,15 @@ namespace plorth
   }
 
   template<typename Operation >
-  static void number_bit_op(const std::shared_ptr<context>& ctx,
+  static void number_bit_op(const ref<context>& ctx,
                             const Operation& op)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    cell a;
+    cell b;
 
     if (ctx->pop_number(b) && ctx->pop_number(a))
     {
-      ctx->push_int(op(a->as_int(), b->as_int()));
+      ctx->push_int(op(a.as_int(), b.as_int()));
     }
   }
 
@@ -730,7 +688,7 @@ namespace plorth
    *
    * Performs bitwise and on the two given numbers.
    */
-  static void w_bit_and(const std::shared_ptr<context>& ctx)
+  static void w_bit_and(const ref<context>& ctx)
   {
     number_bit_op(ctx, std::bit_and<number::int_type>());
   }
@@ -748,7 +706,7 @@ namespace plorth
    *
    * Performs bitwise or on the two given numbers.
    */
-  static void w_bit_or(const std::shared_ptr<context>& ctx)
+  static void w_bit_or(const ref<context>& ctx)
   {
     number_bit_op(ctx, std::bit_or<number::int_type>());
   }
@@ -766,7 +724,7 @@ namespace plorth
    *
    * Performs bitwise xor on the two given numbers.
    */
-  static void w_bit_xor(const std::shared_ptr<context>& ctx)
+  static void w_bit_xor(const ref<context>& ctx)
   {
     number_bit_op(ctx, std::bit_xor<number::int_type>());
   }
@@ -784,14 +742,14 @@ namespace plorth
    *
    * Returns the first value with bits shifted right by the second value.
    */
-  static void w_shift_right(const std::shared_ptr<context>& ctx)
+  static void w_shift_right(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    cell a;
+    cell b;
 
     if (ctx->pop_number(b) && ctx->pop_number(a))
     {
-      ctx->push_int(a->as_int() >> b->as_int());
+      ctx->push_int(a.as_int() >> b.as_int());
     }
   }
 
@@ -808,14 +766,14 @@ namespace plorth
    *
    * Returns the first value with bits shifted left by the second value.
    */
-  static void w_shift_left(const std::shared_ptr<context>& ctx)
+  static void w_shift_left(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    cell a;
+    cell b;
 
     if (ctx->pop_number(b) && ctx->pop_number(a))
     {
-      ctx->push_int(a->as_int() << b->as_int());
+      ctx->push_int(a.as_int() << b.as_int());
     }
   }
 
@@ -831,13 +789,13 @@ namespace plorth
    *
    * Flips the bits of the value.
    */
-  static void w_bit_not(const std::shared_ptr<context>& ctx)
+  static void w_bit_not(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
+    cell a;
 
     if (ctx->pop_number(a))
     {
-      ctx->push_int(~a->as_int());
+      ctx->push_int(~a.as_int());
     }
   }
 
@@ -854,18 +812,18 @@ namespace plorth
    *
    * Returns true if the first number is less than the second one.
    */
-  static void w_lt(const std::shared_ptr<context>& ctx)
+  static void w_lt(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    cell a;
+    cell b;
 
     if (ctx->pop_number(b) && ctx->pop_number(a))
     {
-      if (a->is(number::number_type::real) || b->is(number::number_type::real))
+      if (a.is(number::number_type::real) || b.is(number::number_type::real))
       {
-        ctx->push_boolean(a->as_real() < b->as_real());
+        ctx->push_boolean(a.as_real() < b.as_real());
       } else {
-        ctx->push_boolean(a->as_int() < b->as_int());
+        ctx->push_boolean(a.as_int() < b.as_int());
       }
     }
   }
@@ -883,18 +841,18 @@ namespace plorth
    *
    * Returns true if the first number is greater than the second one.
    */
-  static void w_gt(const std::shared_ptr<context>& ctx)
+  static void w_gt(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    cell a;
+    cell b;
 
     if (ctx->pop_number(b) && ctx->pop_number(a))
     {
-      if (a->is(number::number_type::real) || b->is(number::number_type::real))
+      if (a.is(number::number_type::real) || b.is(number::number_type::real))
       {
-        ctx->push_boolean(a->as_real() > b->as_real());
+        ctx->push_boolean(a.as_real() > b.as_real());
       } else {
-        ctx->push_boolean(a->as_int() > b->as_int());
+        ctx->push_boolean(a.as_int() > b.as_int());
       }
     }
   }
@@ -912,18 +870,18 @@ namespace plorth
    *
    * Returns true if the first number is less than or equal to the second one.
    */
-  static void w_lte(const std::shared_ptr<context>& ctx)
+  static void w_lte(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    cell a;
+    cell b;
 
     if (ctx->pop_number(b) && ctx->pop_number(a))
     {
-      if (a->is(number::number_type::real) || b->is(number::number_type::real))
+      if (a.is(number::number_type::real) || b.is(number::number_type::real))
       {
-        ctx->push_boolean(a->as_real() <= b->as_real());
+        ctx->push_boolean(a.as_real() <= b.as_real());
       } else {
-        ctx->push_boolean(a->as_int() <= b->as_int());
+        ctx->push_boolean(a.as_int() <= b.as_int());
       }
     }
   }
@@ -942,18 +900,18 @@ namespace plorth
    * Returns true if the first number is greater than or equal to the second
    * one.
    */
-  static void w_gte(const std::shared_ptr<context>& ctx)
+  static void w_gte(const ref<context>& ctx)
   {
-    std::shared_ptr<number> a;
-    std::shared_ptr<number> b;
+    cell a;
+    cell b;
 
     if (ctx->pop_number(b) && ctx->pop_number(a))
     {
-      if (a->is(number::number_type::real) || b->is(number::number_type::real))
+      if (a.is(number::number_type::real) || b.is(number::number_type::real))
       {
-        ctx->push_boolean(a->as_real() >= b->as_real());
+        ctx->push_boolean(a.as_real() >= b.as_real());
       } else {
-        ctx->push_boolean(a->as_int() >= b->as_int());
+        ctx->push_boolean(a.as_int() >= b.as_int());
       }
     }
   }
@@ -964,8 +922,8 @@ namespace plorth
     {
       return
       {
-        { U"nan?", w_is_nan },
-        { U"finite?", w_is_finite },
+        { U"nan?", native::thunk<w_is_nan> },
+        { U"finite?", native::thunk<w_is_finite> },
 
         { U"times", w_times },
 
@@ -24,35 +24,110 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <plorth/context.hpp>
+#include <plorth/native.hpp>
 #include <plorth/value-string.hpp>
 
+#include "./shape.hpp"
 #include "./utils.hpp"
 
+#include <bitset>
+#include <new>
+
 namespace plorth
 {
   namespace
   {
-    class simple_object : public object
+    /** Number of hash bits consumed by each level of the trie. */
+    static const unsigned int hamt_bits = 5;
+    static const std::uint32_t hamt_mask = (1 << hamt_bits) - 1;
+
+    /**
+     * Node of the hash array mapped trie. Each of the 32 possible hash
+     * fragments of the node maps either to a property stored directly in the
+     * node or to a child node, which is told apart by the two bitmaps. Both
+     * properties and children are stored in compact vectors in the order of
+     * their hash fragments.
+     */
+    struct hamt_node : public memory::managed
     {
-    public:
-      using container_type = std::unordered_map<key_type, mapped_type>;
+      std::uint32_t datamap = 0;
+      std::uint32_t nodemap = 0;
+      std::vector<object::value_type> entries;
+      std::vector<ref<hamt_node>> children;
+    };
+
+    /**
+     * Atom IDs are unique, so they are used as hashes of the property names
+     * directly. This way two different keys never have an identical hash.
+     */
+    static inline std::uint32_t hamt_hash(const object::key_type& key)
+    {
+      return static_cast<std::uint32_t>(key.id());
+    }
+
+    static inline std::uint32_t hamt_bit(std::uint32_t hash,
+                                         unsigned int shift)
+    {
+      return static_cast<std::uint32_t>(1) << ((hash >> shift) & hamt_mask);
+    }
+
+    /**
+     * Returns position of the slot which corresponds to given bit in the
+     * compact vector described by given bitmap.
+     */
+    static inline std::size_t hamt_index(std::uint32_t bitmap,
+                                         std::uint32_t bit)
+    {
+      return std::bitset<32>(bitmap & (bit - 1)).count();
+    }
+
+    static const object::mapped_type* hamt_find(const hamt_node* node,
+                                                const object::key_type& key)
+    {
+      const auto hash = hamt_hash(key);
 
-      template<class InputIt>
-      explicit simple_object(InputIt first, InputIt last)
-        : m_container(first, last) {}
+      for (unsigned int shift = 0; node; shift += hamt_bits)
+      {
+        const auto bit = hamt_bit(hash, shift);
+
+        if (node->datamap & bit)
+        {
+          const auto& entry = node->entries[hamt_index(node->datamap, bit)];
+
+          return entry.first == key ? &entry.second : nullptr;
+        }
+        else if (!(node->nodemap & bit))
+        {
+          break;
+        }
+        node = node->children[hamt_index(node->nodemap, bit)].get();
+      }
+
+      return nullptr;
+    }
+
+    /**
+     * Persistent hash array mapped trie which is the default object
+     * implementation. Modified versions of the object share all untouched
+     * nodes of the trie with the original.
+     */
+    class hamt_object : public object
+    {
+    public:
+      explicit hamt_object(size_type size, const ref<hamt_node>& root)
+        : m_size(size)
+        , m_root(root) {}
 
       bool has_own_property(const key_type& key) const
       {
-        return m_container.find(key) != std::end(m_container);
+        return !!hamt_find(m_root.get(), key);
       }
 
       bool own_property(const key_type& key, mapped_type& slot) const
       {
-        const auto property = m_container.find(key);
-
-        if (property != std::end(m_container))
+        if (const auto value = hamt_find(m_root.get(), key))
         {
-          slot = property->second;
+          slot = *value;
 
           return true;
         }
@@ -60,268 +135,539 @@ namespace plorth
         return false;
       }
 
-      size_type size() const
+      inline size_type size() const
       {
-        return m_container.size();
+        return m_size;
       }
 
-      std::vector<key_type> keys() const
+      inline const ref<hamt_node>& root() const
       {
-        std::vector<key_type> result;
-
-        result.reserve(m_container.size());
-        for (const auto& property : m_container)
-        {
-          result.push_back(property.first);
-        }
-
-        return result;
+        return m_root;
       }
 
-      std::vector<mapped_type> values() const
+    protected:
+      bool for_each_property(visitor callback, void* data) const
       {
-        std::vector<mapped_type> result;
+        return !m_root || for_each_property(m_root.get(), callback, data);
+      }
 
-        result.reserve(m_container.size());
-        for (const auto& property : m_container)
+    private:
+      static bool for_each_property(const hamt_node* node,
+                                    visitor callback,
+                                    void* data)
+      {
+        for (const auto& entry : node->entries)
         {
-          result.push_back(property.second);
+          if (!callback(data, entry.first, entry.second))
+          {
+            return false;
+          }
+        }
+        for (const auto& child : node->children)
+        {
+          if (!for_each_property(child.get(), callback, data))
+          {
+            return false;
+          }
         }
 
-        return result;
-      }
-
-      std::vector<value_type> entries() const
-      {
-        return std::vector<value_type>(
-          std::begin(m_container),
-          std::end(m_container)
-        );
+        return true;
       }
 
     private:
-      const container_type m_container;
+      const size_type m_size;
+      const ref<hamt_node> m_root;
     };
 
-    class set_object : public object
+    /**
+     * Constructs new persistent objects, either from scratch or by modifying
+     * an existing one. Nodes which are referenced only by the builder are
+     * modified in place, while shared nodes are copied before they are
+     * modified.
+     */
+    class hamt_builder
     {
     public:
-      explicit set_object(const std::shared_ptr<class object>& object,
-                          const key_type& key,
-                          const mapped_type& value)
-        : m_object(object)
-        , m_key(key)
-        , m_value(value) {}
+      explicit hamt_builder(memory::manager& manager)
+        : m_manager(manager)
+        , m_size(0) {}
+
+      explicit hamt_builder(memory::manager& manager,
+                            const hamt_object& object)
+        : m_manager(manager)
+        , m_size(object.size())
+        , m_root(object.root()) {}
+
+      /**
+       * Returns builder which continues from properties of given object. Trie
+       * of persistent objects is shared, other objects are copied.
+       */
+      static hamt_builder from(memory::manager& manager,
+                               const ref<object>& obj)
+      {
+        if (const auto hamt = dynamic_cast<const hamt_object*>(obj.get()))
+        {
+          return hamt_builder(manager, *hamt);
+        } else {
+          hamt_builder builder(manager);
 
-      bool has_own_property(const key_type& key) const
+          obj->for_each([&builder](const object::key_type& key,
+                                   const object::mapped_type& value)
+          {
+            builder.set(key, value);
+          });
+
+          return builder;
+        }
+      }
+
+      inline object::size_type size() const
       {
-        return key == m_key || m_object->has_own_property(key);
+        return m_size;
       }
 
-      bool own_property(const key_type& key, mapped_type& slot) const
+      inline bool has(const object::key_type& key) const
       {
-        if (key == m_key)
+        return !!hamt_find(m_root.get(), key);
+      }
+
+      /**
+       * Introduces new property or replaces value of an existing one.
+       */
+      void set(const object::key_type& key, const object::mapped_type& value)
+      {
+        if (insert(m_root, key, value, hamt_hash(key), 0))
         {
-          slot = m_value;
+          ++m_size;
+        }
+      }
 
-          return true;
+      /**
+       * Removes property with given name, if the object has one.
+       *
+       * \return Boolean flag which tells whether the property was removed.
+       */
+      bool erase(const object::key_type& key)
+      {
+        if (!has(key))
+        {
+          return false;
         }
+        remove(m_root, key, hamt_hash(key), 0);
+        --m_size;
 
-        return m_object->own_property(key, slot);
+        return true;
       }
 
-      size_type size() const
+      /**
+       * Constructs persistent object from current contents of the builder.
+       */
+      ref<object> build() const
       {
-        return m_object->size() + 1;
+        return ref<object>(new (m_manager) hamt_object(m_size, m_root));
       }
 
-      std::vector<key_type> keys() const
+    private:
+      hamt_node* unique_node(ref<hamt_node>& node)
       {
-        auto keys = m_object->keys();
+        if (!node)
+        {
+          node = ref<hamt_node>(new (m_manager) hamt_node());
+        }
+        else if (node->ref_count() > 1)
+        {
+          const auto copy = new (m_manager) hamt_node();
 
-        keys.push_back(m_key);
+          copy->datamap = node->datamap;
+          copy->nodemap = node->nodemap;
+          copy->entries = node->entries;
+          copy->children = node->children;
+          node = ref<hamt_node>(copy);
+        }
 
-        return keys;
+        return node.get();
       }
 
-      std::vector<mapped_type> values() const
+      bool insert(ref<hamt_node>& node,
+                  const object::key_type& key,
+                  const object::mapped_type& value,
+                  std::uint32_t hash,
+                  unsigned int shift)
       {
-        auto values = m_object->values();
+        const auto n = unique_node(node);
+        const auto bit = hamt_bit(hash, shift);
+
+        if (n->datamap & bit)
+        {
+          const auto index = hamt_index(n->datamap, bit);
+          auto& entry = n->entries[index];
+
+          if (entry.first == key)
+          {
+            entry.second = value;
+
+            return false;
+          }
+
+          // Hash fragments of two properties collide, so both of them are
+          // pushed down into a new child node.
+          auto child = merge(
+            entry,
+            hamt_hash(entry.first),
+            object::value_type(key, value),
+            hash,
+            shift + hamt_bits
+          );
+
+          n->entries.erase(std::begin(n->entries) + index);
+          n->datamap ^= bit;
+          n->children.insert(
+            std::begin(n->children) + hamt_index(n->nodemap, bit),
+            std::move(child)
+          );
+          n->nodemap |= bit;
 
-        values.push_back(m_value);
+          return true;
+        }
+        else if (n->nodemap & bit)
+        {
+          return insert(
+            n->children[hamt_index(n->nodemap, bit)],
+            key,
+            value,
+            hash,
+            shift + hamt_bits
+          );
+        }
+        n->entries.insert(
+          std::begin(n->entries) + hamt_index(n->datamap, bit),
+          object::value_type(key, value)
+        );
+        n->datamap |= bit;
 
-        return values;
+        return true;
       }
 
-      std::vector<value_type> entries() const
+      ref<hamt_node> merge(const object::value_type& a,
+                           std::uint32_t a_hash,
+                           const object::value_type& b,
+                           std::uint32_t b_hash,
+                           unsigned int shift)
       {
-        auto entries = m_object->entries();
+        const auto node = new (m_manager) hamt_node();
+        const auto a_bit = hamt_bit(a_hash, shift);
+        const auto b_bit = hamt_bit(b_hash, shift);
 
-        entries.push_back({ m_key, m_value });
+        if (a_bit == b_bit)
+        {
+          node->nodemap = a_bit;
+          node->children.push_back(
+            merge(a, a_hash, b, b_hash, shift + hamt_bits)
+          );
+        } else {
+          node->datamap = a_bit | b_bit;
+          if (a_bit < b_bit)
+          {
+            node->entries.push_back(a);
+            node->entries.push_back(b);
+          } else {
+            node->entries.push_back(b);
+            node->entries.push_back(a);
+          }
+        }
 
-        return entries;
+        return ref<hamt_node>(node);
+      }
+
+      /**
+       * Removes property which is known to exist in the trie. Child nodes
+       * which are left with just a single property are inlined into their
+       * parent, so that the trie stays as shallow as possible.
+       */
+      void remove(ref<hamt_node>& node,
+                  const object::key_type& key,
+                  std::uint32_t hash,
+                  unsigned int shift)
+      {
+        const auto n = unique_node(node);
+        const auto bit = hamt_bit(hash, shift);
+
+        if (n->datamap & bit)
+        {
+          n->entries.erase(
+            std::begin(n->entries) + hamt_index(n->datamap, bit)
+          );
+          n->datamap ^= bit;
+        } else {
+          const auto index = hamt_index(n->nodemap, bit);
+          auto& child = n->children[index];
+
+          remove(child, key, hash, shift + hamt_bits);
+          if (child->children.empty() && child->entries.size() == 1)
+          {
+            const auto entry = child->entries[0];
+
+            n->children.erase(std::begin(n->children) + index);
+            n->nodemap ^= bit;
+            n->entries.insert(
+              std::begin(n->entries) + hamt_index(n->datamap, bit),
+              entry
+            );
+            n->datamap |= bit;
+          }
+        }
       }
 
     private:
-      const std::shared_ptr<object> m_object;
-      const key_type m_key;
-      const mapped_type m_value;
+      memory::manager& m_manager;
+      object::size_type m_size;
+      ref<hamt_node> m_root;
     };
 
-    class set_object_override : public object
+    /**
+     * Object which stores values of its properties in a flat array, laid out
+     * according to a shape shared with other objects that have the same
+     * properties. The values are allocated from the same memory block, right
+     * after the object itself.
+     */
+    class shaped_object : public object
     {
     public:
-      explicit set_object_override(const std::shared_ptr<class object>& object,
-                                   const key_type& key,
-                                   const mapped_type& value)
-        : m_object(object)
-        , m_key(key)
-        , m_value(value) {}
+      /**
+       * Constructs shaped object from given shape and values of each slot
+       * described by the shape.
+       */
+      static ref<object> make(memory::manager& manager,
+                              const ref<class shape>& shape,
+                              const mapped_type* values)
+      {
+        void* memory = memory::managed::operator new(
+          sizeof(shaped_object) + sizeof(mapped_type) * shape->size(),
+          manager
+        );
+
+        return ref<object>(::new (memory) shaped_object(shape, values));
+      }
+
+      ~shaped_object()
+      {
+        const auto size = m_shape->size();
+        const auto values = slots();
+
+        for (size_type i = 0; i < size; ++i)
+        {
+          values[i].~mapped_type();
+        }
+      }
 
       bool has_own_property(const key_type& key) const
       {
-        return key == m_key || m_object->has_own_property(key);
+        shape::size_type index;
+
+        return m_shape->find(key, index);
       }
 
       bool own_property(const key_type& key, mapped_type& slot) const
       {
-        if (key == m_key)
+        shape::size_type index;
+
+        if (m_shape->find(key, index))
         {
-          slot = m_value;
+          slot = slots()[index];
 
           return true;
         }
 
-        return m_object->own_property(key, slot);
+        return false;
       }
 
-      size_type size() const
+      inline size_type size() const
       {
-        return m_object->size();
+        return m_shape->size();
       }
 
-      std::vector<key_type> keys() const
+      inline const ref<class shape>& shape() const
       {
-        return m_object->keys();
+        return m_shape;
       }
 
-      std::vector<mapped_type> values() const
+      inline const mapped_type* slots() const
       {
-        std::vector<mapped_type> result;
+        return reinterpret_cast<const mapped_type*>(this + 1);
+      }
+
+    protected:
+      bool for_each_property(visitor callback, void* data) const
+      {
+        const auto size = m_shape->size();
+        const auto values = slots();
 
-        result.reserve(m_object->size());
-        for (const auto& property : m_object->entries())
+        for (size_type i = 0; i < size; ++i)
         {
-          if (property.first == m_key)
+          if (!callback(data, m_shape->key(i), values[i]))
           {
-            result.push_back(m_value);
-          } else {
-            result.push_back(property.second);
+            return false;
           }
         }
 
-        return result;
+        return true;
       }
 
-      std::vector<value_type> entries() const
+    private:
+      explicit shaped_object(const ref<class shape>& shape,
+                             const mapped_type* values)
+        : m_shape(shape)
       {
-        std::vector<value_type> result;
+        const auto size = shape->size();
+        const auto slots = reinterpret_cast<mapped_type*>(this + 1);
 
-        result.reserve(m_object->size());
-        for (const auto& property : m_object->entries())
+        for (size_type i = 0; i < size; ++i)
         {
-          if (property.first == m_key)
-          {
-            result.push_back({ m_key, m_value });
-          } else {
-            result.push_back(property);
-          }
+          new (slots + i) mapped_type(values[i]);
         }
-
-        return result;
       }
 
     private:
-      const std::shared_ptr<object> m_object;
-      const key_type m_key;
-      const mapped_type m_value;
+      const ref<class shape> m_shape;
     };
 
-    class delete_object : public object
+    /**
+     * Constructs new objects, either from scratch or by modifying an existing
+     * one. Objects are kept in shaped form as long as their layout fits into
+     * a shape. Once a property is deleted or the shape limits are exceeded,
+     * the object is switched into dictionary mode, where the properties are
+     * stored in a hash array mapped trie instead.
+     */
+    class object_builder
     {
     public:
-      explicit delete_object(const std::shared_ptr<class object>& object,
-                             const key_type& removed_key)
-        : m_object(object)
-        , m_removed_key(removed_key) {}
-
-      bool has_own_property(const key_type& key) const
+      explicit object_builder(memory::manager& manager,
+                              const ref<class shape>& shape)
+        : m_manager(manager)
+        , m_shape(shape)
+        , m_dictionary(manager) {}
+
+      /**
+       * Returns builder which continues from properties of given object.
+       */
+      static object_builder from(memory::manager& manager,
+                                 const ref<object>& obj)
       {
-        return m_removed_key != key && m_object->has_own_property(key);
+        if (const auto shaped = dynamic_cast<const shaped_object*>(obj.get()))
+        {
+          object_builder builder(manager, shaped->shape());
+
+          builder.m_slots.assign(
+            shaped->slots(),
+            shaped->slots() + shaped->size()
+          );
+
+          return builder;
+        }
+
+        return object_builder(manager, hamt_builder::from(manager, obj));
       }
 
-      bool own_property(const key_type& key, mapped_type& slot) const
+      bool has(const object::key_type& key) const
       {
-        return key != m_removed_key && m_object->own_property(key, slot);
+        shape::size_type index;
+
+        return m_shape ? m_shape->find(key, index) : m_dictionary.has(key);
       }
 
-      size_type size() const
+      /**
+       * Introduces new property or replaces value of an existing one.
+       */
+      void set(const object::key_type& key, const object::mapped_type& value)
       {
-        return m_object->size() - 1;
+        if (m_shape)
+        {
+          shape::size_type index;
+
+          if (m_shape->find(key, index))
+          {
+            m_slots[index] = value;
+
+            return;
+          }
+          else if (auto next = m_shape->transition(m_manager, key))
+          {
+            m_shape = std::move(next);
+            m_slots.push_back(value);
+
+            return;
+          }
+          to_dictionary();
+        }
+        m_dictionary.set(key, value);
       }
 
-      std::vector<key_type> keys() const
+      /**
+       * Removes property with given name, if the object has one.
+       *
+       * \return Boolean flag which tells whether the property was removed.
+       */
+      bool erase(const object::key_type& key)
       {
-        std::vector<key_type> result;
-
-        for (const auto& key : m_object->keys())
+        if (m_shape)
         {
-          if (key != m_removed_key)
+          if (!has(key))
           {
-            result.push_back(key);
+            return false;
           }
+          to_dictionary();
         }
 
-        return result;
+        return m_dictionary.erase(key);
       }
 
-      std::vector<mapped_type> values() const
+      /**
+       * Constructs object from current contents of the builder.
+       */
+      ref<object> build() const
       {
-        std::vector<mapped_type> result;
-
-        for (const auto& property : m_object->entries())
+        if (m_shape)
         {
-          if (property.first != m_removed_key)
-          {
-            result.push_back(property.second);
-          }
+          return shaped_object::make(m_manager, m_shape, m_slots.data());
         }
 
-        return result;
+        return m_dictionary.build();
       }
 
-      std::vector<value_type> entries() const
+    private:
+      explicit object_builder(memory::manager& manager,
+                              const hamt_builder& dictionary)
+        : m_manager(manager)
+        , m_dictionary(dictionary) {}
+
+      void to_dictionary()
       {
-        std::vector<value_type> result;
+        const auto size = m_shape->size();
 
-        for (const auto& property : m_object->entries())
+        for (shape::size_type i = 0; i < size; ++i)
         {
-          if (property.first != m_removed_key)
-          {
-            result.push_back(property);
-          }
+          m_dictionary.set(m_shape->key(i), m_slots[i]);
         }
-
-        return result;
+        m_shape.reset();
+        m_slots.clear();
       }
 
     private:
-      const std::shared_ptr<object> m_object;
-      const key_type m_removed_key;
+      memory::manager& m_manager;
+      /** Shape of the object, or null reference in dictionary mode. */
+      ref<class shape> m_shape;
+      std::vector<object::mapped_type> m_slots;
+      hamt_builder m_dictionary;
     };
   }
 
-  bool object::has_property(const std::shared_ptr<class runtime>& runtime,
+  /** Counter used for generating identifiers for objects. */
+  static std::atomic<object::id_type> last_id(0);
+
+  object::object()
+    : m_id(++last_id) {}
+
+  bool object::has_property(const ref<class runtime>& runtime,
                             const key_type& key) const
   {
     if (!has_own_property(key))
@@ -339,7 +685,7 @@ namespace plorth
     return true;
   }
 
-  bool object::property(const std::shared_ptr<class runtime>& runtime,
+  bool object::property(const ref<class runtime>& runtime,
                         const key_type& key,
                         mapped_type& slot) const
   {
@@ -358,17 +704,56 @@ namespace plorth
     return true;
   }
 
-  bool object::equals(const std::shared_ptr<value>& that) const
+  std::vector<object::key_type> object::keys() const
+  {
+    std::vector<key_type> result;
+
+    result.reserve(size());
+    for_each([&result](const key_type& key, const mapped_type&)
+    {
+      result.push_back(key);
+    });
+
+    return result;
+  }
+
+  std::vector<object::mapped_type> object::values() const
+  {
+    std::vector<mapped_type> result;
+
+    result.reserve(size());
+    for_each([&result](const key_type&, const mapped_type& value)
+    {
+      result.push_back(value);
+    });
+
+    return result;
+  }
+
+  std::vector<object::value_type> object::entries() const
+  {
+    std::vector<value_type> result;
+
+    result.reserve(size());
+    for_each([&result](const key_type& key, const mapped_type& value)
+    {
+      result.push_back({ key, value });
+    });
+
+    return result;
+  }
+
+  bool object::equals(const ref<value>& that) const
   {
-    std::shared_ptr<object> obj;
-    std::shared_ptr<value> slot;
+    ref<object> obj;
+    ref<value> slot;
 
     if (!is(that, type::object))
     {
       return false;
     }
 
-    if (this == (obj = std::static_pointer_cast<object>(that)).get())
+    if (this == (obj = ref_cast<object>(that)).get())
     {
       return true;
     }
@@ -377,15 +762,34 @@ namespace plorth
       return false;
     }
 
-    for (auto property : entries())
+    return for_each([&obj, &slot](const key_type& key,
+                                  const mapped_type& value)
     {
-      if (!obj->own_property(property.first, slot) || property.second != slot)
+      return obj->own_property(key, slot) && value == slot;
+    });
+  }
+
+  std::size_t object::hash() const
+  {
+    auto result = m_hash.load(std::memory_order_relaxed);
+
+    if (!result)
+    {
+      result = size();
+      // Hash codes of the properties are summed together, so that the result
+      // does not depend on the order in which the properties are visited.
+      for_each([&result](const key_type& key, const mapped_type& val)
       {
-        return false;
+        result += hash_combine(std::hash<key_type>()(key), value::hash(val));
+      });
+      if (!result)
+      {
+        result = 1;
       }
+      m_hash.store(result, std::memory_order_relaxed);
     }
 
-    return true;
+    return result;
   }
 
   std::u32string object::to_string() const
@@ -393,7 +797,7 @@ namespace plorth
     std::u32string result;
     bool first = true;
 
-    for (const auto& property : entries())
+    for_each([&result, &first](const key_type& key, const mapped_type& value)
     {
       if (first)
       {
@@ -402,13 +806,13 @@ namespace plorth
         result += ',';
         result += ' ';
       }
-      result += property.first;
+      result += key.name();
       result += '=';
-      if (property.second)
+      if (value)
       {
-        result += property.second->to_string();
+        result += value->to_string();
       }
-    }
+    });
 
     return result;
   }
@@ -419,7 +823,7 @@ namespace plorth
     bool first = true;
 
     result += '{';
-    for (const auto& property : entries())
+    for_each([&result, &first](const key_type& key, const mapped_type& value)
     {
       if (first)
       {
@@ -428,31 +832,33 @@ namespace plorth
         result += ',';
         result += ' ';
       }
-      result += json_stringify(property.first);
+      result += json_stringify(key.name());
       result += ':';
       result += ' ';
-      if (property.second)
+      if (value)
       {
-        result += property.second->to_source();
+        result += value->to_source();
       } else {
         result += U"null";
       }
-    }
+    });
     result += '}';
 
     return result;
   }
 
-  std::shared_ptr<object> runtime::object(
+  ref<object> runtime::object(
     const std::vector<object::value_type>& properties
   )
   {
-    return std::shared_ptr<class object>(
-      new (*m_memory_manager) simple_object(
-        std::begin(properties),
-        std::end(properties)
-      )
-    );
+    object_builder builder(*m_memory_manager, m_empty_shape);
+
+    for (const auto& property : properties)
+    {
+      builder.set(property.first, property.second);
+    }
+
+    return builder.build();
   }
 
   /**
@@ -469,24 +875,18 @@ namespace plorth
    * Retrieves all keys from the object and returns them in an array. Notice
    * that inherited properties are not included in the list.
    */
-  static void w_keys(const std::shared_ptr<context>& ctx)
+  static void w_keys(const ref<context>& ctx, const object& obj)
   {
     const auto& runtime = ctx->runtime();
-    std::shared_ptr<object> obj;
-    std::vector<std::shared_ptr<value>> result;
-
-    if (!ctx->pop_object(obj))
-    {
-      return;
-    }
+    std::vector<ref<value>> result;
 
-    result.reserve(obj->size());
-    for (const auto& key : obj->keys())
+    result.reserve(obj.size());
+    obj.for_each([&runtime, &result](const object::key_type& key,
+                                     const object::mapped_type&)
     {
-      result.push_back(runtime->string(key));
-    }
+      result.push_back(runtime->string(key.name()));
+    });
 
-    ctx->push(obj);
     ctx->push_array(result.data(), result.size());
   }
 
@@ -504,15 +904,9 @@ namespace plorth
    * Retrieves all values from the object and returns them in an array. Notice
    * that inherited properties are not included in the list.
    */
-  static void w_values(const std::shared_ptr<context>& ctx)
+  static void w_values(const ref<context>& ctx, const object& obj)
   {
-    std::shared_ptr<object> obj;
-
-    if (ctx->pop_object(obj))
-    {
-      ctx->push(obj);
-      ctx->push_array(obj->values());
-    }
+    ctx->push_array(obj.values());
   }
 
   /**
@@ -530,27 +924,22 @@ namespace plorth
    * object is represented as an pair (i.e. array containing two elements, one
    * for the key and one for the value).
    */
-  static void w_entries(const std::shared_ptr<context>& ctx)
+  static void w_entries(const ref<context>& ctx, const object& obj)
   {
     const auto& runtime = ctx->runtime();
-    std::shared_ptr<object> obj;
-    std::vector<std::shared_ptr<value>> result;
+    std::vector<ref<value>> result;
 
-    if (!ctx->pop_object(obj))
+    result.reserve(obj.size());
+    obj.for_each([&runtime, &result](const object::key_type& key,
+                                     const object::mapped_type& value)
     {
-      return;
-    }
+      ref<class value> pair[2];
 
-    for (const auto& property : obj->entries())
-    {
-      std::shared_ptr<value> pair[2];
-
-      pair[0] = runtime->string(property.first);
-      pair[1] = property.second;
+      pair[0] = runtime->string(key.name());
+      pair[1] = value;
       result.push_back(runtime->array(pair, 2));
-    }
+    });
 
-    ctx->push(obj);
     ctx->push_array(result);
   }
 
@@ -569,16 +958,17 @@ namespace plorth
    * Tests whether the object has property with given identifier. Notice that
    * inherited properties are also included in the search.
    */
-  static void w_has(const std::shared_ptr<context>& ctx)
+  static void w_has(const ref<context>& ctx,
+                    const object& obj,
+                    const string& id)
   {
-    std::shared_ptr<object> obj;
-    std::shared_ptr<string> id;
+    atom key;
+    // Names which are not in the atom table cannot be property names either.
+    const bool result = atom::find(id.to_string(), key) &&
+      obj.has_property(ctx->runtime(), key);
 
-    if (ctx->pop_object(obj) && ctx->pop_string(id))
-    {
-      ctx->push(obj);
-      ctx->push_boolean(obj->has_property(ctx->runtime(), id->to_string()));
-    }
+    ctx->nip();
+    ctx->push_boolean(result);
   }
 
   /**
@@ -596,16 +986,16 @@ namespace plorth
    * Tests whether the object has own property with given identifier. Inherited
    * properties are not included in the search.
    */
-  static void w_has_own(const std::shared_ptr<context>& ctx)
+  static void w_has_own(const ref<context>& ctx,
+                        const object& obj,
+                        const string& id)
   {
-    std::shared_ptr<object> obj;
-    std::shared_ptr<string> id;
+    atom key;
+    const bool result = atom::find(id.to_string(), key) &&
+      obj.has_own_property(key);
 
-    if (ctx->pop_object(obj) && ctx->pop_string(id))
-    {
-      ctx->push(obj);
-      ctx->push_boolean(obj->has_own_property(id->to_string()));
-    }
+    ctx->nip();
+    ctx->push_boolean(result);
   }
 
   /**
@@ -623,12 +1013,12 @@ namespace plorth
    *
    * Type error will be thrown if the object has no "prototype" property.
    */
-  static void w_new(const std::shared_ptr<context>& ctx)
+  static void w_new(const ref<context>& ctx)
   {
     const auto& runtime = ctx->runtime();
-    std::shared_ptr<object> obj;
-    std::shared_ptr<value> prototype;
-    std::shared_ptr<value> constructor;
+    ref<object> obj;
+    ref<value> prototype;
+    ref<value> constructor;
 
     if (!ctx->pop_object(obj))
     {
@@ -644,12 +1034,12 @@ namespace plorth
 
     ctx->push_object({ { U"__proto__", prototype } });
 
-    if (std::static_pointer_cast<object>(prototype)->property(runtime,
-                                                              U"constructor",
-                                                              constructor)
+    if (ref_cast<object>(prototype)->property(runtime,
+                                              U"constructor",
+                                              constructor)
         && value::is(constructor, value::type::quote))
     {
-      std::static_pointer_cast<quote>(constructor)->call(ctx);
+      ref_cast<quote>(constructor)->call(ctx);
     }
   }
 
@@ -669,25 +1059,22 @@ namespace plorth
    * object. If the object does not have such a property, range error will be
    * thrown. Notice that inherited properties are also included in the search.
    */
-  static void w_get(const std::shared_ptr<context>& ctx)
+  static void w_get(const ref<context>& ctx,
+                    const object& obj,
+                    const string& id)
   {
-    std::shared_ptr<object> obj;
-    std::shared_ptr<string> id;
-
-    if (ctx->pop_object(obj) && ctx->pop_string(id))
+    const auto name = id.to_string();
+    ref<value> val;
+    atom key;
+    const bool found = atom::find(name, key) &&
+      obj.property(ctx->runtime(), key, val);
+
+    ctx->nip();
+    if (found)
     {
-      std::shared_ptr<value> val;
-
-      ctx->push(obj);
-      if (obj->property(ctx->runtime(), id->to_string(), val))
-      {
-        ctx->push(val);
-      } else {
-        ctx->error(
-          error::code::range,
-          U"No such property: `" + id->to_string() + U"'"
-        );
-      }
+      ctx->push(std::move(val));
+    } else {
+      ctx->error(error::code::range, U"No such property: `" + name + U"'");
     }
   }
 
@@ -706,24 +1093,21 @@ namespace plorth
    * Constructs a copy of the object with new named property either introduced
    * or replaced.
    */
-  static void w_set(const std::shared_ptr<context>& ctx)
+  static void w_set(const ref<context>& ctx)
   {
-    std::shared_ptr<object> obj;
-    std::shared_ptr<string> id;
-    std::shared_ptr<value> val;
+    ref<object> obj;
+    ref<string> id;
+    ref<value> val;
 
     if (ctx->pop_object(obj) && ctx->pop_string(id) && ctx->pop(val))
     {
-      const auto key = id->to_string();
-      std::shared_ptr<object> result;
+      auto builder = object_builder::from(
+        ctx->runtime()->memory_manager(),
+        obj
+      );
 
-      if (obj->has_own_property(key))
-      {
-        result = ctx->runtime()->value<set_object_override>(obj, key, val);
-      } else {
-        result = ctx->runtime()->value<set_object>(obj, key, val);
-      }
-      ctx->push(result);
+      builder.set(id->to_string(), val);
+      ctx->push(builder.build());
     }
   }
 
@@ -740,23 +1124,31 @@ namespace plorth
    *
    * Constructs a copy of the object with the named property removed.
    */
-  static void w_delete(const std::shared_ptr<context>& ctx)
+  static void w_delete(const ref<context>& ctx)
   {
-    std::shared_ptr<object> obj;
-    std::shared_ptr<string> id;
+    ref<object> obj;
+    ref<string> id;
 
     if (ctx->pop_object(obj) && ctx->pop_string(id))
     {
       const auto name = id->to_string();
+      auto builder = object_builder::from(
+        ctx->runtime()->memory_manager(),
+        obj
+      );
 
-      if (!obj->has_own_property(name))
+      if (!builder.erase(name))
       {
+        // Just like with `@', the object stays on the stack when it does not
+        // have the property.
+        ctx->push(std::move(obj));
         ctx->error(
           error::code::range,
           U"No such property: `" + name + U"'"
         );
+        return;
       }
-      ctx->push(ctx->runtime()->value<delete_object>(obj, name));
+      ctx->push(builder.build());
     }
   }
 
@@ -774,27 +1166,40 @@ namespace plorth
    * Combines the contents of two objects together and returns the result. If
    * the two objects share keys the second object's values take precedence.
    */
-  static void w_concat(const std::shared_ptr<context>& ctx)
+  static void w_concat(const ref<context>& ctx)
   {
-    std::shared_ptr<object> a;
-    std::shared_ptr<object> b;
+    ref<object> a;
+    ref<object> b;
 
     if (ctx->pop_object(a) && ctx->pop_object(b))
     {
-      const auto entries = b->entries();
-      std::unordered_map<std::u32string, std::shared_ptr<value>> properties(
-        std::begin(entries),
-        std::end(entries)
-      );
+      auto& manager = ctx->runtime()->memory_manager();
 
-      for (const auto& property : a->entries())
+      // Continue from the larger object, so that only properties of the
+      // smaller one need to be inserted into the trie.
+      if (a->size() > b->size())
       {
-        properties[property.first] = property.second;
+        auto builder = object_builder::from(manager, a);
+
+        b->for_each([&builder](const object::key_type& key,
+                               const object::mapped_type& value)
+        {
+          if (!builder.has(key))
+          {
+            builder.set(key, value);
+          }
+        });
+        ctx->push(builder.build());
+      } else {
+        auto builder = object_builder::from(manager, b);
+
+        a->for_each([&builder](const object::key_type& key,
+                               const object::mapped_type& value)
+        {
+          builder.set(key, value);
+        });
+        ctx->push(builder.build());
       }
-      ctx->push_object(std::vector<object::value_type>(
-        std::begin(properties),
-        std::end(properties)
-      ));
     }
   }
 
@@ -804,13 +1209,13 @@ namespace plorth
     {
       return
       {
-        { U"keys", w_keys },
-        { U"values", w_values },
-        { U"entries", w_entries },
-        { U"has?", w_has },
-        { U"has-own?", w_has_own },
+        { U"keys", native::thunk<w_keys> },
+        { U"values", native::thunk<w_values> },
+        { U"entries", native::thunk<w_entries> },
+        { U"has?", native::thunk<w_has> },
+        { U"has-own?", native::thunk<w_has_own> },
         { U"new", w_new },
-        { U"@", w_get },
+        { U"@", native::thunk<w_get> },
         { U"!", w_set },
         { U"delete", w_delete },
         { U"+", w_concat }
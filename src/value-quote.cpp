@@ -25,8 +25,15 @@
  */
 #include <plorth/context.hpp>
 
+#include "./bytecode.hpp"
 #include "./utils.hpp"
 
+#include <cstdint>
+#include <memory>
+#if PLORTH_ENABLE_MUTEXES
+# include <mutex>
+#endif
+
 namespace plorth
 {
   namespace
@@ -39,7 +46,7 @@ namespace plorth
     class compiled_quote : public quote
     {
     public:
-      explicit compiled_quote(const std::vector<std::shared_ptr<value>>& values)
+      explicit compiled_quote(const std::vector<ref<value>>& values)
         : m_values(values) {}
 
       inline enum quote_type quote_type() const
@@ -47,8 +54,13 @@ namespace plorth
         return quote_type::compiled;
       }
 
-      bool call(const std::shared_ptr<context>& ctx) const
+      bool call(const ref<context>& ctx) const
       {
+        if (ctx->runtime()->execution_engine() ==
+            runtime::execution_engine::bytecode)
+        {
+          return program(ctx->runtime()).execute(ctx);
+        }
         for (const auto& value : m_values)
         {
           if (!value::exec(ctx, value))
@@ -84,16 +96,16 @@ namespace plorth
         return result;
       }
 
-      bool equals(const std::shared_ptr<value>& that) const
+      bool equals(const ref<value>& that) const
       {
-        std::shared_ptr<compiled_quote> q;
+        ref<compiled_quote> q;
 
         if (!value::is(that, type::quote) ||
-            !std::static_pointer_cast<quote>(that)->is(quote_type::compiled))
+            !ref_cast<quote>(that)->is(quote_type::compiled))
         {
           return false;
         }
-        q = std::static_pointer_cast<compiled_quote>(that);
+        q = ref_cast<compiled_quote>(that);
         if (m_values.size() != q->m_values.size())
         {
           return false;
@@ -109,8 +121,47 @@ namespace plorth
         return true;
       }
 
+      std::size_t hash() const
+      {
+        std::size_t result = m_values.size();
+
+        for (const auto& element : m_values)
+        {
+          result = hash_combine(result, value::hash(element));
+        }
+
+        return result;
+      }
+
     private:
-      const std::vector<std::shared_ptr<value>> m_values;
+      /**
+       * Returns bytecode of the quote, translating the values into bytecode
+       * when the quote is called for the first time.
+       */
+      const bytecode::program& program(const ref<runtime>& runtime) const
+      {
+#if PLORTH_ENABLE_MUTEXES
+        std::call_once(m_program_flag, [this, &runtime]()
+        {
+          m_program.reset(new bytecode::program(runtime, m_values));
+        });
+#else
+        if (!m_program)
+        {
+          m_program.reset(new bytecode::program(runtime, m_values));
+        }
+#endif
+
+        return *m_program;
+      }
+
+    private:
+      const std::vector<ref<value>> m_values;
+      /** Bytecode translated from the values. */
+      mutable std::unique_ptr<bytecode::program> m_program;
+#if PLORTH_ENABLE_MUTEXES
+      mutable std::once_flag m_program_flag;
+#endif
     };
 
     /**
@@ -128,7 +179,7 @@ namespace plorth
         return quote_type::native;
       }
 
-      bool call(const std::shared_ptr<context>& ctx) const
+      bool call(const ref<context>& ctx) const
       {
         m_callback(ctx);
 
@@ -140,11 +191,23 @@ namespace plorth
         return U"\"native quote\"";
       }
 
-      bool equals(const std::shared_ptr<value>& that) const
+      bool equals(const ref<value>& that) const
+      {
+        if (!value::is(that, type::quote) ||
+            !ref_cast<quote>(that)->is(quote_type::native))
+        {
+          return false;
+        }
+
+        return m_callback ==
+          static_cast<const native_quote*>(that.get())->m_callback;
+      }
+
+      std::size_t hash() const
       {
-        // Currently there is no way to compare two std::function instances
-        // against each other, even when they are the same type.
-        return this == that.get();
+        return std::hash<std::uintptr_t>()(
+          reinterpret_cast<std::uintptr_t>(m_callback)
+        );
       }
 
     private:
@@ -152,16 +215,16 @@ namespace plorth
     };
   }
 
-  std::shared_ptr<quote> runtime::compiled_quote(const std::vector<std::shared_ptr<class value>>& values)
+  ref<quote> runtime::compiled_quote(const std::vector<ref<class value>>& values)
   {
-    return std::shared_ptr<quote>(
+    return ref<quote>(
       new (*m_memory_manager) class compiled_quote(values)
     );
   }
 
-  std::shared_ptr<quote> runtime::native_quote(quote::callback callback)
+  ref<quote> runtime::native_quote(quote::callback callback)
   {
-    return std::shared_ptr<quote>(
+    return ref<quote>(
       new (*m_memory_manager) class native_quote(callback)
     );
   }
@@ -180,9 +243,9 @@ namespace plorth
    *
    * Executes the quote taken from the top of the stack.
    */
-  static void w_call(const std::shared_ptr<context>& ctx)
+  static void w_call(const ref<context>& ctx)
   {
-    std::shared_ptr<quote> q;
+    ref<quote> q;
 
     if (ctx->pop_quote(q))
     {
@@ -203,11 +266,11 @@ namespace plorth
    *
    * Constructs a new quote which will call the two given quotes in sequence.
    */
-  static void w_compose(const std::shared_ptr<context>& ctx)
+  static void w_compose(const ref<context>& ctx)
   {
     const auto& runtime = ctx->runtime();
-    std::shared_ptr<quote> left;
-    std::shared_ptr<quote> right;
+    ref<quote> left;
+    ref<quote> right;
 
     if (ctx->pop_quote(right) && ctx->pop_quote(left))
     {
@@ -234,11 +297,11 @@ namespace plorth
    * Constructs a curried quote where given value will be pushed onto the stack
    * before calling the original quote.
    */
-  static void w_curry(const std::shared_ptr<context>& ctx)
+  static void w_curry(const ref<context>& ctx)
   {
     const auto& runtime = ctx->runtime();
-    std::shared_ptr<value> argument;
-    std::shared_ptr<quote> quo;
+    ref<value> argument;
+    ref<quote> quo;
 
     if (ctx->pop_quote(quo) && ctx->pop(argument))
     {
@@ -259,10 +322,10 @@ namespace plorth
    * Constructs a negated version of given quote which negates the boolean
    * result returned by the original quote.
    */
-  static void w_negate(const std::shared_ptr<context>& ctx)
+  static void w_negate(const ref<context>& ctx)
   {
     const auto& runtime = ctx->runtime();
-    std::shared_ptr<quote> quo;
+    ref<quote> quo;
 
     if (ctx->pop_quote(quo))
     {
@@ -289,10 +352,10 @@ namespace plorth
    * the quote has returned from it's execution, hidden value will be placed
    * back on the stack.
    */
-  static void w_dip(const std::shared_ptr<context>& ctx)
+  static void w_dip(const ref<context>& ctx)
   {
-    std::shared_ptr<value> val;
-    std::shared_ptr<quote> quo;
+    cell val;
+    ref<quote> quo;
 
     if (!ctx->pop_quote(quo) || !ctx->pop(val))
     {
@@ -300,7 +363,7 @@ namespace plorth
     }
 
     quo->call(ctx);
-    ctx->push(val);
+    ctx->push(std::move(val));
   }
 
   /**
@@ -321,11 +384,11 @@ namespace plorth
    * Once the quote has returned from it's execution, hidden values will be
    * placed back on the stack.
    */
-  static void w_2dip(const std::shared_ptr<context>& ctx)
+  static void w_2dip(const ref<context>& ctx)
   {
-    std::shared_ptr<value> val1;
-    std::shared_ptr<value> val2;
-    std::shared_ptr<quote> quo;
+    cell val1;
+    cell val2;
+    ref<quote> quo;
 
     if (!ctx->pop_quote(quo) || !ctx->pop(val2) || !ctx->pop(val1))
     {
@@ -333,8 +396,8 @@ namespace plorth
     }
 
     quo->call(ctx);
-    ctx->push(val1);
-    ctx->push(val2);
+    ctx->push(std::move(val1));
+    ctx->push(std::move(val2));
   }
 
   /**
@@ -350,10 +413,10 @@ namespace plorth
    *
    * Constructs word from given pair of symbol and quote.
    */
-  static void w_to_word(const std::shared_ptr<context>& ctx)
+  static void w_to_word(const ref<context>& ctx)
   {
-    std::shared_ptr<symbol> sym;
-    std::shared_ptr<quote> quo;
+    ref<symbol> sym;
+    ref<quote> quo;
 
     if (ctx->pop_quote(quo) && ctx->pop_symbol(sym))
     {
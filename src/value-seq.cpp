@@ -0,0 +1,771 @@
+/*
+ * Copyright (c) 2017-2018, Rauli Laine
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <plorth/context.hpp>
+#include <plorth/value-seq.hpp>
+
+#include <vector>
+
+namespace plorth
+{
+  namespace
+  {
+    class array_seq : public seq
+    {
+    public:
+      explicit array_seq(const ref<class array>& array)
+        : m_array(array) {}
+
+      enum seq_type seq_type() const
+      {
+        return seq_type::array;
+      }
+
+      std::unique_ptr<seq::iterator> iterate() const
+      {
+        return std::unique_ptr<seq::iterator>(new iterator(m_array));
+      }
+
+    private:
+      /**
+       * Reads elements through contiguous chunks of the array when the
+       * array has such, and one by one otherwise.
+       */
+      class iterator : public seq::iterator
+      {
+      public:
+        explicit iterator(const ref<class array>& array)
+          : m_array(array)
+          , m_offset(0)
+          , m_chunk(nullptr)
+          , m_chunk_size(0) {}
+
+        bool next(const ref<context>&, ref<value>& slot, bool& end)
+        {
+          if (m_offset >= m_array->size())
+          {
+            end = true;
+
+            return true;
+          }
+          if (!m_chunk_size)
+          {
+            m_chunk = m_array->chunk(m_offset, m_chunk_size);
+          }
+          if (m_chunk)
+          {
+            slot = *m_chunk++;
+            --m_chunk_size;
+          } else {
+            slot = m_array->at(m_offset);
+            m_chunk_size = 0;
+          }
+          ++m_offset;
+          end = false;
+
+          return true;
+        }
+
+      private:
+        const ref<class array> m_array;
+        array::size_type m_offset;
+        array::const_pointer m_chunk;
+        array::size_type m_chunk_size;
+      };
+
+      const ref<class array> m_array;
+    };
+
+    class string_seq : public seq
+    {
+    public:
+      explicit string_seq(const ref<class string>& string)
+        : m_string(string) {}
+
+      enum seq_type seq_type() const
+      {
+        return seq_type::string;
+      }
+
+      std::unique_ptr<seq::iterator> iterate() const
+      {
+        return std::unique_ptr<seq::iterator>(new iterator(m_string));
+      }
+
+    private:
+      class iterator : public seq::iterator
+      {
+      public:
+        explicit iterator(const ref<class string>& string)
+          : m_string(string)
+          , m_offset(0) {}
+
+        bool next(const ref<context>& ctx, ref<value>& slot, bool& end)
+        {
+          if (m_offset >= m_string->length())
+          {
+            end = true;
+
+            return true;
+          }
+
+          const auto c = m_string->at(m_offset++);
+
+          slot = ctx->runtime()->string(&c, 1);
+          end = false;
+
+          return true;
+        }
+
+      private:
+        const ref<class string> m_string;
+        string::size_type m_offset;
+      };
+
+      const ref<class string> m_string;
+    };
+
+    class range_seq : public seq
+    {
+    public:
+      explicit range_seq(number::int_type start,
+                         number::int_type end,
+                         bool bounded)
+        : m_start(start)
+        , m_end(end)
+        , m_bounded(bounded) {}
+
+      enum seq_type seq_type() const
+      {
+        return seq_type::range;
+      }
+
+      std::unique_ptr<seq::iterator> iterate() const
+      {
+        return std::unique_ptr<seq::iterator>(
+          new iterator(m_start, m_end, m_bounded)
+        );
+      }
+
+    private:
+      class iterator : public seq::iterator
+      {
+      public:
+        explicit iterator(number::int_type current,
+                          number::int_type end,
+                          bool bounded)
+          : m_current(current)
+          , m_end(end)
+          , m_bounded(bounded)
+          , m_exhausted(false) {}
+
+        bool next(const ref<context>& ctx, ref<value>& slot, bool& end)
+        {
+          if (m_exhausted || (m_bounded && m_current >= m_end))
+          {
+            end = true;
+
+            return true;
+          }
+          slot = ctx->runtime()->number(m_current);
+          // Endless range stops at the largest integer instead of wrapping
+          // around.
+          if (m_current == number::int_max)
+          {
+            m_exhausted = true;
+          } else {
+            ++m_current;
+          }
+          end = false;
+
+          return true;
+        }
+
+      private:
+        number::int_type m_current;
+        const number::int_type m_end;
+        const bool m_bounded;
+        bool m_exhausted;
+      };
+
+      const number::int_type m_start;
+      const number::int_type m_end;
+      const bool m_bounded;
+    };
+
+    class input_seq : public seq
+    {
+    public:
+      enum seq_type seq_type() const
+      {
+        return seq_type::input;
+      }
+
+      std::unique_ptr<seq::iterator> iterate() const
+      {
+        return std::unique_ptr<seq::iterator>(new iterator());
+      }
+
+    private:
+      /**
+       * Reads input one character at a time, so that nothing past the
+       * current line is consumed from the input.
+       */
+      class iterator : public seq::iterator
+      {
+      public:
+        iterator()
+          : m_eof(false) {}
+
+        bool next(const ref<context>& ctx, ref<value>& slot, bool& end)
+        {
+          std::u32string line;
+
+          while (!m_eof)
+          {
+            std::u32string output;
+            io::input::size_type read;
+            const auto result = ctx->runtime()->read(1, output, read);
+
+            if (result == io::input::result::failure)
+            {
+              ctx->error(error::code::io, U"Unable to decode input as UTF-8.");
+
+              return false;
+            }
+            else if (result == io::input::result::eof || !read)
+            {
+              m_eof = true;
+              line.append(output);
+              break;
+            }
+            else if (output[0] == '\n')
+            {
+              slot = ctx->runtime()->string(line);
+              end = false;
+
+              return true;
+            }
+            line.append(output);
+          }
+          if (line.empty())
+          {
+            end = true;
+          } else {
+            slot = ctx->runtime()->string(line);
+            end = false;
+          }
+
+          return true;
+        }
+
+      private:
+        bool m_eof;
+      };
+    };
+
+    /**
+     * Sequence which runs elements of another sequence through a list of
+     * stages. Adding a stage to a pipeline gives a new pipeline with the
+     * same source, instead of wrapping the pipeline, so that each element
+     * passes through all of the stages in a single loop.
+     */
+    class pipeline_seq : public seq
+    {
+    public:
+      explicit pipeline_seq(const ref<seq>& source,
+                            const std::vector<struct stage>& stages)
+        : m_source(source)
+        , m_stages(stages) {}
+
+      enum seq_type seq_type() const
+      {
+        return seq_type::pipeline;
+      }
+
+      std::unique_ptr<seq::iterator> iterate() const
+      {
+        return std::unique_ptr<seq::iterator>(
+          new iterator(m_source->iterate(), m_stages)
+        );
+      }
+
+      inline const ref<seq>& source() const
+      {
+        return m_source;
+      }
+
+      inline const std::vector<struct stage>& stages() const
+      {
+        return m_stages;
+      }
+
+    private:
+      class iterator : public seq::iterator
+      {
+      public:
+        explicit iterator(std::unique_ptr<seq::iterator> source,
+                          const std::vector<struct stage>& stages)
+          : m_source(std::move(source))
+          , m_stages(stages)
+          , m_counters(stages.size())
+          , m_finished(false)
+        {
+          for (const auto& stage : stages)
+          {
+            if (stage.type == stage_type::take && !stage.count)
+            {
+              m_finished = true;
+            }
+          }
+        }
+
+        bool next(const ref<context>& ctx, ref<value>& slot, bool& end)
+        {
+          const auto size = m_stages.size();
+
+          for (;;)
+          {
+            std::size_t i;
+
+            // Once a take stage has passed all of its elements, nothing can
+            // pass through the pipeline anymore, so the source is not read
+            // any further.
+            if (m_finished)
+            {
+              end = true;
+
+              return true;
+            }
+            if (!m_source->next(ctx, slot, end))
+            {
+              return false;
+            }
+            else if (end)
+            {
+              return true;
+            }
+            for (i = 0; i < size; ++i)
+            {
+              const auto& stage = m_stages[i];
+              auto& counter = m_counters[i];
+              bool keep = true;
+
+              switch (stage.type)
+              {
+                case stage_type::map:
+                  ctx->push(slot);
+                  if (!stage.quote->call(ctx) || !ctx->pop(slot))
+                  {
+                    return false;
+                  }
+                  break;
+
+                case stage_type::filter:
+                  ctx->push(slot);
+                  if (!stage.quote->call(ctx) || !ctx->pop_boolean(keep))
+                  {
+                    return false;
+                  }
+                  break;
+
+                case stage_type::take:
+                  if (++counter >= stage.count)
+                  {
+                    m_finished = true;
+                  }
+                  break;
+
+                case stage_type::drop:
+                  if (counter < stage.count)
+                  {
+                    ++counter;
+                    keep = false;
+                  }
+                  break;
+              }
+              if (!keep)
+              {
+                break;
+              }
+            }
+            if (i == size)
+            {
+              return true;
+            }
+          }
+        }
+
+      private:
+        const std::unique_ptr<seq::iterator> m_source;
+        const std::vector<struct stage> m_stages;
+        std::vector<std::size_t> m_counters;
+        bool m_finished;
+      };
+
+      const ref<seq> m_source;
+      const std::vector<struct stage> m_stages;
+    };
+  }
+
+  seq::iterator::~iterator() {}
+
+  ref<seq> seq::then(const ref<class runtime>& runtime,
+                     const struct stage& stage) const
+  {
+    if (is(seq_type::pipeline))
+    {
+      const auto pipeline = static_cast<const pipeline_seq*>(this);
+      auto stages = pipeline->stages();
+
+      stages.push_back(stage);
+
+      return runtime->value<pipeline_seq>(pipeline->source(), stages);
+    }
+
+    return runtime->value<pipeline_seq>(
+      ref<seq>(const_cast<seq*>(this)),
+      std::vector<struct stage>{ stage }
+    );
+  }
+
+  bool seq::equals(const ref<value>& that) const
+  {
+    return that.get() == this;
+  }
+
+  std::size_t seq::hash() const
+  {
+    return std::hash<const void*>()(this);
+  }
+
+  std::u32string seq::to_string() const
+  {
+    return U"<seq>";
+  }
+
+  std::u32string seq::to_source() const
+  {
+    return to_string();
+  }
+
+  ref<seq> runtime::seq(const ref<class array>& array)
+  {
+    return value<array_seq>(array);
+  }
+
+  ref<seq> runtime::seq(const ref<class string>& string)
+  {
+    return value<string_seq>(string);
+  }
+
+  ref<seq> runtime::range(number::int_type start)
+  {
+    return value<range_seq>(start, start, false);
+  }
+
+  ref<seq> runtime::range(number::int_type start, number::int_type end)
+  {
+    return value<range_seq>(start, end, true);
+  }
+
+  ref<seq> runtime::input_lines()
+  {
+    return value<input_seq>();
+  }
+
+  /**
+   * Pops quote and sequence from the stack and pushes sequence which has
+   * stage of given type appended to it.
+   */
+  static void add_quote_stage(const ref<context>& ctx,
+                              enum seq::stage_type type)
+  {
+    ref<seq> sequence;
+    ref<quote> quo;
+
+    if (ctx->pop_seq(sequence) && ctx->pop_quote(quo))
+    {
+      ctx->push(sequence->then(ctx->runtime(), { type, quo, 0 }));
+    }
+  }
+
+  /**
+   * Pops number and sequence from the stack and pushes sequence which has
+   * stage of given type appended to it.
+   */
+  static void add_count_stage(const ref<context>& ctx,
+                              enum seq::stage_type type)
+  {
+    ref<seq> sequence;
+    cell num;
+
+    if (!ctx->pop_seq(sequence) || !ctx->pop_number(num))
+    {
+      return;
+    }
+
+    const auto count = num.as_int();
+
+    if (count < 0)
+    {
+      ctx->error(error::code::range, U"Count cannot be negative.");
+      return;
+    }
+    ctx->push(sequence->then(
+      ctx->runtime(),
+      { type, ref<quote>(), static_cast<std::size_t>(count) }
+    ));
+  }
+
+  /**
+   * Word: map
+   * Prototype: seq
+   *
+   * Takes:
+   * - quote
+   * - seq
+   *
+   * Gives:
+   * - seq
+   *
+   * Returns sequence which applies quote to each element of the sequence
+   * and gives values returned by the quote. The quote is called only when
+   * the resulting sequence is consumed.
+   */
+  static void w_map(const ref<context>& ctx)
+  {
+    add_quote_stage(ctx, seq::stage_type::map);
+  }
+
+  /**
+   * Word: filter
+   * Prototype: seq
+   *
+   * Takes:
+   * - quote
+   * - seq
+   *
+   * Gives:
+   * - seq
+   *
+   * Returns sequence which contains only those elements of the sequence for
+   * which the quote returns true. The quote is called only when the
+   * resulting sequence is consumed.
+   */
+  static void w_filter(const ref<context>& ctx)
+  {
+    add_quote_stage(ctx, seq::stage_type::filter);
+  }
+
+  /**
+   * Word: take
+   * Prototype: seq
+   *
+   * Takes:
+   * - number
+   * - seq
+   *
+   * Gives:
+   * - seq
+   *
+   * Returns sequence which ends after given number of elements of the
+   * sequence.
+   */
+  static void w_take(const ref<context>& ctx)
+  {
+    add_count_stage(ctx, seq::stage_type::take);
+  }
+
+  /**
+   * Word: drop
+   * Prototype: seq
+   *
+   * Takes:
+   * - number
+   * - seq
+   *
+   * Gives:
+   * - seq
+   *
+   * Returns sequence which skips given number of elements from the
+   * beginning of the sequence.
+   */
+  static void w_drop(const ref<context>& ctx)
+  {
+    add_count_stage(ctx, seq::stage_type::drop);
+  }
+
+  /**
+   * Word: for-each
+   * Prototype: seq
+   *
+   * Takes:
+   * - quote
+   * - seq
+   *
+   * Runs quote once for each element of the sequence.
+   */
+  static void w_for_each(const ref<context>& ctx)
+  {
+    ref<seq> sequence;
+    ref<quote> quo;
+
+    if (!ctx->pop_seq(sequence) || !ctx->pop_quote(quo))
+    {
+      return;
+    }
+
+    const auto iterator = sequence->iterate();
+    ref<value> element;
+    bool end;
+
+    while (iterator->next(ctx, element, end) && !end)
+    {
+      ctx->push(element);
+      if (!quo->call(ctx))
+      {
+        return;
+      }
+    }
+  }
+
+  /**
+   * Word: reduce
+   * Prototype: seq
+   *
+   * Takes:
+   * - quote
+   * - seq
+   *
+   * Gives:
+   * - any
+   *
+   * Applies given quote against an accumulator and each element of the
+   * sequence to reduce it into a single value.
+   */
+  static void w_reduce(const ref<context>& ctx)
+  {
+    ref<seq> sequence;
+    ref<quote> quo;
+
+    if (!ctx->pop_seq(sequence) || !ctx->pop_quote(quo))
+    {
+      return;
+    }
+
+    const auto iterator = sequence->iterate();
+    ref<value> result;
+    ref<value> element;
+    bool end;
+
+    if (!iterator->next(ctx, result, end))
+    {
+      return;
+    }
+    else if (end)
+    {
+      ctx->error(error::code::range, U"Cannot reduce empty sequence.");
+      return;
+    }
+    for (;;)
+    {
+      if (!iterator->next(ctx, element, end))
+      {
+        return;
+      }
+      else if (end)
+      {
+        break;
+      }
+      ctx->push(result);
+      ctx->push(element);
+      if (!quo->call(ctx) || !ctx->pop(result))
+      {
+        return;
+      }
+    }
+    ctx->push(result);
+  }
+
+  /**
+   * Word: >array
+   * Prototype: seq
+   *
+   * Takes:
+   * - seq
+   *
+   * Gives:
+   * - array
+   *
+   * Consumes the sequence and returns its elements in an array.
+   */
+  static void w_to_array(const ref<context>& ctx)
+  {
+    ref<seq> sequence;
+
+    if (!ctx->pop_seq(sequence))
+    {
+      return;
+    }
+
+    const auto iterator = sequence->iterate();
+    std::vector<ref<value>> result;
+    ref<value> element;
+    bool end;
+
+    for (;;)
+    {
+      if (!iterator->next(ctx, element, end))
+      {
+        return;
+      }
+      else if (end)
+      {
+        break;
+      }
+      result.push_back(element);
+    }
+    ctx->push_array(result.data(), result.size());
+  }
+
+  namespace api
+  {
+    runtime::prototype_definition seq_prototype()
+    {
+      return
+      {
+        { U"map", w_map },
+        { U"filter", w_filter },
+        { U"take", w_take },
+        { U"drop", w_drop },
+
+        { U"for-each", w_for_each },
+        { U"reduce", w_reduce },
+        { U">array", w_to_array }
+      };
+    }
+  }
+}
@@ -24,8 +24,10 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <plorth/context.hpp>
+#include <plorth/native.hpp>
 #include <plorth/parser/utils.hpp>
 
+#include "./search.hpp"
 #include "./utils.hpp"
 
 #include <peelo/unicode/ctype/islower.hpp>
@@ -33,86 +35,447 @@
 #include <peelo/unicode/ctype/isupper.hpp>
 #include <peelo/unicode/ctype/tolower.hpp>
 #include <peelo/unicode/ctype/toupper.hpp>
+#include <peelo/unicode/encoding/utf8.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstring>
+#include <limits>
+#include <type_traits>
 
 namespace plorth
 {
   namespace
   {
-    class simple_string : public string
+    /**
+     * Invokes given callback with code units of given width, cast into
+     * pointer of the corresponding code unit type.
+     */
+    template<class Callback>
+    static inline auto visit_units(const void* data,
+                                   std::size_t width,
+                                   Callback callback)
+    {
+      if (width == 1)
+      {
+        return callback(static_cast<const std::uint8_t*>(data));
+      }
+      else if (width == 2)
+      {
+        return callback(static_cast<const char16_t*>(data));
+      }
+
+      return callback(static_cast<const char32_t*>(data));
+    }
+
+    /**
+     * String which stores its contents in a buffer following the object
+     * itself, using code units just wide enough for the largest code point
+     * of the string: Latin-1, UCS-2 or UTF-32.
+     */
+    template<class CharT>
+    class compact_string : public string
     {
     public:
-      explicit simple_string(const char32_t* chars, size_type length)
-        : m_length(length)
-        , m_chars(m_length > 0 ? new char32_t[m_length] : nullptr)
+      /**
+       * Allocates compact string which has room for given number of code
+       * units. Contents of the string are left for the caller to fill.
+       */
+      static compact_string* make(memory::manager& manager, size_type length)
+      {
+        void* memory = memory::managed::operator new(
+          sizeof(compact_string) + sizeof(CharT) * length,
+          manager
+        );
+
+        return ::new (memory) compact_string(length);
+      }
+
+      inline size_type length() const
+      {
+        return m_length;
+      }
+
+      value_type at(size_type offset) const
+      {
+        return data()[offset];
+      }
+
+      const_pointer chunk(size_type offset, size_type& size) const
       {
-        if (m_length > 0)
+        if constexpr (std::is_same<CharT, value_type>::value)
         {
-          std::memcpy(m_chars, chars, sizeof(char32_t) * m_length);
+          size = m_length - offset;
+
+          return data() + offset;
         }
+
+        return nullptr;
+      }
+
+      const void* units(size_type offset,
+                        size_type& size,
+                        std::size_t& width) const
+      {
+        size = m_length - offset;
+        width = sizeof(CharT);
+
+        return data() + offset;
+      }
+
+      void copy(pointer output) const
+      {
+        std::copy(data(), data() + m_length, output);
+      }
+
+      inline CharT* data()
+      {
+        return reinterpret_cast<CharT*>(this + 1);
       }
 
-      ~simple_string()
+      inline const CharT* data() const
       {
-        if (m_length > 0)
+        return reinterpret_cast<const CharT*>(this + 1);
+      }
+
+    private:
+      explicit compact_string(size_type length)
+        : m_length(length) {}
+
+    private:
+      const size_type m_length;
+    };
+
+    /**
+     * Constructs compact string from code points appended into it. Contents
+     * are stored as Latin-1 until a code point which does not fit into it is
+     * encountered, after which everything appended so far is widened into
+     * UCS-2 or UTF-32, so that the input is traversed only once.
+     */
+    class compact_builder
+    {
+    public:
+      explicit compact_builder(memory::manager& manager,
+                               string::size_type capacity)
+        : m_manager(manager)
+        , m_capacity(capacity)
+        , m_length(0)
+        , m_width(1)
+      {
+        const auto str = compact_string<std::uint8_t>::make(manager, capacity);
+
+        m_result = ref<string>(str);
+        m_units = str->data();
+      }
+
+      compact_builder(const compact_builder&) = delete;
+      void operator=(const compact_builder&) = delete;
+
+      /**
+       * Appends code points or code units of any width into the string.
+       */
+      template<class T>
+      void append(const T* data, string::size_type count)
+      {
+        while (count > 0)
         {
-          delete[] m_chars;
+          string::size_type stored;
+
+          if (m_width == 1)
+          {
+            stored = store(static_cast<std::uint8_t*>(m_units), data, count);
+          }
+          else if (m_width == 2)
+          {
+            stored = store(static_cast<char16_t*>(m_units), data, count);
+          } else {
+            stored = store(static_cast<char32_t*>(m_units), data, count);
+          }
+          m_length += stored;
+          data += stored;
+          count -= stored;
+          if (count > 0)
+          {
+            if (*data > 0xffff)
+            {
+              resize<char32_t>(m_capacity);
+            } else {
+              resize<char16_t>(m_capacity);
+            }
+          }
         }
       }
 
-      inline size_type length() const
+      inline void push(char32_t c)
       {
-        return m_length;
+        append(&c, 1);
       }
 
-      value_type at(size_type offset) const
+      /**
+       * Returns the constructed string. If less code points than the
+       * capacity were appended, contents are moved into a string of exact
+       * size first.
+       */
+      ref<string> build()
       {
-        return m_chars[offset];
+        if (m_length != m_capacity)
+        {
+          if (m_width == 1)
+          {
+            resize<std::uint8_t>(m_length);
+          }
+          else if (m_width == 2)
+          {
+            resize<char16_t>(m_length);
+          } else {
+            resize<char32_t>(m_length);
+          }
+        }
+
+        return m_result;
       }
 
     private:
-      const size_type m_length;
-      char32_t* m_chars;
+      /**
+       * Stores as many code points as fit into code units of type U, and
+       * returns number of code points which were stored.
+       */
+      template<class U, class T>
+      string::size_type store(U* output,
+                              const T* data,
+                              string::size_type count) const
+      {
+        output += m_length;
+        if constexpr (sizeof(T) <= sizeof(U))
+        {
+          std::copy(data, data + count, output);
+
+          return count;
+        } else {
+          constexpr T max = sizeof(U) == 1 ? 0xff : 0xffff;
+          string::size_type i;
+
+          for (i = 0; i < count && data[i] <= max; ++i)
+          {
+            output[i] = static_cast<U>(data[i]);
+          }
+
+          return i;
+        }
+      }
+
+      /**
+       * Moves contents appended so far into new string of given capacity
+       * which uses code units of type U.
+       */
+      template<class U>
+      void resize(string::size_type capacity)
+      {
+        const auto str = compact_string<U>::make(m_manager, capacity);
+        const auto length = m_length;
+        const auto output = str->data();
+
+        visit_units(m_units, m_width, [length, output](auto units)
+        {
+          std::copy(units, units + length, output);
+        });
+        m_result = ref<string>(str);
+        m_units = str->data();
+        m_capacity = capacity;
+        m_width = sizeof(U);
+      }
+
+    private:
+      memory::manager& m_manager;
+      string::size_type m_capacity;
+      string::size_type m_length;
+      std::size_t m_width;
+      ref<string> m_result;
+      void* m_units;
     };
 
+    /**
+     * Strings shorter than this are never stored as concatenations, they are
+     * copied into a single simple string instead.
+     */
+    static const string::size_type rope_leaf_length = 128;
+
+    /**
+     * Maximum depth of a rope which is not balanced before it's rebalanced.
+     */
+    static const std::size_t rope_max_depth = 48;
+
+    /**
+     * Number of character lookups after which a rope is flattened into a
+     * contiguous buffer.
+     */
+    static const unsigned int rope_flatten_access_count = 32;
+
+    /**
+     * Node of a rope, which joins two strings together without copying their
+     * contents. Once enough characters have been looked up from the node, its
+     * contents are flattened into a contiguous buffer so that further
+     * lookups do not need to descend into the rope.
+     */
     class concat_string : public string
     {
     public:
-      explicit concat_string(const std::shared_ptr<string>& left,
-                             const std::shared_ptr<string>& right)
+      explicit concat_string(const ref<string>& left,
+                             const ref<string>& right)
         : m_length(left->length() + right->length())
+        , m_depth(std::max(left->depth(), right->depth()) + 1)
         , m_left(left)
-        , m_right(right) {}
+        , m_right(right)
+        , m_accesses(0)
+        , m_flat(nullptr) {}
+
+      ~concat_string()
+      {
+        delete[] m_flat.load(std::memory_order_relaxed);
+      }
 
       inline size_type length() const
       {
         return m_length;
       }
 
+      std::size_t depth() const
+      {
+        return m_depth;
+      }
+
+      inline const ref<string>& left() const
+      {
+        return m_left;
+      }
+
+      inline const ref<string>& right() const
+      {
+        return m_right;
+      }
+
       value_type at(size_type offset) const
       {
-        const size_type left_length = m_left->length();
+        if (const auto flat = flatten())
+        {
+          return flat[offset];
+        }
+
+        return leaf(offset)->at(offset);
+      }
 
-        if (offset < left_length)
+      const_pointer chunk(size_type offset, size_type& size) const
+      {
+        if (const auto flat = m_flat.load(std::memory_order_acquire))
         {
-          return m_left->at(offset);
-        } else {
-          return m_right->at(offset - left_length);
+          size = m_length - offset;
+
+          return flat + offset;
+        }
+
+        return leaf(offset)->chunk(offset, size);
+      }
+
+      const void* units(size_type offset,
+                        size_type& size,
+                        std::size_t& width) const
+      {
+        if (const auto flat = m_flat.load(std::memory_order_acquire))
+        {
+          size = m_length - offset;
+          width = sizeof(value_type);
+
+          return flat + offset;
+        }
+
+        return leaf(offset)->units(offset, size, width);
+      }
+
+      void copy(pointer output) const
+      {
+        if (const auto flat = m_flat.load(std::memory_order_acquire))
+        {
+          std::memcpy(output, flat, sizeof(char32_t) * m_length);
+          return;
+        }
+        m_left->copy(output);
+        m_right->copy(output + m_left->length());
+      }
+
+    private:
+      /**
+       * Descends the rope iteratively until the leaf containing given offset
+       * has been found. The offset is adjusted to be relative to the leaf.
+       */
+      const string* leaf(size_type& offset) const
+      {
+        const string* node = this;
+
+        while (node->depth() > 0)
+        {
+          const auto concat = static_cast<const concat_string*>(node);
+          const auto left_length = concat->m_left->length();
+
+          if (offset < left_length)
+          {
+            node = concat->m_left.get();
+          } else {
+            node = concat->m_right.get();
+            offset -= left_length;
+          }
+        }
+
+        return node;
+      }
+
+      /**
+       * Returns pointer to the flattened contents of the rope, or null
+       * pointer if the rope has not been accessed often enough to be
+       * flattened yet.
+       */
+      const value_type* flatten() const
+      {
+        value_type* flat = m_flat.load(std::memory_order_acquire);
+        value_type* expected = nullptr;
+
+        if (flat ||
+            m_accesses.fetch_add(1, std::memory_order_relaxed) <
+            rope_flatten_access_count)
+        {
+          return flat;
+        }
+
+        flat = new value_type[m_length];
+        copy(flat);
+
+        // Another thread might have flattened the rope at the same time, in
+        // which case the buffer constructed by it is used instead.
+        if (!m_flat.compare_exchange_strong(expected,
+                                            flat,
+                                            std::memory_order_acq_rel))
+        {
+          delete[] flat;
+
+          return expected;
         }
+
+        return flat;
       }
 
     private:
       const size_type m_length;
-      const std::shared_ptr<string> m_left;
-      const std::shared_ptr<string> m_right;
+      const std::size_t m_depth;
+      const ref<string> m_left;
+      const ref<string> m_right;
+      mutable std::atomic<unsigned int> m_accesses;
+      mutable std::atomic<value_type*> m_flat;
     };
 
     class substring : public string
     {
     public:
-      explicit substring(const std::shared_ptr<string>& original,
+      explicit substring(const ref<string>& original,
                          size_type offset,
                          size_type length)
         : m_original(original)
@@ -129,8 +492,28 @@ namespace plorth
         return m_original->at(m_offset + offset);
       }
 
+      const_pointer chunk(size_type offset, size_type& size) const
+      {
+        const auto data = m_original->chunk(m_offset + offset, size);
+
+        size = std::min(size, m_length - offset);
+
+        return data;
+      }
+
+      const void* units(size_type offset,
+                        size_type& size,
+                        std::size_t& width) const
+      {
+        const auto data = m_original->units(m_offset + offset, size, width);
+
+        size = std::min(size, m_length - offset);
+
+        return data;
+      }
+
     private:
-      const std::shared_ptr<string> m_original;
+      const ref<string> m_original;
       const size_type m_offset;
       const size_type m_length;
     };
@@ -141,7 +524,7 @@ namespace plorth
     class reversed_string : public string
     {
     public:
-      explicit reversed_string(const std::shared_ptr<string>& original)
+      explicit reversed_string(const ref<string>& original)
         : m_original(original) {}
 
       inline size_type length() const
@@ -154,34 +537,583 @@ namespace plorth
         return m_original->at(length() - offset - 1);
       }
 
-    private:
-      const std::shared_ptr<string> m_original;
-    };
+    private:
+      const ref<string> m_original;
+    };
+
+    /**
+     * Tests whether the rope is shallow enough in relation to its length to
+     * be considered balanced. Balanced ropes are not taken apart when a rope
+     * containing them is rebalanced.
+     */
+    static bool is_balanced(const ref<string>& str)
+    {
+      std::size_t max_depth = 2;
+
+      for (auto n = str->length() / rope_leaf_length; n > 0; n >>= 1)
+      {
+        ++max_depth;
+      }
+
+      return str->depth() <= max_depth;
+    }
+
+    static ref<string> make_balanced_rope(
+      const ref<runtime>& runtime,
+      const std::vector<ref<string>>& parts,
+      std::size_t begin,
+      std::size_t end
+    )
+    {
+      const auto middle = begin + (end - begin) / 2;
+
+      if (end - begin == 1)
+      {
+        return parts[begin];
+      }
+
+      return runtime->value<concat_string>(
+        make_balanced_rope(runtime, parts, begin, middle),
+        make_balanced_rope(runtime, parts, middle, end)
+      );
+    }
+
+    /**
+     * Rebuilds given rope so that its depth is logarithmic to the number of
+     * parts it consists of. Adjacent short leaves are merged together.
+     */
+    static ref<string> rebalance(const ref<runtime>& runtime,
+                                 const ref<string>& rope)
+    {
+      std::vector<const ref<string>*> stack;
+      std::vector<ref<string>> parts;
+      std::u32string pending;
+
+      stack.push_back(&rope);
+      while (!stack.empty())
+      {
+        const auto& node = *stack.back();
+
+        stack.pop_back();
+        if (node->depth() > 0 && !is_balanced(node))
+        {
+          const auto concat = static_cast<const concat_string*>(node.get());
+
+          stack.push_back(&concat->right());
+          stack.push_back(&concat->left());
+          continue;
+        }
+        if (node->length() < rope_leaf_length)
+        {
+          auto offset = pending.length();
+
+          if (offset + node->length() > rope_leaf_length)
+          {
+            parts.push_back(runtime->string(pending));
+            pending.clear();
+            offset = 0;
+          }
+          pending.resize(offset + node->length());
+          node->copy(&pending[offset]);
+          continue;
+        }
+        if (!pending.empty())
+        {
+          parts.push_back(runtime->string(pending));
+          pending.clear();
+        }
+        parts.push_back(node);
+      }
+      if (!pending.empty())
+      {
+        parts.push_back(runtime->string(pending));
+      }
+
+      return make_balanced_rope(runtime, parts, 0, parts.size());
+    }
+
+    /**
+     * Concatenates two strings together. Short results are copied into a
+     * single simple string, while longer ones are stored as ropes which are
+     * rebalanced when they grow too deep.
+     */
+    static ref<string> concat(const ref<runtime>& runtime,
+                              const ref<string>& left,
+                              const ref<string>& right)
+    {
+      const auto left_length = left->length();
+      const auto right_length = right->length();
+      ref<string> result;
+
+      if (!left_length)
+      {
+        return right;
+      }
+      else if (!right_length)
+      {
+        return left;
+      }
+      else if (left_length + right_length <= rope_leaf_length)
+      {
+        std::u32string buffer;
+
+        buffer.resize(left_length + right_length);
+        left->copy(&buffer[0]);
+        right->copy(&buffer[left_length]);
+
+        return runtime->string(buffer);
+      }
+
+      // When short string is appended into a rope which ends with a short
+      // leaf, the two are merged together instead of growing the rope.
+      if (left->depth() > 0 && right_length < rope_leaf_length)
+      {
+        const auto node = static_cast<const concat_string*>(left.get());
+        const auto& last = node->right();
+
+        if (!last->depth() &&
+            last->length() + right_length <= rope_leaf_length)
+        {
+          return runtime->value<concat_string>(
+            node->left(),
+            concat(runtime, last, right)
+          );
+        }
+      }
+
+      result = runtime->value<concat_string>(left, right);
+      if (result->depth() > rope_max_depth && !is_balanced(result))
+      {
+        return rebalance(runtime, result);
+      }
+
+      return result;
+    }
+
+    /**
+     * Repeats given string by doubling it, so that the resulting rope has
+     * depth logarithmic to the repeat count.
+     */
+    static ref<string> repeat(const ref<runtime>& runtime,
+                              const ref<string>& str,
+                              number::int_type count)
+    {
+      ref<string> power = str;
+      ref<string> result;
+
+      for (;;)
+      {
+        if (count & 1)
+        {
+          result = result ? concat(runtime, result, power) : power;
+        }
+        count >>= 1;
+        if (!count)
+        {
+          break;
+        }
+        power = concat(runtime, power, power);
+      }
+
+      return result;
+    }
+
+    /**
+     * Contiguous view to code units of a string. Strings which are stored in
+     * a single chunk are referenced directly, others are decoded into a
+     * buffer owned by the view.
+     */
+    class flat_string
+    {
+    public:
+      explicit flat_string(const string& str)
+        : m_length(str.length())
+        , m_width(sizeof(char32_t))
+      {
+        string::size_type size = 0;
+        const auto data = m_length > 0
+          ? str.units(0, size, m_width)
+          : nullptr;
+
+        if (data && size == m_length)
+        {
+          m_data = data;
+        } else {
+          m_buffer = str.to_string();
+          m_data = m_buffer.data();
+          m_width = sizeof(char32_t);
+        }
+      }
+
+      flat_string(const flat_string&) = delete;
+      void operator=(const flat_string&) = delete;
+
+      inline string::size_type length() const
+      {
+        return m_length;
+      }
+
+      inline std::size_t width() const
+      {
+        return m_width;
+      }
+
+      inline const void* data() const
+      {
+        return m_data;
+      }
+
+      /**
+       * Invokes given callback with pointer to the code units of the string.
+       */
+      template<class Callback>
+      inline auto visit(Callback callback) const
+      {
+        return visit_units(m_data, m_width, callback);
+      }
+
+    private:
+      const string::size_type m_length;
+      std::size_t m_width;
+      const void* m_data;
+      std::u32string m_buffer;
+    };
+
+    /**
+     * Returns code units of the string beginning from given offset. Parts of
+     * the string which have no contiguous storage are decoded into given
+     * buffer.
+     */
+    static const void* units_at(const string& str,
+                                string::size_type offset,
+                                string::size_type& size,
+                                std::size_t& width,
+                                char32_t (&buffer)[64])
+    {
+      if (const auto data = str.units(offset, size, width))
+      {
+        return data;
+      }
+      size = std::min<string::size_type>(str.length() - offset, 64);
+      width = sizeof(char32_t);
+      str.read(offset, size, buffer);
+
+      return buffer;
+    }
+
+    /**
+     * Tests whether contents of string `b` can be found from string `a`
+     * beginning from given offset. The strings are compared chunk by chunk,
+     * in whatever code unit widths they are stored in.
+     */
+    static bool equal_chunks(const string& a,
+                             string::size_type offset,
+                             const string& b)
+    {
+      const auto length = b.length();
+      char32_t a_buffer[64];
+      char32_t b_buffer[64];
+
+      for (string::size_type i = 0; i < length;)
+      {
+        string::size_type a_size;
+        string::size_type b_size;
+        std::size_t a_width;
+        std::size_t b_width;
+        const auto a_data = units_at(a, offset + i, a_size, a_width, a_buffer);
+        const auto b_data = units_at(b, i, b_size, b_width, b_buffer);
+        const auto count = std::min({ a_size, b_size, length - i });
+        const bool equal = visit_units(a_data, a_width, [&](auto x)
+        {
+          return visit_units(b_data, b_width, [x, count](auto y)
+          {
+            return std::equal(x, x + count, y);
+          });
+        });
+
+        if (!equal)
+        {
+          return false;
+        }
+        i += count;
+      }
+
+      return true;
+    }
+
+    /**
+     * Converts code units into code units of type T. Returns false if some
+     * of them do not fit into the narrower code units, in which case the
+     * input cannot be found from a string stored in such code units either.
+     */
+    template<class T, class U>
+    static bool convert_units(const U* input,
+                              string::size_type length,
+                              std::vector<T>& output)
+    {
+      output.resize(length);
+      for (string::size_type i = 0; i < length; ++i)
+      {
+        if constexpr (sizeof(U) > sizeof(T))
+        {
+          if (input[i] > static_cast<U>(std::numeric_limits<T>::max()))
+          {
+            return false;
+          }
+        }
+        output[i] = static_cast<T>(input[i]);
+      }
+
+      return true;
+    }
+
+    /**
+     * Searches for the first or the last occurrence of a substring from the
+     * string. The search is performed in code units of the string, into which
+     * the substring is converted first if it's stored in different width.
+     */
+    static std::size_t find_substring(const string& str,
+                                      const string& substr,
+                                      bool last)
+    {
+      const flat_string haystack(str);
+      const flat_string needle(substr);
+
+      return haystack.visit([&needle, last, &haystack](auto units)
+      {
+        using unit_type = std::remove_cv_t<
+          std::remove_pointer_t<decltype(units)>
+        >;
+        std::vector<unit_type> buffer;
+        const unit_type* data;
+
+        if (needle.width() == sizeof(unit_type))
+        {
+          data = static_cast<const unit_type*>(needle.data());
+        }
+        else if (needle.visit([&needle, &buffer](auto chars)
+                 {
+                   return convert_units(chars, needle.length(), buffer);
+                 }))
+        {
+          data = buffer.data();
+        } else {
+          return search::npos;
+        }
+
+        if (last)
+        {
+          return search::rfind(
+            units,
+            haystack.length(),
+            data,
+            needle.length()
+          );
+        }
+
+        return search::find(units, haystack.length(), data, needle.length());
+      });
+    }
+
+    /**
+     * Returns table which maps each Latin-1 character with given callback.
+     */
+    template<char32_t (*Callback)(char32_t)>
+    static std::array<char32_t, 256> latin1_table()
+    {
+      std::array<char32_t, 256> table;
+
+      for (char32_t c = 0; c < 256; ++c)
+      {
+        table[c] = Callback(c);
+      }
+
+      return table;
+    }
+
+    /**
+     * Maps code points of the string beginning from given offset with given
+     * callback and appends the results into the builder. Latin-1 code units
+     * are mapped through a table computed once for each callback.
+     */
+    template<char32_t (*Callback)(char32_t)>
+    static void convert_string(compact_builder& builder,
+                               const string& str,
+                               string::size_type offset)
+    {
+      static const auto table = latin1_table<Callback>();
+      const auto length = str.length();
+      char32_t buffer[64];
+      char32_t output[64];
+
+      while (offset < length)
+      {
+        string::size_type size;
+        std::size_t width;
+        const auto data = units_at(str, offset, size, width, buffer);
+
+        offset += size;
+        visit_units(data, width, [&builder, &output, size](auto units)
+        {
+          for (string::size_type i = 0; i < size; i += 64)
+          {
+            const auto count = std::min<string::size_type>(size - i, 64);
+
+            for (string::size_type j = 0; j < count; ++j)
+            {
+              const auto c = units[i + j];
+
+              if constexpr (sizeof(c) == 1)
+              {
+                output[j] = table[c];
+              } else {
+                output[j] = Callback(c);
+              }
+            }
+            builder.append(output, count);
+          }
+        });
+      }
+    }
+  }
+
+  string::const_pointer string::chunk(size_type, size_type&) const
+  {
+    return nullptr;
+  }
+
+  const void* string::units(size_type offset,
+                            size_type& size,
+                            std::size_t& width) const
+  {
+    width = sizeof(value_type);
+
+    return chunk(offset, size);
+  }
+
+  void string::read(size_type offset, size_type count, pointer output) const
+  {
+    while (count > 0)
+    {
+      size_type size;
+      std::size_t width;
+      const auto data = units(offset, size, width);
+
+      if (!data)
+      {
+        for (size_type i = 0; i < count; ++i)
+        {
+          output[i] = at(offset + i);
+        }
+        return;
+      }
+      size = std::min(size, count);
+      visit_units(data, width, [output, size](auto units)
+      {
+        std::copy(units, units + size, output);
+      });
+      output += size;
+      offset += size;
+      count -= size;
+    }
+  }
+
+  void string::copy(pointer output) const
+  {
+    read(0, length(), output);
+  }
+
+  bool string::equals(const ref<class value>& that) const
+  {
+    const string* str;
+
+    if (!is(that, type::string))
+    {
+      return false;
+    }
+    str = static_cast<const string*>(that.get());
+
+    return length() == str->length() && equal_chunks(*this, 0, *str);
   }
 
-  bool string::equals(const std::shared_ptr<class value>& that) const
+  int string::compare(const string& that) const
   {
-    const size_type len = length();
-    std::shared_ptr<string> str;
+    const auto this_length = length();
+    const auto that_length = that.length();
+    const auto length = std::min(this_length, that_length);
+    char32_t a_buffer[64];
+    char32_t b_buffer[64];
 
-    if (!is(that, type::string))
+    for (size_type i = 0; i < length;)
     {
-      return false;
+      size_type a_size;
+      size_type b_size;
+      std::size_t a_width;
+      std::size_t b_width;
+      const auto a_data = units_at(*this, i, a_size, a_width, a_buffer);
+      const auto b_data = units_at(that, i, b_size, b_width, b_buffer);
+      const auto count = std::min({ a_size, b_size, length - i });
+      const int result = visit_units(a_data, a_width, [&](auto x)
+      {
+        return visit_units(b_data, b_width, [x, count](auto y)
+        {
+          const auto position = std::mismatch(x, x + count, y);
+
+          if (position.first == x + count)
+          {
+            return 0;
+          }
+
+          return static_cast<char32_t>(*position.first)
+            < static_cast<char32_t>(*position.second) ? -1 : 1;
+        });
+      });
+
+      if (result)
+      {
+        return result;
+      }
+      i += count;
     }
-    str = std::static_pointer_cast<string>(that);
-    if (len != str->length())
+
+    if (this_length == that_length)
     {
-      return false;
+      return 0;
     }
-    for (size_type i = 0; i < len; ++i)
+
+    return this_length < that_length ? -1 : 1;
+  }
+
+  std::size_t string::hash() const
+  {
+    static const auto prime = static_cast<std::size_t>(0x100000001b3ull);
+    const auto len = length();
+    std::size_t result = len;
+    char32_t buffer[64];
+
+    // Code points are hashed one by one regardless of the width of the code
+    // units they are stored in, so that equal strings hash identically.
+    for (size_type offset = 0; offset < len;)
     {
-      if (at(i) != str->at(i))
+      size_type size;
+      std::size_t width;
+      const auto data = units_at(*this, offset, size, width, buffer);
+
+      result = visit_units(data, width, [result, size](auto units)
       {
-        return false;
-      }
+        auto code = result;
+
+        for (size_type i = 0; i < size; ++i)
+        {
+          code = (code ^ units[i]) * prime;
+        }
+
+        return code;
+      });
+      offset += size;
     }
 
-    return true;
+    return result;
   }
 
   std::u32string string::to_string() const
@@ -189,10 +1121,10 @@ namespace plorth
     const size_type len = length();
     std::u32string result;
 
-    result.reserve(len);
-    for (size_type i = 0; i < len; ++i)
+    if (len > 0)
     {
-      result.append(1, at(i));
+      result.resize(len);
+      copy(&result[0]);
     }
 
     return result;
@@ -203,7 +1135,7 @@ namespace plorth
     return json_stringify(to_string());
   }
 
-  string::iterator::iterator(const std::shared_ptr<string>& str,
+  string::iterator::iterator(const ref<string>& str,
                              string::size_type index)
     : m_string(str)
     , m_index(index) {}
@@ -251,17 +1183,65 @@ namespace plorth
     return m_index != that.m_index;
   }
 
-  std::shared_ptr<string> runtime::string(const std::u32string& input)
+  ref<string> runtime::string(const std::u32string& input)
   {
     return string(input.c_str(), input.length());
   }
 
-  std::shared_ptr<string> runtime::string(string::const_pointer chars,
-                                          string::size_type length)
+  ref<string> runtime::string(string::const_pointer chars,
+                              string::size_type length)
+  {
+    compact_builder builder(*m_memory_manager, length);
+
+    builder.append(chars, length);
+
+    return builder.build();
+  }
+
+  bool runtime::decode_string(const char* input,
+                              std::size_t length,
+                              ref<class string>& output)
   {
-    return std::shared_ptr<class string>(
-      new (*m_memory_manager) simple_string(chars, length)
-    );
+    const auto bytes = reinterpret_cast<const unsigned char*>(input);
+    compact_builder builder(*m_memory_manager, length);
+
+    for (std::size_t i = 0; i < length;)
+    {
+      std::size_t end = i;
+      std::size_t size;
+      char32_t c;
+
+      // Runs of ASCII characters are appended without decoding them.
+      while (end < length && bytes[end] < 0x80)
+      {
+        ++end;
+      }
+      if (end > i)
+      {
+        builder.append(bytes + i, end - i);
+        i = end;
+        continue;
+      }
+      size = peelo::unicode::encoding::utf8::sequence_length(bytes[i]);
+      if (!size || i + size > length)
+      {
+        return false;
+      }
+      c = bytes[i] & (0xff >> (size + 1));
+      for (std::size_t j = 1; j < size; ++j)
+      {
+        if ((bytes[i + j] & 0xc0) != 0x80)
+        {
+          return false;
+        }
+        c = (c << 6) | (bytes[i + j] & 0x3f);
+      }
+      builder.push(c);
+      i += size;
+    }
+    output = builder.build();
+
+    return true;
   }
 
   /**
@@ -277,41 +1257,32 @@ namespace plorth
    *
    * Returns the length of the string.
    */
-  static void w_length(const std::shared_ptr<context>& ctx)
+  static void w_length(const ref<context>& ctx, const string& str)
   {
-    std::shared_ptr<string> str;
-
-    if (ctx->pop_string(str))
-    {
-      ctx->push(str);
-      ctx->push_int(str->length());
-    }
+    ctx->push_int(str.length());
   }
 
-  static void str_test(const std::shared_ptr<context>& ctx,
+  static void str_test(const ref<context>& ctx,
+                       const string& str,
                        bool (*callback)(char32_t))
   {
-    std::shared_ptr<string> str;
+    const auto length = str.length();
+    bool result = length > 0;
+    char32_t buffer[64];
 
-    if (!ctx->pop_string(str))
-    {
-      return;
-    }
-    ctx->push(str);
-    if (str->empty())
-    {
-      ctx->push_boolean(false);
-      return;
-    }
-    for (const auto c : str)
+    for (string::size_type offset = 0; result && offset < length;)
     {
-      if (!callback(c))
+      string::size_type size;
+      std::size_t width;
+      const auto data = units_at(str, offset, size, width, buffer);
+
+      result = visit_units(data, width, [callback, size](auto units)
       {
-        ctx->push_boolean(false);
-        return;
-      }
+        return std::all_of(units, units + size, callback);
+      });
+      offset += size;
     }
-    ctx->push_boolean(true);
+    ctx->push_boolean(result);
   }
 
   /**
@@ -329,58 +1300,15 @@ namespace plorth
    * Tests whether the topmost string contains contents of the second string,
    * returning true or false as appropriate.
    */
-  static void w_includes(const std::shared_ptr<context>& ctx)
+  static void w_includes(const ref<context>& ctx,
+                         const string& str,
+                         const string& substr)
   {
-    std::shared_ptr<string> str;
-    std::shared_ptr<string> substr;
-
-    if (!ctx->pop_string(str) || !ctx->pop_string(substr))
-    {
-      return;
-    }
-
-    const auto str_length = str->length();
-    const auto substr_length = substr->length();
-
-    if (substr_length > str_length)
-    {
-      ctx->push(str);
-      ctx->push_boolean(false);
-      return;
-    }
-    else if (!substr_length)
-    {
-      ctx->push(str);
-      ctx->push_boolean(true);
-      return;
-    }
+    const bool result = substr.length() <= str.length() &&
+      find_substring(str, substr, false) != search::npos;
 
-    for (string::size_type i = 0; i < str_length; ++i)
-    {
-      bool found = true;
-
-      if (i + substr_length > str_length)
-      {
-        break;
-      }
-      for (string::size_type j = 0; j < substr_length; ++j)
-      {
-        if (str->at(i + j) != substr->at(j))
-        {
-          found = false;
-          break;
-        }
-      }
-      if (found)
-      {
-        ctx->push(str);
-        ctx->push_boolean(true);
-        return;
-      }
-    }
-
-    ctx->push(str);
-    ctx->push_boolean(false);
+    ctx->nip();
+    ctx->push_boolean(result);
   }
 
   /**
@@ -400,56 +1328,23 @@ namespace plorth
    * substring does not exist in the string, null will be returned. Otherwise,
    * first numerical index of the occurrence is returned.
    */
-  static void w_index_of(const std::shared_ptr<context>& ctx)
+  static void w_index_of(const ref<context>& ctx,
+                         const string& str,
+                         const string& substr)
   {
-    std::shared_ptr<string> str;
-    std::shared_ptr<string> substr;
+    auto index = search::npos;
 
-    if (!ctx->pop_string(str) || !ctx->pop_string(substr))
+    if (substr.length() <= str.length())
     {
-      return;
+      index = find_substring(str, substr, false);
     }
-
-    const auto str_length = str->length();
-    const auto substr_length = substr->length();
-
-    ctx->push(str);
-
-    if (substr_length > str_length)
+    ctx->nip();
+    if (index != search::npos)
     {
+      ctx->push_int(index);
+    } else {
       ctx->push_null();
-      return;
-    }
-    else if (!substr_length)
-    {
-      ctx->push_int(0);
-      return;
-    }
-
-    for (string::size_type i = 0; i < str_length; ++i)
-    {
-      bool found = true;
-
-      if (i + substr_length > str_length)
-      {
-        break;
-      }
-      for (string::size_type j = 0; j < substr_length; ++j)
-      {
-        if (str->at(i + j) != substr->at(j))
-        {
-          found = false;
-          break;
-        }
-      }
-      if (found)
-      {
-        ctx->push_int(i);
-        return;
-      }
     }
-
-    ctx->push_null();
   }
 
   /**
@@ -469,56 +1364,23 @@ namespace plorth
    * substring does not exist in the string, null will be returned. Otherwise,
    * last numerical index of the occurrence is returned.
    */
-  static void w_last_index_of(const std::shared_ptr<context>& ctx)
+  static void w_last_index_of(const ref<context>& ctx,
+                              const string& str,
+                              const string& substr)
   {
-    std::shared_ptr<string> str;
-    std::shared_ptr<string> substr;
+    auto index = search::npos;
 
-    if (!ctx->pop_string(str) || !ctx->pop_string(substr))
+    if (substr.length() <= str.length())
     {
-      return;
+      index = find_substring(str, substr, true);
     }
-
-    const auto str_length = str->length();
-    const auto substr_length = substr->length();
-
-    ctx->push(str);
-
-    if (substr_length > str_length)
+    ctx->nip();
+    if (index != search::npos)
     {
+      ctx->push_int(index);
+    } else {
       ctx->push_null();
-      return;
-    }
-    else if (!substr_length)
-    {
-      ctx->push_int(str_length);
-      return;
     }
-
-    for (auto i = str_length; i > 0; --i)
-    {
-      bool found = true;
-
-      if (str_length - i + 1 < substr_length)
-      {
-        continue;
-      }
-      for (string::size_type j = 0; j < substr_length; ++j)
-      {
-        if (str->at(i + j - 1) != substr->at(j))
-        {
-          found = false;
-          break;
-        }
-      }
-      if (found)
-      {
-        ctx->push_int(i - 1);
-        return;
-      }
-    }
-
-    ctx->push_null();
   }
 
   /**
@@ -536,44 +1398,15 @@ namespace plorth
    * Tests whether beginning of the string is identical with the given
    * substring.
    */
-  static void w_starts_with(const std::shared_ptr<context>& ctx)
+  static void w_starts_with(const ref<context>& ctx,
+                            const string& str,
+                            const string& substr)
   {
-    std::shared_ptr<string> str;
-    std::shared_ptr<string> substr;
-
-    if (!ctx->pop_string(str) || !ctx->pop_string(substr))
-    {
-      return;
-    }
-
-    const auto str_length = str->length();
-    const auto substr_length = substr->length();
-
-    if (substr_length > str_length)
-    {
-      ctx->push(str);
-      ctx->push_boolean(false);
-      return;
-    }
-    else if (!substr_length)
-    {
-      ctx->push(str);
-      ctx->push_boolean(true);
-      return;
-    }
-
-    for (string::size_type i = 0; i < substr_length; ++i)
-    {
-      if (str->at(i) != substr->at(i))
-      {
-        ctx->push(str);
-        ctx->push_boolean(false);
-        return;
-      }
-    }
+    const bool result = substr.length() <= str.length() &&
+      equal_chunks(str, 0, substr);
 
-    ctx->push(str);
-    ctx->push_boolean(true);
+    ctx->nip();
+    ctx->push_boolean(result);
   }
 
   /**
@@ -590,44 +1423,17 @@ namespace plorth
    *
    * Tests whether end of the string is identical with the given substring.
    */
-  static void w_ends_with(const std::shared_ptr<context>& ctx)
+  static void w_ends_with(const ref<context>& ctx,
+                          const string& str,
+                          const string& substr)
   {
-    std::shared_ptr<string> str;
-    std::shared_ptr<string> substr;
-
-    if (!ctx->pop_string(str) || !ctx->pop_string(substr))
-    {
-      return;
-    }
-
-    const auto str_length = str->length();
-    const auto substr_length = substr->length();
-
-    if (substr_length > str_length)
-    {
-      ctx->push(str);
-      ctx->push_boolean(false);
-      return;
-    }
-    else if (!substr_length)
-    {
-      ctx->push(str);
-      ctx->push_boolean(true);
-      return;
-    }
-
-    for (string::size_type i = 0; i < substr_length; ++i)
-    {
-      if (str->at(str_length - substr_length + i) != substr->at(i))
-      {
-        ctx->push(str);
-        ctx->push_boolean(false);
-        return;
-      }
-    }
+    const auto str_length = str.length();
+    const auto substr_length = substr.length();
+    const bool result = substr_length <= str_length &&
+      equal_chunks(str, str_length - substr_length, substr);
 
-    ctx->push(str);
-    ctx->push_boolean(true);
+    ctx->nip();
+    ctx->push_boolean(result);
   }
 
   /**
@@ -644,9 +1450,9 @@ namespace plorth
    * Tests whether the string contains only whitespace characters. Empty
    * strings return false.
    */
-  static void w_is_space(const std::shared_ptr<context>& ctx)
+  static void w_is_space(const ref<context>& ctx, const string& str)
   {
-    str_test(ctx, peelo::unicode::ctype::isspace);
+    str_test(ctx, str, peelo::unicode::ctype::isspace);
   }
 
   /**
@@ -663,9 +1469,9 @@ namespace plorth
    * Tests whether the string contains only lower case characters. Empty
    * strings return false.
    */
-  static void w_is_lower_case(const std::shared_ptr<context>& ctx)
+  static void w_is_lower_case(const ref<context>& ctx, const string& str)
   {
-    str_test(ctx, peelo::unicode::ctype::islower);
+    str_test(ctx, str, peelo::unicode::ctype::islower);
   }
 
   /**
@@ -682,9 +1488,9 @@ namespace plorth
    * Tests whether the string contains only upper case characters. Empty strings
    * return false.
    */
-  static void w_is_upper_case(const std::shared_ptr<context>& ctx)
+  static void w_is_upper_case(const ref<context>& ctx, const string& str)
   {
-    str_test(ctx, peelo::unicode::ctype::isupper);
+    str_test(ctx, str, peelo::unicode::ctype::isupper);
   }
 
   /**
@@ -701,24 +1507,24 @@ namespace plorth
    * Extracts characters from the string and returns them in an array of
    * substrings.
    */
-  static void w_chars(const std::shared_ptr<context>& ctx)
+  static void w_chars(const ref<context>& ctx, const string& str)
   {
     const auto& runtime = ctx->runtime();
-    std::shared_ptr<string> str;
+    const auto length = str.length();
+    std::vector<ref<value>> output;
 
-    if (ctx->pop_string(str))
+    output.reserve(length);
+    str.for_each_chunk([&runtime, &output](string::const_pointer data,
+                                           string::size_type size)
     {
-      const auto length = str->length();
-      std::vector<std::shared_ptr<value>> output;
-
-      output.reserve(length);
-      for (const auto c : str)
+      for (string::size_type i = 0; i < size; ++i)
       {
-        output.push_back(runtime->string(&c, 1));
+        output.push_back(runtime->string(data + i, 1));
       }
-      ctx->push(str);
-      ctx->push_array(output.data(), length);
-    }
+
+      return true;
+    });
+    ctx->push_array(output.data(), length);
   }
 
   /**
@@ -735,24 +1541,26 @@ namespace plorth
    * Extracts Unicode code points from the string and returns them in an array
    * of numbers.
    */
-  static void w_runes(const std::shared_ptr<context>& ctx)
+  static void w_runes(const ref<context>& ctx, const string& str)
   {
     const auto& runtime = ctx->runtime();
-    std::shared_ptr<string> str;
+    const auto length = str.length();
+    std::vector<ref<value>> output;
 
-    if (ctx->pop_string(str))
+    output.reserve(length);
+    str.for_each_chunk([&runtime, &output](string::const_pointer data,
+                                           string::size_type size)
     {
-      const auto length = str->length();
-      std::vector<std::shared_ptr<value>> output;
-
-      output.reserve(length);
-      for (const auto c : str)
+      for (string::size_type i = 0; i < size; ++i)
       {
-        output.push_back(runtime->number(static_cast<number::int_type>(c)));
+        output.push_back(
+          runtime->number(static_cast<number::int_type>(data[i]))
+        );
       }
-      ctx->push(str);
-      ctx->push_array(output.data(), length);
-    }
+
+      return true;
+    });
+    ctx->push_array(output.data(), length);
   }
 
   /**
@@ -769,39 +1577,41 @@ namespace plorth
    * Extracts white space separated words from the string and returns them in
    * an array.
    */
-  static void w_words(const std::shared_ptr<context>& ctx)
+  static void w_words(const ref<context>& ctx, const string&)
   {
     const auto& runtime = ctx->runtime();
-    std::shared_ptr<string> str;
-
-    if (ctx->pop_string(str))
+    // Substrings keep a reference to the string they are part of.
+    const auto str = ref_cast<string>(ctx->peek().boxed());
+    const flat_string flat(*str);
+    const auto length = flat.length();
+    string::size_type begin = 0;
+    string::size_type end = 0;
+    std::vector<ref<value>> result;
+
+    flat.visit([&](auto chars)
     {
-      const auto length = str->length();
-      string::size_type begin = 0;
-      string::size_type end = 0;
-      std::vector<std::shared_ptr<value>> result;
-
       for (string::size_type i = 0; i < length; ++i)
       {
-        if (peelo::unicode::ctype::isspace(str->at(i)))
+        if (peelo::unicode::ctype::isspace(chars[i]))
         {
           if (end - begin > 0)
           {
-            result.push_back(runtime->value<substring>(str, begin, end - begin));
+            result.push_back(
+              runtime->value<substring>(str, begin, end - begin)
+            );
           }
           begin = end = i + 1;
         } else {
           ++end;
         }
       }
-      if (end - begin > 0)
-      {
-        result.push_back(runtime->value<substring>(str, begin, end - begin));
-      }
-
-      ctx->push(str);
-      ctx->push_array(result.data(), result.size());
+    });
+    if (end - begin > 0)
+    {
+      result.push_back(runtime->value<substring>(str, begin, end - begin));
     }
+
+    ctx->push_array(result.data(), result.size());
   }
 
   /**
@@ -817,43 +1627,47 @@ namespace plorth
    *
    * Extracts lines from the string and returns them in an array.
    */
-  static void w_lines(const std::shared_ptr<context>& ctx)
+  static void w_lines(const ref<context>& ctx, const string&)
   {
     const auto& runtime = ctx->runtime();
-    std::shared_ptr<string> str;
-
-    if (ctx->pop_string(str))
+    // Substrings keep a reference to the string they are part of.
+    const auto str = ref_cast<string>(ctx->peek().boxed());
+    const flat_string flat(*str);
+    const auto length = flat.length();
+    string::size_type begin = 0;
+    string::size_type end = 0;
+    std::vector<ref<value>> result;
+
+    flat.visit([&](auto chars)
     {
-      const auto length = str->length();
-      string::size_type begin = 0;
-      string::size_type end = 0;
-      std::vector<std::shared_ptr<value>> result;
-
       for (string::size_type i = 0; i < length; ++i)
       {
-        const auto c = str->at(i);
+        const auto c = chars[i];
 
-        if (i + 1 < length && c == '\r' && str->at(i + 1) == '\n')
+        if (i + 1 < length && c == '\r' && chars[i + 1] == '\n')
         {
-          result.push_back(runtime->value<substring>(str, begin, end - begin));
+          result.push_back(
+            runtime->value<substring>(str, begin, end - begin)
+          );
           begin = end = ++i + 1;
         }
         else if (c == '\n' || c == '\r')
         {
-          result.push_back(runtime->value<substring>(str, begin, end - begin));
+          result.push_back(
+            runtime->value<substring>(str, begin, end - begin)
+          );
           begin = end = i + 1;
         } else {
           ++end;
         }
       }
-      if (end - begin > 0)
-      {
-        result.push_back(runtime->value<substring>(str, begin, end - begin));
-      }
-
-      ctx->push(str);
-      ctx->push_array(result.data(), result.size());
+    });
+    if (end - begin > 0)
+    {
+      result.push_back(runtime->value<substring>(str, begin, end - begin));
     }
+
+    ctx->push_array(result.data(), result.size());
   }
 
   /**
@@ -868,9 +1682,9 @@ namespace plorth
    *
    * Reverses the string.
    */
-  static void w_reverse(const std::shared_ptr<context>& ctx)
+  static void w_reverse(const ref<context>& ctx)
   {
-    std::shared_ptr<string> str;
+    ref<string> str;
 
     if (ctx->pop_string(str))
     {
@@ -878,21 +1692,20 @@ namespace plorth
     }
   }
 
-  static void str_convert(const std::shared_ptr<context>& ctx,
-                          char32_t (*callback)(char32_t))
+  template<char32_t (*Callback)(char32_t)>
+  static void str_convert(const ref<context>& ctx)
   {
-    std::shared_ptr<string> str;
+    ref<string> str;
 
     if (ctx->pop_string(str))
     {
-      const auto length = str->length();
-      char32_t result[length];
+      compact_builder builder(
+        ctx->runtime()->memory_manager(),
+        str->length()
+      );
 
-      for (string::size_type i = 0; i < length; ++i)
-      {
-        result[i] = callback(str->at(i));
-      }
-      ctx->push_string(result, length);
+      convert_string<Callback>(builder, *str, 0);
+      ctx->push(builder.build());
     }
   }
 
@@ -908,9 +1721,9 @@ namespace plorth
    *
    * Converts the string into upper case.
    */
-  static void w_upper_case(const std::shared_ptr<context>& ctx)
+  static void w_upper_case(const ref<context>& ctx)
   {
-    str_convert(ctx, peelo::unicode::ctype::toupper);
+    str_convert<peelo::unicode::ctype::toupper>(ctx);
   }
 
   /**
@@ -925,9 +1738,9 @@ namespace plorth
    *
    * Converts the string into lower case.
    */
-  static void w_lower_case(const std::shared_ptr<context>& ctx)
+  static void w_lower_case(const ref<context>& ctx)
   {
-    str_convert(ctx, peelo::unicode::ctype::tolower);
+    str_convert<peelo::unicode::ctype::tolower>(ctx);
   }
 
   static inline char32_t unicode_swapcase(char32_t c)
@@ -952,9 +1765,9 @@ namespace plorth
    *
    * Turns lower case characters in the string into upper case and vice versa.
    */
-  static void w_swap_case(const std::shared_ptr<context>& ctx)
+  static void w_swap_case(const ref<context>& ctx)
   {
-    str_convert(ctx, unicode_swapcase);
+    str_convert<unicode_swapcase>(ctx);
   }
 
   /**
@@ -970,28 +1783,23 @@ namespace plorth
    * Converts the first character of the string into upper case and the
    * remaining characters into lower case.
    */
-  static void w_capitalize(const std::shared_ptr<context>& ctx)
+  static void w_capitalize(const ref<context>& ctx)
   {
-    std::shared_ptr<string> str;
+    ref<string> str;
 
     if (ctx->pop_string(str))
     {
-      const auto length = str->length();
-      char32_t output[length];
+      compact_builder builder(
+        ctx->runtime()->memory_manager(),
+        str->length()
+      );
 
-      for (string::size_type i = 0; i < length; ++i)
+      if (!str->empty())
       {
-        auto c = str->at(i);
-
-        if (i == 0)
-        {
-          c = peelo::unicode::ctype::toupper(c);
-        } else {
-          c = peelo::unicode::ctype::tolower(c);
-        }
-        output[i] = c;
+        builder.push(peelo::unicode::ctype::toupper(str->at(0)));
+        convert_string<peelo::unicode::ctype::tolower>(builder, *str, 1);
       }
-      ctx->push_string(output, length);
+      ctx->push(builder.build());
     }
   }
 
@@ -1007,9 +1815,9 @@ namespace plorth
    *
    * Strips whitespace from the begining and the end of the string.
    */
-  static void w_trim(const std::shared_ptr<context>& ctx)
+  static void w_trim(const ref<context>& ctx)
   {
-    std::shared_ptr<string> str;
+    ref<string> str;
 
     if (ctx->pop_string(str))
     {
@@ -1051,9 +1859,9 @@ namespace plorth
    *
    * Strips whitespace from the begining of the string.
    */
-  static void w_trim_left(const std::shared_ptr<context>& ctx)
+  static void w_trim_left(const ref<context>& ctx)
   {
-    std::shared_ptr<string> str;
+    ref<string> str;
 
     if (ctx->pop_string(str))
     {
@@ -1088,9 +1896,9 @@ namespace plorth
    *
    * Strips whitespace from the end of the string.
    */
-  static void w_trim_right(const std::shared_ptr<context>& ctx)
+  static void w_trim_right(const ref<context>& ctx)
   {
-    std::shared_ptr<string> str;
+    ref<string> str;
 
     if (ctx->pop_string(str))
     {
@@ -1126,9 +1934,9 @@ namespace plorth
    * Converts string into a floating point decimal number, or throws a value
    * error if the number cannot be converted into one.
    */
-  static void w_to_number(const std::shared_ptr<context>& ctx)
+  static void w_to_number(const ref<context>& ctx)
   {
-    std::shared_ptr<string> a;
+    ref<string> a;
 
     if (ctx->pop_string(a))
     {
@@ -1156,23 +1964,14 @@ namespace plorth
    *
    * Concatenates the contents of the two strings and returns the result.
    */
-  static void w_concat(const std::shared_ptr<context>& ctx)
+  static void w_concat(const ref<context>& ctx)
   {
-    std::shared_ptr<string> a;
-    std::shared_ptr<string> b;
+    ref<string> a;
+    ref<string> b;
 
     if (ctx->pop_string(a) && ctx->pop_string(b))
     {
-      if (a->empty())
-      {
-        ctx->push(b);
-      }
-      else if (b->empty())
-      {
-        ctx->push(a);
-      } else {
-        ctx->push(ctx->runtime()->value<concat_string>(b, a));
-      }
+      ctx->push(concat(ctx->runtime(), b, a));
     }
   }
 
@@ -1189,25 +1988,18 @@ namespace plorth
    *
    * Repeats the string given number of times.
    */
-  static void w_repeat(const std::shared_ptr<context>& ctx)
+  static void w_repeat(const ref<context>& ctx)
   {
-    std::shared_ptr<string> str;
-    std::shared_ptr<number> num;
+    ref<string> str;
+    cell num;
 
     if (ctx->pop_string(str) && ctx->pop_number(num))
     {
-      number::int_type count = num->as_int();
+      number::int_type count = num.as_int();
 
       if (count > 0)
       {
-        const auto& runtime = ctx->runtime();
-        std::shared_ptr<string> result = str;
-
-        for (number::int_type i = 1; i < count; ++i)
-        {
-          result = runtime->value<concat_string>(result, str);
-        }
-        ctx->push(result);
+        ctx->push(repeat(ctx->runtime(), str, count));
       }
       else if (count == 0)
       {
@@ -1234,32 +2026,50 @@ namespace plorth
    * from the end of the string. If given index is out of bounds, a range error
    * will be thrown.
    */
-  static void w_get(const std::shared_ptr<context>& ctx)
+  static void w_get(const ref<context>& ctx,
+                    const string& str,
+                    number::int_type index)
   {
-    std::shared_ptr<string> str;
-    std::shared_ptr<number> num;
+    const auto length = str.length();
+    char32_t c;
 
-    if (ctx->pop_string(str) && ctx->pop_number(num))
+    if (index < 0)
     {
-      const auto length = str->length();
-      number::int_type index = num->as_int();
-      char32_t c;
+      index += length;
+    }
 
-      if (index < 0)
-      {
-        index += length;
-      }
+    if (!length || index < 0 || index >= static_cast<number::int_type>(length))
+    {
+      ctx->nip();
+      ctx->error(error::code::range, U"String index out of bounds.");
+      return;
+    }
 
-      ctx->push(str);
+    c = str.at(index);
+    ctx->nip();
+    ctx->push(ctx->runtime()->string(&c, 1));
+  }
 
-      if (!length || index < 0 || index >= static_cast<number::int_type>(length))
-      {
-        ctx->error(error::code::range, U"String index out of bounds.");
-        return;
-      }
+  /**
+   * Word: >seq
+   * Prototype: string
+   *
+   * Takes:
+   * - string
+   *
+   * Gives:
+   * - seq
+   *
+   * Returns lazy sequence of characters of the string, each one given as a
+   * substring.
+   */
+  static void w_to_seq(const ref<context>& ctx)
+  {
+    ref<string> str;
 
-      c = str->at(index);
-      ctx->push(ctx->runtime()->string(&c, 1));
+    if (ctx->pop_string(str))
+    {
+      ctx->push(ctx->runtime()->seq(str));
     }
   }
 
@@ -1276,9 +2086,9 @@ namespace plorth
    * Converts given string into symbol. Value error will be thrown if the string
    * is empty or contains whitespace or non-symbolic characters such as separators.
    */
-  static void w_to_symbol(const std::shared_ptr<context>& ctx)
+  static void w_to_symbol(const ref<context>& ctx)
   {
-    std::shared_ptr<string> str;
+    ref<string> str;
 
     if (ctx->pop_string(str))
     {
@@ -1310,21 +2120,21 @@ namespace plorth
     {
       return
       {
-        { U"length", w_length },
-        { U"chars", w_chars },
-        { U"runes", w_runes },
-        { U"words", w_words },
-        { U"lines", w_lines },
+        { U"length", native::thunk<w_length> },
+        { U"chars", native::thunk<w_chars> },
+        { U"runes", native::thunk<w_runes> },
+        { U"words", native::thunk<w_words> },
+        { U"lines", native::thunk<w_lines> },
 
         // Tests.
-        { U"includes?", w_includes },
-        { U"index-of", w_index_of },
-        { U"last-index-of", w_last_index_of },
-        { U"starts-with?", w_starts_with },
-        { U"ends-with?", w_ends_with },
-        { U"space?", w_is_space },
-        { U"lower-case?", w_is_lower_case },
-        { U"upper-case?", w_is_upper_case },
+        { U"includes?", native::thunk<w_includes> },
+        { U"index-of", native::thunk<w_index_of> },
+        { U"last-index-of", native::thunk<w_last_index_of> },
+        { U"starts-with?", native::thunk<w_starts_with> },
+        { U"ends-with?", native::thunk<w_ends_with> },
+        { U"space?", native::thunk<w_is_space> },
+        { U"lower-case?", native::thunk<w_is_lower_case> },
+        { U"upper-case?", native::thunk<w_is_upper_case> },
 
         // Conversions.
         { U"reverse", w_reverse },
@@ -1345,9 +2155,10 @@ namespace plorth
 
         { U"+", w_concat },
         { U"*", w_repeat },
-        { U"@", w_get },
+        { U"@", native::thunk<w_get> },
 
         // Type conversions.
+        { U">seq", w_to_seq },
         { U">symbol", w_to_symbol }
       };
     }
@@ -24,39 +24,58 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <plorth/context.hpp>
+#include <plorth/native.hpp>
+
+#include "./utils.hpp"
 
 namespace plorth
 {
-  symbol::symbol(
-    const std::u32string& id,
-    const std::optional<parser::position>& position
-  )
-    : m_id(id)
-    , m_position(position)
-    , m_hash(0) {}
-
-  std::size_t symbol::hash() const
+  static std::optional<cell> to_literal(const std::u32string& id)
   {
-    std::size_t h = m_hash;
+    number::int_type int_value;
+    number::real_type real_value;
 
-    if (h == 0)
+    if (!id.compare(U"null"))
     {
-      symbol* sym = const_cast<symbol*>(this);
-#if PLORTH_ENABLE_MUTEXES
-      std::lock_guard<std::mutex> lock(sym->m_mutex);
-#endif
-
-      h = sym->m_hash = std::hash<std::u32string>()(sym->m_id);
+      return cell();
+    }
+    else if (!id.compare(U"true"))
+    {
+      return cell::make_boolean(true);
+    }
+    else if (!id.compare(U"false"))
+    {
+      return cell::make_boolean(false);
+    }
+    else if (!is_number(id))
+    {
+      return std::optional<cell>();
+    }
+    else if (to_number(id, int_value, real_value))
+    {
+      return cell::make_int(int_value);
     }
 
-    return h;
+    return cell::make_real(real_value);
   }
 
-  bool symbol::equals(const std::shared_ptr<value>& that) const
+  symbol::symbol(
+    const class atom& id,
+    const std::optional<parser::position>& position
+  )
+    : m_atom(id)
+    , m_position(
+        position
+          ? std::optional<source_position>(source_position(*position))
+          : std::optional<source_position>()
+      )
+    , m_literal(to_literal(id.name())) {}
+
+  bool symbol::equals(const ref<value>& that) const
   {
     if (is(that, type::symbol))
     {
-      return !m_id.compare(std::static_pointer_cast<symbol>(that)->m_id);
+      return m_atom == static_cast<const symbol*>(that.get())->m_atom;
     } else {
       return false;
     }
@@ -69,31 +88,35 @@ namespace plorth
 
   std::u32string symbol::to_source() const
   {
-    return m_id;
+    return m_atom.name();
   }
 
-  std::shared_ptr<class symbol> runtime::symbol(
+  ref<class symbol> runtime::symbol(
     const std::u32string& id,
     const std::optional<parser::position>& position
   )
   {
 #if PLORTH_ENABLE_SYMBOL_CACHE
-    const auto entry = m_symbol_cache.find(id);
+    const class atom key(id);
+# if PLORTH_ENABLE_MUTEXES
+    std::lock_guard<std::mutex> lock(m_symbol_cache_mutex);
+# endif
+    const auto entry = m_symbol_cache.find(key);
 
     if (entry == std::end(m_symbol_cache))
     {
-      const auto reference = std::shared_ptr<class symbol>(
-        new (*m_memory_manager) class symbol(id)
+      const auto reference = ref<class symbol>(
+        new (*m_memory_manager) class symbol(key)
       );
 
-      m_symbol_cache[id] = reference;
+      m_symbol_cache[key] = reference;
 
       return reference;
     }
 
     return entry->second;
 #else
-    return std::shared_ptr<class symbol>(
+    return ref<class symbol>(
       new (*m_memory_manager) class symbol(id, position)
     );
 #endif
@@ -117,27 +140,21 @@ namespace plorth
    * Position is returnedd as object with `filename`, `line` and `column`
    * properties.
    */
-  static void w_position(const std::shared_ptr<context>& ctx)
+  static void w_position(const ref<context>& ctx, const symbol& sym)
   {
-    std::shared_ptr<value> sym;
+    const auto position = sym.position();
 
-    if (ctx->pop(sym, value::type::symbol))
+    if (position)
     {
-      const auto position = std::static_pointer_cast<symbol>(sym)->position();
+      const auto& runtime = ctx->runtime();
 
-      ctx->push(sym);
-      if (position)
-      {
-        const auto& runtime = ctx->runtime();
-
-        ctx->push_object({
-          { U"filename", runtime->string(position->file) },
-          { U"line", runtime->number(number::int_type(position->line)) },
-          { U"column", runtime->number(number::int_type(position->column)) }
-        });
-      } else {
-        ctx->push_null();
-      }
+      ctx->push_object({
+        { U"filename", runtime->string(position->filename()) },
+        { U"line", runtime->number(number::int_type(position->line)) },
+        { U"column", runtime->number(number::int_type(position->column)) }
+      });
+    } else {
+      ctx->push_null();
     }
   }
 
@@ -153,9 +170,9 @@ namespace plorth
    * symbol does not resolve into any kind of word or value, number conversion
    * is attempted on it. If that also fails, reference error will be thrown.
    */
-  static void w_call(const std::shared_ptr<context>& ctx)
+  static void w_call(const ref<context>& ctx)
   {
-    std::shared_ptr<symbol> sym;
+    ref<symbol> sym;
 
     if (ctx->pop_symbol(sym))
     {
@@ -169,7 +186,7 @@ namespace plorth
     {
       return
       {
-        { U"position", w_position },
+        { U"position", native::thunk<w_position> },
         { U"call", w_call }
       };
     }
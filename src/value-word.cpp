@@ -24,28 +24,36 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <plorth/context.hpp>
+#include <plorth/native.hpp>
 #include <plorth/value-word.hpp>
 
+#include "./utils.hpp"
+
 namespace plorth
 {
-  word::word(const std::shared_ptr<class symbol>& symbol,
-             const std::shared_ptr<class quote>& quote)
+  word::word(const ref<class symbol>& symbol,
+             const ref<class quote>& quote)
     : m_symbol(symbol)
     , m_quote(quote) {}
 
-  bool word::equals(const std::shared_ptr<value>& that) const
+  bool word::equals(const ref<value>& that) const
   {
-    std::shared_ptr<word> w;
+    ref<word> w;
 
     if (!is(that, type::word))
     {
       return false;
     }
-    w = std::static_pointer_cast<word>(that);
+    w = ref_cast<word>(that);
 
     return m_symbol->equals(w->m_symbol) && m_quote->equals(w->m_quote);
   }
 
+  std::size_t word::hash() const
+  {
+    return hash_combine(m_symbol->hash(), m_quote->hash());
+  }
+
   std::u32string word::to_string() const
   {
     return to_source();
@@ -56,17 +64,17 @@ namespace plorth
     return U": " + m_symbol->id() + U" " + m_quote->to_string() + U" ;";
   }
 
-  std::shared_ptr<word> runtime::word(
+  ref<word> runtime::word(
     const std::u32string& id,
-    const std::shared_ptr<class quote>& quote
+    const ref<class quote>& quote
   )
   {
     return word(symbol(id), quote);
   }
 
-  std::shared_ptr<word> runtime::word(
-    const std::shared_ptr<class symbol>& symbol,
-    const std::shared_ptr<class quote>& quote
+  ref<word> runtime::word(
+    const ref<class symbol>& symbol,
+    const ref<class quote>& quote
   )
   {
     return value<class word>(symbol, quote);
@@ -85,15 +93,9 @@ namespace plorth
    *
    * Extracts symbol from the word and places it onto top of the stack.
    */
-  static void w_symbol(const std::shared_ptr<context>& ctx)
+  static void w_symbol(const ref<context>& ctx, const word& wrd)
   {
-    std::shared_ptr<word> wrd;
-
-    if (ctx->pop_word(wrd))
-    {
-      ctx->push(wrd);
-      ctx->push(wrd->symbol());
-    }
+    ctx->push(wrd.symbol());
   }
 
   /**
@@ -110,15 +112,9 @@ namespace plorth
    * Extracts quote which acts as the body of the word and places it onto top
    * of the stack.
    */
-  static void w_quote(const std::shared_ptr<context>& ctx)
+  static void w_quote(const ref<context>& ctx, const word& wrd)
   {
-    std::shared_ptr<word> wrd;
-
-    if (ctx->pop_word(wrd))
-    {
-      ctx->push(wrd);
-      ctx->push(wrd->quote());
-    }
+    ctx->push(wrd.quote());
   }
 
   /**
@@ -130,9 +126,9 @@ namespace plorth
    *
    * Executes body of the given word.
    */
-  static void w_call(const std::shared_ptr<context>& ctx)
+  static void w_call(const ref<context>& ctx)
   {
-    std::shared_ptr<word> wrd;
+    ref<word> wrd;
 
     if (ctx->pop_word(wrd))
     {
@@ -149,9 +145,9 @@ namespace plorth
    *
    * Inserts given word into current local dictionary.
    */
-  void w_define(const std::shared_ptr<context>& ctx)
+  void w_define(const ref<context>& ctx)
   {
-    std::shared_ptr<word> wrd;
+    ref<word> wrd;
 
     if (ctx->pop_word(wrd))
     {
@@ -165,8 +161,8 @@ namespace plorth
     {
       return
       {
-        { U"symbol", w_symbol },
-        { U"quote", w_quote },
+        { U"symbol", native::thunk<w_symbol> },
+        { U"quote", native::thunk<w_quote> },
 
         { U"call", w_call },
         { U"define", w_define }
@@ -69,13 +69,16 @@ namespace plorth
 
     case type::error:
       return U"error";
+
+    case type::seq:
+      return U"seq";
     }
 
     return U"unknown";
   }
 
-  std::shared_ptr<object> value::prototype(
-    const std::shared_ptr<class runtime>& runtime
+  ref<object> value::prototype(
+    const ref<class runtime>& runtime
   ) const
   {
     switch (type())
@@ -107,17 +110,22 @@ namespace plorth
     case type::error:
       return runtime->error_prototype();
 
+    case type::seq:
+      return runtime->seq_prototype();
+
     case type::object:
       {
-        std::shared_ptr<value> slot;
+        static const object::key_type prototype_key = U"__proto__";
+        ref<value> slot;
 
-        if (static_cast<const object*>(this)->own_property(U"__proto__", slot))
+        if (static_cast<const object*>(this)->own_property(prototype_key,
+                                                           slot))
         {
           if (is(slot, type::object))
           {
-            return std::static_pointer_cast<object>(slot);
+            return ref_cast<object>(slot);
           } else {
-            return std::shared_ptr<object>();
+            return ref<object>();
           }
         }
 
@@ -126,17 +134,17 @@ namespace plorth
       break;
     }
 
-    return std::shared_ptr<object>(); // Just to make GCC happy.
+    return ref<object>(); // Just to make GCC happy.
   }
 
-  bool operator==(const std::shared_ptr<value>& a,
-                  const std::shared_ptr<value>& b)
+  bool operator==(const ref<value>& a,
+                  const ref<value>& b)
   {
     return a ? b && a->equals(b) : !b;
   }
 
-  bool operator!=(const std::shared_ptr<value>& a,
-                  const std::shared_ptr<value>& b)
+  bool operator!=(const ref<value>& a,
+                  const ref<value>& b)
   {
     return a ? !b || !a->equals(b) : !!b;
   }
@@ -0,0 +1,110 @@
+#include <plorth/plorth.hpp>
+
+#include <cassert>
+
+static void test_atom_interning()
+{
+  const plorth::atom a(U"test-atom-interning");
+  const plorth::atom b(std::u32string(U"test-atom-interning"));
+  const plorth::atom c(U"test-atom-interning-other");
+
+  assert(a == b);
+  assert(a.id() == b.id());
+  assert(a != c);
+  assert(a.name() == U"test-atom-interning");
+}
+
+static void test_atom_find()
+{
+  plorth::atom slot;
+
+  assert(!plorth::atom::find(U"test-atom-find", slot));
+  assert(slot == plorth::atom());
+
+  const plorth::atom a(U"test-atom-find");
+
+  assert(plorth::atom::find(U"test-atom-find", slot));
+  assert(slot == a);
+}
+
+static void test_atom_symbol()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto a = runtime->symbol(U"test-atom-symbol");
+  const auto b = runtime->symbol(U"test-atom-symbol");
+
+  assert(a->atom() == b->atom());
+  assert(a->hash() == b->hash());
+  assert(a->equals(b));
+}
+
+static void test_atom_release()
+{
+  plorth::atom slot;
+  plorth::atom::id_type id;
+
+  {
+    const plorth::atom a(U"test-atom-release");
+    const plorth::atom b(a);
+
+    id = a.id();
+  }
+  assert(!plorth::atom::find(U"test-atom-release", slot));
+
+  // ID of the removed atom is given to the next new identifier.
+  const plorth::atom c(U"test-atom-release-other");
+
+  assert(c.id() == id);
+  assert(plorth::atom::from_id(id).name() == U"test-atom-release-other");
+}
+
+static void test_atom_persistent()
+{
+  plorth::atom slot;
+  plorth::atom::id_type id;
+
+  id = plorth::atom::persistent(U"test-atom-persistent").id();
+  {
+    const plorth::atom a(U"test-atom-persistent-existing");
+
+    plorth::atom::persistent(U"test-atom-persistent-existing");
+  }
+
+  assert(plorth::atom::find(U"test-atom-persistent", slot));
+  assert(slot.id() == id);
+  assert(plorth::atom::from_id(id).name() == U"test-atom-persistent");
+  assert(plorth::atom::find(U"test-atom-persistent-existing", slot));
+}
+
+static void test_atom_property_name()
+{
+  plorth::memory::manager memory_manager;
+  plorth::atom slot;
+
+  {
+    const auto runtime = plorth::runtime::make(memory_manager);
+    const auto context = plorth::context::make(runtime);
+
+    // Property name is built at run time, so only the object and the shapes
+    // of the runtime refer to it.
+    assert(context->compile(
+      U"1 \"test-atom-\" \"property-name\" + {} !"
+    )->call(context));
+    assert(plorth::atom::find(U"test-atom-property-name", slot));
+    slot = plorth::atom();
+  }
+  assert(!plorth::atom::find(U"test-atom-property-name", slot));
+}
+
+int main(int argc, char** argv)
+{
+  test_atom_interning();
+  test_atom_find();
+  test_atom_symbol();
+  test_atom_release();
+  test_atom_persistent();
+  test_atom_property_name();
+
+  return EXIT_SUCCESS;
+}
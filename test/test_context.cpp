@@ -1,4 +1,5 @@
 #include <plorth/plorth.hpp>
+#include <plorth/native.hpp>
 
 #include <cassert>
 
@@ -26,16 +27,8 @@ static void test_push_boolean()
   assert(context->data().size() == 2);
   assert(plorth::value::is(context->data()[0], plorth::value::type::boolean));
   assert(plorth::value::is(context->data()[1], plorth::value::type::boolean));
-  assert(
-    std::static_pointer_cast<plorth::boolean>(
-      context->data()[0]
-    )->value() == true
-  );
-  assert(
-    std::static_pointer_cast<plorth::boolean>(
-      context->data()[1]
-    )->value() == false
-  );
+  assert(context->data()[0].as_boolean() == true);
+  assert(context->data()[1].as_boolean() == false);
 }
 
 static void test_push_int()
@@ -47,17 +40,12 @@ static void test_push_int()
   context->push_int(47);
 
   assert(context->data().size() == 1);
+  assert(context->data()[0].kind() == plorth::cell::kind::integer);
   assert(plorth::value::is(context->data()[0], plorth::value::type::number));
   assert(
-    std::static_pointer_cast<plorth::number>(
-      context->data()[0]
-    )->number_type() == plorth::number::number_type::integer
-  );
-  assert(
-    std::static_pointer_cast<plorth::number>(
-      context->data()[0]
-    )->as_int() == 47
+    context->data()[0].number_type() == plorth::number::number_type::integer
   );
+  assert(context->data()[0].as_int() == 47);
 }
 
 static void test_push_real()
@@ -71,15 +59,9 @@ static void test_push_real()
   assert(context->data().size() == 1);
   assert(plorth::value::is(context->data()[0], plorth::value::type::number));
   assert(
-    std::static_pointer_cast<plorth::number>(
-      context->data()[0]
-    )->number_type() == plorth::number::number_type::real
-  );
-  assert(
-    std::static_pointer_cast<plorth::number>(
-      context->data()[0]
-    )->as_real() == 47.5
+    context->data()[0].number_type() == plorth::number::number_type::real
   );
+  assert(context->data()[0].as_real() == 47.5);
 }
 
 static void test_push_number()
@@ -95,25 +77,32 @@ static void test_push_number()
   assert(plorth::value::is(context->data()[0], plorth::value::type::number));
   assert(plorth::value::is(context->data()[1], plorth::value::type::number));
   assert(
-    std::static_pointer_cast<plorth::number>(
-      context->data()[0]
-    )->number_type() == plorth::number::number_type::integer
-  );
-  assert(
-    std::static_pointer_cast<plorth::number>(
-      context->data()[1]
-    )->number_type() == plorth::number::number_type::real
+    context->data()[0].number_type() == plorth::number::number_type::integer
   );
   assert(
-    std::static_pointer_cast<plorth::number>(
-      context->data()[0]
-    )->as_int() == 47
-  );
-  assert(
-    std::static_pointer_cast<plorth::number>(
-      context->data()[1]
-    )->as_real() == 47.5
+    context->data()[1].number_type() == plorth::number::number_type::real
   );
+  assert(context->data()[0].as_int() == 47);
+  assert(context->data()[1].as_real() == 47.5);
+}
+
+static void test_pop_immediate()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  plorth::ref<plorth::value> value;
+  plorth::ref<plorth::number> number;
+
+  context->push_real(2.5);
+  context->push_int(1000);
+
+  assert(context->pop_number(number));
+  assert(number->as_int() == 1000);
+  assert(context->pop(value));
+  assert(plorth::value::is(value, plorth::value::type::number));
+  assert(plorth::ref_cast<plorth::number>(value)->as_real() == 2.5);
+  assert(context->empty());
 }
 
 static void test_push_string()
@@ -142,8 +131,8 @@ static void test_push_array()
   assert(context->data().size() == 1);
   assert(plorth::value::is(context->data()[0], plorth::value::type::array));
   assert(
-    std::static_pointer_cast<plorth::array>(
-      context->data()[0]
+    plorth::ref_cast<plorth::array>(
+      context->data()[0].boxed()
     )->size() == 2
   );
 }
@@ -187,8 +176,8 @@ static void test_push_symbol()
 
   assert(context->data().size() == 1);
   assert(plorth::value::is(context->data()[0], plorth::value::type::symbol));
-  assert(std::static_pointer_cast<plorth::symbol>(
-    context->data()[0]
+  assert(plorth::ref_cast<plorth::symbol>(
+    context->data()[0].boxed()
   )->id() == U"foo");
 }
 
@@ -207,6 +196,86 @@ static void test_push_word()
   assert(plorth::value::is(context->data()[0], plorth::value::type::word));
 }
 
+static void test_peek()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const plorth::cell* number;
+  const plorth::string* string;
+
+  context->push_int(5);
+  context->push_string(U"foo");
+
+  assert(context->peek_string(string));
+  assert(string->length() == 3);
+  assert(context->peek_number(number, 1));
+  assert(number->as_int() == 5);
+  assert(!context->peek_number(number));
+  assert(context->error()->code() == plorth::error::code::type);
+  context->clear_error();
+  assert(!context->peek(number, 2));
+  assert(context->error()->code() == plorth::error::code::range);
+  assert(context->size() == 2);
+}
+
+static void test_replace_top()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+
+  context->push_int(1);
+  context->push_int(2);
+  context->push_int(3);
+  context->replace_top(plorth::cell::make_boolean(true));
+
+  assert(context->size() == 3);
+  assert(context->peek().as_boolean());
+
+  context->nip();
+
+  assert(context->size() == 2);
+  assert(context->peek().as_boolean());
+  assert(context->peek(1).as_int() == 1);
+}
+
+static void native_length(const plorth::ref<plorth::context>& ctx,
+                          const plorth::string& str,
+                          plorth::number::int_type offset)
+{
+  ctx->push_int(str.length() + offset);
+}
+
+static void test_native_thunk()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const plorth::quote::callback callback =
+    plorth::native::thunk<native_length>;
+
+  context->push_string(U"foo");
+  callback(context);
+  assert(context->error()->code() == plorth::error::code::range);
+  context->clear_error();
+
+  context->clear();
+  context->push_string(U"foo");
+  context->push_string(U"foo");
+  callback(context);
+  assert(context->error()->code() == plorth::error::code::type);
+  context->clear_error();
+
+  context->clear();
+  context->push_int(2);
+  context->push_string(U"foo");
+  callback(context);
+  assert(!context->error());
+  assert(context->size() == 3);
+  assert(context->peek().as_int() == 5);
+}
+
 int main(int argc, char** argv)
 {
   test_push_null();
@@ -214,6 +283,10 @@ int main(int argc, char** argv)
   test_push_int();
   test_push_real();
   test_push_number();
+  test_pop_immediate();
+  test_peek();
+  test_replace_top();
+  test_native_thunk();
   test_push_string();
   test_push_array();
   test_push_object();
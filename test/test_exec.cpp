@@ -1,6 +1,10 @@
 #include <plorth/plorth.hpp>
 
 #include <cassert>
+#include <utility>
+#if PLORTH_ENABLE_THREADS
+# include <thread>
+#endif
 
 static void test_exec_symbol_current_item_prototype()
 {
@@ -69,6 +73,36 @@ static void test_exec_symbol_with_error()
   assert(context->error()->code() == plorth::error::code::reference);
 }
 
+static void test_exec_symbol_error_position()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(U"1 2\n  this-should-fail", U"test");
+
+  assert(!quote->call(context));
+  assert(!!context->error());
+  assert(!!context->error()->position());
+  assert(context->error()->position()->file == U"test");
+  assert(context->error()->position()->line == 2);
+  assert(context->error()->position()->column == 3);
+}
+
+static void test_exec_stack_word_error_position()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(U"1 drop\n  swap", U"test");
+
+  runtime->execution_engine() = plorth::runtime::execution_engine::bytecode;
+  assert(!quote->call(context));
+  assert(!!context->error());
+  assert(!!context->error()->position());
+  assert(context->error()->position()->line == 2);
+  assert(context->error()->position()->column == 3);
+}
+
 static void test_exec_word()
 {
   plorth::memory::manager memory_manager;
@@ -84,6 +118,907 @@ static void test_exec_word()
   assert(!!context->dictionary().find(U"foo"));
 }
 
+static void test_exec_word_shadowing_literal()
+{
+  const enum plorth::runtime::execution_engine engines[] =
+  {
+    plorth::runtime::execution_engine::interpreter,
+    plorth::runtime::execution_engine::bytecode
+  };
+
+  for (const auto engine : engines)
+  {
+    plorth::memory::manager memory_manager;
+    const auto runtime = plorth::runtime::make(memory_manager);
+    const auto context = plorth::context::make(runtime);
+    const auto literals = context->compile(U"1 true");
+    const auto definitions = context->compile(U": 1 2 ; : true false ;");
+    const auto property = context->compile(
+      U"{\"__proto__\": {\"2\": 7}} 2 nip"
+    );
+
+    runtime->execution_engine() = engine;
+    assert(!!literals);
+    assert(!!definitions);
+    assert(!!property);
+
+    assert(literals->call(context));
+    assert(context->size() == 2);
+    assert(context->data()[0].as_int() == 1);
+    assert(context->data()[1].as_boolean());
+    context->clear();
+
+    // Literals are shadowed by words defined after they were compiled.
+    assert(definitions->call(context));
+    assert(literals->call(context));
+    assert(context->size() == 2);
+    assert(context->data()[0].as_int() == 2);
+    assert(!context->data()[1].as_boolean());
+    context->clear();
+
+    // Literals are also shadowed by properties of prototypes.
+    assert(property->call(context));
+    assert(context->size() == 1);
+    assert(context->data()[0].as_int() == 7);
+  }
+}
+
+static void test_exec_compiled_literals()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(U"1 2.5 true null");
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->size() == 4);
+  assert(context->data()[0].as_int() == 1);
+  assert(context->data()[1].as_real() == 2.5);
+  assert(context->data()[2].as_boolean());
+  assert(plorth::value::is(context->data()[3], plorth::value::type::null));
+}
+
+static void test_exec_engines()
+{
+  static const char32_t* sources[] =
+  {
+    U"1 2 3 rot tuck over nip swap 2dup 2drop dup drop",
+    U"true (1) (2) if-else false (3) if (4 5 +) call",
+    U": dup 5 ; 1 dup",
+    U"{\"a\": [1, 2.5, null]} [1, 2, 3] 5 [drop]",
+    U"0 (dup 10 <) (1 +) while",
+    U": if drop 9 ; true (1) if",
+    U": len length ; \"abc\" len [1, 2] len {\"__proto__\": {\"length\": 5}} "
+    U"len {\"__proto__\": {\"length\": 6}} len {\"__proto__\": "
+    U"{\"length\": 7}} len \"de\" len [] len",
+    U"{\"__proto__\": {\"dup\": (7)}} dup {} dup",
+    U": f 1 ; : g f ; g : f 2 ; g : dup 3 ; g dup"
+  };
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+
+  for (const auto source : sources)
+  {
+    const auto interpreter = plorth::context::make(runtime);
+    const auto bytecode = plorth::context::make(runtime);
+
+    runtime->execution_engine() =
+      plorth::runtime::execution_engine::interpreter;
+    assert(interpreter->compile(source)->call(interpreter));
+    runtime->execution_engine() = plorth::runtime::execution_engine::bytecode;
+    assert(bytecode->compile(source)->call(bytecode));
+    assert(interpreter->size() == bytecode->size());
+    for (std::size_t i = 0; i < interpreter->size(); ++i)
+    {
+      assert(interpreter->data()[i].equals(bytecode->data()[i]));
+    }
+  }
+}
+
+static void test_exec_string_rope()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"\"\" (\"abc\" +) 2000 times 2000 \"abc\" *"
+  );
+  plorth::ref<plorth::string> repeated;
+  plorth::ref<plorth::string> appended;
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->pop_string(repeated));
+  assert(context->pop_string(appended));
+  assert(repeated->length() == 6000);
+  assert(appended->length() == 6000);
+  assert(appended->depth() < 48);
+  assert(repeated->at(5999) == U'c');
+  assert(appended->at(4000) == U'b');
+  assert(repeated->equals(appended));
+  assert(repeated->to_string() == appended->to_string());
+}
+
+static void test_exec_array_vector()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"[] (1 swap push) 2000 times dup 7 1500 rot ! dup 8 2000 rot !"
+  );
+  plorth::ref<plorth::array> appended;
+  plorth::ref<plorth::array> updated;
+  plorth::ref<plorth::array> original;
+  const auto number = [&runtime](plorth::number::int_type value)
+  {
+    return runtime->number(value);
+  };
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->pop_array(appended));
+  assert(context->pop_array(updated));
+  assert(context->pop_array(original));
+  assert(original->size() == 2000);
+  assert(updated->size() == 2000);
+  assert(appended->size() == 2001);
+  assert(original->at(1500)->equals(number(1)));
+  assert(updated->at(1500)->equals(number(7)));
+  assert(updated->at(1499)->equals(original->at(1499)));
+  assert(appended->at(2000)->equals(number(8)));
+}
+
+static void test_exec_object_trie()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"{} 0 (swap over dup >string rot ! swap 1 +) 2000 times drop "
+    U"dup \"1500\" swap delete dup 7 \"1499\" rot !"
+  );
+  plorth::ref<plorth::object> updated;
+  plorth::ref<plorth::object> deleted;
+  plorth::ref<plorth::object> original;
+  plorth::ref<plorth::value> slot;
+  std::size_t count = 0;
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->pop_object(updated));
+  assert(context->pop_object(deleted));
+  assert(context->pop_object(original));
+  assert(original->size() == 2000);
+  assert(deleted->size() == 1999);
+  assert(updated->size() == 1999);
+  assert(original->has_own_property(U"1500"));
+  assert(!deleted->has_own_property(U"1500"));
+  assert(updated->own_property(U"1499", slot));
+  assert(slot->equals(runtime->number(plorth::number::int_type(7))));
+  assert(deleted->own_property(U"1499", slot));
+  assert(slot->equals(runtime->number(plorth::number::int_type(1499))));
+  assert(updated->for_each([&count](const plorth::object::key_type&,
+                                    const plorth::object::mapped_type&)
+  {
+    ++count;
+  }));
+  assert(count == 1999);
+  assert(!original->equals(deleted));
+  assert(original->equals(runtime->object(original->entries())));
+}
+
+static void test_exec_object_shape()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"{\"b\": 1, \"a\": 2} dup 3 \"c\" rot ! dup \"b\" swap delete "
+    U"over 0 (swap over dup >string rot ! swap 1 +) 20 times drop"
+  );
+  plorth::ref<plorth::object> large;
+  plorth::ref<plorth::object> deleted;
+  plorth::ref<plorth::object> extended;
+  plorth::ref<plorth::object> original;
+  plorth::ref<plorth::value> slot;
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->pop_object(large));
+  assert(context->pop_object(deleted));
+  assert(context->pop_object(extended));
+  assert(context->pop_object(original));
+
+  const auto keys = extended->keys();
+
+  assert(keys.size() == 3);
+  assert(keys[0] == U"b" && keys[1] == U"a" && keys[2] == U"c");
+  assert(original->size() == 2);
+  assert(!original->has_own_property(U"c"));
+  assert(deleted->size() == 2);
+  assert(!deleted->has_own_property(U"b"));
+  assert(deleted->own_property(U"c", slot));
+  assert(large->size() == 23);
+  assert(large->own_property(U"b", slot));
+  assert(large->own_property(U"19", slot));
+  assert(extended->equals(runtime->object(extended->entries())));
+
+  // Deleting missing property consumes the name but keeps the object.
+  assert(context->size() == 0);
+  assert(!context->compile(U"{\"a\": 1} \"b\" swap delete")->call(context));
+  assert(context->error()->code() == plorth::error::code::range);
+  assert(context->size() == 1);
+  assert(context->pop_object(original));
+  assert(original->size() == 1);
+}
+
+static void test_exec_chunks()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"[] (1 swap push) 100 times dup reverse "
+    U"\"\" (\"abcdefghij\" +) 100 times dup reverse"
+  );
+  plorth::ref<plorth::string> reversed_string;
+  plorth::ref<plorth::string> rope;
+  plorth::ref<plorth::array> reversed_array;
+  plorth::ref<plorth::array> vector;
+  std::u32string contents;
+  plorth::array::size_type elements = 0;
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->pop_string(reversed_string));
+  assert(context->pop_string(rope));
+  assert(context->pop_array(reversed_array));
+  assert(context->pop_array(vector));
+
+  for (const auto& str : { rope, reversed_string })
+  {
+    contents.clear();
+    assert(str->for_each_chunk([&contents](const char32_t* data,
+                                           plorth::string::size_type size)
+    {
+      assert(size > 0);
+      contents.append(data, size);
+
+      return true;
+    }));
+    assert(contents == str->to_string());
+  }
+
+  for (const auto& ary : { vector, reversed_array })
+  {
+    elements = 0;
+    assert(ary->for_each_chunk([&elements](plorth::array::const_pointer,
+                                           plorth::array::size_type size)
+    {
+      assert(size > 0);
+      elements += size;
+
+      return true;
+    }));
+    assert(elements == 100);
+  }
+  assert(vector->equals(reversed_array));
+}
+
+static void test_exec_string_width()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"\"ab\u03a9c\" 60 \"d\" * + dup \"\u03a9c\" swap index-of "
+    U"swap upper-case"
+  );
+  const std::u32string inputs[] = {
+    U"abc",
+    U"ab\u00e9",
+    U"a\u03a9",
+    U"a\U0001f600"
+  };
+  const std::size_t widths[] = { 1, 1, 2, 4 };
+  plorth::ref<plorth::string> str;
+  plorth::ref<plorth::string> upper;
+  plorth::string::size_type size;
+  std::size_t width;
+  plorth::cell index;
+
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    str = runtime->string(inputs[i]);
+    assert(str->units(0, size, width));
+    assert(size == inputs[i].length());
+    assert(width == widths[i]);
+    assert(str->to_string() == inputs[i]);
+    assert(str->at(1) == inputs[i][1]);
+  }
+
+  assert(runtime->decode_string("h\xc3\xa9llo \xce\xa9", 9, str));
+  assert(str->to_string() == U"h\u00e9llo \u03a9");
+  assert(str->units(0, size, width) && width == 2);
+  assert(str->equals(runtime->string(U"h\u00e9llo \u03a9")));
+  assert(!str->equals(runtime->string(U"h\u00e9llo \u03a8")));
+  assert(!runtime->decode_string("\xc3", 1, str));
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->pop_string(upper));
+  assert(context->pop_number(index));
+  assert(index.as_int() == 2);
+  assert(upper->length() == 64);
+  assert(upper->to_string().substr(0, 6) == U"AB\u03a9CDD");
+}
+
+static void test_exec_array_sort()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"[] 1 (75 * 74 + 65537 % dup rot push swap) 2000 times drop sort "
+    U"[3, 1.5, -2, 1] sort "
+    U"[\"b\", \"\u03a9\", \"ab\", \"\", \"\u00e9\"] sort "
+    U"(2 %) [1, 2, 3, 4] sort-by "
+    U"(>) [1, 4, 2, 3] sort-with "
+    U"[1, 3, 3, 5] 3 swap binary-search swap drop "
+    U"[1, 3, 3, 5] 4 swap binary-search swap drop"
+  );
+  const auto failing = context->compile(U"(drop \"x\") [1, 2] sort-with");
+  const auto failing_sort = context->compile(U"[1, \"a\", 2] sort");
+  const auto failing_search = context->compile(
+    U"\"b\" [1, 2, 3] binary-search"
+  );
+  plorth::ref<plorth::array> numbers;
+  plorth::ref<plorth::array> mixed;
+  plorth::ref<plorth::array> strings;
+  plorth::ref<plorth::array> by_key;
+  plorth::ref<plorth::array> with_comparator;
+  plorth::ref<plorth::value> missing;
+  plorth::cell found;
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->pop(missing));
+  assert(!missing);
+  assert(context->pop_number(found));
+  assert(found.as_int() == 1);
+  assert(context->pop_array(with_comparator));
+  assert(with_comparator->to_string() == U"4, 3, 2, 1");
+  assert(context->pop_array(by_key));
+  assert(by_key->to_string() == U"2, 4, 1, 3");
+  assert(context->pop_array(strings));
+  assert(strings->to_string() == U", ab, b, \u00e9, \u03a9");
+  assert(context->pop_array(mixed));
+  assert(mixed->to_string() == U"-2, 1, 1.5, 3");
+  assert(context->pop_array(numbers));
+  assert(numbers->size() == 2000);
+  for (plorth::array::size_type i = 1; i < numbers->size(); ++i)
+  {
+    assert(plorth::ref_cast<plorth::number>(numbers->at(i - 1))->as_int()
+           <= plorth::ref_cast<plorth::number>(numbers->at(i))->as_int());
+  }
+
+  // Arguments are left on the stack as they were when comparison fails.
+  assert(!!failing);
+  assert(!failing->call(context));
+  assert(context->error());
+  assert(context->error()->code() == plorth::error::code::type);
+  assert(context->size() == 2);
+  assert(context->data()[0].is(plorth::value::type::quote));
+  assert(context->data()[1].to_string() == U"1, 2");
+  context->clear();
+  context->clear_error();
+
+  assert(!!failing_sort);
+  assert(!failing_sort->call(context));
+  assert(context->error());
+  assert(context->size() == 1);
+  assert(context->data()[0].to_string() == U"1, a, 2");
+  context->clear();
+  context->clear_error();
+
+  assert(!!failing_search);
+  assert(!failing_search->call(context));
+  assert(context->error());
+  assert(context->size() == 2);
+  assert(context->data()[0].to_string() == U"b");
+  assert(context->data()[1].to_string() == U"1, 2, 3");
+}
+
+static void test_exec_value_hash()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"[1, 2, 1.0, \"a\", \"a\", {\"x\": 1, \"y\": 2}, "
+    U"{\"y\": 2, \"x\": 1}, null, null] uniq "
+    U"[4, 2, 2, 1, 5] [1, 2, 3, 4] & "
+    U"[3, 1] [1, 2, 2] | "
+    U"\"x\u03a9\" 60 \"y\" * +"
+  );
+  const auto one = runtime->number(plorth::number::int_type(1));
+  const plorth::ref<plorth::value> ints[] = { one, runtime->true_value() };
+  const plorth::ref<plorth::value> reals[] = {
+    runtime->number(plorth::number::real_type(1)),
+    runtime->true_value()
+  };
+  plorth::ref<plorth::array> unique;
+  plorth::ref<plorth::array> intersection;
+  plorth::ref<plorth::array> combined;
+  plorth::ref<plorth::string> rope;
+
+  assert(one->hash() == runtime->number(plorth::number::real_type(1))->hash());
+  assert(runtime->array(ints, 2)->hash()
+         == runtime->array(reals, 2)->hash());
+  assert(plorth::value::hash(plorth::ref<plorth::value>()) == 0);
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->pop_string(rope));
+  assert(rope->hash()
+         == runtime->string(U"x\u03a9" + std::u32string(60, U'y'))->hash());
+  assert(context->pop_array(combined));
+  assert(context->pop_array(intersection));
+  assert(context->pop_array(unique));
+  assert(unique->size() == 5);
+  assert(unique->at(0)->equals(one));
+  assert(!unique->at(4));
+  assert(intersection->size() == 3);
+  assert(intersection->at(0)->equals(
+    runtime->number(plorth::number::int_type(4))
+  ));
+  assert(combined->size() == 3);
+  assert(combined->at(0)->equals(
+    runtime->number(plorth::number::int_type(3))
+  ));
+}
+
+static void test_exec_numeric_array()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"[1, 2, 3, 4, 5, 6, 7, 8, 9, 10] >int64-array "
+    U"element-type swap "
+    U"dup .+ "
+    U"dup sum swap "
+    U"2 swap .* >generic-array "
+    U"[0.5, 1.5, 2.5] >float64-array dup max swap mean "
+    U"[1, 2, 3] [4, 5, 6] dot "
+    U"3 [1, 2, 3, 4] .< "
+    U"[9223372036854775807, -9223372036854775807] >int64-array dup .+ "
+    U"element-type "
+    U"swap drop"
+  );
+  const auto failing = context->compile(U"[1, 2] [1, 2, 3] .+");
+  plorth::ref<plorth::string> overflowed;
+  plorth::ref<plorth::array> less;
+  plorth::ref<plorth::array> doubled;
+  plorth::ref<plorth::string> type;
+  plorth::cell dot;
+  plorth::cell mean;
+  plorth::cell max;
+  plorth::cell sum;
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->pop_string(overflowed));
+  assert(overflowed->to_string() == U"float64");
+  assert(context->pop_array(less));
+  assert(less->to_string() == U"false, false, false, true");
+  assert(context->pop_number(dot));
+  assert(dot.as_int() == 32);
+  assert(context->pop_number(mean));
+  assert(mean.as_real() == 1.5);
+  assert(context->pop_number(max));
+  assert(max.as_real() == 2.5);
+  assert(context->pop_array(doubled));
+  assert(doubled->element_type() == plorth::array::element_type::any);
+  assert(doubled->to_string() == U"4, 8, 12, 16, 20, 24, 28, 32, 36, 40");
+  assert(context->pop_number(sum));
+  assert(sum.as_int() == 110);
+  assert(context->pop_string(type));
+  assert(type->to_string() == U"int64");
+
+  assert(!!failing);
+  assert(!failing->call(context));
+  assert(context->error()->code() == plorth::error::code::range);
+}
+
+static void test_exec_numeric_array_overflow()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"[9223372036854775807, 5] >int64-array [1, 7] >int64-array .+ "
+    U"9223372036854775807 1 + "
+    U"[4611686018427387904, 3] >int64-array [4, 2] >int64-array .* "
+    U"2 [1, 2, 3] >int64-array .< "
+    U"70 0 100 range >array >int64-array @ nip "
+    U"[9223372036854775807, 1, -1] sum "
+    U"[9223372036854775807, -1, 1] sum "
+    U"[1, 0, 0, 0, 9223372036854775807, 0, 0, 0, -1] sum"
+  );
+  const auto overflowing = context->compile(
+    U"[9223372036854775807, 9223372036854775807] sum"
+  );
+  const auto fractional = context->compile(U"[1, 1.5] >int64-array");
+  plorth::ref<plorth::array> wrapped;
+  plorth::ref<plorth::array> mixed;
+  plorth::ref<plorth::array> less;
+  plorth::cell scalar;
+  plorth::cell element;
+  plorth::cell sum;
+
+  assert(!!quote);
+  assert(quote->call(context));
+  // Sum is exact regardless of order of the elements.
+  for (int i = 0; i < 3; ++i)
+  {
+    assert(context->pop_number(sum));
+    assert(sum.is(plorth::number::number_type::integer));
+    assert(sum.as_int() == 9223372036854775807);
+  }
+  assert(context->pop_number(element));
+  assert(element.as_int() == 70);
+  assert(context->pop_array(less));
+  assert(less->to_string() == U"false, false, true");
+  assert(context->pop_array(mixed));
+  assert(mixed->element_type() == plorth::array::element_type::any);
+  assert(plorth::value::is(mixed->at(0), plorth::value::type::number));
+  assert(static_cast<const plorth::number*>(mixed->at(0).get())->is(
+    plorth::number::number_type::real
+  ));
+  assert(static_cast<const plorth::number*>(mixed->at(1).get())->as_int() == 6);
+  assert(context->pop_number(scalar));
+  assert(context->pop_array(wrapped));
+  assert(wrapped->element_type() == plorth::array::element_type::int64);
+  assert(scalar.is(plorth::number::number_type::integer));
+  assert(
+    static_cast<const plorth::number*>(wrapped->at(0).get())->as_int()
+    == scalar.as_int()
+  );
+  assert(wrapped->to_string() == U"-9223372036854775808, 12");
+  assert(context->size() == 0);
+
+  assert(!!fractional);
+  assert(!fractional->call(context));
+  assert(context->error()->code() == plorth::error::code::value);
+  context->clear();
+  context->clear_error();
+
+  // Sum which does not fit into an integer is an error.
+  assert(!!overflowing);
+  assert(!overflowing->call(context));
+  assert(context->error()->code() == plorth::error::code::range);
+}
+
+namespace
+{
+  class string_input : public plorth::io::input
+  {
+  public:
+    explicit string_input(const std::u32string& source)
+      : m_source(source)
+      , m_offset(0) {}
+
+    result read(size_type size, std::u32string& output, size_type& read)
+    {
+      read = 0;
+      while (m_offset < m_source.length() && (!size || read < size))
+      {
+        output.append(1, m_source[m_offset++]);
+        ++read;
+      }
+
+      return read ? result::ok : result::eof;
+    }
+
+  private:
+    const std::u32string m_source;
+    std::size_t m_offset;
+  };
+}
+
+static void test_exec_seq()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(
+    memory_manager,
+    plorth::ref<plorth::io::input>(
+      new (memory_manager) string_input(U"first\nsecond\n\nlast")
+    )
+  );
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"(dup *) (2 % 0 =) 0 iota filter map 3 swap take >array "
+    U"(+) 1 11 range reduce "
+    U"0 (+) 1 4 range for-each "
+    U"2 [1, 2, 3, 4] >seq drop dup >array swap >array "
+    U"\"abc\" >seq >array "
+    U"(length nip) lines map 3 swap take >array "
+    U"lines >array "
+    U"2.0 4 range >array"
+  );
+  const auto failing = context->compile(U"(+) [] >seq reduce");
+  const auto failing_bounds = {
+    std::make_pair(U"0.5 3 range", plorth::error::code::value),
+    std::make_pair(U"0 2.5 range", plorth::error::code::value),
+    std::make_pair(U"0 1e30 range", plorth::error::code::range),
+    std::make_pair(U"0.5 iota", plorth::error::code::value),
+    std::make_pair(U"-1e30 iota", plorth::error::code::range)
+  };
+  plorth::ref<plorth::array> integral;
+  plorth::ref<plorth::array> rest;
+  plorth::ref<plorth::array> lengths;
+  plorth::ref<plorth::array> chars;
+  plorth::ref<plorth::array> second;
+  plorth::ref<plorth::array> first;
+  plorth::ref<plorth::array> squares;
+  plorth::cell each;
+  plorth::cell sum;
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->pop_array(integral));
+  assert(integral->to_string() == U"2, 3");
+  assert(context->pop_array(rest));
+  assert(rest->to_string() == U"last");
+  assert(context->pop_array(lengths));
+  assert(lengths->to_string() == U"5, 6, 0");
+  assert(context->pop_array(chars));
+  assert(chars->to_string() == U"a, b, c");
+  assert(context->pop_array(second));
+  assert(context->pop_array(first));
+  assert(first->to_string() == U"3, 4");
+  assert(second->to_string() == U"3, 4");
+  assert(context->pop_number(each));
+  assert(each.as_int() == 6);
+  assert(context->pop_number(sum));
+  assert(sum.as_int() == 55);
+  assert(context->pop_array(squares));
+  assert(squares->to_string() == U"0, 4, 16");
+  assert(context->size() == 0);
+
+  assert(!!failing);
+  assert(!failing->call(context));
+  assert(context->error()->code() == plorth::error::code::range);
+
+  // Bounds of ranges must be integers.
+  for (const auto& bounds : failing_bounds)
+  {
+    const auto bounded = context->compile(bounds.first);
+
+    context->clear();
+    context->clear_error();
+    assert(!!bounded);
+    assert(!bounded->call(context));
+    assert(context->error()->code() == bounds.second);
+  }
+}
+
+static void test_exec_parallel()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U"(dup *) 0 1000 range >array pmap (+) swap preduce "
+    U"(3 % 0 =) 0 1000 range >array pfilter length nip "
+    U"(>string) 0 300 range >array pmap dup "
+    U"(+) swap preduce swap (+) swap reduce = "
+    U"(1 +) [] pmap"
+  );
+  const auto failing = context->compile(
+    U"(dup 700 < (1 +) ([] @) if-else) 0 1000 range >array pmap"
+  );
+  const auto filter_failing = context->compile(
+    U"(dup 500 < (drop true) if) 0 1000 range >array pfilter"
+  );
+  const auto isolated = context->compile(
+    U"(: foo 1 ; dup) [1, 2, 3] pmap drop "
+    U"(: bar 1 ; dup true) [1, 2, 3] pfilter drop "
+    U"(: baz 1 ; dup +) [1, 2, 3] preduce drop "
+    U"1 2 3"
+  );
+  plorth::ref<plorth::array> empty;
+  bool ordered;
+  plorth::cell multiples;
+  plorth::cell squares;
+
+  // Force use of worker threads even on single core machines.
+  runtime->concurrency(4);
+
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->pop_array(empty));
+  assert(empty->size() == 0);
+  assert(context->pop_boolean(ordered));
+  assert(ordered);
+  assert(context->pop_number(multiples));
+  assert(multiples.as_int() == 334);
+  assert(context->pop_number(squares));
+  assert(squares.as_int() == 332833500);
+  assert(context->size() == 0);
+
+  assert(!!failing);
+  assert(!failing->call(context));
+  assert(context->error()->code() == plorth::error::code::range);
+  context->clear();
+  context->clear_error();
+
+  assert(!!filter_failing);
+  assert(!filter_failing->call(context));
+  assert(context->error()->code() == plorth::error::code::type);
+  context->clear();
+  context->clear_error();
+
+  // Quotes are executed only in forked contexts, so neither extra values
+  // nor definitions end up in the calling context.
+  assert(!!isolated);
+  assert(isolated->call(context));
+  assert(context->size() == 3);
+  assert(!context->dictionary().find(U"foo"));
+  assert(!context->dictionary().find(U"bar"));
+  assert(!context->dictionary().find(U"baz"));
+}
+
+static void test_exec_frozen_runtime()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto setup = plorth::context::make(runtime);
+  const auto definition = setup->compile(U": square dup * ;");
+  plorth::ref<plorth::word> square;
+
+  assert(!!definition);
+  assert(definition->call(setup));
+  assert(!!(square = setup->dictionary().find(U"square")));
+  assert(runtime->dictionary().insert(square));
+
+  runtime->freeze();
+  assert(runtime->frozen());
+  assert(!runtime->dictionary().insert(square));
+  assert(!runtime->dictionary().assign(setup->dictionary()));
+  assert(runtime->dictionary().find(U"square") == square);
+  assert(setup->dictionary().assign(runtime->dictionary()));
+  assert(plorth::context::make(runtime)->concurrent());
+
+#if PLORTH_ENABLE_THREADS
+  static const std::size_t thread_count = 4;
+  // Quote which is shared by all of the threads, so that they fill caches
+  // of the same call sites.
+  const auto shared = setup->compile(
+    U"(square) swap map (+) swap reduce "
+    U"{\"a\": 1} keys nip length nip + "
+    U"\"abc\" length nip + "
+    U": twice 2 * ; twice"
+  );
+  std::thread threads[thread_count];
+  plorth::number::int_type results[thread_count];
+
+  assert(!!shared);
+  for (std::size_t i = 0; i < thread_count; ++i)
+  {
+    threads[i] = std::thread([&runtime, &shared, &results, i]()
+    {
+      const auto context = plorth::context::make(runtime);
+      plorth::cell result;
+
+      results[i] = 0;
+      for (int j = 0; j < 200; ++j)
+      {
+        context->push_array({
+          runtime->number(plorth::number::int_type(i)),
+          runtime->number(plorth::number::int_type(j))
+        });
+        if (!shared->call(context) || !context->pop_number(result))
+        {
+          return;
+        }
+        results[i] += result.as_int();
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  for (std::size_t i = 0; i < thread_count; ++i)
+  {
+    plorth::number::int_type expected = 0;
+
+    for (int j = 0; j < 200; ++j)
+    {
+      expected += (i * i + j * j + 4) * 2;
+    }
+    assert(results[i] == expected);
+  }
+#endif
+}
+
+static void test_exec_recursive_word()
+{
+  // Memory manager is destroyed last, after the runtime and everything the
+  // call site caches of the recursive word refer to.
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  const auto quote = context->compile(
+    U": fact dup 1 > (dup 1 - fact *) (drop 1) if-else ; 10 fact"
+  );
+
+  runtime->execution_engine() = plorth::runtime::execution_engine::bytecode;
+  assert(!!quote);
+  assert(quote->call(context));
+  assert(context->size() == 1);
+  assert(context->data()[0].as_int() == 3628800);
+}
+
+static void test_exec_prototype_method_cache()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+  auto definition = context->compile(U"{\"foo\": (7), \"bar\": (foo)}");
+  auto call = context->compile(U"bar");
+  plorth::ref<plorth::object> prototype;
+
+  runtime->execution_engine() = plorth::runtime::execution_engine::bytecode;
+  assert(!!definition);
+  assert(!!call);
+  assert(definition->call(context));
+  assert(context->pop_object(prototype));
+  context->push_object({ { U"__proto__", prototype } });
+  assert(call->call(context));
+  assert(context->size() == 2);
+  assert(context->data()[1].as_int() == 7);
+  context->clear();
+
+  // Call sites of the methods must not keep the prototype alive once
+  // nothing else refers to it.
+  definition.reset();
+  call.reset();
+  assert(prototype->ref_count() == 1);
+}
+
+static void test_exec_native_words()
+{
+  plorth::memory::manager memory_manager;
+  const auto runtime = plorth::runtime::make(memory_manager);
+  const auto context = plorth::context::make(runtime);
+
+  assert(context->compile(U"1 2 2dup over typeof")->call(context));
+  assert(context->size() == 6);
+  assert(context->data()[0].as_int() == 1);
+  assert(context->data()[3].as_int() == 2);
+  assert(context->data()[4].as_int() == 1);
+  assert(plorth::value::is(context->data()[5], plorth::value::type::string));
+
+  // Failed type check of a native word leaves its arguments untouched.
+  context->clear();
+  assert(!context->compile(U"1 2 instance-of?")->call(context));
+  assert(context->error()->code() == plorth::error::code::type);
+  assert(context->size() == 2);
+  context->clear_error();
+
+  context->clear();
+  assert(context->compile(U"\"foo bar\\nbaz\" lines nip length nip")->call(
+    context
+  ));
+  assert(context->size() == 1);
+  assert(context->data()[0].as_int() == 2);
+}
+
 static void test_exec_value()
 {
   plorth::memory::manager memory_manager;
@@ -103,7 +1038,28 @@ int main(int argc, char** argv)
   test_exec_symbol_word_from_global_dictionary();
   test_exec_symbol_number();
   test_exec_symbol_with_error();
+  test_exec_symbol_error_position();
+  test_exec_stack_word_error_position();
   test_exec_word();
+  test_exec_word_shadowing_literal();
+  test_exec_compiled_literals();
+  test_exec_engines();
+  test_exec_string_rope();
+  test_exec_array_vector();
+  test_exec_object_trie();
+  test_exec_object_shape();
+  test_exec_chunks();
+  test_exec_string_width();
+  test_exec_array_sort();
+  test_exec_value_hash();
+  test_exec_numeric_array();
+  test_exec_numeric_array_overflow();
+  test_exec_seq();
+  test_exec_parallel();
+  test_exec_frozen_runtime();
+  test_exec_recursive_word();
+  test_exec_prototype_method_cache();
+  test_exec_native_words();
   test_exec_value();
 
   return EXIT_SUCCESS;
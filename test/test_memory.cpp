@@ -0,0 +1,202 @@
+#include <plorth/plorth.hpp>
+
+#include <cassert>
+#if PLORTH_ENABLE_THREADS
+# include <thread>
+#endif
+#include <vector>
+
+namespace
+{
+  class small_object : public plorth::memory::managed
+  {
+  public:
+    explicit small_object(int& counter)
+      : m_counter(counter)
+    {
+      ++m_counter;
+    }
+
+    ~small_object()
+    {
+      --m_counter;
+    }
+
+  private:
+    int& m_counter;
+  };
+
+  class large_object : public small_object
+  {
+  public:
+    explicit large_object(int& counter)
+      : small_object(counter) {}
+
+  private:
+    char m_data[4096];
+  };
+}
+
+#if PLORTH_ENABLE_MEMORY_POOL
+static void test_allocate_reuses_slot()
+{
+  plorth::memory::manager memory_manager;
+  int counter = 0;
+  auto first = new (memory_manager) small_object(counter);
+  void* address = static_cast<void*>(first);
+
+  delete first;
+  assert(counter == 0);
+
+  auto second = new (memory_manager) small_object(counter);
+
+  assert(static_cast<void*>(second) == address);
+  delete second;
+}
+#endif
+
+static void test_allocate_many()
+{
+  plorth::memory::manager memory_manager;
+  std::vector<small_object*> objects;
+  int counter = 0;
+
+  for (int i = 0; i < 50000; ++i)
+  {
+    objects.push_back(new (memory_manager) small_object(counter));
+  }
+  assert(counter == 50000);
+
+  for (std::size_t i = 0; i < objects.size(); i += 2)
+  {
+    delete objects[i];
+  }
+  assert(counter == 25000);
+
+  for (std::size_t i = 1; i < objects.size(); i += 2)
+  {
+    delete objects[i];
+  }
+  assert(counter == 0);
+}
+
+static void test_allocate_large()
+{
+  plorth::memory::manager memory_manager;
+  int counter = 0;
+  auto object = new (memory_manager) large_object(counter);
+
+  assert(counter == 1);
+  delete object;
+  assert(counter == 0);
+}
+
+#if PLORTH_ENABLE_MEMORY_POOL
+static void test_destroy_manager()
+{
+  int counter = 0;
+
+  {
+    plorth::memory::manager memory_manager;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+      new (memory_manager) small_object(counter);
+      new (memory_manager) large_object(counter);
+    }
+    assert(counter == 2000);
+  }
+
+  assert(counter == 0);
+}
+#endif
+
+#if PLORTH_ENABLE_THREADS
+static void test_release_in_other_thread()
+{
+  static const int thread_count = 4;
+  static const int object_count = 10000;
+  plorth::memory::manager memory_manager;
+  std::vector<small_object*> objects[thread_count];
+  std::thread threads[thread_count];
+  int counters[thread_count] = { 0 };
+  int counter = 0;
+
+  for (int i = 0; i < thread_count; ++i)
+  {
+    threads[i] = std::thread([&memory_manager, &objects, &counters, i]()
+    {
+      for (int j = 0; j < object_count; ++j)
+      {
+        objects[i].push_back(new (memory_manager) small_object(counters[i]));
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  // Each thread releases objects allocated by another thread, while
+  // allocating new ones.
+  for (int i = 0; i < thread_count; ++i)
+  {
+    threads[i] = std::thread([&memory_manager, &objects, &counters, i]()
+    {
+      const auto other = (i + 1) % thread_count;
+
+      for (const auto object : objects[other])
+      {
+        delete object;
+        delete new (memory_manager) small_object(counters[other]);
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  for (const auto value : counters)
+  {
+    assert(value == 0);
+  }
+
+  // Thread which has never allocated anything from the memory manager
+  // releases objects, which then have to be reusable by this thread.
+  objects[0].clear();
+  for (int i = 0; i < object_count; ++i)
+  {
+    objects[0].push_back(new (memory_manager) small_object(counter));
+  }
+  std::thread([&objects]()
+  {
+    for (const auto object : objects[0])
+    {
+      delete object;
+    }
+  }).join();
+  assert(counter == 0);
+  for (int i = 0; i < object_count; ++i)
+  {
+    delete new (memory_manager) small_object(counter);
+  }
+  assert(counter == 0);
+}
+#endif
+
+int main(int argc, char** argv)
+{
+#if PLORTH_ENABLE_MEMORY_POOL
+  test_allocate_reuses_slot();
+#endif
+  test_allocate_many();
+  test_allocate_large();
+#if PLORTH_ENABLE_MEMORY_POOL
+  test_destroy_manager();
+#endif
+#if PLORTH_ENABLE_THREADS
+  test_release_in_other_thread();
+#endif
+
+  return EXIT_SUCCESS;
+}